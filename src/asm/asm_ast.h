@@ -1,123 +1,37 @@
 #ifndef ASM_H
 #define ASM_H
 
-#include <memory>
+#include <cstdint>
 #include <vector>
 #include <string>
+#include <stdexcept>
+#include "src/source/symbol.h"
 
 namespace ASM {
 
-class AstNode;
-class ProgramNode;
-class FunctionNode;
-class InstructionNode;
-class NegNode;
-class NotNode;
-class MovNode;
-class MovBNode;
-class RetNode;
-class AllocateStackNode;
-class ImmNode;
-class StackNode;
-class RegisterNode;
-class PseudoNode;
-class AddNode;
-class SubNode;
-class DivNode;
-class MultNode;
-class BitwiseAndNode;
-class BitwiseOrNode;
-class BitwiseXorNode;
-class SarNode;
-class SalNode;
-class CDQNode;
-
-class Visitor {
-public:
-    virtual ~Visitor() = default;
-    virtual void visit(ProgramNode& node) = 0;
-    virtual void visit(FunctionNode& node) = 0;
-    virtual void visit(NegNode& node) = 0;
-    virtual void visit(NotNode& node) = 0;
-    virtual void visit(MovNode& node) = 0;
-    virtual void visit(MovBNode& node) = 0;
-    virtual void visit(RetNode& node) = 0;
-    virtual void visit(AllocateStackNode& node) = 0;
-    virtual void visit(ImmNode& node) = 0;
-    virtual void visit(StackNode& node) = 0;
-    virtual void visit(RegisterNode& node) = 0;
-    virtual void visit(PseudoNode& node) = 0;
-    virtual void visit(AddNode& node) = 0;
-    virtual void visit(SubNode& node) = 0;
-    virtual void visit(MultNode& node) = 0;
-    virtual void visit(DivNode& node) = 0;
-    virtual void visit(CDQNode& node) = 0;
-    virtual void visit(BitwiseAndNode& node) = 0;
-    virtual void visit(BitwiseOrNode& node) = 0;
-    virtual void visit(BitwiseXorNode& node) = 0;
-    virtual void visit(SarNode& node) = 0;
-    virtual void visit(SalNode& node) = 0;
-};
-
-class AstNode {
-public:
-    virtual ~AstNode() = default;
-    virtual void accept(Visitor& v) = 0;
-    AstNode() = default;
-    AstNode(AstNode&& that) = delete;
-    AstNode operator=(AstNode&& that) = delete;
-    AstNode(AstNode& that) = delete;
-    AstNode operator=(AstNode& that) = delete;
-};
-
-class ProgramNode : public AstNode {
-public:
-    ~ProgramNode() = default;
-    void accept(Visitor& v) override {v.visit(*this);}
-    ProgramNode(std::vector<std::shared_ptr<FunctionNode>> functions)
-        : functions_(std::move(functions)) {}
-    std::vector<std::shared_ptr<FunctionNode>> functions_;
-};
-
-class FunctionNode : public AstNode {
-public:
-    ~FunctionNode() = default;
-    FunctionNode(std::string name, std::vector<std::shared_ptr<InstructionNode>> instructions)
-        : name_(name), instructions_(std::move(instructions)) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-    std::string name_;
-    std::vector<std::shared_ptr<InstructionNode>> instructions_;
-};
-
-class InstructionNode : public AstNode {
-public:
-    virtual ~InstructionNode() = default;
-    virtual void accept(Visitor& v) = 0;
-    InstructionNode() = default;
-};
-
-class OperandNode : public AstNode {
-public:
-    virtual ~OperandNode() = default;
-    virtual void accept(Visitor& v) = 0;
-};
-
-class ImmNode : public OperandNode {
-public:
-    ~ImmNode() = default;
-    ImmNode(int val) : val_(val) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-    int val_;
-};
-
-enum Register {
+enum Register : uint8_t {
     AX,
     DX,
     CL,
     R10,
     R10b,
     R11,
-};
+    // only handed out by the register allocator
+    SI,
+    DI,
+    R8,
+    R9,
+    BX,
+    R12,
+    R13,
+    R14,
+    R15,
+};
+
+// the System V ABI wants these preserved across calls
+inline bool is_callee_saved(Register reg) {
+    return reg == Register::BX || (reg >= Register::R12 && reg <= Register::R15);
+}
 
 inline std::string register_as_string(Register reg) {
     switch(reg) {
@@ -133,194 +47,207 @@ inline std::string register_as_string(Register reg) {
             return "R10b";
         case Register::R11:
             return "R11";
+        case Register::SI:
+            return "SI";
+        case Register::DI:
+            return "DI";
+        case Register::R8:
+            return "R8";
+        case Register::R9:
+            return "R9";
+        case Register::BX:
+            return "BX";
+        case Register::R12:
+            return "R12";
+        case Register::R13:
+            return "R13";
+        case Register::R14:
+            return "R14";
+        case Register::R15:
+            return "R15";
         default:
             throw std::runtime_error("Unexpected register type for string conversion");
     }
 }
 
-class RegisterNode : public OperandNode {
-public:
-    ~RegisterNode() = default;
-    RegisterNode(Register reg) : reg_(reg) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-    Register reg_;
-};
-
-class PseudoNode : public OperandNode {
-public:
-    ~PseudoNode() = default;
-    PseudoNode(std::string name) : name_(name) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-    std::string name_;
-};
-
-class StackNode : public OperandNode {
-public:
-    ~StackNode() = default;
-    StackNode(int size) : size_(size) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-    int size_;
-};
-
-class UnaryInstructionNode : public InstructionNode {
-public:
-    virtual ~UnaryInstructionNode() = default;
-    UnaryInstructionNode(std::shared_ptr<OperandNode> src) : src_(src) {}
-    std::shared_ptr<OperandNode> src_;
-};
-
-class NegNode : public UnaryInstructionNode {
-public:
-    ~NegNode() = default;
-    NegNode(std::shared_ptr<OperandNode> src) : UnaryInstructionNode(src) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class NotNode : public UnaryInstructionNode {
-public:
-    ~NotNode() = default;
-    NotNode(std::shared_ptr<OperandNode> src) : UnaryInstructionNode(src) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class BinInstructionNode : public InstructionNode {
-public:
-    std::shared_ptr<OperandNode> left_, right_;
-    BinInstructionNode(
-        std::shared_ptr<OperandNode> left,
-        std::shared_ptr<OperandNode> right)
-            : left_(left), right_(right) {}
-    virtual ~BinInstructionNode() = default;
-    virtual void accept(Visitor& v) = 0;
-};
-
-class AddNode : public BinInstructionNode {
-public:
-    ~AddNode() = default;
-    AddNode(
-        std::shared_ptr<OperandNode> left,
-        std::shared_ptr<OperandNode> right)
-            : BinInstructionNode(left, right) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class SubNode : public BinInstructionNode {
-public:
-    ~SubNode() = default;
-    SubNode(
-        std::shared_ptr<OperandNode> left,
-        std::shared_ptr<OperandNode> right)
-            : BinInstructionNode(left, right) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class DivNode : public InstructionNode {
-public:
-    std::shared_ptr<OperandNode> src_;
-    ~DivNode() = default;
-    DivNode(std::shared_ptr<OperandNode> src) : src_(src) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class MultNode : public BinInstructionNode {
-public:
-    ~MultNode() = default;
-    MultNode(
-        std::shared_ptr<OperandNode> left,
-        std::shared_ptr<OperandNode> right)
-            : BinInstructionNode(left, right) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class BitwiseAndNode : public BinInstructionNode {
-public:
-    ~BitwiseAndNode() = default;
-    BitwiseAndNode(
-        std::shared_ptr<OperandNode> left,
-        std::shared_ptr<OperandNode> right)
-            : BinInstructionNode(left, right) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class BitwiseOrNode : public BinInstructionNode {
-public:
-    ~BitwiseOrNode() = default;
-    BitwiseOrNode(
-        std::shared_ptr<OperandNode> left,
-        std::shared_ptr<OperandNode> right)
-            : BinInstructionNode(left, right) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class BitwiseXorNode : public BinInstructionNode {
-public:
-    ~BitwiseXorNode() = default;
-    BitwiseXorNode(
-        std::shared_ptr<OperandNode> left,
-        std::shared_ptr<OperandNode> right)
-            : BinInstructionNode(left, right) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class SarNode : public BinInstructionNode {
-public:
-    ~SarNode() = default;
-    SarNode(
-        std::shared_ptr<OperandNode> left,
-        std::shared_ptr<OperandNode> right)
-            : BinInstructionNode(left, right) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class SalNode : public BinInstructionNode {
-public:
-    ~SalNode() = default;
-    SalNode(
-        std::shared_ptr<OperandNode> left,
-        std::shared_ptr<OperandNode> right)
-            : BinInstructionNode(left, right) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class CDQNode : public InstructionNode {
-public:
-    ~CDQNode() = default;
-    CDQNode() = default;
-    void accept(Visitor& v) override {v.visit(*this);}
-};
+// Operands are 8 byte values: a kind tag and a 32 bit payload holding the
+// register, the immediate, the rbp relative stack offset, the pseudo id or
+// the label id.
+// Registers are just tags, so using AX or R10 never allocates.
+class Operand {
+public:
+    enum class Kind : uint8_t {
+        NONE,
+        REGISTER,
+        IMMEDIATE,
+        STACK,
+        PSEUDO,
+        LABEL,
+    };
+    Operand() : kind_(Kind::NONE), payload_(0) {}
+    static Operand reg(Register reg) { return Operand(Kind::REGISTER, reg); }
+    static Operand imm(int value) { return Operand(Kind::IMMEDIATE, static_cast<uint32_t>(value)); }
+    static Operand stack(int offset) { return Operand(Kind::STACK, static_cast<uint32_t>(offset)); }
+    static Operand pseudo(uint32_t id) { return Operand(Kind::PSEUDO, id); }
+    static Operand label(uint32_t id) { return Operand(Kind::LABEL, id); }
+    Kind kind() const { return kind_; }
+    bool is_none() const { return kind_ == Kind::NONE; }
+    bool is_register() const { return kind_ == Kind::REGISTER; }
+    bool is_immediate() const { return kind_ == Kind::IMMEDIATE; }
+    bool is_stack() const { return kind_ == Kind::STACK; }
+    bool is_pseudo() const { return kind_ == Kind::PSEUDO; }
+    bool is_label() const { return kind_ == Kind::LABEL; }
+    Register reg() const { return static_cast<Register>(payload_); }
+    int imm_value() const { return static_cast<int>(payload_); }
+    int stack_offset() const { return static_cast<int>(payload_); }
+    uint32_t pseudo_id() const { return payload_; }
+    uint32_t label_id() const { return payload_; }
+    bool operator==(const Operand& that) const { return kind_ == that.kind_ && payload_ == that.payload_; }
+    bool operator!=(const Operand& that) const { return !(*this == that); }
+private:
+    Operand(Kind kind, uint32_t payload) : kind_(kind), payload_(payload) {}
+    Kind kind_;
+    uint32_t payload_;
+};
+
+enum class OpCode : uint8_t {
+    MOV,
+    MOVB,
+    NEG,
+    NOT,
+    ADD,
+    SUB,
+    MULT,
+    DIV,
+    CDQ,
+    BITWISE_AND,
+    BITWISE_OR,
+    BITWISE_XOR,
+    SAL,
+    SAR,
+    // 64 bit ops for multiply high sequences: movslq, imulq and sarq
+    MOVSX,
+    MULT64,
+    SAR64,
+    // three operand forms the tree tiler picks, leal and imull $imm
+    LEA,
+    MULT3,
+    // cmpl and testl, and the setcc reading their flags
+    CMP,
+    TEST,
+    SETE,
+    SETNE,
+    SETL,
+    SETLE,
+    SETG,
+    SETGE,
+    // a label to jump to, jmp and the jcc reading the flags
+    LABEL,
+    JMP,
+    JE,
+    JNE,
+    JL,
+    JLE,
+    JG,
+    JGE,
+    ALLOCATE_STACK,
+    RET,
+};
+
+inline std::string opcode_as_str(OpCode op) {
+    switch (op) {
+        case OpCode::MOV: return "Mov";
+        case OpCode::MOVB: return "MovB";
+        case OpCode::NEG: return "Neg";
+        case OpCode::NOT: return "Not";
+        case OpCode::ADD: return "Add";
+        case OpCode::SUB: return "Sub";
+        case OpCode::MULT: return "Mult";
+        case OpCode::DIV: return "Div";
+        case OpCode::CDQ: return "CDQ";
+        case OpCode::BITWISE_AND: return "BitwiseAnd";
+        case OpCode::BITWISE_OR: return "BitwiseOr";
+        case OpCode::BITWISE_XOR: return "BitwiseXor";
+        case OpCode::SAL: return "Sal";
+        case OpCode::SAR: return "Sar";
+        case OpCode::MOVSX: return "MovSx";
+        case OpCode::MULT64: return "Mult64";
+        case OpCode::SAR64: return "Sar64";
+        case OpCode::LEA: return "Lea";
+        case OpCode::MULT3: return "Mult3";
+        case OpCode::CMP: return "Cmp";
+        case OpCode::TEST: return "Test";
+        case OpCode::SETE: return "SetE";
+        case OpCode::SETNE: return "SetNE";
+        case OpCode::SETL: return "SetL";
+        case OpCode::SETLE: return "SetLE";
+        case OpCode::SETG: return "SetG";
+        case OpCode::SETGE: return "SetGE";
+        case OpCode::LABEL: return "Label";
+        case OpCode::JMP: return "Jmp";
+        case OpCode::JE: return "JE";
+        case OpCode::JNE: return "JNE";
+        case OpCode::JL: return "JL";
+        case OpCode::JLE: return "JLE";
+        case OpCode::JG: return "JG";
+        case OpCode::JGE: return "JGE";
+        case OpCode::ALLOCATE_STACK: return "AllocateStack";
+        case OpCode::RET: return "Ret";
+    }
+    return "";
+}
 
-class MovNode : public InstructionNode {
-public:
-    ~MovNode() = default;
-    MovNode(std::shared_ptr<OperandNode> src, std::shared_ptr<OperandNode> dst)
-        : src_(src), dst_(dst) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-    std::shared_ptr<OperandNode> src_, dst_;
-};
+inline bool is_setcc(OpCode op) {
+    return op >= OpCode::SETE && op <= OpCode::SETGE;
+}
 
-class MovBNode : public InstructionNode {
-public:
-    ~MovBNode() = default;
-    MovBNode(std::shared_ptr<OperandNode> src, std::shared_ptr<OperandNode> dst)
-        : src_(src), dst_(dst) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-    std::shared_ptr<OperandNode> src_, dst_;
-};
+inline bool is_jcc(OpCode op) {
+    return op >= OpCode::JE && op <= OpCode::JGE;
+}
 
-class AllocateStackNode : public InstructionNode {
-public:
-    ~AllocateStackNode() = default;
-    AllocateStackNode(int size) : size_(size) {};
-    void accept(Visitor& v) override {v.visit(*this);}
-    int size_;
-};
+// where control flow may enter or leave the straight line
+inline bool is_branch(OpCode op) {
+    return op == OpCode::LABEL || op == OpCode::JMP || is_jcc(op);
+}
 
-class RetNode : public InstructionNode {
-public:
-    ~RetNode() = default;
-    RetNode() = default;
-    void accept(Visitor& v) override {v.visit(*this);}
+// Operands follow AT&T order. Binary ops compute dst = dst op src, unary
+// ones (neg, not) rewrite dst in place, div takes its divisor in src and
+// allocate stack its size as an immediate src. Unused slots are NONE.
+// MOVSX sign extends a 32 bit src into a 64 bit register, MULT64 and SAR64
+// work on the full 64 bit registers.
+// LEA computes dst = src + index * scale, src may be NONE. An immediate
+// index is a displacement instead, dst = src + index. MULT3 computes
+// dst = src * index with an immediate index. Both only read index.
+// CMP and TEST only read both operands and set the flags from dst - src
+// and dst & src. The setcc ops write the low byte of dst from the flags
+// and leave the rest of it alone. LABEL places the label in src, and JMP
+// and the jcc ops jump to the one in their src.
+struct Instruction {
+    OpCode op_;
+    Operand src_;
+    Operand dst_;
+    Operand index_ = Operand();
+    uint8_t scale_ = 1;
+};
+
+static_assert(sizeof(Operand) == 8);
+static_assert(sizeof(Instruction) <= 32);
+
+struct Function {
+    Source::Symbol name_;
+    // pseudo ids in this function are all below this
+    uint32_t pseudo_count_ = 0;
+    std::vector<Instruction> instructions_;
+    // bytes below rbp, the saved registers first and then the stack slots,
+    // known once pseudos are replaced
+    uint32_t frame_size_ = 0;
+    // callee saved registers the allocator handed out, pushed right below rbp
+    std::vector<Register> saved_registers_;
+};
+
+struct Program {
+    std::vector<Function> functions_;
 };
 
 } //namespace ASM
-#endif // ASM_H
\ No newline at end of file
+#endif // ASM_H
@@ -0,0 +1,314 @@
+#include "src/asm/liveness.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace ASM {
+
+namespace {
+
+// ops that write dst without looking at its old value
+bool writes_whole_dst(OpCode op) {
+    return op == OpCode::MOV || op == OpCode::MOVSX || op == OpCode::LEA || op == OpCode::MULT3;
+}
+
+bool aliases(Operand a, Operand b) {
+    if (a == b) {
+        return true;
+    }
+    auto r10 = Operand::reg(Register::R10);
+    auto r10b = Operand::reg(Register::R10b);
+    return (a == r10 && b == r10b) || (a == r10b && b == r10);
+}
+
+void insert_sorted(std::vector<uint32_t>& positions, uint32_t position) {
+    positions.insert(std::lower_bound(positions.begin(), positions.end(), position), position);
+}
+
+void erase_sorted(std::vector<uint32_t>& positions, uint32_t position) {
+    auto it = std::lower_bound(positions.begin(), positions.end(), position);
+    if (it != positions.end() && *it == position) {
+        positions.erase(it);
+    }
+}
+
+} // namespace
+
+bool reads(const Instruction& instruction, Operand operand) {
+    if (operand.is_none()) {
+        return false;
+    }
+    // the zeroing idiom doesn't depend on the old value
+    if (instruction.op_ == OpCode::BITWISE_XOR && instruction.src_ == instruction.dst_) {
+        return false;
+    }
+    if (aliases(instruction.src_, operand) || aliases(instruction.index_, operand)) {
+        return true;
+    }
+    if (aliases(instruction.dst_, operand) && !writes_whole_dst(instruction.op_)) {
+        return true;
+    }
+    auto ax = Operand::reg(Register::AX);
+    auto dx = Operand::reg(Register::DX);
+    switch (instruction.op_) {
+        case OpCode::DIV: return operand == ax || operand == dx;
+        case OpCode::CDQ:
+        case OpCode::RET: return operand == ax;
+        default: return false;
+    }
+}
+
+bool writes(const Instruction& instruction, Operand operand) {
+    if (overwrites(instruction, operand)) {
+        return true;
+    }
+    auto op = instruction.op_;
+    return !operand.is_none() && aliases(instruction.dst_, operand) && op != OpCode::CMP && op != OpCode::TEST;
+}
+
+bool overwrites(const Instruction& instruction, Operand operand) {
+    if (operand.is_none()) {
+        return false;
+    }
+    if (writes_whole_dst(instruction.op_)) {
+        return aliases(instruction.dst_, operand);
+    }
+    switch (instruction.op_) {
+        case OpCode::BITWISE_XOR: return instruction.src_ == instruction.dst_ && instruction.dst_ == operand;
+        case OpCode::CDQ: return operand == Operand::reg(Register::DX);
+        case OpCode::DIV: return operand == Operand::reg(Register::AX) || operand == Operand::reg(Register::DX);
+        default: return false;
+    }
+}
+
+// the shifts leave the flags alone for a zero count, so they don't count
+bool writes_flags(OpCode op) {
+    switch (op) {
+        case OpCode::NEG:
+        case OpCode::ADD:
+        case OpCode::SUB:
+        case OpCode::MULT:
+        case OpCode::DIV:
+        case OpCode::BITWISE_AND:
+        case OpCode::BITWISE_OR:
+        case OpCode::BITWISE_XOR:
+        case OpCode::MULT64:
+        case OpCode::MULT3:
+        case OpCode::CMP:
+        case OpCode::TEST:
+            return true;
+        default:
+            return false;
+    }
+}
+
+Liveness::Liveness(const Function& function) : function_(function) {
+    auto& instructions = function.instructions_;
+    uint32_t pseudos = function.pseudo_count_;
+    uint32_t slots = 0;
+    for (auto& instruction : instructions) {
+        for (auto operand : {instruction.src_, instruction.dst_, instruction.index_}) {
+            if (operand.is_pseudo()) {
+                pseudos = std::max(pseudos, operand.pseudo_id() + 1);
+            } else if (operand.is_stack() && operand.stack_offset() < 0) {
+                slots = std::max(slots, static_cast<uint32_t>(-operand.stack_offset() + 3) / 4);
+            }
+        }
+    }
+    first_slot_ = kFlags + 1 + pseudos;
+    location_count_ = first_slot_ + slots;
+    words_ = (location_count_ + 63) / 64;
+    uses_.resize(location_count_);
+    definitions_.resize(location_count_);
+    effects_.resize(instructions.size());
+    for (uint32_t i = 0; i < instructions.size(); i++) {
+        add(i);
+    }
+    live_in_.assign((instructions.size() + 1) * words_, 0);
+    live_out_.assign(instructions.size() * words_, 0);
+    for (uint32_t i = instructions.size(); i-- > 0;) {
+        transfer(i);
+    }
+}
+
+uint32_t Liveness::location(Operand operand) const {
+    switch (operand.kind()) {
+        case Operand::Kind::REGISTER:
+            return operand.reg() == Register::R10b ? Register::R10 : operand.reg();
+        case Operand::Kind::PSEUDO:
+            if (kFlags + 1 + operand.pseudo_id() >= first_slot_) {
+                throw std::runtime_error("Pseudo the liveness doesn't know about");
+            }
+            return kFlags + 1 + operand.pseudo_id();
+        case Operand::Kind::STACK: {
+            auto offset = operand.stack_offset();
+            if (offset >= 0 || offset % 4 != 0 || first_slot_ + -offset / 4 - 1 >= location_count_) {
+                throw std::runtime_error("Stack slot the liveness doesn't know about");
+            }
+            return first_slot_ + -offset / 4 - 1;
+        }
+        default:
+            return kNoLocation;
+    }
+}
+
+std::span<const uint64_t> Liveness::live_in(uint32_t position) const {
+    return std::span(live_in_).subspan(position * words_, words_);
+}
+
+std::span<const uint64_t> Liveness::live_out(uint32_t position) const {
+    return std::span(live_out_).subspan(position * words_, words_);
+}
+
+// Only the upstream instructions can change: a set only depends on the ones
+// after it, or on a label's for a jump there. The walk goes back while the
+// live in sets keep changing, and a changed label takes it to the first
+// jump to it at least.
+void Liveness::update(uint32_t position) {
+    auto old_label = effects_[position].label_;
+    remove(position);
+    add(position);
+    uint32_t until = position;
+    auto reach_jumps = [&](uint32_t label) {
+        if (label < jumps_.size() && !jumps_[label].empty()) {
+            until = std::min(until, jumps_[label].front());
+        }
+    };
+    auto& instructions = function_.instructions_;
+    if (old_label != effects_[position].label_) {
+        reach_jumps(old_label);
+        reach_jumps(effects_[position].label_);
+    }
+    for (uint32_t i = position + 1; i-- > 0;) {
+        bool changed = transfer(i);
+        if (changed && instructions[i].op_ == OpCode::LABEL) {
+            reach_jumps(effects_[i].label_);
+        }
+        if (!changed && i <= until) {
+            return;
+        }
+    }
+}
+
+Liveness::Effects Liveness::effects_of(const Instruction& instruction) const {
+    Effects effects;
+    auto note = [](auto& locations, uint8_t& count, uint32_t location) {
+        if (std::find(locations.begin(), locations.begin() + count, location) == locations.begin() + count) {
+            locations[count++] = location;
+        }
+    };
+    auto ax = Operand::reg(Register::AX);
+    auto dx = Operand::reg(Register::DX);
+    for (auto operand : {instruction.src_, instruction.index_, instruction.dst_, ax, dx}) {
+        auto location = this->location(operand);
+        if (location == kNoLocation) {
+            continue;
+        }
+        if (reads(instruction, operand)) {
+            note(effects.reads_, effects.read_count_, location);
+        }
+        if (writes(instruction, operand)) {
+            note(effects.writes_, effects.write_count_, location);
+        }
+    }
+    if (reads_flags(instruction.op_)) {
+        note(effects.reads_, effects.read_count_, kFlags);
+    }
+    if (writes_flags(instruction.op_)) {
+        note(effects.writes_, effects.write_count_, kFlags);
+    }
+    if (instruction.op_ == OpCode::LABEL || instruction.op_ == OpCode::JMP || is_jcc(instruction.op_)) {
+        effects.label_ = instruction.src_.label_id();
+    }
+    return effects;
+}
+
+void Liveness::add(uint32_t position) {
+    auto& instruction = function_.instructions_[position];
+    auto& effects = effects_[position] = effects_of(instruction);
+    for (auto location : effects.reads()) {
+        insert_sorted(uses_[location], position);
+    }
+    for (auto location : effects.writes()) {
+        insert_sorted(definitions_[location], position);
+    }
+    if (effects.label_ == kNoLocation) {
+        return;
+    }
+    if (effects.label_ >= labels_.size()) {
+        labels_.resize(effects.label_ + 1, kNoLocation);
+        jumps_.resize(effects.label_ + 1);
+    }
+    if (instruction.op_ == OpCode::LABEL) {
+        labels_[effects.label_] = position;
+    } else {
+        insert_sorted(jumps_[effects.label_], position);
+    }
+}
+
+void Liveness::remove(uint32_t position) {
+    auto& effects = effects_[position];
+    for (auto location : effects.reads()) {
+        erase_sorted(uses_[location], position);
+    }
+    for (auto location : effects.writes()) {
+        erase_sorted(definitions_[location], position);
+    }
+    if (effects.label_ != kNoLocation) {
+        if (labels_[effects.label_] == position) {
+            labels_[effects.label_] = kNoLocation;
+        }
+        erase_sorted(jumps_[effects.label_], position);
+    }
+    effects = Effects();
+}
+
+uint32_t Liveness::target(uint32_t position) const {
+    auto label = effects_[position].label_;
+    if (labels_[label] == kNoLocation) {
+        throw std::runtime_error("Jump to a label that isn't placed");
+    }
+    if (labels_[label] <= position) {
+        throw std::runtime_error("ASM jumps must go forward");
+    }
+    return labels_[label];
+}
+
+// live out is what the successors have live in, nothing after a ret. Live
+// in is that without what the instruction writes, plus what it reads.
+bool Liveness::transfer(uint32_t position) {
+    auto op = function_.instructions_[position].op_;
+    auto out = std::span(live_out_).subspan(position * words_, words_);
+    auto in = std::span(live_in_).subspan(position * words_, words_);
+    if (op == OpCode::RET) {
+        std::fill(out.begin(), out.end(), 0);
+    } else {
+        auto next = live_in(op == OpCode::JMP ? target(position) : position + 1);
+        std::copy(next.begin(), next.end(), out.begin());
+        if (is_jcc(op)) {
+            auto jumped = live_in(target(position));
+            for (size_t w = 0; w < words_; w++) {
+                out[w] |= jumped[w];
+            }
+        }
+    }
+    bool changed = false;
+    auto& effects = effects_[position];
+    for (size_t w = 0; w < words_; w++) {
+        auto word = out[w];
+        for (auto location : effects.writes()) {
+            if (location / 64 == w) {
+                word &= ~(uint64_t{1} << (location % 64));
+            }
+        }
+        for (auto location : effects.reads()) {
+            if (location / 64 == w) {
+                word |= uint64_t{1} << (location % 64);
+            }
+        }
+        changed = changed || word != in[w];
+        in[w] = word;
+    }
+    return changed;
+}
+
+} // namespace ASM
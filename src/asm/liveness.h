@@ -0,0 +1,102 @@
+#ifndef ASM_LIVENESS_H
+#define ASM_LIVENESS_H
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "src/asm/asm_ast.h"
+
+namespace ASM {
+
+// what an instruction does to an operand, implicit ones like the AX and DX
+// of div included. r10b is the low byte of r10 and touches it as well. A
+// write that keeps part of the old value, a byte move or a setcc, reads it
+// too.
+bool reads(const Instruction& instruction, Operand operand);
+bool writes(const Instruction& instruction, Operand operand);
+// writes without looking at the old value
+bool overwrites(const Instruction& instruction, Operand operand);
+// ops leaving the flags for a setcc or jcc to read, or clobbering them
+bool writes_flags(OpCode op);
+inline bool reads_flags(OpCode op) {
+    return is_setcc(op) || is_jcc(op);
+}
+
+// Liveness and def-use chains over the registers, the flags, the pseudos
+// and the 4 byte stack slots of a function, which are its locations. They
+// are numbered registers first, with r10b sharing r10's, then the flags,
+// the pseudos and the slots from rbp down.
+//
+// Jumps only go forward, so one backward pass sees every label before the
+// jumps to it and settles the sets. A pass editing an instruction in place
+// calls update() with its position, which redoes that instruction's
+// chains and walks back only as far as the sets keep changing.
+class Liveness {
+public:
+    static constexpr uint32_t kNoLocation = UINT32_MAX;
+    static constexpr uint32_t kFlags = Register::R15 + 1;
+    explicit Liveness(const Function& function);
+    Liveness(const Liveness& that) = delete;
+    Liveness& operator=(const Liveness& that) = delete;
+
+    // kNoLocation for immediates, labels and NONE
+    uint32_t location(Operand operand) const;
+    uint32_t location_count() const { return location_count_; }
+
+    // whether the location holds a value read later on, before and after
+    // the instruction at position. Nothing is live past the last one.
+    bool live_in(uint32_t position, uint32_t location) const { return test(live_in(position), location); }
+    bool live_out(uint32_t position, uint32_t location) const { return test(live_out(position), location); }
+    // the whole sets, location l is bit l % 64 of word l / 64
+    std::span<const uint64_t> live_in(uint32_t position) const;
+    std::span<const uint64_t> live_out(uint32_t position) const;
+
+    // instructions reading and writing the location, in order
+    std::span<const uint32_t> uses(uint32_t location) const { return uses_.at(location); }
+    std::span<const uint32_t> definitions(uint32_t location) const { return definitions_.at(location); }
+
+    // the instruction at position changed in place. The locations it
+    // touches must be ones the function had already.
+    void update(uint32_t position);
+private:
+    static bool test(std::span<const uint64_t> set, uint32_t location) {
+        return location != kNoLocation && (set[location / 64] >> (location % 64)) & 1;
+    }
+    // what one instruction reads and writes, and the label it places or
+    // jumps to
+    struct Effects {
+        std::array<uint32_t, 6> reads_;
+        std::array<uint32_t, 4> writes_;
+        uint8_t read_count_ = 0;
+        uint8_t write_count_ = 0;
+        uint32_t label_ = kNoLocation;
+        std::span<const uint32_t> reads() const { return std::span(reads_).first(read_count_); }
+        std::span<const uint32_t> writes() const { return std::span(writes_).first(write_count_); }
+    };
+    Effects effects_of(const Instruction& instruction) const;
+    void add(uint32_t position);
+    void remove(uint32_t position);
+    // recomputes the sets at position, true when live in changed
+    bool transfer(uint32_t position);
+    uint32_t target(uint32_t position) const;
+
+    const Function& function_;
+    uint32_t location_count_;
+    uint32_t first_slot_;
+    size_t words_;
+    std::vector<Effects> effects_;
+    // one row of words_ per instruction, live_in_ has an empty one past the
+    // end
+    std::vector<uint64_t> live_in_;
+    std::vector<uint64_t> live_out_;
+    std::vector<std::vector<uint32_t>> uses_;
+    std::vector<std::vector<uint32_t>> definitions_;
+    // by label id, where it's placed and the jumps to it in order
+    std::vector<uint32_t> labels_;
+    std::vector<std::vector<uint32_t>> jumps_;
+};
+
+} // namespace ASM
+
+#endif // ASM_LIVENESS_H
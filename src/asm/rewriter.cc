@@ -0,0 +1,65 @@
+#include "src/asm/rewriter.h"
+#include <algorithm>
+
+namespace ASM {
+
+Rewriter::Rewriter(std::vector<Instruction>& instructions)
+    : instructions_(instructions), read_(0), write_(0), next_gap_(kMinGap) {}
+
+void Rewriter::keep() {
+    if (write_ != read_) {
+        instructions_[write_] = instructions_[read_];
+    }
+    write_++;
+    read_++;
+}
+
+void Rewriter::erase() {
+    read_++;
+}
+
+void Rewriter::replace(std::initializer_list<Instruction> replacement) {
+    // consuming first frees the current slot for the first replacement
+    read_++;
+    make_room(replacement.size());
+    for (auto& instruction : replacement) {
+        instructions_[write_++] = instruction;
+    }
+}
+
+void Rewriter::insert(const Instruction& instruction) {
+    make_room(1);
+    instructions_[write_++] = instruction;
+}
+
+void Rewriter::make_room(size_t count) {
+    if (read_ - write_ >= count) {
+        return;
+    }
+    // sized off the unread tail, each shift then pays for many inserts
+    size_t old_size = instructions_.size();
+    size_t grow = std::max({count - (read_ - write_), next_gap_, old_size - read_});
+    next_gap_ *= 2;
+    instructions_.resize(old_size + grow);
+    std::move_backward(
+        instructions_.begin() + read_,
+        instructions_.begin() + old_size,
+        instructions_.end()
+    );
+    read_ += grow;
+}
+
+void Rewriter::finish() {
+    if (write_ == read_) {
+        return;
+    }
+    auto tail = std::move(
+        instructions_.begin() + read_,
+        instructions_.end(),
+        instructions_.begin() + write_
+    );
+    instructions_.erase(tail, instructions_.end());
+    read_ = write_;
+}
+
+} // namespace ASM
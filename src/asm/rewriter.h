@@ -0,0 +1,52 @@
+#ifndef ASM_REWRITER_H
+#define ASM_REWRITER_H
+
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+#include "src/asm/asm_ast.h"
+
+namespace ASM {
+
+// Cursor that edits a function's instruction list in place, front to back.
+//
+// The list is split into the rewritten prefix [0, write_), a gap of dead
+// slots [write_, read_) and the still unread suffix [read_, size). Keeping
+// an instruction while there is no gap touches nothing; replacing or
+// erasing one widens the gap, and inserting fills it. The suffix is only
+// shifted when an insert finds the gap empty, and the new gap is at least
+// as large as the suffix so expanding passes stay amortized linear.
+class Rewriter {
+public:
+    explicit Rewriter(std::vector<Instruction>& instructions);
+    Rewriter(const Rewriter& that) = delete;
+    Rewriter& operator=(const Rewriter& that) = delete;
+    ~Rewriter() { finish(); }
+
+    bool at_end() const { return read_ == instructions_.size(); }
+    // the next unread instruction, may be edited in place before keep()
+    Instruction& current() { return instructions_[read_]; }
+
+    // moves past the current instruction, leaving it as is
+    void keep();
+    // drops the current instruction
+    void erase();
+    // swaps the current instruction for the given ones, in order
+    void replace(std::initializer_list<Instruction> replacement);
+    // adds an instruction before the current one
+    void insert(const Instruction& instruction);
+    // closes the gap; the list is consistent again afterwards
+    void finish();
+
+private:
+    void make_room(size_t count);
+    static constexpr size_t kMinGap = 16;
+    std::vector<Instruction>& instructions_;
+    size_t read_;
+    size_t write_;
+    size_t next_gap_;
+};
+
+} // namespace ASM
+
+#endif // ASM_REWRITER_H
@@ -0,0 +1,17 @@
+#include "src/ast/arena.h"
+#include <algorithm>
+
+namespace CAst {
+
+// chunks double until kMaxChunkSize, so a tree of n bytes costs O(log n)
+// allocations up to a megabyte and one per megabyte after that
+void Arena::grow(size_t at_least) {
+    size_t size = std::max(next_chunk_size_, at_least);
+    next_chunk_size_ = std::min(next_chunk_size_ * 2, kMaxChunkSize);
+    chunks_.push_back(std::make_unique_for_overwrite<std::byte[]>(size));
+    cursor_ = chunks_.back().get();
+    limit_ = cursor_ + size;
+    bytes_reserved_ += size;
+}
+
+} // namespace CAst
@@ -0,0 +1,70 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace CAst {
+
+// Bump allocator backing one C AST. Nodes are never freed one by one: the
+// arena drops all of its chunks at once when the tree goes away, so only
+// trivially destructible types may live here.
+class Arena {
+public:
+    Arena() = default;
+    Arena(const Arena& that) = delete;
+    Arena& operator=(const Arena& that) = delete;
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible_v<T>, "arena objects are never destroyed");
+        void* memory = allocate(sizeof(T), alignof(T));
+        return new (memory) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    std::span<T> copy(const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable_v<T>, "arena arrays are copied bytewise");
+        if (values.empty()) {
+            return {};
+        }
+        T* memory = static_cast<T*>(allocate(sizeof(T) * values.size(), alignof(T)));
+        std::uninitialized_copy(values.begin(), values.end(), memory);
+        return std::span<T>(memory, values.size());
+    }
+
+    size_t bytes_allocated() const { return bytes_allocated_; }
+    size_t bytes_reserved() const { return bytes_reserved_; }
+private:
+    void* allocate(size_t size, size_t alignment) {
+        size_t padding = (alignment - reinterpret_cast<uintptr_t>(cursor_) % alignment) % alignment;
+        if (cursor_ == nullptr || padding + size > static_cast<size_t>(limit_ - cursor_)) {
+            grow(size + alignment);
+            padding = (alignment - reinterpret_cast<uintptr_t>(cursor_) % alignment) % alignment;
+        }
+        void* result = cursor_ + padding;
+        cursor_ += padding + size;
+        bytes_allocated_ += size;
+        return result;
+    }
+    void grow(size_t at_least);
+
+    static constexpr size_t kFirstChunkSize = 16 * 1024;
+    static constexpr size_t kMaxChunkSize = 1024 * 1024;
+    std::vector<std::unique_ptr<std::byte[]>> chunks_;
+    std::byte* cursor_ = nullptr;
+    std::byte* limit_ = nullptr;
+    size_t next_chunk_size_ = kFirstChunkSize;
+    size_t bytes_allocated_ = 0;
+    size_t bytes_reserved_ = 0;
+};
+
+} // namespace CAst
+
+#endif // ARENA_H
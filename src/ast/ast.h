@@ -1,291 +1,202 @@
 #ifndef _AST_H_
 #define _AST_H_
 
+#include <cstdint>
 #include <vector>
-#include <list>
+#include <span>
 #include <string>
-#include <memory>
+#include "src/ast/arena.h"
 #include "src/ast/type.h"
+#include "src/source/symbol.h"
 
 namespace CAst {
 
-// Forward declarations
-class Visitor;
-struct TypeNode;
-struct FunctionArgumentsNode;
-struct ReturnStatementNode;
-struct StatementBlockNode;
-struct FunctionNode;
-struct ProgramNode;
-struct IntegerValueNode;
-struct TildeUnaryExpressionNode;
-struct MinusUnaryExpressionNode;
-struct NotUnaryExpressionNode;
-struct DivNode;
-struct ModNode;
-struct MultNode;
-struct PlusNode;
-struct MinusNode;
-struct AndNode;
-struct OrNode;
-struct BitwiseXorNode;
-struct BitwiseAndNode;
-struct BitwiseOrNode;
-struct BitwiseLeftShiftNode;
-struct BitwiseRightShiftNode;
-
-// --- Visitor Interface ---
-class Visitor {
-public:
-    virtual ~Visitor() = default;
-    virtual void visit(TypeNode& node) = 0;
-    virtual void visit(FunctionArgumentsNode& node) = 0;
-    virtual void visit(ReturnStatementNode& node) = 0;
-    virtual void visit(StatementBlockNode& node) = 0;
-    virtual void visit(FunctionNode& node) = 0;
-    virtual void visit(TildeUnaryExpressionNode& node) = 0;
-    virtual void visit(MinusUnaryExpressionNode& node) = 0;
-    virtual void visit(NotUnaryExpressionNode& node) = 0;
-    virtual void visit(AndNode& node) = 0;
-    virtual void visit(OrNode& node) = 0;
-    virtual void visit(BitwiseXorNode& node) = 0;
-    virtual void visit(BitwiseAndNode& node) = 0;
-    virtual void visit(BitwiseOrNode& node) = 0;
-    virtual void visit(BitwiseLeftShiftNode& node) = 0;
-    virtual void visit(BitwiseRightShiftNode& node) = 0;
-    virtual void visit(IntegerValueNode& node) = 0;
-    virtual void visit(ModNode& node) = 0;
-    virtual void visit(DivNode& node) = 0;
-    virtual void visit(MultNode& node) = 0;
-    virtual void visit(PlusNode& node) = 0;
-    virtual void visit(MinusNode& node) = 0;
-    virtual void visit(ProgramNode& node) = 0;
-};
+// The C AST is a closed set of node kinds. Every node carries its kind, and
+// passes switch over it instead of double dispatching through a visitor.
+enum class NodeKind : uint8_t {
+    INTEGER_VALUE,
+    UNARY_EXPRESSION,
+    BINARY_EXPRESSION,
+    TYPE,
+    FUNCTION_ARGUMENTS,
+    RETURN_STATEMENT,
+    STATEMENT_BLOCK,
+    FUNCTION,
+    PROGRAM,
+};
+
+enum class UnaryOperator : uint8_t {
+    COMPLEMENT,
+    NEGATE,
+    NOT,
+};
+
+enum class BinaryOperator : uint8_t {
+    MULT,
+    DIV,
+    MOD,
+    PLUS,
+    MINUS,
+    BITWISE_AND,
+    BITWISE_OR,
+    BITWISE_XOR,
+    LEFT_SHIFT,
+    RIGHT_SHIFT,
+    AND,
+    OR,
+    EQUAL,
+    NOT_EQUAL,
+    LESS,
+    GREATER,
+    LESS_EQ,
+    GREATER_EQ,
+};
+
+inline std::string unary_operator_as_str(UnaryOperator op) {
+    switch (op) {
+        case UnaryOperator::COMPLEMENT: return "~";
+        case UnaryOperator::NEGATE: return "-";
+        case UnaryOperator::NOT: return "!";
+    }
+    return "";
+}
+
+inline std::string binary_operator_as_str(BinaryOperator op) {
+    switch (op) {
+        case BinaryOperator::MULT: return "*";
+        case BinaryOperator::DIV: return "/";
+        case BinaryOperator::MOD: return "%";
+        case BinaryOperator::PLUS: return "+";
+        case BinaryOperator::MINUS: return "-";
+        case BinaryOperator::BITWISE_AND: return "&";
+        case BinaryOperator::BITWISE_OR: return "|";
+        case BinaryOperator::BITWISE_XOR: return "^";
+        case BinaryOperator::LEFT_SHIFT: return "<<";
+        case BinaryOperator::RIGHT_SHIFT: return ">>";
+        case BinaryOperator::AND: return "&&";
+        case BinaryOperator::OR: return "||";
+        case BinaryOperator::EQUAL: return "==";
+        case BinaryOperator::NOT_EQUAL: return "!=";
+        case BinaryOperator::LESS: return "<";
+        case BinaryOperator::GREATER: return ">";
+        case BinaryOperator::LESS_EQ: return "<=";
+        case BinaryOperator::GREATER_EQ: return ">=";
+    }
+    return "";
+}
 
 // --- Base Nodes ---
-class ASTNode {
-public:
-    virtual ~ASTNode() = default;
-    virtual void accept(Visitor& v) = 0;
+// Nodes live in the Arena owned by their ProgramNode and are never deleted
+// through a base pointer, so they need neither a vtable nor a destructor.
+struct ASTNode {
+    NodeKind kind_;
+protected:
+    explicit ASTNode(NodeKind kind) : kind_(kind) {}
 };
 
-class ExpressionNode : public ASTNode {
-public:
-    virtual ~ExpressionNode() = default;
-    virtual void accept(Visitor& v) override = 0;
+struct ExpressionNode : public ASTNode {
+protected:
+    using ASTNode::ASTNode;
 };
 
-class StatementNode : public ASTNode {
-public:
-    virtual ~StatementNode() = default;
-    virtual void accept(Visitor& v) override = 0;
+struct StatementNode : public ASTNode {
+protected:
+    using ASTNode::ASTNode;
 };
 
+// Checked downcast: the node as a T if it is of T's kind, nullptr otherwise.
+template <typename T>
+T* node_cast(ASTNode* node) {
+    return node != nullptr && node->kind_ == T::kKind ? static_cast<T*>(node) : nullptr;
+}
+
 // --- Expressions ---
-class ConstantValueNode : public ExpressionNode {
-public:
-    virtual ~ConstantValueNode() = default;
+struct ConstantValueNode : public ExpressionNode {
+protected:
+    using ExpressionNode::ExpressionNode;
 };
 
-class IntegerValueNode : public ConstantValueNode {
-public:
+struct IntegerValueNode : public ConstantValueNode {
+    static constexpr NodeKind kKind = NodeKind::INTEGER_VALUE;
     int value_;
-    IntegerValueNode(int value) : value_(value) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class UnaryExpressionNode : public ExpressionNode {
-public:
-    std::shared_ptr<ExpressionNode> operand_;
-    virtual ~UnaryExpressionNode() = default;
-    UnaryExpressionNode(std::shared_ptr<ExpressionNode> operand)
-        : operand_(operand) {}
-
-};
-
-class TildeUnaryExpressionNode : public UnaryExpressionNode {
-public:
-    TildeUnaryExpressionNode(std::shared_ptr<ExpressionNode> operand) 
-        : UnaryExpressionNode(operand) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class MinusUnaryExpressionNode : public UnaryExpressionNode {
-public:
-    MinusUnaryExpressionNode(std::shared_ptr<ExpressionNode> operand) 
-        : UnaryExpressionNode(operand) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class NotUnaryExpressionNode : public UnaryExpressionNode {
-public:
-    NotUnaryExpressionNode(std::shared_ptr<ExpressionNode> operand)
-        : UnaryExpressionNode(operand) {}
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class BinaryExpressionNode : public ExpressionNode {
-public:
-    std::shared_ptr<ExpressionNode> left_, right_;
-    BinaryExpressionNode(std::shared_ptr<ExpressionNode> left, std::shared_ptr<ExpressionNode> right)
-        :   left_(left), right_(right) {}
-    virtual void accept(Visitor& v) = 0;
-    virtual ~BinaryExpressionNode() = default;
-};
-
-class ModNode : public BinaryExpressionNode {
-public:
-    ModNode(std::shared_ptr<ExpressionNode> left, std::shared_ptr<ExpressionNode> right)
-        :   BinaryExpressionNode(left, right) {}
-    ~ModNode() = default;
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class DivNode : public BinaryExpressionNode {
-public:
-    DivNode(std::shared_ptr<ExpressionNode> left, std::shared_ptr<ExpressionNode> right)
-        :   BinaryExpressionNode(left, right) {}
-    ~DivNode() = default;
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class MultNode : public BinaryExpressionNode {
-public:
-    MultNode(std::shared_ptr<ExpressionNode> left, std::shared_ptr<ExpressionNode> right)
-        :   BinaryExpressionNode(left, right) {}
-    ~MultNode() = default;
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class PlusNode : public BinaryExpressionNode {
-public:
-    PlusNode(std::shared_ptr<ExpressionNode> left, std::shared_ptr<ExpressionNode> right)
-        :   BinaryExpressionNode(left, right) {}
-    ~PlusNode() = default;
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class MinusNode : public BinaryExpressionNode {
-public:
-    MinusNode(std::shared_ptr<ExpressionNode> left, std::shared_ptr<ExpressionNode> right)
-        :   BinaryExpressionNode(left, right) {}
-    ~MinusNode() = default;
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class AndNode : public BinaryExpressionNode {
-public:
-    AndNode(std::shared_ptr<ExpressionNode> left, std::shared_ptr<ExpressionNode> right)
-        :  BinaryExpressionNode(left, right) {}
-    ~AndNode() = default;
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class BitwiseAndNode : public BinaryExpressionNode {
-public:
-    BitwiseAndNode(std::shared_ptr<ExpressionNode> left, std::shared_ptr<ExpressionNode> right)
-        :  BinaryExpressionNode(left, right) {}
-    ~BitwiseAndNode() = default;
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class OrNode : public BinaryExpressionNode {
-public:
-    OrNode(std::shared_ptr<ExpressionNode> left, std::shared_ptr<ExpressionNode> right)
-        :  BinaryExpressionNode(left, right) {}
-    ~OrNode() = default;
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class BitwiseOrNode : public BinaryExpressionNode {
-public:
-    BitwiseOrNode(std::shared_ptr<ExpressionNode> left, std::shared_ptr<ExpressionNode> right)
-        :  BinaryExpressionNode(left, right) {}
-    ~BitwiseOrNode() = default;
-    void accept(Visitor& v) override {v.visit(*this);}
-};
-
-class BitwiseXorNode : public BinaryExpressionNode {
-public:
-    BitwiseXorNode(std::shared_ptr<ExpressionNode> left, std::shared_ptr<ExpressionNode> right)
-        :  BinaryExpressionNode(left, right) {}
-    ~BitwiseXorNode() = default;
-    void accept(Visitor& v) override {v.visit(*this);}
+    IntegerValueNode(int value) : ConstantValueNode(kKind), value_(value) {}
 };
 
-class BitwiseLeftShiftNode : public BinaryExpressionNode {
-public:
-    BitwiseLeftShiftNode(std::shared_ptr<ExpressionNode> left, std::shared_ptr<ExpressionNode> right)
-        :  BinaryExpressionNode(left, right) {}
-    ~BitwiseLeftShiftNode() = default;
-    void accept(Visitor& v) override {v.visit(*this);}
+struct UnaryExpressionNode : public ExpressionNode {
+    static constexpr NodeKind kKind = NodeKind::UNARY_EXPRESSION;
+    UnaryOperator op_;
+    ExpressionNode* operand_;
+    UnaryExpressionNode(UnaryOperator op, ExpressionNode* operand)
+        : ExpressionNode(kKind), op_(op), operand_(operand) {}
 };
 
-class BitwiseRightShiftNode : public BinaryExpressionNode {
-public:
-    BitwiseRightShiftNode(std::shared_ptr<ExpressionNode> left, std::shared_ptr<ExpressionNode> right)
-        :  BinaryExpressionNode(left, right) {}
-    ~BitwiseRightShiftNode() = default;
-    void accept(Visitor& v) override {v.visit(*this);}
+struct BinaryExpressionNode : public ExpressionNode {
+    static constexpr NodeKind kKind = NodeKind::BINARY_EXPRESSION;
+    BinaryOperator op_;
+    ExpressionNode* left_;
+    ExpressionNode* right_;
+    BinaryExpressionNode(BinaryOperator op, ExpressionNode* left, ExpressionNode* right)
+        : ExpressionNode(kKind), op_(op), left_(left), right_(right) {}
 };
 
 // --- Structural Nodes ---
 struct FunctionArgument {
     Type type;
-    std::string name;
+    Source::Symbol name;
 };
 
 struct TypeNode : public ASTNode {
+    static constexpr NodeKind kKind = NodeKind::TYPE;
     Type type_;
-    TypeNode(Type type) : type_(type) {}
-    void accept(Visitor& v) override {v.visit(*this);}
+    TypeNode(Type type) : ASTNode(kKind), type_(type) {}
 };
 
 struct FunctionArgumentsNode : public ASTNode {
-    std::list<FunctionArgument> arguments_;
-    FunctionArgumentsNode() = default;
-    FunctionArgumentsNode(std::list<FunctionArgument>&& arguments) 
-        : arguments_(std::move(arguments)) {}
-    void accept(Visitor& v) override {v.visit(*this);}
+    static constexpr NodeKind kKind = NodeKind::FUNCTION_ARGUMENTS;
+    std::span<FunctionArgument> arguments_;
+    FunctionArgumentsNode() : ASTNode(kKind) {}
+    FunctionArgumentsNode(std::span<FunctionArgument> arguments)
+        : ASTNode(kKind), arguments_(arguments) {}
 };
 
 struct ReturnStatementNode : public StatementNode {
+    static constexpr NodeKind kKind = NodeKind::RETURN_STATEMENT;
     Type type_;
-    std::shared_ptr<ExpressionNode> return_value_;
-    ReturnStatementNode(Type return_type, std::shared_ptr<ExpressionNode> return_value)
-        : type_(return_type), return_value_(std::move(return_value)) {}
-    void accept(Visitor& v) override {v.visit(*this);}
+    ExpressionNode* return_value_;
+    ReturnStatementNode(Type return_type, ExpressionNode* return_value)
+        : StatementNode(kKind), type_(return_type), return_value_(return_value) {}
 };
 
 struct StatementBlockNode : public ASTNode {
-    std::vector<std::shared_ptr<StatementNode>> statements_;
-    StatementBlockNode() = default;
-    StatementBlockNode(std::vector<std::shared_ptr<StatementNode>> statements) 
-        : statements_(std::move(statements)) {}
-    void accept(Visitor& v) override {v.visit(*this);}
+    static constexpr NodeKind kKind = NodeKind::STATEMENT_BLOCK;
+    std::span<StatementNode*> statements_;
+    StatementBlockNode() : ASTNode(kKind) {}
+    StatementBlockNode(std::span<StatementNode*> statements)
+        : ASTNode(kKind), statements_(statements) {}
 };
 
 struct FunctionNode : public ASTNode {
-    std::string name_;
-    std::shared_ptr<TypeNode> type_node_;
-    std::shared_ptr<FunctionArgumentsNode> arguments_node_;
-    std::shared_ptr<StatementBlockNode> body_;
+    static constexpr NodeKind kKind = NodeKind::FUNCTION;
+    Source::Symbol name_;
+    TypeNode* type_node_;
+    FunctionArgumentsNode* arguments_node_;
+    StatementBlockNode* body_;
 
-    FunctionNode(std::string name, std::shared_ptr<TypeNode> type_node, 
-                 std::shared_ptr<FunctionArgumentsNode> arguments, 
-                 std::shared_ptr<StatementBlockNode> body)
-    : name_(std::move(name)), type_node_(std::move(type_node)), 
-      arguments_node_(std::move(arguments)), body_(std::move(body)) {}
-    void accept(Visitor& v) override {v.visit(*this);}
+    FunctionNode(Source::Symbol name, TypeNode* type_node,
+                 FunctionArgumentsNode* arguments,
+                 StatementBlockNode* body)
+    : ASTNode(kKind), name_(name), type_node_(type_node),
+      arguments_node_(arguments), body_(body) {}
 };
 
+// The root is the only node outside the arena: it owns the arena, and with
+// it every other node of the tree, which all go away together.
 struct ProgramNode : public ASTNode {
-    std::vector<std::shared_ptr<FunctionNode>> functions_;
-    ProgramNode() = default;
-    ProgramNode(std::vector<std::shared_ptr<FunctionNode>> functions) 
-        : functions_(std::move(functions)) {}
-    void accept(Visitor& v) override {v.visit(*this);}
+    static constexpr NodeKind kKind = NodeKind::PROGRAM;
+    Arena arena_;
+    std::span<FunctionNode*> functions_;
+    ProgramNode() : ASTNode(kKind) {}
 };
 
 } // namespace CAst
-#endif // _AST_H_
\ No newline at end of file
+#endif // _AST_H_
@@ -1,7 +1,27 @@
 #include "src/codegen/asm_dump/asm_dump.h"
+#include <charconv>
+#include <iterator>
 
 namespace Codegen {
 
+namespace {
+
+// indexed by ASM::Register
+constexpr const char* kDwordNames[] = {
+    "%eax", "%edx", "%cl", "%r10d", "%r10b", "%r11d",
+    "%esi", "%edi", "%r8d", "%r9d", "%ebx", "%r12d", "%r13d", "%r14d", "%r15d",
+};
+constexpr const char* kByteNames[] = {
+    "%al", "%dl", "%cl", "%r10b", "%r10b", "%r11b",
+    "%sil", "%dil", "%r8b", "%r9b", "%bl", "%r12b", "%r13b", "%r14b", "%r15b",
+};
+constexpr const char* kQwordNames[] = {
+    "%rax", "%rdx", "%rcx", "%r10", "%r10", "%r11",
+    "%rsi", "%rdi", "%r8", "%r9", "%rbx", "%r12", "%r13", "%r14", "%r15",
+};
+
+} // namespace
+
 ASMDumper::ASMDumper(std::string filename) : target_filename_(filename) {
     of = std::ofstream(filename);
     if (!of.is_open()) {
@@ -11,200 +31,198 @@ ASMDumper::ASMDumper(std::string filename) : target_filename_(filename) {
 
 ASMDumper::~ASMDumper() {
     if (of.is_open()) {
+        flush();
         of.close();
     }
 }
 
-
-void ASMDumper::visit(ASM::ProgramNode& node) {
-    of << "\t.section .note.GNU-stack,\"\",@progbits\n";
-    of << "\t.text\n";
-    for(auto& fn : node.functions_) {
-        fn->accept(*this);
+void ASMDumper::dump_assembly(const ASM::Program& asm_program) {
+    text_ += "\t.section .note.GNU-stack,\"\",@progbits\n";
+    text_ += "\t.text\n";
+    for(auto& fn : asm_program.functions_) {
+        dump_function(fn);
+        if (text_.size() >= kFlushThreshold) {
+            flush();
+        }
     }
+    flush();
 }
 
-void ASMDumper::visit(ASM::FunctionNode& node) {
-    of << "\t.globl " + node.name_ + "\n";
-    of << node.name_ + ":\n";
-    of << "\tpushq  %rbp\n";
-    of << "\tmovq   %rsp, %rbp\n";
-    for(auto& instruction : node.instructions_) {
-        instruction->accept(*this);
-    }
-}
-
-void ASMDumper::visit(ASM::NegNode& node) {
-    node.src_->accept(*this);
-    auto operand_as_str = buffer_.back();
-    buffer_.pop_back();
-    of << "\tnegl   " + operand_as_str + "\n";
-}
-
-void ASMDumper::visit(ASM::NotNode& node) {
-    node.src_->accept(*this);
-    auto src_as_str = buffer_.back();
-    buffer_.pop_back();
-    of << "\tnotl   " + src_as_str + "\n";
-}
-
-void ASMDumper::visit(ASM::MovNode& node) {
-    node.src_->accept(*this);
-    auto src_as_str = buffer_.back();
-    buffer_.pop_back();
-    node.dst_->accept(*this);
-    auto dst_as_str = buffer_.back();
-    buffer_.pop_back();    
-    of << "\tmovl   " + src_as_str + ",  " + dst_as_str + "\n";
+void ASMDumper::flush() {
+    of.write(text_.data(), text_.size());
+    text_.clear();
 }
 
-void ASMDumper::visit(ASM::MovBNode& node) {
-    node.src_->accept(*this);
-    auto src_as_str = buffer_.back();
-    buffer_.pop_back();
-    node.dst_->accept(*this);
-    auto dst_as_str = buffer_.back();
-    buffer_.pop_back();    
-    of << "\tmovb   " + src_as_str + ",  " + dst_as_str + "\n";
+void ASMDumper::dump_int(int value) {
+    char digits[16];
+    text_.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
 }
 
-void ASMDumper::visit(ASM::RetNode& node) {
-    of << "\tmovq   %rbp,%rsp\n";
-    of << "\tpopq   %rbp\n";
-    of << "\tret\n";
-}
-
-void ASMDumper::visit(ASM::AllocateStackNode& node) {
-    of << "\tsubq   $" + std::to_string(node.size_) + ", %rsp\n";
-}
-
-void ASMDumper::visit(ASM::ImmNode& node) {
-    buffer_.push_back(std::string("$") + std::to_string(node.val_));
-}
-
-void ASMDumper::visit(ASM::StackNode& node) {
-    buffer_.push_back(std::to_string(node.size_) + "(%rbp)");
+void ASMDumper::dump_function(const ASM::Function& function) {
+    text_ += "\t.globl ";
+    text_ += function.name_.str();
+    text_ += "\n";
+    text_ += function.name_.str();
+    text_ += ":\n";
+    text_ += "\tpushq  %rbp\n";
+    text_ += "\tmovq   %rsp, %rbp\n";
+    for (auto reg : function.saved_registers_) {
+        text_ += "\tpushq  ";
+        text_ += kQwordNames[reg];
+        text_ += "\n";
+    }
+    function_ = &function;
+    for(auto& instruction : function.instructions_) {
+        dump_instruction(instruction);
+    }
 }
 
-void ASMDumper::visit(ASM::RegisterNode& node) {
-    switch (node.reg_) {
-        case ASM::Register::AX:
-            buffer_.push_back("\%eax");
+void ASMDumper::dump_instruction(const ASM::Instruction& instruction) {
+    switch (instruction.op_) {
+        case ASM::OpCode::NEG: dump_unary("\tnegl   ", instruction.dst_); break;
+        case ASM::OpCode::NOT: dump_unary("\tnotl   ", instruction.dst_); break;
+        case ASM::OpCode::DIV: dump_unary("\tidivl  ", instruction.src_); break;
+        case ASM::OpCode::MOV: dump_binary("\tmovl   ", instruction); break;
+        case ASM::OpCode::MOVB: dump_binary("\tmovb   ", instruction, Width::BYTE, Width::BYTE); break;
+        case ASM::OpCode::MOVSX: dump_binary("\tmovslq ", instruction, Width::LONG, Width::QUAD); break;
+        case ASM::OpCode::MULT64: dump_binary("\timulq  ", instruction, Width::QUAD, Width::QUAD); break;
+        case ASM::OpCode::SAR64: dump_binary("\tsarq  ", instruction, Width::QUAD, Width::QUAD); break;
+        case ASM::OpCode::MULT: dump_binary("\timull  ", instruction); break;
+        case ASM::OpCode::ADD: dump_binary("\taddl  ", instruction); break;
+        case ASM::OpCode::SUB: dump_binary("\tsubl  ", instruction); break;
+        case ASM::OpCode::BITWISE_AND: dump_binary("\tandl  ", instruction); break;
+        case ASM::OpCode::BITWISE_OR: dump_binary("\torl  ", instruction); break;
+        case ASM::OpCode::BITWISE_XOR: dump_binary("\txorl  ", instruction); break;
+        case ASM::OpCode::SAR: dump_binary("\tsarl  ", instruction); break;
+        case ASM::OpCode::SAL: dump_binary("\tsall  ", instruction); break;
+        case ASM::OpCode::CMP: dump_binary("\tcmpl  ", instruction); break;
+        case ASM::OpCode::TEST: dump_binary("\ttestl ", instruction); break;
+        case ASM::OpCode::SETE: dump_unary("\tsete   ", instruction.dst_, Width::BYTE); break;
+        case ASM::OpCode::SETNE: dump_unary("\tsetne  ", instruction.dst_, Width::BYTE); break;
+        case ASM::OpCode::SETL: dump_unary("\tsetl   ", instruction.dst_, Width::BYTE); break;
+        case ASM::OpCode::SETLE: dump_unary("\tsetle  ", instruction.dst_, Width::BYTE); break;
+        case ASM::OpCode::SETG: dump_unary("\tsetg   ", instruction.dst_, Width::BYTE); break;
+        case ASM::OpCode::SETGE: dump_unary("\tsetge  ", instruction.dst_, Width::BYTE); break;
+        case ASM::OpCode::JMP: dump_unary("\tjmp    ", instruction.src_); break;
+        case ASM::OpCode::JE: dump_unary("\tje     ", instruction.src_); break;
+        case ASM::OpCode::JNE: dump_unary("\tjne    ", instruction.src_); break;
+        case ASM::OpCode::JL: dump_unary("\tjl     ", instruction.src_); break;
+        case ASM::OpCode::JLE: dump_unary("\tjle    ", instruction.src_); break;
+        case ASM::OpCode::JG: dump_unary("\tjg     ", instruction.src_); break;
+        case ASM::OpCode::JGE: dump_unary("\tjge    ", instruction.src_); break;
+        case ASM::OpCode::LABEL:
+            dump_operand(instruction.src_);
+            text_ += ":\n";
             break;
-        case ASM::Register::DX:
-            buffer_.push_back("\%edx");
+        case ASM::OpCode::LEA:
+            text_ += "\tleal   ";
+            dump_address(instruction);
+            text_ += ",  ";
+            dump_operand(instruction.dst_);
+            text_ += "\n";
             break;
-        case ASM::Register::CL:
-            buffer_.push_back("\%cl");
+        case ASM::OpCode::MULT3:
+            text_ += "\timull  ";
+            dump_operand(instruction.index_);
+            text_ += ",  ";
+            dump_operand(instruction.src_);
+            text_ += ",  ";
+            dump_operand(instruction.dst_);
+            text_ += "\n";
             break;
-        case ASM::Register::R10:
-            buffer_.push_back("\%r10d");
+        case ASM::OpCode::CDQ:
+            text_ += "\tcdq\n";
             break;
-        case ASM::Register::R11:
-            buffer_.push_back("\%r11d");
+        case ASM::OpCode::ALLOCATE_STACK:
+            text_ += "\tsubq   $";
+            dump_int(instruction.src_.imm_value());
+            text_ += ", %rsp\n";
+            break;
+        case ASM::OpCode::RET:
+            for (size_t i = 0; i < function_->saved_registers_.size(); i++) {
+                text_ += "\tmovq   -";
+                dump_int(8 * static_cast<int>(i + 1));
+                text_ += "(%rbp), ";
+                text_ += kQwordNames[function_->saved_registers_[i]];
+                text_ += "\n";
+            }
+            text_ += "\tmovq   %rbp,%rsp\n";
+            text_ += "\tpopq   %rbp\n";
+            text_ += "\tret\n";
             break;
-        default:
-            throw std::runtime_error("Unknown register type");
     }
 }
 
-void ASMDumper::visit(ASM::DivNode& node) {
-    node.src_->accept(*this);
-    auto operand = buffer_.back();
-    buffer_.pop_back();
-    of << "\tidivl  " + operand + "\n";
-}
-
-void ASMDumper::visit(ASM::MultNode& node) {
-    node.left_->accept(*this);
-    auto left = buffer_.back();
-    buffer_.pop_back();
-    node.right_->accept(*this);
-    auto right = buffer_.back();
-    buffer_.pop_back();
-    of << "\timull  " + left + ",  " + right + "\n";
-}
-
-void ASMDumper::visit(ASM::AddNode& node) {
-    node.left_->accept(*this);
-    auto left = buffer_.back();
-    buffer_.pop_back();
-    node.right_->accept(*this);
-    auto right = buffer_.back();
-    buffer_.pop_back();
-    of << "\taddl  " + left + ",  " + right + "\n";
-}
-
-void ASMDumper::visit(ASM::BitwiseAndNode& node) {
-    node.left_->accept(*this);
-    auto left = buffer_.back();
-    buffer_.pop_back();
-    node.right_->accept(*this);
-    auto right = buffer_.back();
-    buffer_.pop_back();
-    of << "\tandl  " + left + ",  " + right + "\n";
-}
-
-void ASMDumper::visit(ASM::BitwiseOrNode& node) {
-    node.left_->accept(*this);
-    auto left = buffer_.back();
-    buffer_.pop_back();
-    node.right_->accept(*this);
-    auto right = buffer_.back();
-    buffer_.pop_back();
-    of << "\torl  " + left + ",  " + right + "\n";
-}
-
-void ASMDumper::visit(ASM::BitwiseXorNode& node) {
-    node.left_->accept(*this);
-    auto left = buffer_.back();
-    buffer_.pop_back();
-    node.right_->accept(*this);
-    auto right = buffer_.back();
-    buffer_.pop_back();
-    of << "\txorl  " + left + ",  " + right + "\n";
-}
-
-void ASMDumper::visit(ASM::SarNode& node) {
-    node.left_->accept(*this);
-    auto left = buffer_.back();
-    buffer_.pop_back();
-    node.right_->accept(*this);
-    auto right = buffer_.back();
-    buffer_.pop_back();
-    of << "\tsarl  " + left + ",  " + right + "\n";
+void ASMDumper::dump_unary(const char* mnemonic, const ASM::Operand& operand, Width width) {
+    text_ += mnemonic;
+    dump_operand(operand, width);
+    text_ += "\n";
 }
 
-void ASMDumper::visit(ASM::SalNode& node) {
-    node.left_->accept(*this);
-    auto left = buffer_.back();
-    buffer_.pop_back();
-    node.right_->accept(*this);
-    auto right = buffer_.back();
-    buffer_.pop_back();
-    of << "\tsall  " + left + ",  " + right + "\n";
+void ASMDumper::dump_binary(const char* mnemonic, const ASM::Instruction& instruction, Width src_width, Width dst_width) {
+    text_ += mnemonic;
+    dump_operand(instruction.src_, src_width);
+    text_ += ",  ";
+    dump_operand(instruction.dst_, dst_width);
+    text_ += "\n";
 }
 
-void ASMDumper::visit(ASM::SubNode& node) {
-    node.left_->accept(*this);
-    auto left = buffer_.back();
-    buffer_.pop_back();
-    node.right_->accept(*this);
-    auto right = buffer_.back();
-    buffer_.pop_back();
-    of << "\tsubl  " + left + ",  " + right + "\n";
-}
-
-void ASMDumper::visit(ASM::CDQNode& node) {
-    of << "\tcdq\n";
-}
-
-void ASMDumper::visit(ASM::PseudoNode& node) {
-    throw std::runtime_error("Pseudo nodes should have vanished in the first asm pass.");
-}
-
-void ASMDumper::dump_assembly(std::shared_ptr<ASM::ProgramNode> asm_program) {
-    asm_program->accept(*this);
+// disp(base) or (base, index, scale), addresses take 64 bit registers and
+// the low 32 bits of the sum don't depend on the upper halves
+void ASMDumper::dump_address(const ASM::Instruction& instruction) {
+    if (instruction.index_.is_immediate()) {
+        if (instruction.index_.imm_value() != 0) {
+            dump_int(instruction.index_.imm_value());
+        }
+        text_ += '(';
+        dump_operand(instruction.src_, Width::QUAD);
+        text_ += ')';
+        return;
+    }
+    text_ += '(';
+    if (!instruction.src_.is_none()) {
+        dump_operand(instruction.src_, Width::QUAD);
+    }
+    text_ += ',';
+    dump_operand(instruction.index_, Width::QUAD);
+    text_ += ',';
+    dump_int(instruction.scale_);
+    text_ += ')';
+}
+
+void ASMDumper::dump_operand(const ASM::Operand& operand, Width width) {
+    switch (operand.kind()) {
+        case ASM::Operand::Kind::IMMEDIATE:
+            text_ += '$';
+            dump_int(operand.imm_value());
+            return;
+        case ASM::Operand::Kind::STACK:
+            dump_int(operand.stack_offset());
+            text_ += "(%rbp)";
+            return;
+        case ASM::Operand::Kind::REGISTER:
+            if (operand.reg() >= std::size(kDwordNames)) {
+                throw std::runtime_error("Unknown register type");
+            }
+            switch (width) {
+                case Width::BYTE: text_ += kByteNames[operand.reg()]; return;
+                case Width::LONG: text_ += kDwordNames[operand.reg()]; return;
+                case Width::QUAD: text_ += kQwordNames[operand.reg()]; return;
+            }
+            return;
+        // local to the object file, and to the function by its name
+        case ASM::Operand::Kind::LABEL:
+            text_ += ".L";
+            text_ += function_->name_.str();
+            text_ += '.';
+            dump_int(static_cast<int>(operand.label_id()));
+            return;
+        case ASM::Operand::Kind::PSEUDO:
+            throw std::runtime_error("Pseudo nodes should have vanished in the first asm pass.");
+        case ASM::Operand::Kind::NONE:
+            break;
+    }
+    throw std::runtime_error("Missing operand in ASM instruction");
 }
 
-} // namespace Codegen
\ No newline at end of file
+} // namespace Codegen
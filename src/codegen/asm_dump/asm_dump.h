@@ -5,36 +5,30 @@
 
 namespace Codegen {
 
-class ASMDumper : public ASM::Visitor {
+class ASMDumper {
 public:
     ~ASMDumper();
     ASMDumper(std::string filename);
-    void visit(ASM::ProgramNode& node) override;
-    void visit(ASM::FunctionNode& node) override;
-    void visit(ASM::NegNode& node) override;
-    void visit(ASM::NotNode& node) override;
-    void visit(ASM::MovNode& node) override;
-    void visit(ASM::MovBNode& node) override;
-    void visit(ASM::RetNode& node) override;
-    void visit(ASM::AllocateStackNode& node) override;
-    void visit(ASM::ImmNode& node) override;
-    void visit(ASM::StackNode& node) override;
-    void visit(ASM::RegisterNode& node) override;
-    void visit(ASM::PseudoNode& node) override;
-    void visit(ASM::DivNode& node) override;
-    void visit(ASM::MultNode& node) override;
-    void visit(ASM::AddNode& node) override;
-    void visit(ASM::SubNode& node) override;
-    void visit(ASM::CDQNode& node) override;
-    void visit(ASM::BitwiseAndNode& node) override;
-    void visit(ASM::BitwiseOrNode& node) override;
-    void visit(ASM::BitwiseXorNode& node) override;
-    void visit(ASM::SalNode& node) override;
-    void visit(ASM::SarNode& node) override;
-    void dump_assembly(std::shared_ptr<ASM::ProgramNode> asm_program);
-    std::vector<std::string> asm_text_dump_, buffer_;
+    void dump_assembly(const ASM::Program& asm_program);
     std::string target_filename_;
     std::ofstream of;
+private:
+    void dump_function(const ASM::Function& function);
+    void dump_instruction(const ASM::Instruction& instruction);
+    // registers are named after the width the instruction works on
+    enum class Width { BYTE, LONG, QUAD };
+    void dump_operand(const ASM::Operand& operand, Width width = Width::LONG);
+    void dump_unary(const char* mnemonic, const ASM::Operand& operand, Width width = Width::LONG);
+    void dump_binary(const char* mnemonic, const ASM::Instruction& instruction,
+        Width src_width = Width::LONG, Width dst_width = Width::LONG);
+    void dump_address(const ASM::Instruction& instruction);
+    void dump_int(int value);
+    void flush();
+    // text is formatted here and written out in large blocks
+    static constexpr size_t kFlushThreshold = 1 << 16;
+    std::string text_;
+    // the function being dumped, its saved registers are restored on ret
+    const ASM::Function* function_ = nullptr;
 };
 
-}
\ No newline at end of file
+}
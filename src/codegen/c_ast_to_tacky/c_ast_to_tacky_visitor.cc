@@ -1,169 +1,159 @@
 #include "src/codegen/c_ast_to_tacky/c_ast_to_tacky.h"
 #include "src/tacky/tacky.h"
-#include <memory>
-#include <algorithm>
 
 namespace Codegen {
 
-template<typename T>
-std::shared_ptr<T> AstToTackyVisitor::get_result()
-{
-    if (result_buffer_.empty()) {
-        throw std::runtime_error("Result buffer is empty when fetching result");
-    }
-    auto ast_node = result_buffer_.back();
-    result_buffer_.pop_back();
-    auto casted_node = std::dynamic_pointer_cast<T>(ast_node);
-    if (!casted_node) {
-        throw std::runtime_error("Failed to cast AST node in result buffer");
-    }
-    return casted_node;
-}
-
-template <typename T>
-std::vector<std::shared_ptr<T>> AstToTackyVisitor::get_results() {
-    std::vector<std::shared_ptr<T>> results;
-    while (!result_buffer_.empty()) {
-        auto back_node = get_result<T>();
-        results.push_back(back_node);
+namespace {
+
+// whether evaluating node can divide by zero or overflow INT_MIN / -1
+bool may_trap(const CAst::ExpressionNode& node) {
+    switch (node.kind_) {
+        case CAst::NodeKind::UNARY_EXPRESSION:
+            return may_trap(*static_cast<const CAst::UnaryExpressionNode&>(node).operand_);
+        case CAst::NodeKind::BINARY_EXPRESSION: {
+            auto& binary = static_cast<const CAst::BinaryExpressionNode&>(node);
+            if (binary.op_ == CAst::BinaryOperator::DIV || binary.op_ == CAst::BinaryOperator::MOD) {
+                auto& divisor = *binary.right_;
+                if (divisor.kind_ != CAst::NodeKind::INTEGER_VALUE) {
+                    return true;
+                }
+                auto value = static_cast<const CAst::IntegerValueNode&>(divisor).value_;
+                if (value == 0 || value == -1) {
+                    return true;
+                }
+            }
+            return may_trap(*binary.left_) || may_trap(*binary.right_);
+        }
+        default:
+            return false;
     }
-    std::reverse(results.begin(), results.end());
-    return results;
-}
-
-template<std::derived_from<Tacky::BinaryOpNode> T>
-void AstToTackyVisitor::visit_bin_exp(CAst::BinaryExpressionNode& node) {
-    node.left_->accept(*this);
-    auto left_expression_result = get_result<Tacky::ValueNode>();
-    node.right_->accept(*this);
-    auto right_expression_result = get_result<Tacky::ValueNode>();
-    auto dst = generate_temp_var_name();
-
-    auto dst_node = std::make_shared<Tacky::VariableNode>(dst);
-
-    auto tacky_op = std::make_shared<T>(
-        left_expression_result,
-        right_expression_result,
-        dst_node
-    );
-
-    result_buffer_.push_back(tacky_op);
-    result_buffer_.push_back(dst_node);    
 }
 
+} // namespace
 
-template<std::derived_from<Tacky::UnaryNode> T>
-void AstToTackyVisitor::visit_un_exp(CAst::UnaryExpressionNode& node) {
-
-    node.operand_->accept(*this);
-
-    auto inner_expression_result = get_result<Tacky::ValueNode>();
-    auto dst = generate_temp_var_name();
-
-    auto tacky_op = std::make_shared<T>(
-        inner_expression_result,
-        std::make_shared<Tacky::VariableNode>(dst)
-    );
-
-    auto value_return_hint = std::make_shared<Tacky::VariableNode>(dst);
-    
-    result_buffer_.push_back(tacky_op);
-    result_buffer_.push_back(value_return_hint);
-}
-
-std::shared_ptr<Tacky::ProgramNode> AstToTackyVisitor::get_tacky_from_c_ast(std::shared_ptr<CAst::ProgramNode> root_node)
+Tacky::Program AstToTackyVisitor::get_tacky_from_c_ast(std::shared_ptr<CAst::ProgramNode> root_node)
 {
-    if (!result_buffer_.empty()) {
-        throw std::runtime_error("Result buffer not empty at start of conversion");
-    }
-    root_node->accept(*this);
-    if (result_buffer_.size() != 1) {
-        throw std::runtime_error("Expected exactly one Tacky AST root node");
+    Tacky::Program program;
+    program.functions_.reserve(root_node->functions_.size());
+    for (auto& function : root_node->functions_) {
+        program.functions_.push_back(visit(*function));
     }
-    auto result_node = std::dynamic_pointer_cast<Tacky::ProgramNode>(result_buffer_.back());
-    result_buffer_.pop_back();
-    if (!result_node) {
-        throw std::runtime_error("Expected Tacky ProgramNode as conversion result");
-    }
-    return result_node;
+    return program;
 }
 
-void AstToTackyVisitor::visit(CAst::ProgramNode& node) {
-    for (auto& function : node.functions_) {
-        function->accept(*this);
+Tacky::Function AstToTackyVisitor::visit(CAst::FunctionNode& node) {
+    Tacky::Function function;
+    function.name_ = node.name_;
+    function_ = &function;
+    for (auto& statement : node.body_->statements_) {
+        visit(*statement);
     }
-    auto functions = get_results<Tacky::FunctionNode>();
-    auto result = std::make_shared<Tacky::ProgramNode>(std::move(functions) );
-    result_buffer_.push_back(result);
+    function_ = nullptr;
+    return function;
 }
 
-void AstToTackyVisitor::visit(CAst::FunctionNode& node) {
-    for (auto& statement : node.body_->statements_) {
-        statement->accept(*this);
+void AstToTackyVisitor::visit(CAst::StatementNode& node) {
+    switch (node.kind_) {
+        case CAst::NodeKind::RETURN_STATEMENT:
+            visit(static_cast<CAst::ReturnStatementNode&>(node));
+            break;
+        default:
+            throw std::runtime_error("Unexpected statement kind while emitting tacky");
     }
-
-    auto tacky_instructions = get_results<Tacky::InstructionNode>();
-
-    auto function_result = std::make_shared<Tacky::FunctionNode>(
-        node.name_,
-        tacky_instructions
-    );
-
-    result_buffer_.push_back(function_result);
 }
 
 void AstToTackyVisitor::visit(CAst::ReturnStatementNode& node) {
     if (node.type_ != CAst::Type::INTEGER) {
        throw std::runtime_error("Only integer return types are supported for now");
     }
-
-    // recursively parses an expression and returns a value node
-    node.return_value_->accept(*this);
-
-    // if we end up on a leaf value node, we can just create a return node
-    // leaf visitors push the value onto the stack
-
-    result_buffer_.push_back(
-        std::make_shared<Tacky::ReturnNode>(get_result<Tacky::ValueNode>())
-    );
-
+    auto value = visit(*node.return_value_);
+    emit_control(Tacky::OpCode::RETURN, value);
 }
 
-// unary expressions
-void AstToTackyVisitor::visit(CAst::TildeUnaryExpressionNode& node) {visit_un_exp<Tacky::ComplementNode>(node);}
-void AstToTackyVisitor::visit(CAst::MinusUnaryExpressionNode& node) {visit_un_exp<Tacky::NegateNode>(node);}
-void AstToTackyVisitor::visit(CAst::NotUnaryExpressionNode& node) {visit_un_exp<Tacky::NotNode>(node);}
-
-// unary arithmetic expressions
-void AstToTackyVisitor::visit(CAst::DivNode& node) {visit_bin_exp<Tacky::DivNode>(node);}
-void AstToTackyVisitor::visit(CAst::MultNode& node) {visit_bin_exp<Tacky::MultNode>(node);}
-void AstToTackyVisitor::visit(CAst::ModNode& node) {visit_bin_exp<Tacky::ModNode>(node);}
-void AstToTackyVisitor::visit(CAst::MinusNode& node) {visit_bin_exp<Tacky::MinusNode>(node);}
-void AstToTackyVisitor::visit(CAst::PlusNode& node) {visit_bin_exp<Tacky::PlusNode>(node);}
-
-// unary boolean expressions
-void AstToTackyVisitor::visit(CAst::AndNode& node) {visit_bin_exp<Tacky::AndNode>(node);}
-void AstToTackyVisitor::visit(CAst::BitwiseAndNode& node) {visit_bin_exp<Tacky::BitwiseAndNode>(node);}
-void AstToTackyVisitor::visit(CAst::OrNode& node) {visit_bin_exp<Tacky::OrNode>(node);}
-void AstToTackyVisitor::visit(CAst::BitwiseOrNode& node) {visit_bin_exp<Tacky::BitwiseOrNode>(node);}
-void AstToTackyVisitor::visit(CAst::BitwiseLeftShiftNode& node) {visit_bin_exp<Tacky::BitwiseLeftShiftNode>(node);}
-void AstToTackyVisitor::visit(CAst::BitwiseRightShiftNode& node) {visit_bin_exp<Tacky::BitwiseRightShiftNode>(node);}
-void AstToTackyVisitor::visit(CAst::BitwiseXorNode& node) {visit_bin_exp<Tacky::BitwiseXorNode>(node);}
+Tacky::Value AstToTackyVisitor::visit(CAst::ExpressionNode& node) {
+    switch (node.kind_) {
+        case CAst::NodeKind::INTEGER_VALUE:
+            // constants are operands, they need no instruction
+            return Tacky::Value::constant(static_cast<CAst::IntegerValueNode&>(node).value_);
+        case CAst::NodeKind::UNARY_EXPRESSION:
+            return visit(static_cast<CAst::UnaryExpressionNode&>(node));
+        case CAst::NodeKind::BINARY_EXPRESSION:
+            return visit(static_cast<CAst::BinaryExpressionNode&>(node));
+        default:
+            throw std::runtime_error("Unexpected expression kind while emitting tacky");
+    }
+}
 
-void AstToTackyVisitor::visit(CAst::IntegerValueNode& node) {
-    result_buffer_.push_back(
-        std::make_shared<Tacky::IntegerNode>(node.value_)
-    );
+Tacky::Value AstToTackyVisitor::visit(CAst::UnaryExpressionNode& node) {
+    auto operand = visit(*node.operand_);
+    switch (node.op_) {
+        case CAst::UnaryOperator::COMPLEMENT: return emit(Tacky::OpCode::COMPLEMENT, operand);
+        case CAst::UnaryOperator::NEGATE: return emit(Tacky::OpCode::NEGATE, operand);
+        case CAst::UnaryOperator::NOT: return emit(Tacky::OpCode::NOT, operand);
+    }
+    throw std::runtime_error("Unexpected unary operator while emitting tacky");
 }
 
-void AstToTackyVisitor::visit(CAst::TypeNode& node) {}
+Tacky::Value AstToTackyVisitor::visit(CAst::BinaryExpressionNode& node) {
+    if (node.op_ == CAst::BinaryOperator::AND || node.op_ == CAst::BinaryOperator::OR) {
+        return visit_logical(node);
+    }
+    auto left = visit(*node.left_);
+    auto right = visit(*node.right_);
+    switch (node.op_) {
+        // arithmetic
+        case CAst::BinaryOperator::DIV: return emit(Tacky::OpCode::DIV, left, right);
+        case CAst::BinaryOperator::MULT: return emit(Tacky::OpCode::MULT, left, right);
+        case CAst::BinaryOperator::MOD: return emit(Tacky::OpCode::MOD, left, right);
+        case CAst::BinaryOperator::MINUS: return emit(Tacky::OpCode::MINUS, left, right);
+        case CAst::BinaryOperator::PLUS: return emit(Tacky::OpCode::PLUS, left, right);
+        // bitwise
+        case CAst::BinaryOperator::BITWISE_AND: return emit(Tacky::OpCode::BITWISE_AND, left, right);
+        case CAst::BinaryOperator::BITWISE_OR: return emit(Tacky::OpCode::BITWISE_OR, left, right);
+        case CAst::BinaryOperator::LEFT_SHIFT: return emit(Tacky::OpCode::LEFT_SHIFT, left, right);
+        case CAst::BinaryOperator::RIGHT_SHIFT: return emit(Tacky::OpCode::RIGHT_SHIFT, left, right);
+        case CAst::BinaryOperator::BITWISE_XOR: return emit(Tacky::OpCode::BITWISE_XOR, left, right);
+        // relational
+        case CAst::BinaryOperator::EQUAL: return emit(Tacky::OpCode::EQUAL, left, right);
+        case CAst::BinaryOperator::NOT_EQUAL: return emit(Tacky::OpCode::NOT_EQUAL, left, right);
+        case CAst::BinaryOperator::LESS: return emit(Tacky::OpCode::LESS, left, right);
+        case CAst::BinaryOperator::GREATER: return emit(Tacky::OpCode::GREATER, left, right);
+        case CAst::BinaryOperator::LESS_EQ: return emit(Tacky::OpCode::LESS_EQ, left, right);
+        case CAst::BinaryOperator::GREATER_EQ: return emit(Tacky::OpCode::GREATER_EQ, left, right);
+        default: break;
+    }
+    throw std::runtime_error("Unexpected binary operator while emitting tacky");
+}
 
-void AstToTackyVisitor::visit(CAst::FunctionArgumentsNode& node) {}
+// && and || skip their right operand when the left one decides the result.
+// Expressions have no side effects besides trapping in a division, so a
+// right operand that can't trap is computed without branches, and one that
+// may is jumped over. The && or || after the label reads it on both paths,
+// on the one that skipped it its value doesn't change the result.
+Tacky::Value AstToTackyVisitor::visit_logical(CAst::BinaryExpressionNode& node) {
+    auto op = node.op_ == CAst::BinaryOperator::AND ? Tacky::OpCode::AND : Tacky::OpCode::OR;
+    auto left = visit(*node.left_);
+    if (!may_trap(*node.right_)) {
+        return emit(op, left, visit(*node.right_));
+    }
+    auto skip = Tacky::Value::label(function_->label_count_++);
+    emit_control(op == Tacky::OpCode::AND ? Tacky::OpCode::JUMP_IF_ZERO : Tacky::OpCode::JUMP_IF_NOT_ZERO,
+        left, skip);
+    auto right = visit(*node.right_);
+    emit_control(Tacky::OpCode::LABEL, skip);
+    return emit(op, left, right);
+}
 
-void AstToTackyVisitor::visit(CAst::StatementBlockNode& node) {}
+// appends dst = op src1 [src2] into a fresh temporary and returns it
+Tacky::Value AstToTackyVisitor::emit(Tacky::OpCode op, Tacky::Value src1, Tacky::Value src2) {
+    auto dst = Tacky::Value::temporary(function_->temporary_count_++);
+    function_->instructions_.push_back({op, dst, src1, src2});
+    return dst;
+}
 
-std::string AstToTackyVisitor::generate_temp_var_name() {
-    return "_tacky_temp_" + std::to_string(temp_var_counter_++);
+// appends an instruction without a dst, a return, label or jump
+void AstToTackyVisitor::emit_control(Tacky::OpCode op, Tacky::Value src1, Tacky::Value src2) {
+    function_->instructions_.push_back({op, Tacky::Value(), src1, src2});
 }
 
-} // namespace Codegen
\ No newline at end of file
+} // namespace Codegen
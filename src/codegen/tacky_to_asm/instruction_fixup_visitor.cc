@@ -1,293 +1,180 @@
 #include "src/codegen/tacky_to_asm/tacky_to_asm.h"
 
-#include <iostream>
-
 namespace Codegen {
 
-void InstructionFixUpVisitor::visit(ASM::FunctionNode& node) {
-    std::vector<std::shared_ptr<ASM::InstructionNode>> processed_instructions;
-    for(auto& instruction : node.instructions_) {
-        instruction->accept(*this);
-        while(!buffer_.empty()) {
-            auto processed_instruction = As<ASM::InstructionNode>(
-                buffer_.front(),
-                std::string("Failed to cast buffered instruction as ASM::InstructionNode")
-            );
-            buffer_.pop_front();
-            processed_instructions.push_back(processed_instruction);
+void InstructionFixUpVisitor::rewrite(ASM::Program& program) {
+    for (auto& function : program.functions_) {
+        int aligned_stack_size = (8 + function.frame_size_ + 15)/16;
+        aligned_stack_size *= 16;
+        // the saved registers were already pushed by the prologue
+        aligned_stack_size -= 8 * static_cast<int>(function.saved_registers_.size());
+        ASM::Rewriter rewriter(function.instructions_);
+        rewriter.insert({ASM::OpCode::ALLOCATE_STACK, ASM::Operand::imm(aligned_stack_size)});
+        while (!rewriter.at_end()) {
+            fix_up(rewriter);
         }
     }
-    int aligned_stack_size = (8 + max_stack_offset_ + 15)/16;
-    aligned_stack_size *= 16;
-    processed_instructions.insert(
-        processed_instructions.begin(),
-        std::make_shared<ASM::AllocateStackNode>(aligned_stack_size)
-    );
-    buffer_.push_back(
-        std::make_shared<ASM::FunctionNode>(
-            node.name_,
-            std::move(processed_instructions)
-        )
-    );
-}
-
-void InstructionFixUpVisitor::visit(ASM::MovNode& node) {
-    bool must_split_dual_memory_access = false;
-    node.src_->accept(*this);
-    auto fixed_src = As<ASM::OperandNode>(buffer_.back(), "Failed to cast buffered src to ASM::OperandNode.");
-    buffer_.pop_back();
-    auto src_as_stack = std::dynamic_pointer_cast<ASM::StackNode>(fixed_src);
-    node.dst_->accept(*this);
-    auto fixed_dst = As<ASM::OperandNode>(buffer_.back(), "Failed to cast buffered dst to ASM::OperandNode.");
-    buffer_.pop_back();
-    auto dst_as_stack = std::dynamic_pointer_cast<ASM::StackNode>(fixed_dst);
-    if (dst_as_stack && src_as_stack) {
-        must_split_dual_memory_access = true;
-    }
-    if (must_split_dual_memory_access) {
-        auto swap_register = std::make_shared<ASM::RegisterNode>(ASM::Register::R10);
-        auto first_move = std::make_shared<ASM::MovNode>(fixed_src, swap_register);
-        auto second_move = std::make_shared<ASM::MovNode>(swap_register, fixed_dst);
-        buffer_.push_back(std::move(first_move));
-        buffer_.push_back(std::move(second_move));
-        return;
-    }
-    buffer_.push_back(std::make_shared<ASM::MovNode>(node.src_, node.dst_));
-}
-
-void InstructionFixUpVisitor::visit(ASM::MovBNode& node) {
-    bool must_split_dual_memory_access = false;
-    node.src_->accept(*this);
-    auto fixed_src = As<ASM::OperandNode>(buffer_.back(), "Failed to cast buffered src to ASM::OperandNode.");
-    buffer_.pop_back();
-    auto src_as_stack = std::dynamic_pointer_cast<ASM::StackNode>(fixed_src);
-    node.dst_->accept(*this);
-    auto fixed_dst = As<ASM::OperandNode>(buffer_.back(), "Failed to cast buffered dst to ASM::OperandNode.");
-    buffer_.pop_back();
-    auto dst_as_stack = std::dynamic_pointer_cast<ASM::StackNode>(fixed_dst);
-    if (dst_as_stack && src_as_stack) {
-        must_split_dual_memory_access = true;
-    }
-    if (must_split_dual_memory_access) {
-        auto swap_register = std::make_shared<ASM::RegisterNode>(ASM::Register::R10b);
-        auto first_move = std::make_shared<ASM::MovBNode>(fixed_src, swap_register);
-        auto second_move = std::make_shared<ASM::MovBNode>(swap_register, fixed_dst);
-        buffer_.push_back(std::move(first_move));
-        buffer_.push_back(std::move(second_move));
-        return;
-    }
-    buffer_.push_back(std::make_shared<ASM::MovBNode>(node.src_, node.dst_));
-}
-
-
-void InstructionFixUpVisitor::visit(ASM::DivNode& node) {
-    auto src_as_imm = std::dynamic_pointer_cast<ASM::ImmNode>(node.src_);
-    if (src_as_imm) {
-        auto new_target_location = std::make_shared<ASM::RegisterNode>(ASM::Register::R10);
-        buffer_.push_back(std::make_shared<ASM::MovNode>(
-            node.src_,
-            new_target_location
-        ));
-        buffer_.push_back(std::make_shared<ASM::DivNode>(
-            new_target_location
-        ));
-    } else {
-        buffer_.push_back(std::make_shared<ASM::DivNode>(
-            node.src_
-        ));
-    }
-}
-
-void InstructionFixUpVisitor::visit(ASM::AddNode& node) {
-    auto left_as_stack_locations = std::dynamic_pointer_cast<ASM::StackNode>(node.left_);
-    auto right_as_stack_locations = std::dynamic_pointer_cast<ASM::StackNode>(node.right_);
-    if (
-        left_as_stack_locations &&
-        right_as_stack_locations
-    ) {
-        auto r10 = std::make_shared<ASM::RegisterNode>(ASM::Register::R10);
-        buffer_.push_back(std::make_shared<ASM::MovNode>(
-            node.left_,
-            r10
-        ));
-        buffer_.push_back(std::make_shared<ASM::AddNode>(
-            r10,
-            node.right_
-        ));
-    } else {
-        buffer_.push_back(std::make_shared<ASM::AddNode>(
-            node.left_,
-            node.right_
-        ));
-    }
-}
-
-void InstructionFixUpVisitor::visit(ASM::SubNode& node) {
-    auto left_as_stack_locations = std::dynamic_pointer_cast<ASM::StackNode>(node.left_);
-    auto right_as_stack_locations = std::dynamic_pointer_cast<ASM::StackNode>(node.right_);
-    if (
-        left_as_stack_locations &&
-        right_as_stack_locations
-    ) {
-        auto r10 = std::make_shared<ASM::RegisterNode>(ASM::Register::R10);
-        buffer_.push_back(std::make_shared<ASM::MovNode>(
-            node.left_,
-            r10
-        ));
-        buffer_.push_back(std::make_shared<ASM::SubNode>(
-            r10,
-            node.right_
-        ));
-    } else {
-        buffer_.push_back(std::make_shared<ASM::SubNode>(
-            node.left_,
-            node.right_
-        ));
-    }
-}
-
-void InstructionFixUpVisitor::visit(ASM::MultNode& node) {
-    auto right_operand_as_stack = std::dynamic_pointer_cast<ASM::StackNode>(node.right_);
-    if (right_operand_as_stack) {
-        auto r11 = std::make_shared<ASM::RegisterNode>(ASM::Register::R11);
-        buffer_.push_back(std::make_shared<ASM::MovNode>(
-            node.right_,
-            r11
-        ));
-        buffer_.push_back(std::make_shared<ASM::MultNode>(
-            node.left_,
-            r11
-        ));
-        buffer_.push_back(std::make_shared<ASM::MovNode>(
-            r11,
-            node.right_
-        ));
-    } else {
-        buffer_.push_back(std::make_shared<ASM::MultNode>(
-            node.left_,
-            node.right_
-        ));
-    }
-}
-
-void InstructionFixUpVisitor::visit(ASM::BitwiseAndNode& node) {
-    auto right_operand_as_stack = std::dynamic_pointer_cast<ASM::StackNode>(node.right_);
-    if (right_operand_as_stack) {
-        auto r11 = std::make_shared<ASM::RegisterNode>(ASM::Register::R11);
-        buffer_.push_back(std::make_shared<ASM::MovNode>(
-            node.right_,
-            r11
-        ));
-        buffer_.push_back(std::make_shared<ASM::BitwiseAndNode>(
-            node.left_,
-            r11
-        ));
-        buffer_.push_back(std::make_shared<ASM::MovNode>(
-            r11,
-            node.right_
-        ));
-    } else {
-        buffer_.push_back(std::make_shared<ASM::BitwiseAndNode>(
-            node.left_,
-            node.right_
-        ));
-    }
 }
 
-void InstructionFixUpVisitor::visit(ASM::BitwiseOrNode& node) {
-    auto right_operand_as_stack = std::dynamic_pointer_cast<ASM::StackNode>(node.right_);
-    if (right_operand_as_stack) {
-        auto r11 = std::make_shared<ASM::RegisterNode>(ASM::Register::R11);
-        buffer_.push_back(std::make_shared<ASM::MovNode>(
-            node.right_,
-            r11
-        ));
-        buffer_.push_back(std::make_shared<ASM::BitwiseOrNode>(
-            node.left_,
-            r11
-        ));
-        buffer_.push_back(std::make_shared<ASM::MovNode>(
-            r11,
-            node.right_
-        ));
-    } else {
-        buffer_.push_back(std::make_shared<ASM::BitwiseOrNode>(
-            node.left_,
-            node.right_
-        ));
-    }
-}
-
-void InstructionFixUpVisitor::visit(ASM::BitwiseXorNode& node) {
-    auto right_operand_as_stack = std::dynamic_pointer_cast<ASM::StackNode>(node.right_);
-    if (right_operand_as_stack) {
-        auto r11 = std::make_shared<ASM::RegisterNode>(ASM::Register::R11);
-        buffer_.push_back(std::make_shared<ASM::MovNode>(
-            node.right_,
-            r11
-        ));
-        buffer_.push_back(std::make_shared<ASM::BitwiseXorNode>(
-            node.left_,
-            r11
-        ));
-        buffer_.push_back(std::make_shared<ASM::MovNode>(
-            r11,
-            node.right_
-        ));
-    } else {
-        buffer_.push_back(std::make_shared<ASM::BitwiseXorNode>(
-            node.left_,
-            node.right_
-        ));
-    }
-}
-
-void InstructionFixUpVisitor::visit(ASM::SalNode& node) {
-    std::shared_ptr<ASM::OperandNode> shift_amount = std::dynamic_pointer_cast<ASM::ImmNode>(node.left_);
-    if (!shift_amount) {
-         shift_amount = std::make_shared<ASM::RegisterNode>(ASM::Register::CL);
-         buffer_.push_back(std::make_shared<ASM::MovBNode>(
-            node.left_,
-            shift_amount
-         ));
-    }
-    auto r11 = std::make_shared<ASM::RegisterNode>(ASM::Register::R11);
-    buffer_.push_back(std::make_shared<ASM::MovNode>(
-        node.right_,
-        r11
-    ));
-    buffer_.push_back(std::make_shared<ASM::SalNode>(
-        shift_amount,
-        r11
-    ));
-    buffer_.push_back(std::make_shared<ASM::MovNode>(
-        r11,
-        node.right_
-    ));
-}
-
-void InstructionFixUpVisitor::visit(ASM::SarNode& node) {
-    std::shared_ptr<ASM::OperandNode> shift_amount = std::dynamic_pointer_cast<ASM::ImmNode>(node.left_);
-    if (!shift_amount) {
-         shift_amount = std::make_shared<ASM::RegisterNode>(ASM::Register::CL);
-         buffer_.push_back(std::make_shared<ASM::MovBNode>(
-            node.left_,
-            shift_amount
-         ));
+void InstructionFixUpVisitor::fix_up(ASM::Rewriter& rewriter) {
+    // a copy, replacing overwrites the slot the current instruction sits in
+    auto instruction = rewriter.current();
+    auto src = instruction.src_;
+    auto dst = instruction.dst_;
+    switch (instruction.op_) {
+        // no memory to memory moves
+        case ASM::OpCode::MOV:
+        case ASM::OpCode::MOVB: {
+            if (src.is_stack() && dst.is_stack()) {
+                auto swap_register = ASM::Operand::reg(
+                    instruction.op_ == ASM::OpCode::MOV ? ASM::Register::R10 : ASM::Register::R10b);
+                rewriter.replace({
+                    {instruction.op_, src, swap_register},
+                    {instruction.op_, swap_register, dst},
+                });
+                return;
+            }
+            break;
+        }
+        // idiv can't take an immediate
+        case ASM::OpCode::DIV: {
+            if (src.is_immediate()) {
+                auto r10 = ASM::Operand::reg(ASM::Register::R10);
+                rewriter.replace({
+                    {ASM::OpCode::MOV, src, r10},
+                    {ASM::OpCode::DIV, r10},
+                });
+                return;
+            }
+            break;
+        }
+        case ASM::OpCode::ADD:
+        case ASM::OpCode::SUB: {
+            if (src.is_stack() && dst.is_stack()) {
+                auto r10 = ASM::Operand::reg(ASM::Register::R10);
+                rewriter.replace({
+                    {ASM::OpCode::MOV, src, r10},
+                    {instruction.op_, r10, dst},
+                });
+                return;
+            }
+            break;
+        }
+        // these go through R11 when the destination lives in memory
+        case ASM::OpCode::MULT:
+        case ASM::OpCode::BITWISE_AND:
+        case ASM::OpCode::BITWISE_OR:
+        case ASM::OpCode::BITWISE_XOR: {
+            if (dst.is_stack()) {
+                auto r11 = ASM::Operand::reg(ASM::Register::R11);
+                rewriter.replace({
+                    {ASM::OpCode::MOV, dst, r11},
+                    {instruction.op_, src, r11},
+                    {ASM::OpCode::MOV, r11, dst},
+                });
+                return;
+            }
+            break;
+        }
+        // lea addresses through registers and writes one, spilled or
+        // rematerialized operands go through R10 and R11. A rematerialized
+        // index only works as is when it reads as a displacement.
+        case ASM::OpCode::LEA: {
+            auto r10 = ASM::Operand::reg(ASM::Register::R10);
+            auto r11 = ASM::Operand::reg(ASM::Register::R11);
+            if (!src.is_none() && !src.is_register()) {
+                rewriter.insert({ASM::OpCode::MOV, src, r10});
+                instruction.src_ = r10;
+            }
+            auto index = instruction.index_;
+            if (index.is_stack() || (index.is_immediate() && (instruction.scale_ != 1 || src.is_none()))) {
+                rewriter.insert({ASM::OpCode::MOV, instruction.index_, r11});
+                instruction.index_ = r11;
+            }
+            if (dst.is_stack()) {
+                instruction.dst_ = r11;
+                rewriter.replace({instruction, {ASM::OpCode::MOV, r11, dst}});
+                return;
+            }
+            rewriter.replace({instruction});
+            return;
+        }
+        // imul $imm, src, dst wants a register or memory src and a register dst
+        case ASM::OpCode::MULT3: {
+            auto r10 = ASM::Operand::reg(ASM::Register::R10);
+            auto r11 = ASM::Operand::reg(ASM::Register::R11);
+            if (src.is_immediate()) {
+                rewriter.insert({ASM::OpCode::MOV, src, r10});
+                instruction.src_ = r10;
+            }
+            if (dst.is_stack()) {
+                instruction.dst_ = r11;
+                rewriter.replace({instruction, {ASM::OpCode::MOV, r11, dst}});
+                return;
+            }
+            rewriter.replace({instruction});
+            return;
+        }
+        // cmp compares into a register or memory and takes at most one
+        // memory operand
+        case ASM::OpCode::CMP: {
+            if (dst.is_immediate()) {
+                auto r11 = ASM::Operand::reg(ASM::Register::R11);
+                rewriter.replace({
+                    {ASM::OpCode::MOV, dst, r11},
+                    {ASM::OpCode::CMP, src, r11},
+                });
+                return;
+            }
+            if (src.is_stack() && dst.is_stack()) {
+                auto r10 = ASM::Operand::reg(ASM::Register::R10);
+                rewriter.replace({
+                    {ASM::OpCode::MOV, src, r10},
+                    {ASM::OpCode::CMP, r10, dst},
+                });
+                return;
+            }
+            break;
+        }
+        // shift counts are either immediates or live in CL. The CPU only
+        // looks at the low 5 bits of CL, an immediate count out of range
+        // (undefined in C) is masked the same way so it still encodes.
+        case ASM::OpCode::SAL:
+        case ASM::OpCode::SAR: {
+            auto r11 = ASM::Operand::reg(ASM::Register::R11);
+            if (src.is_immediate()) {
+                src = ASM::Operand::imm(src.imm_value() & 31);
+                if (dst.is_register()) {
+                    rewriter.replace({{instruction.op_, src, dst}});
+                    return;
+                }
+                rewriter.replace({
+                    {ASM::OpCode::MOV, dst, r11},
+                    {instruction.op_, src, r11},
+                    {ASM::OpCode::MOV, r11, dst},
+                });
+                return;
+            }
+            auto cl = ASM::Operand::reg(ASM::Register::CL);
+            if (dst.is_register()) {
+                rewriter.replace({
+                    {ASM::OpCode::MOVB, src, cl},
+                    {instruction.op_, cl, dst},
+                });
+                return;
+            }
+            rewriter.replace({
+                {ASM::OpCode::MOVB, src, cl},
+                {ASM::OpCode::MOV, dst, r11},
+                {instruction.op_, cl, r11},
+                {ASM::OpCode::MOV, r11, dst},
+            });
+            return;
+        }
+        default:
+            break;
     }
-    auto r11 = std::make_shared<ASM::RegisterNode>(ASM::Register::R11);
-    buffer_.push_back(std::make_shared<ASM::MovNode>(
-        node.right_,
-        r11
-    ));
-    buffer_.push_back(std::make_shared<ASM::SarNode>(
-        shift_amount,
-        r11
-    ));
-    buffer_.push_back(std::make_shared<ASM::MovNode>(
-        r11,
-        node.right_
-    ));
+    rewriter.keep();
 }
 
 } // namespace Codegen
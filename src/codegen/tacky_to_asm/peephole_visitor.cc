@@ -0,0 +1,262 @@
+#include "src/codegen/tacky_to_asm/tacky_to_asm.h"
+
+#include <iterator>
+
+namespace Codegen {
+
+namespace {
+
+using Window = std::vector<ASM::Instruction>;
+
+// where the input continues after the output's tail, and what's live in
+// the input, which the rewrites of the tail leave as it was from there on
+struct Rest {
+    const ASM::Liveness& liveness_;
+    uint32_t position_;
+};
+
+// how far back dead_store() looks for stores later rewrites made dead
+constexpr size_t kStoreWindow = 4;
+
+bool is_move(const ASM::Instruction& instruction) {
+    return instruction.op_ == ASM::OpCode::MOV || instruction.op_ == ASM::OpCode::MOVB;
+}
+
+// ops that read src and can take a register or an immediate there instead
+// of a stack slot
+bool takes_any_source(ASM::OpCode op) {
+    switch (op) {
+        case ASM::OpCode::MOV:
+        case ASM::OpCode::ADD:
+        case ASM::OpCode::SUB:
+        case ASM::OpCode::MULT:
+        case ASM::OpCode::BITWISE_AND:
+        case ASM::OpCode::BITWISE_OR:
+        case ASM::OpCode::BITWISE_XOR:
+        case ASM::OpCode::CMP:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// ops whose only effect besides the flags is writing dst
+bool only_writes_dst(ASM::OpCode op) {
+    switch (op) {
+        case ASM::OpCode::MOV:
+        case ASM::OpCode::NEG:
+        case ASM::OpCode::NOT:
+        case ASM::OpCode::ADD:
+        case ASM::OpCode::SUB:
+        case ASM::OpCode::MULT:
+        case ASM::OpCode::BITWISE_AND:
+        case ASM::OpCode::BITWISE_OR:
+        case ASM::OpCode::BITWISE_XOR:
+        case ASM::OpCode::SAL:
+        case ASM::OpCode::SAR:
+        case ASM::OpCode::LEA:
+        case ASM::OpCode::MULT3:
+        case ASM::OpCode::SETE:
+        case ASM::OpCode::SETNE:
+        case ASM::OpCode::SETL:
+        case ASM::OpCode::SETLE:
+        case ASM::OpCode::SETG:
+        case ASM::OpCode::SETGE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// whether the value operand holds before following and rest is never read,
+// i.e. it's overwritten first or the function returns. following is only
+// straight line code, a jump or label there makes it live.
+bool dead(ASM::Operand operand, std::span<const ASM::Instruction> following, const Rest& rest) {
+    for (auto& instruction : following) {
+        if (ASM::reads(instruction, operand) || ASM::is_branch(instruction.op_)) {
+            return false;
+        }
+        if (ASM::overwrites(instruction, operand) || instruction.op_ == ASM::OpCode::RET) {
+            return true;
+        }
+    }
+    auto location = rest.liveness_.location(operand);
+    return location != ASM::Liveness::kNoLocation && !rest.liveness_.live_in(rest.position_, location);
+}
+
+// same as dead(), for the flags
+bool flags_dead(std::span<const ASM::Instruction> following, const Rest& rest) {
+    for (auto& instruction : following) {
+        if (ASM::reads_flags(instruction.op_) || ASM::is_branch(instruction.op_)) {
+            return false;
+        }
+        if (ASM::writes_flags(instruction.op_) || instruction.op_ == ASM::OpCode::RET) {
+            return true;
+        }
+    }
+    return !rest.liveness_.live_in(rest.position_, ASM::Liveness::kFlags);
+}
+
+// mov x, x
+bool self_move(Window& window, const Rest&) {
+    auto& last = window.back();
+    if (!is_move(last) || last.src_ != last.dst_) {
+        return false;
+    }
+    window.pop_back();
+    return true;
+}
+
+// mov a, b; mov b, a drops the second one, b already holds a
+bool redundant_move(Window& window, const Rest&) {
+    if (window.size() < 2) {
+        return false;
+    }
+    auto& first = window[window.size() - 2];
+    auto& second = window.back();
+    if (first.op_ != ASM::OpCode::MOV || second.op_ != ASM::OpCode::MOV ||
+        first.src_ != second.dst_ || first.dst_ != second.src_) {
+        return false;
+    }
+    window.pop_back();
+    return true;
+}
+
+// mov a, slot; op slot, d reads a straight from where it came from, when a
+// is a register or an immediate
+bool store_to_load(Window& window, const Rest&) {
+    if (window.size() < 2) {
+        return false;
+    }
+    auto& store = window[window.size() - 2];
+    auto& load = window.back();
+    if (store.op_ != ASM::OpCode::MOV || !store.dst_.is_stack() || load.src_ != store.dst_ ||
+        !takes_any_source(load.op_) || !(store.src_.is_register() || store.src_.is_immediate())) {
+        return false;
+    }
+    load.src_ = store.src_;
+    return true;
+}
+
+// mov a, r; op r, d becomes op a, d when nothing reads r afterwards, e.g.
+// the r10 bounce of a stack to stack move once one side is a register
+bool copy_through_dead_register(Window& window, const Rest& rest) {
+    if (window.size() < 2) {
+        return false;
+    }
+    auto& copy = window[window.size() - 2];
+    auto& use = window.back();
+    auto through = copy.dst_;
+    if (copy.op_ != ASM::OpCode::MOV || !through.is_register() || use.src_ != through ||
+        !takes_any_source(use.op_) || use.dst_ == through ||
+        (copy.src_.is_stack() && use.dst_.is_stack()) || !dead(through, {}, rest)) {
+        return false;
+    }
+    use.src_ = copy.src_;
+    window.erase(window.end() - 2);
+    return true;
+}
+
+// a write to a slot or register nobody reads before it's overwritten, and
+// whose flags nobody reads either. The last few are checked, forwarding can
+// take away the only read of a store a couple of instructions later.
+bool dead_store(Window& window, const Rest& rest) {
+    for (size_t back = 1; back <= kStoreWindow && back <= window.size(); back++) {
+        auto store = window.end() - back;
+        std::span<const ASM::Instruction> following(store + 1, window.end());
+        if (only_writes_dst(store->op_) && !store->dst_.is_none() && dead(store->dst_, following, rest) &&
+            (!ASM::writes_flags(store->op_) || flags_dead(following, rest))) {
+            window.erase(store);
+            return true;
+        }
+    }
+    return false;
+}
+
+// mov $0, reg becomes xor reg, reg, shorter and breaks the dependency on
+// the old value, unless a setcc or jcc still reads the flags it would
+// clobber
+bool zeroing_idiom(Window& window, const Rest& rest) {
+    auto& last = window.back();
+    if (last.op_ != ASM::OpCode::MOV || last.src_ != ASM::Operand::imm(0) || !last.dst_.is_register() ||
+        !flags_dead({}, rest)) {
+        return false;
+    }
+    last = {ASM::OpCode::BITWISE_XOR, last.dst_, last.dst_};
+    return true;
+}
+
+// cmp $0, reg becomes test reg, reg, same flags without the immediate
+bool test_idiom(Window& window, const Rest&) {
+    auto& last = window.back();
+    if (last.op_ != ASM::OpCode::CMP || last.src_ != ASM::Operand::imm(0) || !last.dst_.is_register()) {
+        return false;
+    }
+    last = {ASM::OpCode::TEST, last.dst_, last.dst_};
+    return true;
+}
+
+struct Rule {
+    const char* name;
+    bool (*apply)(Window& window, const Rest& rest);
+};
+
+// tried in order, the first one that matches wins
+constexpr Rule kRules[] = {
+    {"self move", self_move},
+    {"redundant move", redundant_move},
+    {"store to load forwarding", store_to_load},
+    {"copy through dead register", copy_through_dead_register},
+    {"dead store", dead_store},
+    {"zeroing idiom", zeroing_idiom},
+    {"test idiom", test_idiom},
+};
+
+static_assert(std::size(kRules) == PeepholeVisitor::kRuleCount);
+
+} // namespace
+
+void PeepholeVisitor::rewrite(ASM::Program& program) {
+    for (auto& function : program.functions_) {
+        rewrite(function);
+    }
+}
+
+// Instructions move to the output one at a time and the rules look at its
+// tail, with the liveness of the input telling what the instructions still
+// to come read. A rewrite can expose another match further back, e.g. a
+// forwarded load turning into a self move, so the rules run again until
+// none fires.
+void PeepholeVisitor::rewrite(ASM::Function& function) {
+    output_.clear();
+    output_.reserve(function.instructions_.size());
+    ASM::Liveness liveness(function);
+    auto& instructions = function.instructions_;
+    for (uint32_t i = 0; i < instructions.size(); i++) {
+        output_.push_back(instructions[i]);
+        while (!output_.empty() && apply_rules(liveness, i + 1)) {
+        }
+    }
+    function.instructions_.swap(output_);
+}
+
+bool PeepholeVisitor::apply_rules(const ASM::Liveness& liveness, uint32_t position) {
+    Rest rest{liveness, position};
+    for (size_t i = 0; i < kRuleCount; i++) {
+        if (kRules[i].apply(output_, rest)) {
+            hits_[i]++;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::pair<std::string, size_t>> PeepholeVisitor::hits() const {
+    std::vector<std::pair<std::string, size_t>> hits;
+    for (size_t i = 0; i < kRuleCount; i++) {
+        hits.emplace_back(kRules[i].name, hits_[i]);
+    }
+    return hits;
+}
+
+} // namespace Codegen
@@ -2,24 +2,78 @@
 
 namespace Codegen {
 
-void PseudoReplacerVisitor::visit(ASM::PseudoNode& node) {
-    if (stack_offsets_.count(node.name_) == 0) {
-        current_offset_ -= 4;
-        stack_offsets_[node.name_] = current_offset_;
+void PseudoReplacerVisitor::rewrite(ASM::Program& program) {
+    for (auto& function : program.functions_) {
+        rewrite(function);
     }
-    buffer_.push_back(
-        std::make_shared<ASM::StackNode>(stack_offsets_[node.name_])
-    );
 }
 
-int PseudoReplacerVisitor::get_offset() {
-    // this is consumed by the instruction fix up visitor
-    // let's return a positive value for sanity
-    if (current_offset_ > 0) {
-        throw std::runtime_error("Offset should be <=0, it is " + std::to_string(current_offset_));
+void PseudoReplacerVisitor::rewrite(ASM::Function& function) {
+    last_use_.assign(function.pseudo_count_, 0);
+    slots_.assign(function.pseudo_count_, kNoSlot);
+    free_slots_.clear();
+    slot_count_ = 0;
+    saved_bytes_ = 8 * static_cast<uint32_t>(function.saved_registers_.size());
+
+    auto& instructions = function.instructions_;
+    for (uint32_t position = 0; position < instructions.size(); position++) {
+        auto& instruction = instructions[position];
+        for (auto operand : {instruction.src_, instruction.index_, instruction.dst_}) {
+            if (!operand.is_pseudo()) {
+                continue;
+            }
+            if (operand.pseudo_id() >= function.pseudo_count_) {
+                throw std::runtime_error("Pseudo id " + std::to_string(operand.pseudo_id()) + " out of range for its function");
+            }
+            last_use_[operand.pseudo_id()] = position;
+        }
+    }
+
+    // only operands change, so every instruction is patched where it is
+    ASM::Rewriter rewriter(function.instructions_);
+    for (uint32_t position = 0; !rewriter.at_end(); position++) {
+        auto& instruction = rewriter.current();
+        auto src = instruction.src_;
+        auto index = instruction.index_;
+        auto dst = instruction.dst_;
+        instruction.src_ = replace(src);
+        instruction.index_ = replace(index);
+        instruction.dst_ = replace(dst);
+        // freed only after the instruction, so its operands never share a slot
+        release_if_dead(src, position);
+        release_if_dead(index, position);
+        release_if_dead(dst, position);
+        rewriter.keep();
+    }
+    function.frame_size_ = saved_bytes_ + 4 * slot_count_;
+}
+
+ASM::Operand PseudoReplacerVisitor::replace(ASM::Operand operand) {
+    if (!operand.is_pseudo()) {
+        return operand;
+    }
+    uint32_t& slot = slots_[operand.pseudo_id()];
+    if (slot == kNoSlot) {
+        if (free_slots_.empty()) {
+            slot = slot_count_++;
+        } else {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+        }
     }
-    return -1*current_offset_;
+    return ASM::Operand::stack(-static_cast<int>(saved_bytes_ + 4 * (slot + 1)));
 }
 
+void PseudoReplacerVisitor::release_if_dead(ASM::Operand operand, uint32_t position) {
+    if (!operand.is_pseudo()) {
+        return;
+    }
+    uint32_t& slot = slots_[operand.pseudo_id()];
+    // operands may be the same pseudo, release it once
+    if (last_use_[operand.pseudo_id()] == position && slot != kNoSlot) {
+        free_slots_.push_back(slot);
+        slot = kNoSlot;
+    }
+}
 
-} // namespace Codegen
\ No newline at end of file
+} // namespace Codegen
@@ -0,0 +1,155 @@
+#include "src/codegen/tacky_to_asm/tacky_to_asm.h"
+#include <algorithm>
+#include <bit>
+#include <iterator>
+#include <utility>
+
+namespace Codegen {
+
+namespace {
+
+// caller saved ones first, a callee saved register costs a save and restore
+constexpr ASM::Register kAllocatable[] = {
+    ASM::Register::SI, ASM::Register::DI, ASM::Register::R8, ASM::Register::R9,
+    ASM::Register::BX, ASM::Register::R12, ASM::Register::R13, ASM::Register::R14, ASM::Register::R15,
+};
+constexpr uint32_t kAllRegisters = (1u << std::size(kAllocatable)) - 1;
+
+} // namespace
+
+void RegisterAllocatorVisitor::rewrite(ASM::Program& program) {
+    for (auto& function : program.functions_) {
+        rewrite(function);
+    }
+}
+
+void RegisterAllocatorVisitor::rewrite(ASM::Function& function) {
+    compute_intervals(function);
+    allocate();
+    assign(function);
+}
+
+void RegisterAllocatorVisitor::compute_intervals(const ASM::Function& function) {
+    intervals_.assign(function.pseudo_count_, Interval());
+    order_.clear();
+    auto& instructions = function.instructions_;
+    for (uint32_t position = 0; position < instructions.size(); position++) {
+        auto& instruction = instructions[position];
+        std::pair<ASM::Operand, bool> operands[] = {
+            {instruction.src_, false}, {instruction.index_, false}, {instruction.dst_, true},
+        };
+        for (auto [operand, is_dst] : operands) {
+            if (!operand.is_pseudo()) {
+                continue;
+            }
+            if (operand.pseudo_id() >= function.pseudo_count_) {
+                throw std::runtime_error("Pseudo id " + std::to_string(operand.pseudo_id()) + " out of range for its function");
+            }
+            auto& interval = intervals_[operand.pseudo_id()];
+            if (!interval.seen_) {
+                interval.seen_ = true;
+                interval.start_ = position;
+                interval.constant_ = instruction.op_ == ASM::OpCode::MOV && is_dst && instruction.src_.is_immediate();
+                interval.value_ = instruction.src_.imm_value();
+                order_.push_back(operand.pseudo_id());
+            } else if (is_dst) {
+                // every instruction writing a dst after the first definition changes it
+                interval.constant_ = false;
+            }
+            interval.end_ = position;
+            interval.uses_++;
+        }
+    }
+}
+
+bool RegisterAllocatorVisitor::cheaper_to_spill(uint32_t a, uint32_t b) const {
+    auto& left = intervals_[a];
+    auto& right = intervals_[b];
+    // a spilled pseudo costs a memory access per use, a constant costs nothing
+    uint32_t left_cost = left.constant_ ? 0 : left.uses_;
+    uint32_t right_cost = right.constant_ ? 0 : right.uses_;
+    if (left_cost != right_cost) {
+        return left_cost < right_cost;
+    }
+    // on a tie, spilling the longer interval frees its register for longer
+    return left.end_ > right.end_;
+}
+
+void RegisterAllocatorVisitor::allocate() {
+    locations_.assign(intervals_.size(), kSpilled);
+    active_.clear();
+    free_registers_ = kAllRegisters;
+    used_registers_ = 0;
+    for (auto id : order_) {
+        auto& interval = intervals_[id];
+        // registers are freed after their last use, so operands of one instruction never share one
+        std::erase_if(active_, [&](uint32_t other) {
+            if (intervals_[other].end_ < interval.start_) {
+                free_registers_ |= 1u << locations_[other];
+                return true;
+            }
+            return false;
+        });
+        if (free_registers_ != 0) {
+            auto index = static_cast<uint8_t>(std::countr_zero(free_registers_));
+            free_registers_ &= ~(1u << index);
+            used_registers_ |= 1u << index;
+            locations_[id] = index;
+            active_.push_back(id);
+            continue;
+        }
+        uint32_t victim = id;
+        for (auto other : active_) {
+            if (cheaper_to_spill(other, victim)) {
+                victim = other;
+            }
+        }
+        if (victim != id) {
+            locations_[id] = locations_[victim];
+            locations_[victim] = kSpilled;
+            std::replace(active_.begin(), active_.end(), victim, id);
+        }
+    }
+}
+
+void RegisterAllocatorVisitor::assign(ASM::Function& function) {
+    ASM::Rewriter rewriter(function.instructions_);
+    while (!rewriter.at_end()) {
+        auto& instruction = rewriter.current();
+        // a rematerialized constant needs no definition
+        if (instruction.dst_.is_pseudo()) {
+            auto id = instruction.dst_.pseudo_id();
+            if (locations_[id] == kSpilled && intervals_[id].constant_) {
+                rewriter.erase();
+                continue;
+            }
+        }
+        instruction.src_ = replace(instruction.src_);
+        instruction.index_ = replace(instruction.index_);
+        instruction.dst_ = replace(instruction.dst_);
+        rewriter.keep();
+    }
+    rewriter.finish();
+    function.saved_registers_.clear();
+    for (uint32_t index = 0; index < std::size(kAllocatable); index++) {
+        if ((used_registers_ & (1u << index)) && ASM::is_callee_saved(kAllocatable[index])) {
+            function.saved_registers_.push_back(kAllocatable[index]);
+        }
+    }
+}
+
+ASM::Operand RegisterAllocatorVisitor::replace(ASM::Operand operand) const {
+    if (!operand.is_pseudo()) {
+        return operand;
+    }
+    auto id = operand.pseudo_id();
+    if (locations_[id] != kSpilled) {
+        return ASM::Operand::reg(kAllocatable[locations_[id]]);
+    }
+    if (intervals_[id].constant_) {
+        return ASM::Operand::imm(intervals_[id].value_);
+    }
+    return operand;
+}
+
+} // namespace Codegen
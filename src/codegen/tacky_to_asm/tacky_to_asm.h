@@ -1,123 +1,222 @@
 #ifndef TACKY_TO_ASM_VISITOR_H
 #define TACKY_TO_ASM_VISITOR_H
 
+#include "src/tacky/cfg.h"
+#include "src/tacky/def_use.h"
 #include "src/tacky/tacky.h"
 #include "src/asm/asm_ast.h"
+#include "src/asm/liveness.h"
+#include "src/asm/rewriter.h"
+#include <array>
+#include <optional>
+#include <span>
 #include <stdexcept>
-#include <unordered_map>
-#include <deque>
+#include <string>
+#include <utility>
 
 namespace Codegen {
 
-template<typename T>
-inline std::shared_ptr<T> As(std::shared_ptr<ASM::AstNode>& node, const std::string& error_msg) {
-    auto casted_ptr = std::dynamic_pointer_cast<T>(node);
-    if (!casted_ptr) {
-        throw std::runtime_error(error_msg);
-    }
-    return casted_ptr;
-}
-
-class TackyToAsmVisitor : public Tacky::Visitor {
+// Selects ASM for the flat Tacky encoding. Arithmetic is selected by tree
+// tiling: a temporary used once, by the arithmetic instruction right after
+// its tree, is folded into that user, and the trees that leaves are
+// covered with the cheapest set of tiles, e.g. one lea for a + b * 4
+// (tree_tiling.cc). Everything else is lowered one instruction at a time,
+// comparisons and logical ops without branches, to cmp and setcc, and a
+// conditional jump on a comparison to cmp and jcc.
+class TackyToAsmVisitor {
 public:
     ~TackyToAsmVisitor() = default;
     TackyToAsmVisitor() = default;
-    void visit(Tacky::ProgramNode& node) override;
-    void visit(Tacky::FunctionNode& node) override;
-    void visit(Tacky::ReturnNode& node) override;
-    void visit(Tacky::ComplementNode& node) override;
-    void visit(Tacky::NegateNode& node) override;
-    void visit(Tacky::NotNode& node) override;
-    void visit(Tacky::IntegerNode& node) override;
-    void visit(Tacky::VariableNode& node) override;
-    void visit(Tacky::DivNode& node) override;
-    void visit(Tacky::ModNode& node) override;
-    void visit(Tacky::MultNode& node) override;
-    void visit(Tacky::PlusNode& node) override;
-    void visit(Tacky::MinusNode& node) override;
-    void visit(Tacky::AndNode& node) override;
-    void visit(Tacky::BitwiseAndNode& node) override;
-    void visit(Tacky::OrNode& node) override;
-    void visit(Tacky::BitwiseOrNode& node) override;
-    void visit(Tacky::BitwiseXorNode& node) override;
-    void visit(Tacky::BitwiseLeftShiftNode& node) override;
-    void visit(Tacky::BitwiseRightShiftNode& node) override;
-
-    template<std::derived_from<ASM::BinInstructionNode> T>
-    void visit_binexp(Tacky::BinaryOpNode& node);
-
-    template<std::derived_from<ASM::UnaryInstructionNode> T>
-    void visit_unexp(Tacky::UnaryNode& node);
+    ASM::Program get_asm_from_tacky(const Tacky::Program& tacky_program);
+private:
+    ASM::Function emit_function(const Tacky::Function& function);
+    void lower(const Tacky::Function& function, uint32_t& i);
+    void emit_instruction(const Tacky::Instruction& instruction);
+    ASM::Operand operand(Tacky::Value value);
+    void emit_division(const Tacky::Instruction& instruction, Tacky::Value quotient, Tacky::Value remainder);
+    bool emit_constant_division(const Tacky::Instruction& instruction, Tacky::Value quotient, Tacky::Value remainder);
+    void pair_divisions(const Tacky::Function& function);
+    ASM::OpCode emit_cmp(const Tacky::Instruction& instruction);
+    void emit_comparison(const Tacky::Instruction& instruction, Tacky::Value dst, bool invert);
+    void emit_branch(const Tacky::Instruction& instruction);
+    void emit_compare_and_branch(const Tacky::Instruction& comparison, const Tacky::Instruction& jump);
+    void emit_truth(Tacky::Value value, ASM::Operand dst, ASM::OpCode set);
+    void emit_not(const Tacky::Instruction& instruction);
+    void emit_logical(const Tacky::Instruction& instruction);
+    bool is_boolean(Tacky::Value value) const;
+    void note_boolean(const Tacky::Instruction& instruction);
+    void find_booleans(const Tacky::Function& function);
+    static constexpr uint32_t kNoPartner = UINT32_MAX;
+    std::vector<ASM::Instruction> instructions_;
+    // indexed by instruction, the division computing the other half of its idiv
+    std::vector<uint32_t> partners_;
+    // indexed by temporary, whether it's known to hold 0 or 1 at the
+    // instruction being lowered, and the same at the start of each block
+    std::vector<bool> booleans_;
+    std::vector<std::vector<bool>> block_booleans_;
+    // blocks of the function being lowered
+    std::optional<Tacky::ControlFlowGraph> cfg_;
 
-    std::shared_ptr<ASM::ProgramNode> get_asm_from_tacky(std::shared_ptr<Tacky::ProgramNode> tacky_program);
-    std::vector<std::shared_ptr<ASM::AstNode>> buffer_;
+    // tree tiling, BURS style: every node is labeled bottom up with the
+    // cheapest rule deriving each nonterminal, then the root is reduced to a
+    // register top down, emitting the instructions of the chosen tiles
+    enum NonTerminal : uint8_t {
+        REG,
+        IMM,
+        // base + index * scale or base + displacement, ready for lea
+        ADDR,
+        // index * scale without a base
+        SCALED,
+        kNonTerminals,
+    };
+    enum class Rule : uint8_t {
+        NONE,
+        LEAF_REG,
+        LEAF_IMM,
+        REG_FROM_IMM,
+        REG_FROM_ADDR,
+        REG_FROM_SCALED,
+        ADDR_REG_REG,
+        ADDR_REG_SCALED,
+        ADDR_REG_DISP,
+        ADDR_MULT_359,
+        SCALED_MULT,
+        SCALED_SHIFT,
+        MULT_IMM,
+        UNARY,
+        BINARY,
+    };
+    struct Node {
+        Tacky::OpCode op_ = Tacky::OpCode::RETURN;
+        // the constant or temporary the node computes
+        Tacky::Value value_;
+        uint32_t left_ = kLeaf;
+        uint32_t right_ = kLeaf;
+        std::array<uint32_t, kNonTerminals> cost_;
+        std::array<Rule, kNonTerminals> rule_;
+        // the rule matched a commutative op with its operands swapped
+        std::array<bool, kNonTerminals> swapped_;
+    };
+    static constexpr uint32_t kLeaf = UINT32_MAX;
+    static constexpr uint32_t kInfinite = 1u << 24;
+    static bool is_tree_op(Tacky::OpCode op);
+    void find_trees(const Tacky::Function& function);
+    void emit_tree(const Tacky::Instruction& root);
+    uint32_t build(Tacky::Value value);
+    uint32_t build(const Tacky::Instruction& instruction);
+    void label(uint32_t id);
+    ASM::Operand reduce(uint32_t id, NonTerminal goal);
+    ASM::Operand reduce_operand(uint32_t id);
+    ASM::Instruction reduce_address(uint32_t id, NonTerminal goal);
+    ASM::Operand destination(const Node& node);
+    const Tacky::Function* function_ = nullptr;
+    uint32_t pseudo_count_ = 0;
+    // indexed by temporary: the instruction defining it when there's only
+    // one, how often it's used and whether it's computed as part of its
+    // only user's tree
+    std::vector<uint32_t> definitions_;
+    std::vector<uint8_t> uses_;
+    std::vector<bool> folded_;
+    // indexed by instruction, the first instruction of the tree ending there
+    std::vector<uint32_t> tree_starts_;
+    // the tree being tiled, children before their parents
+    std::vector<Node> nodes_;
 };
 
-class ASMRewriteVisitor : public ASM::Visitor {
-private:
-    template <std::derived_from<ASM::BinInstructionNode> T>
-    void visit_binexp(ASM::BinInstructionNode& node);
-    template <std::derived_from<ASM::UnaryInstructionNode> T>
-    void visit_unexp(ASM::UnaryInstructionNode& node);
+// Linear scan register allocation over pseudos. Jumps only go forward, so
+// every path from a pseudo's first occurrence to its last one stays in
+// between and its live interval runs from the one to the other. When more
+// intervals overlap than there are registers, the one that is cheapest to
+// spill stays a pseudo and ends up on the stack. A pseudo that only ever
+// holds one constant costs nothing to spill, its uses just turn back into
+// the immediate.
+class RegisterAllocatorVisitor {
 public:
-    ~ASMRewriteVisitor() = default;
-    ASMRewriteVisitor() = default;
-    void visit(ASM::ProgramNode& node) override;
-    void visit(ASM::FunctionNode& node) override;
-    void visit(ASM::NegNode& node) override;
-    void visit(ASM::NotNode& node) override;
-    void visit(ASM::MovNode& node) override;
-    void visit(ASM::MovBNode& node) override;
-    void visit(ASM::RetNode& node) override;
-    void visit(ASM::AllocateStackNode& node) override;
-    void visit(ASM::ImmNode& node) override;
-    void visit(ASM::StackNode& node) override;
-    void visit(ASM::RegisterNode& node) override;
-    void visit(ASM::PseudoNode& node) override;
-    void visit(ASM::MultNode& node) override;
-    void visit(ASM::DivNode& node) override;
-    void visit(ASM::AddNode& node) override;
-    void visit(ASM::SubNode& node) override;
-    void visit(ASM::BitwiseAndNode& node) override;
-    void visit(ASM::BitwiseOrNode& node) override;
-    void visit(ASM::BitwiseXorNode& node) override;
-    void visit(ASM::SalNode& node) override;
-    void visit(ASM::SarNode& node) override;
-    void visit(ASM::CDQNode& node) override;
-    std::shared_ptr<ASM::ProgramNode> get_rewritten_asm_program(std::shared_ptr<ASM::ProgramNode> program);
-    std::deque<std::shared_ptr<ASM::AstNode>> buffer_;
+    ~RegisterAllocatorVisitor() = default;
+    RegisterAllocatorVisitor() = default;
+    void rewrite(ASM::Program& program);
+private:
+    struct Interval {
+        uint32_t start_ = 0;
+        uint32_t end_ = 0;
+        uint32_t uses_ = 0;
+        bool seen_ = false;
+        // defined once by a mov of value_ and only read afterwards
+        bool constant_ = false;
+        int value_ = 0;
+    };
+    void rewrite(ASM::Function& function);
+    void compute_intervals(const ASM::Function& function);
+    void allocate();
+    void assign(ASM::Function& function);
+    bool cheaper_to_spill(uint32_t a, uint32_t b) const;
+    ASM::Operand replace(ASM::Operand operand) const;
+    static constexpr uint8_t kSpilled = UINT8_MAX;
+    // all indexed by pseudo id and reused from function to function
+    std::vector<Interval> intervals_;
+    std::vector<uint8_t> locations_;
+    // pseudo ids by interval start, and the ones holding a register right now
+    std::vector<uint32_t> order_;
+    std::vector<uint32_t> active_;
+    uint32_t free_registers_ = 0;
+    uint32_t used_registers_ = 0;
 };
 
-class PseudoReplacerVisitor : public ASMRewriteVisitor {
+// Gives every function its own frame of 4 byte stack slots below rbp and
+// below the registers it saves.
+// Jumps only go forward, so a pseudo is live from its first to its last
+// occurrence, and a slot is handed to the next pseudo that starts
+// once its previous owner is dead.
+class PseudoReplacerVisitor {
 public:
     ~PseudoReplacerVisitor() = default;
-    PseudoReplacerVisitor() : current_offset_(0) {}
-    void visit(ASM::PseudoNode& node) override;
-    int get_offset();
-    int current_offset_;
-    std::unordered_map<std::string, int> stack_offsets_;
+    PseudoReplacerVisitor() = default;
+    void rewrite(ASM::Program& program);
+private:
+    void rewrite(ASM::Function& function);
+    ASM::Operand replace(ASM::Operand operand);
+    void release_if_dead(ASM::Operand operand, uint32_t position);
+    static constexpr uint32_t kNoSlot = UINT32_MAX;
+    // all indexed by pseudo id and reused from function to function
+    std::vector<uint32_t> last_use_;
+    std::vector<uint32_t> slots_;
+    std::vector<uint32_t> free_slots_;
+    uint32_t slot_count_ = 0;
+    uint32_t saved_bytes_ = 0;
 };
 
-class InstructionFixUpVisitor : public ASMRewriteVisitor {
+// Rewrites instructions whose operands x86 can't encode, e.g. memory to
+// memory moves, and prepends the stack allocation.
+class InstructionFixUpVisitor {
 public:
     ~InstructionFixUpVisitor() = default;
-    InstructionFixUpVisitor(int offset)
-        : ASMRewriteVisitor(), max_stack_offset_(offset) {}
-    void visit(ASM::FunctionNode& node) override;
-    void visit(ASM::MovNode& node) override;
-    void visit(ASM::MovBNode& node) override;
-    void visit(ASM::DivNode& node) override;
-    void visit(ASM::MultNode& node) override;
-    void visit(ASM::AddNode& node) override;
-    void visit(ASM::SubNode& node) override;
-    void visit(ASM::BitwiseAndNode& node) override;
-    void visit(ASM::BitwiseOrNode& node) override;
-    void visit(ASM::BitwiseXorNode& node) override;
-    void visit(ASM::SalNode& node) override;
-    void visit(ASM::SarNode& node) override;
-    int max_stack_offset_;
+    InstructionFixUpVisitor() = default;
+    void rewrite(ASM::Program& program);
+private:
+    void fix_up(ASM::Rewriter& rewriter);
+};
+
+// Windowed peephole pass over the final instruction stream: drops self and
+// redundant moves, copies through registers and stores nothing reads
+// afterwards, reads a value just stored to a slot from where it came from,
+// zeroes registers with xor and compares them against zero with test.
+// Counts how often each rule fired across rewrites.
+class PeepholeVisitor {
+public:
+    ~PeepholeVisitor() = default;
+    PeepholeVisitor() = default;
+    void rewrite(ASM::Program& program);
+    // rule names and hit counts, in the order the rules are tried
+    std::vector<std::pair<std::string, size_t>> hits() const;
+    static constexpr size_t kRuleCount = 7;
+private:
+    void rewrite(ASM::Function& function);
+    // position is where the input continues after the output's tail
+    bool apply_rules(const ASM::Liveness& liveness, uint32_t position);
+    std::vector<ASM::Instruction> output_;
+    std::array<size_t, kRuleCount> hits_{};
 };
 
 } // namespace Codegen
 
-#endif // TACKY_TO_ASM_VISITOR_H
\ No newline at end of file
+#endif // TACKY_TO_ASM_VISITOR_H
@@ -1,199 +1,499 @@
 #include "src/codegen/tacky_to_asm/tacky_to_asm.h"
-#include <algorithm>
+
+#include <climits>
+#include <cstdint>
+#include <map>
+#include <tuple>
 
 namespace Codegen {
 
-template<std::derived_from<ASM::BinInstructionNode> T>
-void TackyToAsmVisitor::visit_binexp(Tacky::BinaryOpNode& node) {
-    node.left_->accept(*this);
-    auto left_operand = As<ASM::OperandNode>(
-        buffer_.back(), "Failed to cast left operand to ASM::OperandNode");
-    buffer_.pop_back();
+namespace {
+
+// Multiplier and shift with n / d == (n * multiplier) >> (32 + shift) for
+// every non negative 32 bit n, rounded down, from Hacker's Delight 10-1
+// with d > 1. The multiplier is below 2^32, so the product fits a signed
+// 64 bit register and needs no add back.
+struct Magic {
+    uint32_t multiplier;
+    int shift;
+};
+
+Magic magic_for(uint32_t d) {
+    const uint32_t two31 = 0x80000000u;
+    uint32_t anc = two31 - 1 - two31 % d;
+    uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+    uint32_t q2 = two31 / d, r2 = two31 - q2 * d;
+    int p = 31;
+    uint32_t delta;
+    do {
+        p++;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc) {
+            q1++;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= d) {
+            q2++;
+            r2 -= d;
+        }
+        delta = d - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+    return Magic{q2 + 1, p - 32};
+}
 
-    node.right_->accept(*this);
-    auto right_operand = As<ASM::OperandNode>(
-        buffer_.back(), "Failed to cast right operand to ASM::OperandNode");
-    buffer_.pop_back();
+ASM::OpCode set_for(Tacky::OpCode op) {
+    switch (op) {
+        case Tacky::OpCode::EQUAL: return ASM::OpCode::SETE;
+        case Tacky::OpCode::NOT_EQUAL: return ASM::OpCode::SETNE;
+        case Tacky::OpCode::LESS: return ASM::OpCode::SETL;
+        case Tacky::OpCode::LESS_EQ: return ASM::OpCode::SETLE;
+        case Tacky::OpCode::GREATER: return ASM::OpCode::SETG;
+        case Tacky::OpCode::GREATER_EQ: return ASM::OpCode::SETGE;
+        default: throw std::runtime_error("No condition for tacky " + Tacky::opcode_as_str(op));
+    }
+}
 
-    node.dst_->accept(*this);
-    auto dst_operand = As<ASM::OperandNode>(
-        buffer_.back(), "Failed to cast dst operand to ASM::OperandNode");
-    buffer_.pop_back();
-
-    buffer_.push_back(std::make_shared<ASM::MovNode>(
-        left_operand,
-        dst_operand
-    ));
-
-    buffer_.push_back(std::make_shared<T>(
-        right_operand,
-        dst_operand
-    ));
-}
-
-template<std::derived_from<ASM::UnaryInstructionNode> T>
-void TackyToAsmVisitor::visit_unexp(Tacky::UnaryNode& node) {
-    node.src_->accept(*this);
-
-    auto converted_src = As<ASM::OperandNode>(
-        buffer_.back(), "Failed to cast src operand to ASM::OperandNode");
-    buffer_.pop_back();
-
-    node.dst_->accept(*this);
-
-    auto converted_dst = As<ASM::OperandNode>(
-        buffer_.back(), "Failed to cast dst operand to ASM::OperandNode");
-    buffer_.pop_back();
-
-    buffer_.push_back(std::make_shared<ASM::MovNode>(converted_src, converted_dst));
-    buffer_.push_back(std::make_shared<T>(converted_dst));
-}
-
-std::shared_ptr<ASM::ProgramNode> TackyToAsmVisitor::get_asm_from_tacky(std::shared_ptr<Tacky::ProgramNode> tacky_program) {
-    if (!buffer_.empty()) {
-        throw std::runtime_error("Expected buffer to be empty before generating asm from tacky.");
-    }
-    tacky_program->accept(*this);
-    auto asm_program = As<ASM::ProgramNode>(
-        buffer_.back(), "Expected buffer to be empty after generating asm from tacky.");
-    buffer_.pop_back();
-    return asm_program;
-}
-
-void TackyToAsmVisitor::visit(Tacky::ProgramNode& node) {
-    for(auto& function : node.functions_) {
-        function->accept(*this);
-    }
-    std::vector<std::shared_ptr<ASM::FunctionNode>> converted_functions;
-    while(!buffer_.empty()) {
-        auto converted_fn = As<ASM::FunctionNode>(
-            buffer_.back(), std::string("Failed to cast buffered function to ASM::FunctionNode"));
-        buffer_.pop_back();
-        converted_functions.push_back(std::move(converted_fn));
-    }
-    std::reverse(converted_functions.begin(), converted_functions.end());
-    std::shared_ptr<ASM::ProgramNode> converted_program = 
-        std::make_shared<ASM::ProgramNode>(std::move(converted_functions));
-    buffer_.push_back(std::move(converted_program));
-}
-
-void TackyToAsmVisitor::visit(Tacky::FunctionNode& node) {
-    for(auto& tacky_instruction : node.instructions_) {
-        tacky_instruction->accept(*this);
-    }
-    std::vector<std::shared_ptr<ASM::InstructionNode>> converted_instructions;
-    while(!buffer_.empty()) {
-        auto converted_instruction = As<ASM::InstructionNode>(
-            buffer_.back(), "Unable to cast buffered instruction to ASM::InstructionNode");
-        buffer_.pop_back();
-        converted_instructions.push_back(std::move(converted_instruction));
-    }
-    std::reverse(converted_instructions.begin(), converted_instructions.end());
-    auto converted_fn = std::make_shared<ASM::FunctionNode>(node.name_, converted_instructions);
-    buffer_.push_back(std::move(converted_fn));
-}
-
-void TackyToAsmVisitor::visit(Tacky::ReturnNode& node) {
-    node.value_->accept(*this);
-    auto casted_value = As<ASM::OperandNode>(
-        buffer_.back(), "Failed to cast buffered value to ASM::OperandNode");
-    buffer_.pop_back();
-    auto return_destination = std::make_shared<ASM::RegisterNode>(ASM::Register::AX);
-    auto mov_instruction = std::make_shared<ASM::MovNode>(casted_value, return_destination);
-    auto ret_instruction = std::make_shared<ASM::RetNode>();
-    buffer_.push_back(std::move(mov_instruction));
-    buffer_.push_back(std::move(ret_instruction));
+// the condition of b op a, for the condition of a op b
+ASM::OpCode swapped(ASM::OpCode set) {
+    switch (set) {
+        case ASM::OpCode::SETL: return ASM::OpCode::SETG;
+        case ASM::OpCode::SETLE: return ASM::OpCode::SETGE;
+        case ASM::OpCode::SETG: return ASM::OpCode::SETL;
+        case ASM::OpCode::SETGE: return ASM::OpCode::SETLE;
+        default: return set;
+    }
 }
 
-// unary exps
-void TackyToAsmVisitor::visit(Tacky::ComplementNode& node) {visit_unexp<ASM::NotNode>(node);}
-void TackyToAsmVisitor::visit(Tacky::NegateNode& node) {visit_unexp<ASM::NegNode>(node);}
-void TackyToAsmVisitor::visit(Tacky::NotNode& node) {}
+// the condition holding exactly when set's doesn't
+ASM::OpCode inverted(ASM::OpCode set) {
+    switch (set) {
+        case ASM::OpCode::SETE: return ASM::OpCode::SETNE;
+        case ASM::OpCode::SETNE: return ASM::OpCode::SETE;
+        case ASM::OpCode::SETL: return ASM::OpCode::SETGE;
+        case ASM::OpCode::SETLE: return ASM::OpCode::SETG;
+        case ASM::OpCode::SETG: return ASM::OpCode::SETLE;
+        case ASM::OpCode::SETGE: return ASM::OpCode::SETL;
+        default: throw std::runtime_error("Not a setcc: " + ASM::opcode_as_str(set));
+    }
+}
 
-// binary arithmetic exps
-void TackyToAsmVisitor::visit(Tacky::MultNode& node) {visit_binexp<ASM::MultNode>(node);}
-void TackyToAsmVisitor::visit(Tacky::PlusNode& node) {visit_binexp<ASM::AddNode>(node);}
-void TackyToAsmVisitor::visit(Tacky::MinusNode& node) {visit_binexp<ASM::SubNode>(node);}
+// the jcc taken when set's condition holds
+ASM::OpCode jump_for(ASM::OpCode set) {
+    switch (set) {
+        case ASM::OpCode::SETE: return ASM::OpCode::JE;
+        case ASM::OpCode::SETNE: return ASM::OpCode::JNE;
+        case ASM::OpCode::SETL: return ASM::OpCode::JL;
+        case ASM::OpCode::SETLE: return ASM::OpCode::JLE;
+        case ASM::OpCode::SETG: return ASM::OpCode::JG;
+        case ASM::OpCode::SETGE: return ASM::OpCode::JGE;
+        default: throw std::runtime_error("Not a setcc: " + ASM::opcode_as_str(set));
+    }
+}
+
+ASM::Operand label_operand(Tacky::Value value) {
+    if (!value.is_label()) {
+        throw std::runtime_error("Expected a label in tacky instruction");
+    }
+    return ASM::Operand::label(value.label_id());
+}
 
-// binary bitwise exps
-void TackyToAsmVisitor::visit(Tacky::BitwiseAndNode& node) {visit_binexp<ASM::BitwiseAndNode>(node);}
-void TackyToAsmVisitor::visit(Tacky::BitwiseOrNode& node) {visit_binexp<ASM::BitwiseOrNode>(node);}
-void TackyToAsmVisitor::visit(Tacky::BitwiseXorNode& node) {visit_binexp<ASM::BitwiseXorNode>(node);}
-void TackyToAsmVisitor::visit(Tacky::BitwiseLeftShiftNode& node) {visit_binexp<ASM::SalNode>(node);}
-void TackyToAsmVisitor::visit(Tacky::BitwiseRightShiftNode& node) {visit_binexp<ASM::SarNode>(node);}
+} // namespace
+
+// division is a bit of a snowflake: the quotient lands in AX, the remainder in DX.
+// Either destination may be missing, a fused a / b and a % b asks for both.
+void TackyToAsmVisitor::emit_division(const Tacky::Instruction& instruction, Tacky::Value quotient, Tacky::Value remainder) {
+    if (emit_constant_division(instruction, quotient, remainder)) {
+        return;
+    }
+    instructions_.push_back({ASM::OpCode::MOV, operand(instruction.src1_), ASM::Operand::reg(ASM::Register::AX)});
+    instructions_.push_back({ASM::OpCode::CDQ});
+    instructions_.push_back({ASM::OpCode::DIV, operand(instruction.src2_)});
+    if (!quotient.is_none()) {
+        instructions_.push_back({ASM::OpCode::MOV, ASM::Operand::reg(ASM::Register::AX), operand(quotient)});
+    }
+    if (!remainder.is_none()) {
+        instructions_.push_back({ASM::OpCode::MOV, ASM::Operand::reg(ASM::Register::DX), operand(remainder)});
+    }
+}
+
+// idiv is slow, a known divisor becomes a multiply high and shift. Negative
+// dividends round down there, so one is added back for them, and the
+// quotient of |d| is negated for a negative d. Divisors that trap or don't
+// have a magic number (0, 1, -1 and INT_MIN) keep the idiv.
+bool TackyToAsmVisitor::emit_constant_division(const Tacky::Instruction& instruction, Tacky::Value quotient, Tacky::Value remainder) {
+    if (!instruction.src2_.is_constant()) {
+        return false;
+    }
+    int d = instruction.src2_.constant_value();
+    if (d == 0 || d == 1 || d == -1 || d == INT_MIN) {
+        return false;
+    }
+    auto magic = magic_for(static_cast<uint32_t>(d < 0 ? -d : d));
+    auto n = operand(instruction.src1_);
+    auto ax = ASM::Operand::reg(ASM::Register::AX);
+    auto dx = ASM::Operand::reg(ASM::Register::DX);
+    auto r11 = ASM::Operand::reg(ASM::Register::R11);
+    instructions_.push_back({ASM::OpCode::MOV, n, ax});
+    instructions_.push_back({ASM::OpCode::MOVSX, ax, ax});
+    // movl zero extends, so the unsigned multiplier arrives intact
+    instructions_.push_back({ASM::OpCode::MOV, ASM::Operand::imm(static_cast<int>(magic.multiplier)), r11});
+    instructions_.push_back({ASM::OpCode::MULT64, r11, ax});
+    instructions_.push_back({ASM::OpCode::SAR64, ASM::Operand::imm(32 + magic.shift), ax});
+    instructions_.push_back({ASM::OpCode::MOV, n, dx});
+    instructions_.push_back({ASM::OpCode::SAR, ASM::Operand::imm(31), dx});
+    instructions_.push_back({ASM::OpCode::SUB, dx, ax});
+    if (d < 0) {
+        instructions_.push_back({ASM::OpCode::NEG, ASM::Operand(), ax});
+    }
+    if (!quotient.is_none()) {
+        instructions_.push_back({ASM::OpCode::MOV, ax, operand(quotient)});
+    }
+    if (!remainder.is_none()) {
+        // n - (n / d) * d
+        instructions_.push_back({ASM::OpCode::MULT, ASM::Operand::imm(d), ax});
+        instructions_.push_back({ASM::OpCode::MOV, n, dx});
+        instructions_.push_back({ASM::OpCode::SUB, ax, dx});
+        instructions_.push_back({ASM::OpCode::MOV, dx, operand(remainder)});
+    }
+    return true;
+}
+
+// the cmp of a comparison, returns the setcc for its condition
+ASM::OpCode TackyToAsmVisitor::emit_cmp(const Tacky::Instruction& instruction) {
+    auto set = set_for(instruction.op_);
+    auto left = operand(instruction.src1_);
+    auto right = operand(instruction.src2_);
+    // cmp can't take an immediate on the left, the condition turns around instead
+    if (left.is_immediate() && !right.is_immediate()) {
+        std::swap(left, right);
+        set = swapped(set);
+    }
+    instructions_.push_back({ASM::OpCode::CMP, right, left});
+    return set;
+}
+
+// mov doesn't touch the flags, so dst is zeroed ahead of the cmp and setcc
+// only writes its low byte. invert sets the opposite condition, for a !
+// right after the comparison.
+void TackyToAsmVisitor::emit_comparison(const Tacky::Instruction& instruction, Tacky::Value dst, bool invert) {
+    auto result = operand(dst);
+    instructions_.push_back({ASM::OpCode::MOV, ASM::Operand::imm(0), result});
+    auto set = emit_cmp(instruction);
+    if (invert) {
+        set = inverted(set);
+    }
+    instructions_.push_back({set, ASM::Operand(), result});
+}
 
-// binary logic exps
-void TackyToAsmVisitor::visit(Tacky::AndNode& node) {}
-void TackyToAsmVisitor::visit(Tacky::OrNode& node) {}
+// A conditional jump compares its condition against zero. One on a constant
+// always jumps or never does.
+void TackyToAsmVisitor::emit_branch(const Tacky::Instruction& instruction) {
+    bool if_zero = instruction.op_ == Tacky::OpCode::JUMP_IF_ZERO;
+    auto target = label_operand(instruction.src2_);
+    if (instruction.src1_.is_constant()) {
+        if ((instruction.src1_.constant_value() == 0) == if_zero) {
+            instructions_.push_back({ASM::OpCode::JMP, target});
+        }
+        return;
+    }
+    instructions_.push_back({ASM::OpCode::CMP, ASM::Operand::imm(0), operand(instruction.src1_)});
+    instructions_.push_back({if_zero ? ASM::OpCode::JE : ASM::OpCode::JNE, target});
+}
 
-// division is a bit of a snowflake
-void TackyToAsmVisitor::visit(Tacky::DivNode& node) {
-    node.left_->accept(*this);
-    auto left_operand = As<ASM::OperandNode>(
-        buffer_.back(), "Failed to cast left operand in div to ASM::OperandNode");
-    buffer_.pop_back();
+// a conditional jump on a comparison nothing else reads jumps on the
+// comparison's own flags, the opposite condition for a jump if zero
+void TackyToAsmVisitor::emit_compare_and_branch(const Tacky::Instruction& comparison, const Tacky::Instruction& jump) {
+    auto set = emit_cmp(comparison);
+    if (jump.op_ == Tacky::OpCode::JUMP_IF_ZERO) {
+        set = inverted(set);
+    }
+    instructions_.push_back({jump_for(set), label_operand(jump.src2_)});
+}
 
-    node.right_->accept(*this);
-    auto right_operand = As<ASM::OperandNode>(
-        buffer_.back(), "Failed to cast right operand in div to ASM::OperandNode");
-    buffer_.pop_back();
+// dst = value != 0, set from a cmp against zero
+void TackyToAsmVisitor::emit_truth(Tacky::Value value, ASM::Operand dst, ASM::OpCode set) {
+    instructions_.push_back({ASM::OpCode::MOV, ASM::Operand::imm(0), dst});
+    instructions_.push_back({ASM::OpCode::CMP, ASM::Operand::imm(0), operand(value)});
+    instructions_.push_back({set, ASM::Operand(), dst});
+}
 
-    node.dst_->accept(*this);
-    auto dst_operand = As<ASM::OperandNode>(
-        buffer_.back(), "Failed to cast dst operand in div to ASM::OperandNode");
-    buffer_.pop_back();
+bool TackyToAsmVisitor::is_boolean(Tacky::Value value) const {
+    if (value.is_constant()) {
+        return value.constant_value() == 0 || value.constant_value() == 1;
+    }
+    return booleans_[value.temporary_id()];
+}
 
-    buffer_.push_back(std::make_shared<ASM::MovNode>(
-        left_operand,
-        std::make_shared<ASM::RegisterNode>(ASM::Register::AX)
-    ));
+// comparisons and logical ops leave 0 or 1, a copy whatever its source holds
+void TackyToAsmVisitor::note_boolean(const Tacky::Instruction& instruction) {
+    if (Tacky::is_control(instruction.op_)) {
+        return;
+    }
+    auto op = instruction.op_;
+    booleans_[instruction.dst_.temporary_id()] = Tacky::is_comparison(op) || op == Tacky::OpCode::NOT ||
+        op == Tacky::OpCode::AND || op == Tacky::OpCode::OR ||
+        (op == Tacky::OpCode::COPY && is_boolean(instruction.src1_));
+}
 
-    buffer_.push_back(std::make_shared<ASM::CDQNode>());
-
-    buffer_.push_back(std::make_shared<ASM::DivNode>(right_operand));
-    buffer_.push_back(std::make_shared<ASM::MovNode>(
-        std::make_shared<ASM::RegisterNode>(ASM::Register::AX),
-        dst_operand
-    ));
+// Which temporaries hold 0 or 1 where each block starts. A temporary may be
+// written on more than one path, so only where every path into the block
+// leaves it so, and nothing does at the entry. Otherwise the sets start out
+// full and shrink until they hold.
+void TackyToAsmVisitor::find_booleans(const Tacky::Function& function) {
+    auto& blocks = cfg_->blocks();
+    auto count = function.temporary_count_;
+    block_booleans_.assign(blocks.size(), std::vector<bool>(count, true));
+    for (uint32_t b = 0; b < blocks.size(); b++) {
+        if (b == 0 || !cfg_->reachable(b)) {
+            block_booleans_[b].assign(count, false);
+        }
+    }
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto b : cfg_->reverse_postorder()) {
+            booleans_ = block_booleans_[b];
+            for (uint32_t i = blocks[b].begin_; i < blocks[b].end_; i++) {
+                note_boolean(function.instructions_[i]);
+            }
+            for (auto successor : {blocks[b].fall_through_, blocks[b].target_}) {
+                if (successor == Tacky::ControlFlowGraph::kNoBlock) {
+                    continue;
+                }
+                auto& in = block_booleans_[successor];
+                for (uint32_t t = 0; t < count; t++) {
+                    if (in[t] && !booleans_[t]) {
+                        in[t] = false;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
 }
 
-void TackyToAsmVisitor::visit(Tacky::ModNode& node) {
-    node.left_->accept(*this);
-    auto left_operand = As<ASM::OperandNode>(
-        buffer_.back(), "Failed to cast left operand in div to ASM::OperandNode");
-    buffer_.pop_back();
+// ! of a 0 or 1 only flips the low bit
+void TackyToAsmVisitor::emit_not(const Tacky::Instruction& instruction) {
+    auto dst = operand(instruction.dst_);
+    if (is_boolean(instruction.src1_)) {
+        instructions_.push_back({ASM::OpCode::MOV, operand(instruction.src1_), dst});
+        instructions_.push_back({ASM::OpCode::BITWISE_XOR, ASM::Operand::imm(1), dst});
+    } else {
+        emit_truth(instruction.src1_, dst, ASM::OpCode::SETE);
+    }
+}
 
-    node.right_->accept(*this);
-    auto right_operand = As<ASM::OperandNode>(
-        buffer_.back(), "Failed to cast right operand in div to ASM::OperandNode");
-    buffer_.pop_back();
+// Both operands are already computed, so && and || are bitwise ops once
+// they are 0 or 1. a || b is also just (a | b) != 0.
+void TackyToAsmVisitor::emit_logical(const Tacky::Instruction& instruction) {
+    auto dst = operand(instruction.dst_);
+    auto left = instruction.src1_;
+    auto right = instruction.src2_;
+    if (instruction.op_ == Tacky::OpCode::OR && !(is_boolean(left) && is_boolean(right))) {
+        auto any = ASM::Operand::pseudo(pseudo_count_++);
+        instructions_.push_back({ASM::OpCode::MOV, operand(left), any});
+        instructions_.push_back({ASM::OpCode::BITWISE_OR, operand(right), any});
+        instructions_.push_back({ASM::OpCode::MOV, ASM::Operand::imm(0), dst});
+        instructions_.push_back({ASM::OpCode::CMP, ASM::Operand::imm(0), any});
+        instructions_.push_back({ASM::OpCode::SETNE, ASM::Operand(), dst});
+    } else {
+        auto op = instruction.op_ == Tacky::OpCode::AND ? ASM::OpCode::BITWISE_AND : ASM::OpCode::BITWISE_OR;
+        auto a = operand(left);
+        if (!is_boolean(left)) {
+            a = ASM::Operand::pseudo(pseudo_count_++);
+            emit_truth(left, a, ASM::OpCode::SETNE);
+        }
+        if (is_boolean(right)) {
+            instructions_.push_back({ASM::OpCode::MOV, a, dst});
+            instructions_.push_back({op, operand(right), dst});
+        } else {
+            emit_truth(right, dst, ASM::OpCode::SETNE);
+            instructions_.push_back({op, a, dst});
+        }
+    }
+}
 
-    node.dst_->accept(*this);
-    auto dst_operand = As<ASM::OperandNode>(
-        buffer_.back(), "Failed to cast dst operand in div to ASM::OperandNode");
-    buffer_.pop_back();
+ASM::Program TackyToAsmVisitor::get_asm_from_tacky(const Tacky::Program& tacky_program) {
+    ASM::Program program;
+    program.functions_.reserve(tacky_program.functions_.size());
+    for (auto& function : tacky_program.functions_) {
+        program.functions_.push_back(emit_function(function));
+    }
+    return program;
+}
 
-    buffer_.push_back(std::make_shared<ASM::MovNode>(
-        left_operand,
-        std::make_shared<ASM::RegisterNode>(ASM::Register::AX)
-    ));
-
-    buffer_.push_back(std::make_shared<ASM::CDQNode>());
+// Pairs every a / b with an a % b over the same operands, so both come out of
+// one division. Between two labels the first one runs whenever the second
+// does, and equal operands hold equal values unless something writes one of
+// them in between. Both results are written at the first one, so nothing
+// in between may read or write the second one's dst either.
+void TackyToAsmVisitor::pair_divisions(const Tacky::Function& function) {
+    partners_.assign(function.instructions_.size(), kNoPartner);
+    // unpaired divisions by opcode and operands
+    std::map<std::tuple<Tacky::OpCode, uint64_t, uint64_t>, uint32_t> unpaired;
+    for (uint32_t i = 0; i < function.instructions_.size(); i++) {
+        auto& instruction = function.instructions_[i];
+        // the one after a label can run without the one before it
+        if (instruction.op_ == Tacky::OpCode::LABEL) {
+            unpaired.clear();
+        }
+        if (instruction.op_ == Tacky::OpCode::DIV || instruction.op_ == Tacky::OpCode::MOD) {
+            auto other = instruction.op_ == Tacky::OpCode::DIV ? Tacky::OpCode::MOD : Tacky::OpCode::DIV;
+            auto it = unpaired.find({other, instruction.src1_.bits(), instruction.src2_.bits()});
+            auto touched = [&](uint32_t first) {
+                for (auto j = first + 1; j < i; j++) {
+                    auto& between = function.instructions_[j];
+                    for (auto value : {between.dst_, between.src1_, between.src2_}) {
+                        if (value == instruction.dst_) {
+                            return true;
+                        }
+                    }
+                }
+                return false;
+            };
+            if (it == unpaired.end() || touched(it->second)) {
+                unpaired.insert_or_assign(std::tuple{instruction.op_, instruction.src1_.bits(), instruction.src2_.bits()}, i);
+            } else {
+                partners_[it->second] = i;
+                partners_[i] = it->second;
+                unpaired.erase(it);
+            }
+        }
+        // a division whose operand changes can't pair with one after
+        if (instruction.dst_.is_temporary()) {
+            auto dst = instruction.dst_.bits();
+            std::erase_if(unpaired, [dst](const auto& entry) {
+                return std::get<1>(entry.first) == dst || std::get<2>(entry.first) == dst;
+            });
+        }
+    }
+}
 
-    buffer_.push_back(std::make_shared<ASM::DivNode>(right_operand));
-    buffer_.push_back(std::make_shared<ASM::MovNode>(
-        std::make_shared<ASM::RegisterNode>(ASM::Register::DX),
-        dst_operand
-    ));
+ASM::Function TackyToAsmVisitor::emit_function(const Tacky::Function& function) {
+    instructions_.clear();
+    instructions_.reserve(function.instructions_.size() * 2);
+    pair_divisions(function);
+    find_trees(function);
+    cfg_.emplace(function);
+    find_booleans(function);
+    for (uint32_t b = 0; b < cfg_->blocks().size(); b++) {
+        booleans_ = block_booleans_[b];
+        for (uint32_t i = cfg_->blocks()[b].begin_; i < cfg_->blocks()[b].end_; i++) {
+            auto first = i;
+            lower(function, i);
+            for (auto j = first; j <= i; j++) {
+                note_boolean(function.instructions_[j]);
+            }
+        }
+    }
+    return ASM::Function{function.name_, pseudo_count_, std::move(instructions_)};
 }
 
-void TackyToAsmVisitor::visit(Tacky::IntegerNode& node) {
-    buffer_.push_back(std::make_shared<ASM::ImmNode>(node.value_));
+// Lowers the instruction at i, and the one after it as well when the two
+// go together, leaving i at the last one lowered.
+void TackyToAsmVisitor::lower(const Tacky::Function& function, uint32_t& i) {
+    auto& instruction = function.instructions_[i];
+    // computed as part of its user's tree
+    if (instruction.dst_.is_temporary() && folded_[instruction.dst_.temporary_id()]) {
+        return;
+    }
+    // a ! or a conditional jump right after its only use's comparison
+    // works from the same flags
+    if (Tacky::is_comparison(instruction.op_) && i + 1 < function.instructions_.size()) {
+        auto& next = function.instructions_[i + 1];
+        if (next.src1_ == instruction.dst_ && uses_[instruction.dst_.temporary_id()] == 1) {
+            if (next.op_ == Tacky::OpCode::NOT) {
+                emit_comparison(instruction, next.dst_, true);
+                i++;
+                return;
+            }
+            if (next.op_ == Tacky::OpCode::JUMP_IF_ZERO || next.op_ == Tacky::OpCode::JUMP_IF_NOT_ZERO) {
+                emit_compare_and_branch(instruction, next);
+                i++;
+                return;
+            }
+        }
+    }
+    if (partners_[i] == kNoPartner) {
+        emit_instruction(instruction);
+        return;
+    }
+    // the second of a pair was emitted along with the first
+    if (partners_[i] < i) {
+        return;
+    }
+    auto& partner = function.instructions_[partners_[i]];
+    auto& div = instruction.op_ == Tacky::OpCode::DIV ? instruction : partner;
+    auto& mod = instruction.op_ == Tacky::OpCode::MOD ? instruction : partner;
+    emit_division(instruction, div.dst_, mod.dst_);
 }
 
-void TackyToAsmVisitor::visit(Tacky::VariableNode& node) {
-    buffer_.push_back(std::make_shared<ASM::PseudoNode>(node.name_));
-}
+void TackyToAsmVisitor::emit_instruction(const Tacky::Instruction& instruction) {
+    switch (instruction.op_) {
+        case Tacky::OpCode::RETURN:
+            instructions_.push_back({ASM::OpCode::MOV, operand(instruction.src1_), ASM::Operand::reg(ASM::Register::AX)});
+            instructions_.push_back({ASM::OpCode::RET});
+            break;
+        case Tacky::OpCode::COPY:
+            instructions_.push_back({ASM::OpCode::MOV, operand(instruction.src1_), operand(instruction.dst_)});
+            break;
+        // arithmetic is tiled as trees
+        case Tacky::OpCode::COMPLEMENT:
+        case Tacky::OpCode::NEGATE:
+        case Tacky::OpCode::MULT:
+        case Tacky::OpCode::PLUS:
+        case Tacky::OpCode::MINUS:
+        case Tacky::OpCode::BITWISE_AND:
+        case Tacky::OpCode::BITWISE_OR:
+        case Tacky::OpCode::BITWISE_XOR:
+        case Tacky::OpCode::LEFT_SHIFT:
+        case Tacky::OpCode::RIGHT_SHIFT:
+            emit_tree(instruction);
+            break;
+        case Tacky::OpCode::DIV: emit_division(instruction, instruction.dst_, Tacky::Value()); break;
+        case Tacky::OpCode::MOD: emit_division(instruction, Tacky::Value(), instruction.dst_); break;
+        case Tacky::OpCode::EQUAL:
+        case Tacky::OpCode::NOT_EQUAL:
+        case Tacky::OpCode::LESS:
+        case Tacky::OpCode::LESS_EQ:
+        case Tacky::OpCode::GREATER:
+        case Tacky::OpCode::GREATER_EQ:
+            emit_comparison(instruction, instruction.dst_, false);
+            break;
+        case Tacky::OpCode::NOT: emit_not(instruction); break;
+        case Tacky::OpCode::AND:
+        case Tacky::OpCode::OR:
+            emit_logical(instruction);
+            break;
+        case Tacky::OpCode::LABEL:
+            instructions_.push_back({ASM::OpCode::LABEL, label_operand(instruction.src1_)});
+            break;
+        case Tacky::OpCode::JUMP:
+            instructions_.push_back({ASM::OpCode::JMP, label_operand(instruction.src1_)});
+            break;
+        case Tacky::OpCode::JUMP_IF_ZERO:
+        case Tacky::OpCode::JUMP_IF_NOT_ZERO:
+            emit_branch(instruction);
+            break;
+        case Tacky::OpCode::PHI:
+            throw std::runtime_error("Tacky phis must be taken out of SSA form before lowering");
+    }
+}
 
+ASM::Operand TackyToAsmVisitor::operand(Tacky::Value value) {
+    switch (value.kind()) {
+        case Tacky::Value::Kind::CONSTANT:
+            return ASM::Operand::imm(value.constant_value());
+        case Tacky::Value::Kind::TEMPORARY:
+            return ASM::Operand::pseudo(value.temporary_id());
+        case Tacky::Value::Kind::LABEL:
+            throw std::runtime_error("Unexpected label operand in tacky instruction");
+        case Tacky::Value::Kind::NONE:
+            break;
+    }
+    throw std::runtime_error("Missing operand in tacky instruction");
+}
 
-} //namespace Codegen
\ No newline at end of file
+} //namespace Codegen
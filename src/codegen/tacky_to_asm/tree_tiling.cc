@@ -0,0 +1,313 @@
+#include "src/codegen/tacky_to_asm/tacky_to_asm.h"
+
+#include <algorithm>
+#include <climits>
+#include <optional>
+
+namespace Codegen {
+
+namespace {
+
+ASM::OpCode asm_opcode(Tacky::OpCode op) {
+    switch (op) {
+        case Tacky::OpCode::COMPLEMENT: return ASM::OpCode::NOT;
+        case Tacky::OpCode::NEGATE: return ASM::OpCode::NEG;
+        case Tacky::OpCode::MULT: return ASM::OpCode::MULT;
+        case Tacky::OpCode::PLUS: return ASM::OpCode::ADD;
+        case Tacky::OpCode::MINUS: return ASM::OpCode::SUB;
+        case Tacky::OpCode::BITWISE_AND: return ASM::OpCode::BITWISE_AND;
+        case Tacky::OpCode::BITWISE_OR: return ASM::OpCode::BITWISE_OR;
+        case Tacky::OpCode::BITWISE_XOR: return ASM::OpCode::BITWISE_XOR;
+        case Tacky::OpCode::LEFT_SHIFT: return ASM::OpCode::SAL;
+        case Tacky::OpCode::RIGHT_SHIFT: return ASM::OpCode::SAR;
+        default: break;
+    }
+    throw std::runtime_error("No ASM opcode for tacky " + Tacky::opcode_as_str(op));
+}
+
+} // namespace
+
+// arithmetic without side effects, the ops trees are made of
+bool TackyToAsmVisitor::is_tree_op(Tacky::OpCode op) {
+    switch (op) {
+        case Tacky::OpCode::COMPLEMENT:
+        case Tacky::OpCode::NEGATE:
+        case Tacky::OpCode::MULT:
+        case Tacky::OpCode::PLUS:
+        case Tacky::OpCode::MINUS:
+        case Tacky::OpCode::BITWISE_AND:
+        case Tacky::OpCode::BITWISE_OR:
+        case Tacky::OpCode::BITWISE_XOR:
+        case Tacky::OpCode::LEFT_SHIFT:
+        case Tacky::OpCode::RIGHT_SHIFT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// A temporary defined once and used exactly once, by another tree op, can
+// be computed right where that use is. Only a definition right before its
+// user's tree is folded: moving one past other instructions, say a
+// division, would keep its operands live across them.
+void TackyToAsmVisitor::find_trees(const Tacky::Function& function) {
+    function_ = &function;
+    pseudo_count_ = function.temporary_count_;
+    definitions_.assign(function.temporary_count_, kLeaf);
+    folded_.assign(function.temporary_count_, false);
+    // saturates at 2, more than once is all that matters
+    uses_.assign(function.temporary_count_, 0);
+    Tacky::DefUse def_use(function);
+    for (uint32_t t = 0; t < function.temporary_count_; t++) {
+        uses_[t] = std::min<size_t>(def_use.uses(t).size(), 2);
+        if (def_use.definitions(t).size() == 1) {
+            definitions_[t] = def_use.definition(t);
+        }
+    }
+    auto& instructions = function.instructions_;
+    // where the tree ending at each instruction starts, operands are
+    // computed left to right so the right one's tree ends just before
+    tree_starts_.resize(instructions.size());
+    for (uint32_t i = 0; i < instructions.size(); i++) {
+        auto& instruction = instructions[i];
+        tree_starts_[i] = i;
+        if (!is_tree_op(instruction.op_)) {
+            continue;
+        }
+        for (auto src : {instruction.src2_, instruction.src1_}) {
+            if (!src.is_temporary() || uses_[src.temporary_id()] != 1) {
+                continue;
+            }
+            auto definition = definitions_[src.temporary_id()];
+            if (definition != kLeaf && definition + 1 == tree_starts_[i] && is_tree_op(instructions[definition].op_)) {
+                folded_[src.temporary_id()] = true;
+                tree_starts_[i] = tree_starts_[definition];
+            }
+        }
+    }
+}
+
+void TackyToAsmVisitor::emit_tree(const Tacky::Instruction& root) {
+    nodes_.clear();
+    auto id = build(root);
+    reduce(id, REG);
+}
+
+uint32_t TackyToAsmVisitor::build(Tacky::Value value) {
+    if (value.is_temporary() && folded_[value.temporary_id()]) {
+        return build(function_->instructions_[definitions_[value.temporary_id()]]);
+    }
+    Node node;
+    node.value_ = value;
+    nodes_.push_back(node);
+    label(nodes_.size() - 1);
+    return nodes_.size() - 1;
+}
+
+uint32_t TackyToAsmVisitor::build(const Tacky::Instruction& instruction) {
+    Node node;
+    node.op_ = instruction.op_;
+    node.value_ = instruction.dst_;
+    node.left_ = build(instruction.src1_);
+    if (!Tacky::is_unary(instruction.op_)) {
+        node.right_ = build(instruction.src2_);
+    }
+    nodes_.push_back(node);
+    label(nodes_.size() - 1);
+    return nodes_.size() - 1;
+}
+
+// Rules are tried cheapest shape first and only a strictly cheaper one
+// replaces a match, so lea wins its ties against imul and mov + op.
+void TackyToAsmVisitor::label(uint32_t id) {
+    auto& node = nodes_[id];
+    node.cost_.fill(kInfinite);
+    node.rule_.fill(Rule::NONE);
+    node.swapped_.fill(false);
+    auto match = [&](NonTerminal goal, Rule rule, uint32_t cost, bool swapped = false) {
+        if (cost < node.cost_[goal]) {
+            node.cost_[goal] = cost;
+            node.rule_[goal] = rule;
+            node.swapped_[goal] = swapped;
+        }
+    };
+    if (node.left_ == kLeaf) {
+        if (node.value_.is_constant()) {
+            match(IMM, Rule::LEAF_IMM, 0);
+            match(REG, Rule::REG_FROM_IMM, 1);
+        } else {
+            match(REG, Rule::LEAF_REG, 0);
+        }
+        return;
+    }
+    auto& left = nodes_[node.left_];
+    auto operand_cost = [](const Node& operand) { return std::min(operand.cost_[REG], operand.cost_[IMM]); };
+    if (node.right_ == kLeaf) {
+        match(REG, Rule::UNARY, 2 + operand_cost(left));
+        return;
+    }
+    auto& right = nodes_[node.right_];
+    auto constant = [](const Node& operand) {
+        return operand.left_ == kLeaf && operand.value_.is_constant() ? std::optional<int>(operand.value_.constant_value()) : std::nullopt;
+    };
+    switch (node.op_) {
+        case Tacky::OpCode::PLUS:
+            match(ADDR, Rule::ADDR_REG_REG, left.cost_[REG] + right.cost_[REG]);
+            for (bool swapped : {false, true}) {
+                auto& base = swapped ? right : left;
+                auto& other = swapped ? left : right;
+                match(ADDR, Rule::ADDR_REG_SCALED, base.cost_[REG] + other.cost_[SCALED], swapped);
+                if (constant(other)) {
+                    match(ADDR, Rule::ADDR_REG_DISP, base.cost_[REG], swapped);
+                }
+            }
+            break;
+        case Tacky::OpCode::MINUS:
+            if (auto k = constant(right); k && *k != INT_MIN) {
+                match(ADDR, Rule::ADDR_REG_DISP, left.cost_[REG]);
+            }
+            break;
+        case Tacky::OpCode::MULT:
+            for (bool swapped : {false, true}) {
+                auto& factor = swapped ? right : left;
+                auto k = constant(swapped ? left : right);
+                if (!k) {
+                    continue;
+                }
+                if (*k == 2 || *k == 4 || *k == 8) {
+                    match(SCALED, Rule::SCALED_MULT, factor.cost_[REG], swapped);
+                }
+                if (*k == 3 || *k == 5 || *k == 9) {
+                    match(ADDR, Rule::ADDR_MULT_359, factor.cost_[REG], swapped);
+                }
+            }
+            break;
+        case Tacky::OpCode::LEFT_SHIFT:
+            if (auto k = constant(right); k && *k >= 1 && *k <= 3) {
+                match(SCALED, Rule::SCALED_SHIFT, left.cost_[REG]);
+            }
+            break;
+        default:
+            break;
+    }
+    match(REG, Rule::REG_FROM_ADDR, node.cost_[ADDR] + 1);
+    match(REG, Rule::REG_FROM_SCALED, node.cost_[SCALED] + 1);
+    if (node.op_ == Tacky::OpCode::MULT) {
+        for (bool swapped : {false, true}) {
+            if (constant(swapped ? left : right)) {
+                match(REG, Rule::MULT_IMM, (swapped ? right : left).cost_[REG] + 1, swapped);
+            }
+        }
+    }
+    match(REG, Rule::BINARY, 2 + operand_cost(left) + operand_cost(right));
+}
+
+// interior nodes compute into their own temporary, a constant needing a
+// register gets a fresh pseudo
+ASM::Operand TackyToAsmVisitor::destination(const Node& node) {
+    if (node.value_.is_temporary()) {
+        return ASM::Operand::pseudo(node.value_.temporary_id());
+    }
+    return ASM::Operand::pseudo(pseudo_count_++);
+}
+
+ASM::Operand TackyToAsmVisitor::reduce_operand(uint32_t id) {
+    auto& node = nodes_[id];
+    return reduce(id, node.cost_[IMM] <= node.cost_[REG] ? IMM : REG);
+}
+
+ASM::Operand TackyToAsmVisitor::reduce(uint32_t id, NonTerminal goal) {
+    auto& node = nodes_[id];
+    bool swapped = node.swapped_[goal];
+    switch (node.rule_[goal]) {
+        case Rule::LEAF_REG:
+            return ASM::Operand::pseudo(node.value_.temporary_id());
+        case Rule::LEAF_IMM:
+            return ASM::Operand::imm(node.value_.constant_value());
+        case Rule::REG_FROM_IMM: {
+            auto dst = destination(node);
+            instructions_.push_back({ASM::OpCode::MOV, ASM::Operand::imm(node.value_.constant_value()), dst});
+            return dst;
+        }
+        case Rule::REG_FROM_ADDR:
+        case Rule::REG_FROM_SCALED: {
+            auto lea = reduce_address(id, node.rule_[goal] == Rule::REG_FROM_ADDR ? ADDR : SCALED);
+            lea.dst_ = destination(node);
+            instructions_.push_back(lea);
+            return lea.dst_;
+        }
+        case Rule::MULT_IMM: {
+            auto src = reduce(swapped ? node.right_ : node.left_, REG);
+            auto k = nodes_[swapped ? node.left_ : node.right_].value_.constant_value();
+            auto dst = destination(node);
+            instructions_.push_back({ASM::OpCode::MULT3, src, dst, ASM::Operand::imm(k)});
+            return dst;
+        }
+        case Rule::UNARY: {
+            auto src = reduce_operand(node.left_);
+            auto dst = destination(node);
+            instructions_.push_back({ASM::OpCode::MOV, src, dst});
+            instructions_.push_back({asm_opcode(node.op_), ASM::Operand(), dst});
+            return dst;
+        }
+        case Rule::BINARY: {
+            auto left = reduce_operand(node.left_);
+            auto right = reduce_operand(node.right_);
+            auto dst = destination(node);
+            instructions_.push_back({ASM::OpCode::MOV, left, dst});
+            instructions_.push_back({asm_opcode(node.op_), right, dst});
+            return dst;
+        }
+        default:
+            break;
+    }
+    throw std::runtime_error("No tile covers the tree as a register or an immediate");
+}
+
+// an unfinished lea, without its dst
+ASM::Instruction TackyToAsmVisitor::reduce_address(uint32_t id, NonTerminal goal) {
+    auto& node = nodes_[id];
+    bool swapped = node.swapped_[goal];
+    auto first = swapped ? node.right_ : node.left_;
+    auto second = swapped ? node.left_ : node.right_;
+    ASM::Instruction lea{ASM::OpCode::LEA, ASM::Operand(), ASM::Operand()};
+    switch (node.rule_[goal]) {
+        case Rule::ADDR_REG_REG:
+            lea.src_ = reduce(first, REG);
+            lea.index_ = reduce(second, REG);
+            return lea;
+        case Rule::ADDR_REG_SCALED: {
+            lea.src_ = reduce(first, REG);
+            auto scaled = reduce_address(second, SCALED);
+            lea.index_ = scaled.index_;
+            lea.scale_ = scaled.scale_;
+            return lea;
+        }
+        case Rule::ADDR_REG_DISP: {
+            lea.src_ = reduce(first, REG);
+            int k = nodes_[second].value_.constant_value();
+            lea.index_ = ASM::Operand::imm(node.op_ == Tacky::OpCode::MINUS ? -k : k);
+            return lea;
+        }
+        case Rule::ADDR_MULT_359: {
+            // x * 3 is x + x * 2
+            lea.src_ = reduce(first, REG);
+            lea.index_ = lea.src_;
+            lea.scale_ = static_cast<uint8_t>(nodes_[second].value_.constant_value() - 1);
+            return lea;
+        }
+        case Rule::SCALED_MULT:
+            lea.index_ = reduce(first, REG);
+            lea.scale_ = static_cast<uint8_t>(nodes_[second].value_.constant_value());
+            return lea;
+        case Rule::SCALED_SHIFT:
+            lea.index_ = reduce(first, REG);
+            lea.scale_ = static_cast<uint8_t>(1 << nodes_[second].value_.constant_value());
+            return lea;
+        default:
+            break;
+    }
+    throw std::runtime_error("No tile covers the tree as an address");
+}
+
+} // namespace Codegen
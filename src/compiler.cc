@@ -1,37 +1,44 @@
+#include <chrono>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <string>
 #include <filesystem>
+#include <optional>
 
 #include "src/ast/ast.h"
 #include "src/graphviz/graphviz.h"
 #include "src/codegen/c_ast_to_tacky/c_ast_to_tacky.h"
 #include "src/codegen/tacky_to_asm/tacky_to_asm.h"
 #include "src/codegen/asm_dump/asm_dump.h"
+#include "src/optimizer/optimizer.h"
 #include "src/lexer/lexer.h"
+#include "src/lexer/dfa_lexer.h"
 #include "src/parser/parser.h"
+#include "src/source/source_buffer.h"
 
 int main(int argc, char** argv) {
-    if (argc != 3) {
-        std::cerr << "Usage: cc <source_file> <output_asm_file>" << std::endl;
+    bool optimize = argc == 4 && std::string(argv[1]) == "-O";
+    if (argc != 3 && !optimize) {
+        std::cerr << "Usage: cc [-O] <source_file|-> <output_asm_file>" << std::endl;
         return 1;
     }
-    std::string source_file = argv[1];
-    std::string output_asm_file = argv[2];
-    std::ifstream input_file(source_file);
-    if (!input_file.is_open()) {
-        std::cerr << "Error: Could not open input file " << source_file << std::endl;
+    std::string source_file = argv[argc - 2];
+    std::string output_asm_file = argv[argc - 1];
+    std::optional<Source::SourceBuffer> source;
+    try {
+        source.emplace(Source::SourceBuffer::from_file(source_file));
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
-
-    std::stringstream buffer;
-    buffer << input_file.rdbuf();
-    std::string source_code = buffer.str();
+    auto& load = source->stats();
+    std::cout << "Read " << load.bytes_read << " bytes from " << source->name()
+              << (load.mapped ? " (mmap)" : " (stream)") << " in "
+              << std::chrono::duration<double, std::milli>(load.io_time).count() << " ms, "
+              << load.bytes_copied << " bytes copied" << std::endl;
 
     std::cout << "Lexing input file..." << std::endl;
 
-    auto lexer = std::make_unique<Lexer::ManualLexer>(source_code);
+    auto lexer = std::make_unique<Lexer::DfaLexer>(source->text());
     auto tokens = lexer->Lex();
 
     // 3. Parsing
@@ -48,55 +55,71 @@ int main(int argc, char** argv) {
     {
         std::cout << "Generating graphviz visualization for CAst..." << std::endl;
         Graphviz::GraphvizCAstVisitor c_ast_graphviz(std::string("asm_output/cast.dot"));
-        auto program_raw = *(program_node.value());
+        auto& program_raw = *(program_node.value());
         c_ast_graphviz.visit(program_raw);
     }
 
     auto tacky_visitor = Codegen::AstToTackyVisitor();
     std::cout << "Generating TACKY AST from C AST..." << std::endl;
-    std::shared_ptr<Tacky::ProgramNode> tacky_program = tacky_visitor.get_tacky_from_c_ast(program_node.value());
+    Tacky::Program tacky_program = tacky_visitor.get_tacky_from_c_ast(program_node.value());
+    if (optimize) {
+        std::cout << "Optimizing TACKY..." << std::endl;
+        auto stats = Optimizer::optimize(tacky_program);
+        std::cout << "Optimized " << stats.instructions_before << " TACKY instructions down to "
+                  << stats.instructions_after << ", " << stats.value_numbered << " of them repeated computations"
+                  << std::endl;
+    }
     {
         std::cout << "Generating graphviz visualization for Tacky AST..." << std::endl;
         Graphviz::GraphvizTackyVisitor tacky_graphviz(std::string("asm_output/tacky.dot"));
-        tacky_graphviz.visit(*tacky_program);
+        tacky_graphviz.visit(tacky_program);
     }
 
     std::cout << "First pass: ASM from Tacky..." << std::endl;
     auto asm_visitor = Codegen::TackyToAsmVisitor();
-    std::shared_ptr<ASM::ProgramNode> asm_program = asm_visitor.get_asm_from_tacky(tacky_program);
+    ASM::Program asm_program = asm_visitor.get_asm_from_tacky(tacky_program);
 
     {
         std::cout << "Generating graphviz visualization for ASM AST first pass..." << std::endl;
         Graphviz::GraphvizASMVisitor asm_graphviz(std::string("asm_output/asm_1st_pass.dot"));
-        asm_graphviz.visit(*asm_program);
+        asm_graphviz.visit(asm_program);
     }
 
+    std::cout << "Allocating registers for pseudos..." << std::endl;
+    auto register_allocator_visitor = Codegen::RegisterAllocatorVisitor();
+    register_allocator_visitor.rewrite(asm_program);
+
     auto pseudo_replacement_visitor = Codegen::PseudoReplacerVisitor();
     std::cout << "Second pass: removing pseudo registers from ASM..." << std::endl;
-    auto no_pseudo_asm_program = pseudo_replacement_visitor.get_rewritten_asm_program(asm_program);
+    pseudo_replacement_visitor.rewrite(asm_program);
 
     {
         std::cout << "Generating graphviz visualization for ASM AST second pass..." << std::endl;
         Graphviz::GraphvizASMVisitor asm_graphviz(std::string("asm_output/asm_2nd_pass.dot"));
-        asm_graphviz.visit(*no_pseudo_asm_program);
+        asm_graphviz.visit(asm_program);
     }
 
-    int max_offset = pseudo_replacement_visitor.get_offset();
-
     std::cout << "Third pass: ASM instruction fixup..." << std::endl;
-    auto instruction_fixup_visitor = Codegen::InstructionFixUpVisitor(max_offset);
-    auto fixed_asm_program = instruction_fixup_visitor.get_rewritten_asm_program(no_pseudo_asm_program);
+    auto instruction_fixup_visitor = Codegen::InstructionFixUpVisitor();
+    instruction_fixup_visitor.rewrite(asm_program);
+
+    std::cout << "Peephole pass over the final ASM..." << std::endl;
+    auto peephole_visitor = Codegen::PeepholeVisitor();
+    peephole_visitor.rewrite(asm_program);
+    for (auto& [rule, hits] : peephole_visitor.hits()) {
+        std::cout << "  " << rule << ": " << hits << std::endl;
+    }
 
     {
         std::cout << "Generating graphviz visualization for ASM AST third pass..." << std::endl;
         Graphviz::GraphvizASMVisitor asm_graphviz(std::string("asm_output/asm_3rd_pass.dot"));
-        asm_graphviz.visit(*fixed_asm_program);
+        asm_graphviz.visit(asm_program);
     }
 
     {
         std::cout << "Dumping ASM code..." << std::endl;
         auto asm_dump_visitor = Codegen::ASMDumper(std::string(output_asm_file));
-        asm_dump_visitor.dump_assembly(fixed_asm_program);
+        asm_dump_visitor.dump_assembly(asm_program);
     }
 
     // generate the graphviz pngs
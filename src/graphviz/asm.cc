@@ -18,8 +18,8 @@ GraphvizASMVisitor::~GraphvizASMVisitor() {
     }
 }
 
-std::string GraphvizASMVisitor::visit_child(std::string parent_id, std::string edge_name, std::shared_ptr<ASM::AstNode> child_node) {
-    child_node->accept(*this);
+std::string GraphvizASMVisitor::visit_child(std::string parent_id, std::string edge_name, const ASM::Operand& operand) {
+    visit(operand);
     auto child_id = buffer_.back();
     buffer_.pop_back();
     auto edge = labeled_edge(parent_id, child_id, edge_name);
@@ -27,31 +27,7 @@ std::string GraphvizASMVisitor::visit_child(std::string parent_id, std::string e
     return child_id;
 }
 
-void GraphvizASMVisitor::visit_bin_exp(std::string node_name, ASM::BinInstructionNode& node) {
-    auto my_id = std::to_string(node_count_++);
-    auto node_repr = labeled_node_with_kv_pairs(
-        my_id,
-        node_name,
-        {}
-    );
-    visit_child(my_id, "left", node.left_);
-    visit_child(my_id, "right", node.right_);
-    buffer_.push_back(my_id);
-}
-
-void GraphvizASMVisitor::visit_un_exp(std::string node_name, ASM::UnaryInstructionNode& node) {
-    auto my_id = std::to_string(node_count_++);
-    auto node_repr = labeled_node_with_kv_pairs(
-        my_id,
-        node_name,
-        {}
-    );
-    visit_child(my_id, "operand", node.src_);
-    buffer_.push_back(my_id);
-}
-
-
-void GraphvizASMVisitor::visit(ASM::ProgramNode& node) {
+void GraphvizASMVisitor::visit(const ASM::Program& program) {
     auto my_id = std::to_string(node_count_++);
     auto node_repr = labeled_node_with_kv_pairs(
         my_id,
@@ -59,154 +35,88 @@ void GraphvizASMVisitor::visit(ASM::ProgramNode& node) {
         {}
     );
     of << node_repr;
-    for(auto& fn : node.functions_) {
-        visit_child(my_id, "function", fn);
+    for(auto& fn : program.functions_) {
+        visit(fn);
+        of << labeled_edge(my_id, buffer_.back(), "function");
+        buffer_.pop_back();
     }
     buffer_.push_back(my_id);
 }
 
-void GraphvizASMVisitor::visit(ASM::FunctionNode& node) {
+void GraphvizASMVisitor::visit(const ASM::Function& function) {
     auto my_id = std::to_string(node_count_++);
     auto node_repr = labeled_node_with_kv_pairs(
         my_id,
         "FunctionNode",
-        {std::make_pair("name", node.name_)}
+        {std::make_pair("name", std::string(function.name_.str()))}
     );
     of << node_repr;
-    auto last_parent = my_id;
-    for(auto& instruction : node.instructions_) {
-        last_parent = visit_child(my_id, "next instruction", instruction);
+    for(auto& instruction : function.instructions_) {
+        visit(instruction);
+        of << labeled_edge(my_id, buffer_.back(), "next instruction");
+        buffer_.pop_back();
     }
     buffer_.push_back(my_id);
 }
 
-// Unary exps
-void GraphvizASMVisitor::visit(ASM::NegNode& node) {visit_un_exp("NegNode", node);}
-void GraphvizASMVisitor::visit(ASM::NotNode& node) {visit_un_exp("NotNode", node);}
-
-// binary arithmetic exps
-void GraphvizASMVisitor::visit(ASM::MultNode& node) {visit_bin_exp("MultNode", node);}
-void GraphvizASMVisitor::visit(ASM::AddNode& node) {visit_bin_exp("AddNode", node);}
-void GraphvizASMVisitor::visit(ASM::SubNode& node) {visit_bin_exp("SubNode", node);}
-
-// binary boolean exps
-void GraphvizASMVisitor::visit(ASM::BitwiseAndNode& node) {visit_bin_exp("BitwiseAndNode", node);}
-void GraphvizASMVisitor::visit(ASM::BitwiseOrNode& node) {visit_bin_exp("BitwiseOrNode", node);}
-void GraphvizASMVisitor::visit(ASM::BitwiseXorNode& node) {visit_bin_exp("BitwiseXorNode", node);}
-void GraphvizASMVisitor::visit(ASM::SalNode& node) {visit_bin_exp("SalNode", node);}
-void GraphvizASMVisitor::visit(ASM::SarNode& node) {visit_bin_exp("SarNode", node);}
-
-void GraphvizASMVisitor::visit(ASM::MovNode& node) {
-    auto my_id = std::to_string(node_count_++);
-    auto node_repr = labeled_node_with_kv_pairs(
-        my_id,
-        "MovNode",
-        {}
-    );
-    visit_child(my_id, "src", node.src_);
-    visit_child(my_id, "dst", node.dst_);
-    buffer_.push_back(my_id);
-}
-
-void GraphvizASMVisitor::visit(ASM::MovBNode& node) {
-    auto my_id = std::to_string(node_count_++);
-    auto node_repr = labeled_node_with_kv_pairs(
-        my_id,
-        "MovBNode",
-        {}
-    );
-    of << node_repr;
-    visit_child(my_id, "src", node.src_);
-    visit_child(my_id, "dst", node.dst_);
-    buffer_.push_back(my_id);
-}
-
-void GraphvizASMVisitor::visit(ASM::DivNode& node) {
-    auto my_id = std::to_string(node_count_++);
-    auto node_repr = labeled_node_with_kv_pairs(
-        my_id,
-        "DivNode",
-        {}
-    );
-    visit_child(my_id, "src", node.src_);
-}
-
-void GraphvizASMVisitor::visit(ASM::CDQNode& node) {
-    auto my_id = std::to_string(node_count_++);
-    auto node_repr = labeled_node_with_kv_pairs(
-        my_id,
-        "CDQNode",
-        {}
-    );
-    of << node_repr;
-    buffer_.push_back(my_id);
-}
-
-void GraphvizASMVisitor::visit(ASM::RetNode& node) {
-    auto my_id = std::to_string(node_count_++);
-    auto node_repr = labeled_node_with_kv_pairs(
-        my_id,
-        "RetNode",
-        {}
-    );
-    of << node_repr;
-    buffer_.push_back(my_id);
-}
-
-void GraphvizASMVisitor::visit(ASM::AllocateStackNode& node) {
-    auto my_id = std::to_string(node_count_++);
-    auto node_repr = labeled_node_with_kv_pairs(
-        my_id,
-        "AllocateStackNode",
-        {std::make_pair("size", std::to_string(node.size_))}   
-    );
-    of << node_repr;
-    buffer_.push_back(my_id);
-}
-
-void GraphvizASMVisitor::visit(ASM::ImmNode& node) {
-    auto my_id = std::to_string(node_count_++);
-    auto node_repr = labeled_node_with_kv_pairs(
-        my_id,
-        "ImmNode",
-        {std::make_pair("value", std::to_string(node.val_))}
-    );
-    of << node_repr;
-    buffer_.push_back(my_id);
-}
-
-void GraphvizASMVisitor::visit(ASM::StackNode& node) {
-    auto my_id = std::to_string(node_count_++);
-    auto node_repr = labeled_node_with_kv_pairs(
-        my_id,
-        "StackNode",
-        {std::make_pair("size", std::to_string(node.size_))}
-    );
-    of << node_repr;
-    buffer_.push_back(my_id);
-}
-
-void GraphvizASMVisitor::visit(ASM::RegisterNode& node) {
+void GraphvizASMVisitor::visit(const ASM::Instruction& instruction) {
     auto my_id = std::to_string(node_count_++);
+    std::vector<NodeKVPair> kv_pairs;
+    if (instruction.op_ == ASM::OpCode::ALLOCATE_STACK) {
+        kv_pairs.push_back(std::make_pair("size", std::to_string(instruction.src_.imm_value())));
+    }
+    if (instruction.op_ == ASM::OpCode::LEA && !instruction.index_.is_immediate()) {
+        kv_pairs.push_back(std::make_pair("scale", std::to_string(instruction.scale_)));
+    }
     auto node_repr = labeled_node_with_kv_pairs(
         my_id,
-        "RegisterNode",
-        {std::make_pair("register", ASM::register_as_string(node.reg_))}
+        ASM::opcode_as_str(instruction.op_) + "Node",
+        kv_pairs
     );
     of << node_repr;
+    if (instruction.op_ != ASM::OpCode::ALLOCATE_STACK) {
+        if (!instruction.src_.is_none()) {
+            visit_child(my_id, "src", instruction.src_);
+        }
+        if (!instruction.index_.is_none()) {
+            visit_child(my_id, "index", instruction.index_);
+        }
+        if (!instruction.dst_.is_none()) {
+            visit_child(my_id, "dst", instruction.dst_);
+        }
+    }
     buffer_.push_back(my_id);
 }
 
-void GraphvizASMVisitor::visit(ASM::PseudoNode& node) {
+void GraphvizASMVisitor::visit(const ASM::Operand& operand) {
     auto my_id = std::to_string(node_count_++);
-    auto node_repr = labeled_node_with_kv_pairs(
-        my_id,
-        "PseudoNode",
-        {std::make_pair("id", node.name_)}
-    );
+    std::string node_repr;
+    switch (operand.kind()) {
+        case ASM::Operand::Kind::IMMEDIATE:
+            node_repr = labeled_node_with_kv_pairs(
+                my_id, "ImmNode", {std::make_pair("value", std::to_string(operand.imm_value()))});
+            break;
+        case ASM::Operand::Kind::STACK:
+            node_repr = labeled_node_with_kv_pairs(
+                my_id, "StackNode", {std::make_pair("offset", std::to_string(operand.stack_offset()))});
+            break;
+        case ASM::Operand::Kind::REGISTER:
+            node_repr = labeled_node_with_kv_pairs(
+                my_id, "RegisterNode", {std::make_pair("register", ASM::register_as_string(operand.reg()))});
+            break;
+        case ASM::Operand::Kind::PSEUDO:
+            node_repr = labeled_node_with_kv_pairs(
+                my_id, "PseudoNode", {std::make_pair("id", std::to_string(operand.pseudo_id()))});
+            break;
+        case ASM::Operand::Kind::LABEL:
+            node_repr = labeled_node_with_kv_pairs(
+                my_id, "LabelNode", {std::make_pair("id", std::to_string(operand.label_id()))});
+            break;
+        case ASM::Operand::Kind::NONE:
+            throw std::runtime_error("unable to draw a missing ASM operand");
+    }
     of << node_repr;
     buffer_.push_back(my_id);
 }
 
-
-} //namespace Graphviz
\ No newline at end of file
+} //namespace Graphviz
@@ -18,8 +18,8 @@ GraphvizCAstVisitor::~GraphvizCAstVisitor() {
     }
 }
 
-std::string GraphvizCAstVisitor::visit_child(std::string parent_id, std::string edge_label, std::shared_ptr<CAst::ASTNode> child_node) {
-    child_node->accept(*this);
+std::string GraphvizCAstVisitor::visit_child(std::string parent_id, std::string edge_label, CAst::ASTNode* child_node) {
+    visit(*child_node);
     auto child_id = buffer_.back();
     auto edge = labeled_edge(parent_id, child_id, edge_label);
     of << edge;
@@ -27,24 +27,38 @@ std::string GraphvizCAstVisitor::visit_child(std::string parent_id, std::string
     return child_id;
 }
 
-void GraphvizCAstVisitor::visit_un_exp(std::string node_name, CAst::UnaryExpressionNode& node) {
+void GraphvizCAstVisitor::visit(CAst::ASTNode& node) {
+    switch (node.kind_) {
+        case CAst::NodeKind::INTEGER_VALUE: visit(static_cast<CAst::IntegerValueNode&>(node)); break;
+        case CAst::NodeKind::UNARY_EXPRESSION: visit(static_cast<CAst::UnaryExpressionNode&>(node)); break;
+        case CAst::NodeKind::BINARY_EXPRESSION: visit(static_cast<CAst::BinaryExpressionNode&>(node)); break;
+        case CAst::NodeKind::TYPE: visit(static_cast<CAst::TypeNode&>(node)); break;
+        case CAst::NodeKind::FUNCTION_ARGUMENTS: visit(static_cast<CAst::FunctionArgumentsNode&>(node)); break;
+        case CAst::NodeKind::RETURN_STATEMENT: visit(static_cast<CAst::ReturnStatementNode&>(node)); break;
+        case CAst::NodeKind::STATEMENT_BLOCK: visit(static_cast<CAst::StatementBlockNode&>(node)); break;
+        case CAst::NodeKind::FUNCTION: visit(static_cast<CAst::FunctionNode&>(node)); break;
+        case CAst::NodeKind::PROGRAM: visit(static_cast<CAst::ProgramNode&>(node)); break;
+    }
+}
+
+void GraphvizCAstVisitor::visit(CAst::UnaryExpressionNode& node) {
     auto my_id = std::to_string(node_count_++);
     auto node_repr = labeled_node_with_kv_pairs(
         my_id,
-        node_name,
-        {}
+        "UnaryExpressionNode",
+        {std::make_pair("op", escape_record_label(CAst::unary_operator_as_str(node.op_)))}
     );
     of << node_repr;
     visit_child(my_id, std::string("operand"), node.operand_);
     buffer_.push_back(my_id);
 }
 
-void GraphvizCAstVisitor::visit_bin_exp(std::string node_name, CAst::BinaryExpressionNode& node) {
+void GraphvizCAstVisitor::visit(CAst::BinaryExpressionNode& node) {
     auto my_id = std::to_string(node_count_++);
     auto node_repr = labeled_node_with_kv_pairs(
         my_id,
-        node_name,
-        {}
+        "BinaryExpressionNode",
+        {std::make_pair("op", escape_record_label(CAst::binary_operator_as_str(node.op_)))}
     );
     of << node_repr;
 
@@ -73,7 +87,7 @@ void GraphvizCAstVisitor::visit(CAst::FunctionNode& node) {
     auto node_repr = labeled_node_with_kv_pairs(
         my_id,
         "FunctionNode",
-        {std::make_pair("Name", node.name_)}
+        {std::make_pair("Name", std::string(node.name_.str()))}
     );
     of << node_repr;
 
@@ -99,7 +113,7 @@ void GraphvizCAstVisitor::visit(CAst::FunctionArgumentsNode& node) {
     auto my_id = std::to_string(node_count_++);
     std::vector<NodeKVPair> kvpairs;
     for(auto x : node.arguments_) {
-        kvpairs.push_back(std::make_pair(type_as_str(x.type), x.name));
+        kvpairs.push_back(std::make_pair(type_as_str(x.type), std::string(x.name.str())));
     }
     auto node_repr = labeled_node_with_kv_pairs(
         my_id,
@@ -138,28 +152,6 @@ void GraphvizCAstVisitor::visit(CAst::ReturnStatementNode& node) {
     buffer_.push_back(my_id);
 }
 
-// Unary Expressions
-void GraphvizCAstVisitor::visit(CAst::TildeUnaryExpressionNode& node) {visit_un_exp(std::string("TildeUnaryExpressionNode"), node);}
-void GraphvizCAstVisitor::visit(CAst::NotUnaryExpressionNode& node) {visit_un_exp(std::string("NotUnaryExpressionNode"), node);}
-void GraphvizCAstVisitor::visit(CAst::MinusUnaryExpressionNode& node) {visit_un_exp(std::string("MinusUnaryExpressionNode"), node);}
-
-// Binary arithmetic Expressions
-void GraphvizCAstVisitor::visit(CAst::DivNode& node) {visit_bin_exp("DivNode", node);}
-void GraphvizCAstVisitor::visit(CAst::MultNode& node) {visit_bin_exp("MultNode", node);}
-void GraphvizCAstVisitor::visit(CAst::ModNode& node) {visit_bin_exp("ModNode", node);}
-void GraphvizCAstVisitor::visit(CAst::MinusNode& node) {visit_bin_exp("MinusNode", node);}
-void GraphvizCAstVisitor::visit(CAst::PlusNode& node) {visit_bin_exp("PlusNode", node);}
-
-// Binary bitwise expressions
-void GraphvizCAstVisitor::visit(CAst::AndNode& node) {visit_bin_exp("AndNode", node);}
-void GraphvizCAstVisitor::visit(CAst::OrNode& node) {visit_bin_exp("OrNode", node);}
-void GraphvizCAstVisitor::visit(CAst::BitwiseAndNode& node) {visit_bin_exp("BitwiseAndNode", node);}
-void GraphvizCAstVisitor::visit(CAst::BitwiseOrNode& node) {visit_bin_exp("BitwiseOrNode", node);}
-void GraphvizCAstVisitor::visit(CAst::BitwiseXorNode& node) {visit_bin_exp("BitwiseXorNode", node);}
-void GraphvizCAstVisitor::visit(CAst::BitwiseLeftShiftNode& node) {visit_bin_exp("BitwiseLeftShiftNode", node);}
-void GraphvizCAstVisitor::visit(CAst::BitwiseRightShiftNode& node) {visit_bin_exp("BitwiseRightShiftNode", node);}
-
-
 // Terminal nodes
 
 void GraphvizCAstVisitor::visit(CAst::IntegerValueNode& node) {
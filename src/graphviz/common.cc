@@ -18,6 +18,17 @@ std::string labeled_node_with_kv_pairs(std::string node_id, std::string node_nam
     return result;
 }
 
+std::string escape_record_label(std::string_view text) {
+    std::string result;
+    for (char c : text) {
+        if (c == '|' || c == '<' || c == '>' || c == '{' || c == '}' || c == '"' || c == '\\') {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result;
+}
+
 std::string labeled_edge(std::string parent_id, std::string child_id, std::string label) {
     return "\tn" + parent_id + " -> n" + child_id + "[label=\"" + label + "\"]\n";
 }
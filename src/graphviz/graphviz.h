@@ -7,6 +7,7 @@
 #include <fstream>
 #include <utility>
 #include <string>
+#include <string_view>
 
 namespace Graphviz {
 
@@ -14,107 +15,57 @@ typedef std::pair<std::string, std::string> NodeKVPair;
 
 std::string labeled_node_with_kv_pairs(std::string node_id, std::string node_name, const std::vector<NodeKVPair>& kv_pairs);
 std::string labeled_edge(std::string parent_id, std::string child_id, std::string label);
+// record labels treat |, <, >, { and } as structure, operators must escape them
+std::string escape_record_label(std::string_view text);
 
-class GraphvizCAstVisitor : public CAst::Visitor {
+class GraphvizCAstVisitor {
 public:
     ~GraphvizCAstVisitor();
     GraphvizCAstVisitor(std::string filename);
-    void visit(CAst::TypeNode& node) override;
-    void visit(CAst::FunctionArgumentsNode& node) override;
-    void visit(CAst::ReturnStatementNode& node) override;
-    void visit(CAst::StatementBlockNode& node) override;
-    void visit(CAst::FunctionNode& node) override;
-    void visit(CAst::ProgramNode& node) override;
-    void visit(CAst::TildeUnaryExpressionNode& node) override;
-    void visit(CAst::MinusUnaryExpressionNode& node) override;
-    void visit(CAst::IntegerValueNode& node) override;
-    void visit(CAst::DivNode& node) override;
-    void visit(CAst::MultNode& node) override;
-    void visit(CAst::ModNode& node) override;
-    void visit(CAst::MinusNode& node) override;
-    void visit(CAst::PlusNode& node) override;
-    void visit(CAst::AndNode& node) override;
-    void visit(CAst::OrNode& node) override;
-    void visit(CAst::BitwiseAndNode& node) override;
-    void visit(CAst::BitwiseOrNode& node) override;
-    void visit(CAst::BitwiseXorNode& node) override;
-    void visit(CAst::BitwiseRightShiftNode& node) override;
-    void visit(CAst::BitwiseLeftShiftNode& node) override;
-    void visit(CAst::NotUnaryExpressionNode& node) override;
+    void visit(CAst::ASTNode& node);
+    void visit(CAst::TypeNode& node);
+    void visit(CAst::FunctionArgumentsNode& node);
+    void visit(CAst::ReturnStatementNode& node);
+    void visit(CAst::StatementBlockNode& node);
+    void visit(CAst::FunctionNode& node);
+    void visit(CAst::ProgramNode& node);
+    void visit(CAst::IntegerValueNode& node);
+    void visit(CAst::UnaryExpressionNode& node);
+    void visit(CAst::BinaryExpressionNode& node);
 
-    void visit_bin_exp(std::string node_name, CAst::BinaryExpressionNode& node);
-    void visit_un_exp(std::string node_name, CAst::UnaryExpressionNode& node);
-    std::string visit_child(std::string parent_id, std::string edge_name, std::shared_ptr<CAst::ASTNode> child_node);
+    std::string visit_child(std::string parent_id, std::string edge_name, CAst::ASTNode* child_node);
 
     std::vector<std::string> buffer_;
     int node_count_;
     std::ofstream of;
 };
 
-class GraphvizTackyVisitor : public Tacky::Visitor {
+class GraphvizTackyVisitor {
 public:
     ~GraphvizTackyVisitor();
     GraphvizTackyVisitor(std::string filename);
-    void visit(Tacky::ProgramNode& node) override;
-    void visit(Tacky::FunctionNode& node) override;
-    void visit(Tacky::ReturnNode& node) override;
-    void visit(Tacky::ComplementNode& node) override;
-    void visit(Tacky::NegateNode& node) override;
-    void visit(Tacky::NotNode& node) override;
-    void visit(Tacky::IntegerNode& node) override;
-    void visit(Tacky::VariableNode& node) override;
-    void visit(Tacky::DivNode& node) override;
-    void visit(Tacky::MultNode& node) override;
-    void visit(Tacky::ModNode& node) override;
-    void visit(Tacky::PlusNode& node) override;
-    void visit(Tacky::MinusNode& node) override;
-    void visit(Tacky::AndNode& node) override;
-    void visit(Tacky::BitwiseAndNode& node) override;
-    void visit(Tacky::OrNode& node) override;
-    void visit(Tacky::BitwiseOrNode& node) override;
-    void visit(Tacky::BitwiseLeftShiftNode& node) override;
-    void visit(Tacky::BitwiseRightShiftNode& node) override;
-    void visit(Tacky::BitwiseXorNode& node) override;
+    void visit(const Tacky::Program& program);
+    void visit(const Tacky::Function& function);
+    void visit(const Tacky::Instruction& instruction);
+    void visit(Tacky::Value value);
 
-    void visit_bin_exp(std::string node_name, Tacky::BinaryOpNode& node);
-    void visit_un_exp(std::string node_name, Tacky::UnaryNode& node);
-    std::string visit_child(std::string parent_id, std::string edge_name, std::shared_ptr<Tacky::AstNode> child_node);
+    std::string visit_child(std::string parent_id, std::string edge_name, Tacky::Value value);
 
     std::vector<std::string> buffer_;
     std::ofstream of;
     int node_count_;
 };
 
-class GraphvizASMVisitor : public ASM::Visitor {
+class GraphvizASMVisitor {
 public:
     ~GraphvizASMVisitor();
     GraphvizASMVisitor(std::string filename);
-    void visit(ASM::ProgramNode& node) override;
-    void visit(ASM::FunctionNode& node) override;
-    void visit(ASM::NegNode& node) override;
-    void visit(ASM::NotNode& node) override;
-    void visit(ASM::MovNode& node) override;
-    void visit(ASM::MovBNode& node) override;
-    void visit(ASM::RetNode& node) override;
-    void visit(ASM::AllocateStackNode& node) override;
-    void visit(ASM::ImmNode& node) override;
-    void visit(ASM::StackNode& node) override;
-    void visit(ASM::RegisterNode& node) override;
-    void visit(ASM::PseudoNode& node) override;
-    void visit(ASM::DivNode& node) override;
-    void visit(ASM::MultNode& node) override;
-    void visit(ASM::AddNode& node) override;
-    void visit(ASM::SubNode& node) override;
-    void visit(ASM::CDQNode& node) override;
-    void visit(ASM::BitwiseAndNode& node) override;
-    void visit(ASM::BitwiseOrNode& node) override;
-    void visit(ASM::BitwiseXorNode& node) override;
-    void visit(ASM::SalNode& node) override;
-    void visit(ASM::SarNode& node) override;
+    void visit(const ASM::Program& program);
+    void visit(const ASM::Function& function);
+    void visit(const ASM::Instruction& instruction);
+    void visit(const ASM::Operand& operand);
 
-    void visit_bin_exp(std::string node_name, ASM::BinInstructionNode& node);
-    void visit_un_exp(std::string node_name, ASM::UnaryInstructionNode& node);
-    std::string visit_child(std::string parent_id, std::string edge_name, std::shared_ptr<ASM::AstNode> child_node);
+    std::string visit_child(std::string parent_id, std::string edge_name, const ASM::Operand& operand);
 
     std::vector<std::string> buffer_;
     std::ofstream of;
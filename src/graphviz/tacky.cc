@@ -19,8 +19,8 @@ GraphvizTackyVisitor::~GraphvizTackyVisitor() {
     }
 }
 
-std::string GraphvizTackyVisitor::visit_child(std::string parent_id, std::string edge_name, std::shared_ptr<Tacky::AstNode> child_node) {
-    child_node->accept(*this);
+std::string GraphvizTackyVisitor::visit_child(std::string parent_id, std::string edge_name, Tacky::Value value) {
+    visit(value);
     auto child_id = buffer_.back();
     buffer_.pop_back();
     auto edge = labeled_edge(parent_id, child_id, edge_name);
@@ -28,36 +28,7 @@ std::string GraphvizTackyVisitor::visit_child(std::string parent_id, std::string
     return child_id;
 }
 
-void GraphvizTackyVisitor::visit_bin_exp(std::string node_name, Tacky::BinaryOpNode& node) {
-    auto my_id = std::to_string(node_count_++);
-    std::string node_repr = labeled_node_with_kv_pairs(
-        my_id,
-        node_name,
-        {}
-    );
-    of << node_repr;
-
-    visit_child(my_id, "left", node.left_);
-    visit_child(my_id, "right", node.right_);
-    visit_child(my_id, "dst", node.dst_);
-
-    buffer_.push_back(my_id);
-}
-
-void GraphvizTackyVisitor::visit_un_exp(std::string node_name, Tacky::UnaryNode& node) {
-    auto my_id = std::to_string(node_count_++);
-    std::string node_repr = labeled_node_with_kv_pairs(
-        my_id,
-        node_name,
-        {}
-    );
-    of << node_repr;
-    visit_child(my_id, "src", node.src_);
-    visit_child(my_id, "dst", node.dst_);
-    buffer_.push_back(my_id);
-}
-
-void GraphvizTackyVisitor::visit(Tacky::ProgramNode& node) {
+void GraphvizTackyVisitor::visit(const Tacky::Program& program) {
     auto my_id = std::to_string(node_count_++);
     std::string node_repr = labeled_node_with_kv_pairs(
         my_id,
@@ -65,80 +36,90 @@ void GraphvizTackyVisitor::visit(Tacky::ProgramNode& node) {
         {}
     );
     of << node_repr;
-    for (auto &fn : node.functions_) {
-        visit_child(my_id, "function", fn);
+    for (auto &fn : program.functions_) {
+        visit(fn);
+        of << labeled_edge(my_id, buffer_.back(), "function");
+        buffer_.pop_back();
     }
     buffer_.push_back(my_id);
 }
 
-void GraphvizTackyVisitor::visit(Tacky::FunctionNode& node) {
+void GraphvizTackyVisitor::visit(const Tacky::Function& function) {
     auto my_id = std::to_string(node_count_++);
     std::string node_repr = labeled_node_with_kv_pairs(
         my_id,
         "FunctionNode",
-        {std::make_pair("name", node.name_)}
+        {
+            std::make_pair("name", std::string(function.name_.str())),
+            std::make_pair("temporaries", std::to_string(function.temporary_count_)),
+            std::make_pair("labels", std::to_string(function.label_count_)),
+        }
     );
     of << node_repr;
     auto last_parent = my_id;
-    for(auto& instruction : node.instructions_) {
-        last_parent = visit_child(last_parent, "next instruction", instruction);
+    for(auto& instruction : function.instructions_) {
+        visit(instruction);
+        of << labeled_edge(last_parent, buffer_.back(), "next instruction");
+        last_parent = buffer_.back();
+        buffer_.pop_back();
     }
     buffer_.push_back(my_id);
 }
 
-void GraphvizTackyVisitor::visit(Tacky::ReturnNode& node) {
+void GraphvizTackyVisitor::visit(const Tacky::Instruction& instruction) {
     auto my_id = std::to_string(node_count_++);
     std::string node_repr = labeled_node_with_kv_pairs(
         my_id,
-        "ReturnNode",
+        Tacky::opcode_as_str(instruction.op_) + "Node",
         {}
     );
     of << node_repr;
-    visit_child(my_id, "return value", node.value_);
-    buffer_.push_back(my_id);
-}
-
-// Unary expressions
-void GraphvizTackyVisitor::visit(Tacky::ComplementNode& node) {visit_un_exp("ComplementNode", node);}
-void GraphvizTackyVisitor::visit(Tacky::NegateNode& node) {visit_un_exp("NegateNode", node);}
-void GraphvizTackyVisitor::visit(Tacky::NotNode& node) {visit_un_exp("NotNode", node);}
-
-// Binary arithmetic expressions
-void GraphvizTackyVisitor::visit(Tacky::DivNode& node) {visit_bin_exp("DivNode", node);}
-void GraphvizTackyVisitor::visit(Tacky::MultNode& node) {visit_bin_exp("MultNode", node);}
-void GraphvizTackyVisitor::visit(Tacky::ModNode& node) {visit_bin_exp("ModNode", node);}
-void GraphvizTackyVisitor::visit(Tacky::PlusNode& node) {visit_bin_exp("PlusNode", node);}
-void GraphvizTackyVisitor::visit(Tacky::MinusNode& node) {visit_bin_exp("MinusNode", node);}
-
-// Binary boolean expressions
-void GraphvizTackyVisitor::visit(Tacky::AndNode& node) {visit_bin_exp("AndNode", node);}
-void GraphvizTackyVisitor::visit(Tacky::BitwiseAndNode& node) {visit_bin_exp("BitwiseAndNode", node);}
-void GraphvizTackyVisitor::visit(Tacky::OrNode& node) {visit_bin_exp("OrNode", node);}
-void GraphvizTackyVisitor::visit(Tacky::BitwiseOrNode& node) {visit_bin_exp("BitwiseOrNode", node);}
-void GraphvizTackyVisitor::visit(Tacky::BitwiseLeftShiftNode& node) {visit_bin_exp("BitwiseLeftShiftNode", node);}
-void GraphvizTackyVisitor::visit(Tacky::BitwiseRightShiftNode& node) {visit_bin_exp("BitwiseRightShiftNode", node);}
-void GraphvizTackyVisitor::visit(Tacky::BitwiseXorNode& node) {visit_bin_exp("BitwiseXorNode", node);}
-
-void GraphvizTackyVisitor::visit(Tacky::IntegerNode& node) {
-    auto my_id = std::to_string(node_count_++);
-    std::string node_repr = labeled_node_with_kv_pairs(
-        my_id,
-        "IntegerNode",
-        {std::make_pair("value", std::to_string(node.value_))}
-    );
-    of << node_repr;
+    if (instruction.op_ == Tacky::OpCode::RETURN) {
+        visit_child(my_id, "return value", instruction.src1_);
+    } else if (instruction.op_ == Tacky::OpCode::LABEL || instruction.op_ == Tacky::OpCode::JUMP) {
+        visit_child(my_id, "label", instruction.src1_);
+    } else if (Tacky::is_jump(instruction.op_)) {
+        visit_child(my_id, "condition", instruction.src1_);
+        visit_child(my_id, "label", instruction.src2_);
+    } else if (instruction.op_ == Tacky::OpCode::PHI) {
+        // an undefined incoming value has no edge
+        if (!instruction.src1_.is_none()) {
+            visit_child(my_id, "value", instruction.src1_);
+        }
+        visit_child(my_id, "predecessor", instruction.src2_);
+        visit_child(my_id, "dst", instruction.dst_);
+    } else if (Tacky::is_unary(instruction.op_)) {
+        visit_child(my_id, "src", instruction.src1_);
+        visit_child(my_id, "dst", instruction.dst_);
+    } else {
+        visit_child(my_id, "left", instruction.src1_);
+        visit_child(my_id, "right", instruction.src2_);
+        visit_child(my_id, "dst", instruction.dst_);
+    }
     buffer_.push_back(my_id);
 }
 
-void GraphvizTackyVisitor::visit(Tacky::VariableNode& node) {
+void GraphvizTackyVisitor::visit(Tacky::Value value) {
     auto my_id = std::to_string(node_count_++);
-    std::string node_repr = labeled_node_with_kv_pairs(
-        my_id,
-        "VariableNode",
-        {std::make_pair("id", node.name_)}
-    );
+    std::string node_repr;
+    switch (value.kind()) {
+        case Tacky::Value::Kind::CONSTANT:
+            node_repr = labeled_node_with_kv_pairs(
+                my_id, "IntegerNode", {std::make_pair("value", std::to_string(value.constant_value()))});
+            break;
+        case Tacky::Value::Kind::TEMPORARY:
+            node_repr = labeled_node_with_kv_pairs(
+                my_id, "VariableNode", {std::make_pair("id", std::to_string(value.temporary_id()))});
+            break;
+        case Tacky::Value::Kind::LABEL:
+            node_repr = labeled_node_with_kv_pairs(
+                my_id, "LabelNode", {std::make_pair("id", std::to_string(value.label_id()))});
+            break;
+        case Tacky::Value::Kind::NONE:
+            throw std::runtime_error("unable to draw a missing tacky operand");
+    }
     of << node_repr;
     buffer_.push_back(my_id);
 }
 
-} //namespace Graphviz
\ No newline at end of file
+} //namespace Graphviz
@@ -0,0 +1,279 @@
+#include "src/lexer/dfa_lexer.h"
+#include <bit>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+namespace Lexer {
+
+namespace {
+
+constexpr std::array<CharClass, 256> kCharClasses = [] {
+    std::array<CharClass, 256> classes{};
+    classes.fill(CharClass::INVALID_CHAR);
+    for (unsigned char c : std::string_view(" \t\n\v\f\r")) {
+        classes[c] = CharClass::WHITESPACE_CHAR;
+    }
+    for (int c = '0'; c <= '9'; c++) {
+        classes[c] = CharClass::DIGIT_CHAR;
+    }
+    for (int c = 'a'; c <= 'z'; c++) {
+        classes[c] = CharClass::IDENTIFIER_CHAR;
+    }
+    for (int c = 'A'; c <= 'Z'; c++) {
+        classes[c] = CharClass::IDENTIFIER_CHAR;
+    }
+    classes['_'] = CharClass::IDENTIFIER_CHAR;
+    classes['"'] = CharClass::QUOTE_CHAR;
+    for (unsigned char c : std::string_view("(){};,~-+*/%&|^!<>=")) {
+        classes[c] = CharClass::OPERATOR_CHAR;
+    }
+    return classes;
+}();
+
+constexpr std::array<OperatorTransition, 256> kOperatorTransitions = [] {
+    std::array<OperatorTransition, 256> table{};
+    auto single = [&](char c, TokenType kind) {
+        auto& row = table[static_cast<unsigned char>(c)];
+        row.single = kind;
+        row.single_valid = true;
+    };
+    auto paired = [&](char c, int slot, char second, TokenType kind) {
+        auto& row = table[static_cast<unsigned char>(c)];
+        row.second[slot] = second;
+        row.paired[slot] = kind;
+    };
+    single('(', TokenType::LPAREN);
+    single(')', TokenType::RPAREN);
+    single('{', TokenType::LBRACE);
+    single('}', TokenType::RBRACE);
+    single(';', TokenType::SEMICOLON);
+    single(',', TokenType::COMMA);
+    single('~', TokenType::TILDE);
+    single('+', TokenType::PLUS);
+    single('*', TokenType::MULT);
+    single('/', TokenType::DIV);
+    single('%', TokenType::MOD);
+    single('^', TokenType::BITWISE_XOR);
+    single('-', TokenType::MINUS);
+    paired('-', 0, '-', TokenType::DOUBLE_MINUS);
+    single('&', TokenType::BITWISE_AND);
+    paired('&', 0, '&', TokenType::AND);
+    single('|', TokenType::BITWISE_OR);
+    paired('|', 0, '|', TokenType::OR);
+    single('!', TokenType::NOT);
+    paired('!', 0, '=', TokenType::NOT_EQUAL);
+    single('<', TokenType::LESS);
+    paired('<', 0, '<', TokenType::BITSHIFT_LEFT);
+    paired('<', 1, '=', TokenType::LESS_EQ);
+    single('>', TokenType::GREATER);
+    paired('>', 0, '>', TokenType::BITSHIFT_RIGHT);
+    paired('>', 1, '=', TokenType::GREATER_EQ);
+    // a lone '=' is not a token in this language, only '=='
+    paired('=', 0, '=', TokenType::EQUAL);
+    return table;
+}();
+
+// Perfect hash over the keyword set: first byte xor length, masked to the
+// table size. The static_assert below keeps it collision free when keywords
+// are added.
+constexpr size_t kKeywordTableSize = 4;
+
+constexpr size_t keyword_hash(char first, size_t length) {
+    return (static_cast<unsigned char>(first) ^ length) & (kKeywordTableSize - 1);
+}
+
+constexpr std::array<Keyword, 2> kKeywords = {{
+    {"int", TokenType::INTEGER_TYPE},
+    {"return", TokenType::RETURN},
+}};
+
+constexpr std::array<Keyword, kKeywordTableSize> kKeywordTable = [] {
+    std::array<Keyword, kKeywordTableSize> table{};
+    for (auto& keyword : kKeywords) {
+        table[keyword_hash(keyword.text[0], keyword.text.size())] = keyword;
+    }
+    return table;
+}();
+
+constexpr bool keyword_hash_is_perfect() {
+    for (size_t i = 0; i < kKeywords.size(); i++) {
+        for (size_t j = i + 1; j < kKeywords.size(); j++) {
+            if (keyword_hash(kKeywords[i].text[0], kKeywords[i].text.size()) ==
+                keyword_hash(kKeywords[j].text[0], kKeywords[j].text.size())) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+static_assert(keyword_hash_is_perfect(), "keyword hash has collisions, grow the table or change the hash");
+
+// SWAR helpers: process 8 source bytes per step. Each returns a word with the
+// high bit of every byte set where the byte matches.
+constexpr uint64_t kOnes = 0x0101010101010101ULL;
+constexpr uint64_t kHighBits = 0x8080808080808080ULL;
+constexpr uint64_t kLowBits = 0x7F7F7F7F7F7F7F7FULL;
+
+static_assert(std::endian::native == std::endian::little, "SWAR scanning assumes a little endian target");
+
+inline uint64_t load_word(const char* ptr) {
+    uint64_t word;
+    std::memcpy(&word, ptr, sizeof(word));
+    return word;
+}
+
+inline uint64_t bytes_equal(uint64_t word, unsigned char c) {
+    uint64_t diff = word ^ (kOnes * c);
+    return ~(((diff & kLowBits) + kLowBits) | diff | kLowBits);
+}
+
+// bytes within [lo, hi], both ascii
+inline uint64_t bytes_in_range(uint64_t word, unsigned char lo, unsigned char hi) {
+    uint64_t low7 = word & kLowBits;
+    uint64_t at_least_lo = (low7 + kOnes * (0x80 - lo)) & kHighBits;
+    uint64_t at_most_hi = ~(low7 + kOnes * (0x7F - hi)) & kHighBits;
+    return at_least_lo & at_most_hi & ~word;
+}
+
+inline uint64_t whitespace_bytes(uint64_t word) {
+    return bytes_equal(word, ' ') | bytes_in_range(word, '\t', '\r');
+}
+
+inline uint64_t digit_bytes(uint64_t word) {
+    return bytes_in_range(word, '0', '9');
+}
+
+} // namespace
+
+DfaLexer::DfaLexer(std::string_view code) : idx_(0), code_(code) {}
+
+auto DfaLexer::Lex() -> TokenStream {
+    return TokenStream(tokenize());
+}
+
+auto DfaLexer::tokenize() -> std::generator<Token> {
+    while (true) {
+        Token token = next_token();
+        bool reached_end = token.kind == TokenType::END_OF_FILE;
+        co_yield std::move(token);
+        if (reached_end) {
+            co_return;
+        }
+    }
+}
+
+Token DfaLexer::next_token() {
+    skip_whitespace();
+    if (idx_ >= code_.size()) {
+        return Token{TokenType::END_OF_FILE, std::monostate{}};
+    }
+    switch (kCharClasses[static_cast<unsigned char>(code_[idx_])]) {
+        case CharClass::OPERATOR_CHAR:
+            return lex_operator();
+        case CharClass::DIGIT_CHAR:
+            return lex_integer();
+        case CharClass::IDENTIFIER_CHAR:
+            return lex_identifier();
+        case CharClass::QUOTE_CHAR:
+            return lex_string();
+        case CharClass::WHITESPACE_CHAR:
+        case CharClass::INVALID_CHAR:
+            break;
+    }
+    throw std::runtime_error("Unexpected character '" + std::string(1, code_[idx_]) +
+        "' at offset " + std::to_string(idx_));
+}
+
+void DfaLexer::skip_whitespace() {
+    const char* data = code_.data();
+    while (idx_ + sizeof(uint64_t) <= code_.size()) {
+        uint64_t non_whitespace = ~whitespace_bytes(load_word(data + idx_)) & kHighBits;
+        if (non_whitespace) {
+            idx_ += std::countr_zero(non_whitespace) / 8;
+            return;
+        }
+        idx_ += sizeof(uint64_t);
+    }
+    while (idx_ < code_.size() &&
+           kCharClasses[static_cast<unsigned char>(data[idx_])] == CharClass::WHITESPACE_CHAR) {
+        idx_++;
+    }
+}
+
+size_t DfaLexer::digit_run_end(size_t from) const {
+    const char* data = code_.data();
+    while (from + sizeof(uint64_t) <= code_.size()) {
+        uint64_t non_digits = ~digit_bytes(load_word(data + from)) & kHighBits;
+        if (non_digits) {
+            return from + std::countr_zero(non_digits) / 8;
+        }
+        from += sizeof(uint64_t);
+    }
+    while (from < code_.size() &&
+           kCharClasses[static_cast<unsigned char>(data[from])] == CharClass::DIGIT_CHAR) {
+        from++;
+    }
+    return from;
+}
+
+Token DfaLexer::lex_operator() {
+    const auto& transition = kOperatorTransitions[static_cast<unsigned char>(code_[idx_])];
+    if (idx_ + 1 < code_.size()) {
+        char next = code_[idx_ + 1];
+        for (int slot = 0; slot < 2; slot++) {
+            if (transition.second[slot] != 0 && transition.second[slot] == next) {
+                idx_ += 2;
+                return Token{transition.paired[slot], std::monostate{}};
+            }
+        }
+    }
+    if (!transition.single_valid) {
+        throw std::runtime_error("Unexpected character '" + std::string(1, code_[idx_]) +
+            "' at offset " + std::to_string(idx_));
+    }
+    idx_++;
+    return Token{transition.single, std::monostate{}};
+}
+
+Token DfaLexer::lex_integer() {
+    size_t end = digit_run_end(idx_);
+    int64_t value = 0;
+    for (size_t i = idx_; i < end; i++) {
+        value = value * 10 + (code_[i] - '0');
+        if (value > INT_MAX) {
+            throw std::runtime_error("Integer literal out of range at offset " + std::to_string(idx_));
+        }
+    }
+    idx_ = end;
+    return Token{TokenType::INTEGER_VALUE, static_cast<int>(value)};
+}
+
+Token DfaLexer::lex_identifier() {
+    size_t start = idx_;
+    while (idx_ < code_.size()) {
+        auto char_class = kCharClasses[static_cast<unsigned char>(code_[idx_])];
+        if (char_class != CharClass::IDENTIFIER_CHAR && char_class != CharClass::DIGIT_CHAR) {
+            break;
+        }
+        idx_++;
+    }
+    std::string_view word = code_.substr(start, idx_ - start);
+    const auto& candidate = kKeywordTable[keyword_hash(word[0], word.size())];
+    if (candidate.text == word) {
+        return Token{candidate.kind, std::monostate{}};
+    }
+    return Token{TokenType::NAME, Source::Symbol::intern(word)};
+}
+
+Token DfaLexer::lex_string() {
+    size_t start = ++idx_;
+    size_t end = code_.find('"', start);
+    if (end == std::string_view::npos) {
+        throw std::runtime_error("Unterminated string literal at offset " + std::to_string(start - 1));
+    }
+    idx_ = end + 1;
+    return Token{TokenType::STRING, Source::Symbol::intern(code_.substr(start, end - start))};
+}
+
+} // namespace Lexer
@@ -0,0 +1,55 @@
+#pragma once
+#include "src/lexer/lexer.h"
+#include "src/lexer/token.h"
+#include <array>
+#include <cstdint>
+#include <generator>
+#include <string>
+#include <string_view>
+
+namespace Lexer {
+
+// Byte classes driving the DFA. Every input byte maps to exactly one class,
+// so the main loop dispatches through a single table lookup per token start.
+enum CharClass : uint8_t {
+    INVALID_CHAR,
+    WHITESPACE_CHAR,
+    DIGIT_CHAR,
+    IDENTIFIER_CHAR,
+    QUOTE_CHAR,
+    OPERATOR_CHAR,
+};
+
+// An operator token is at most two bytes long. Each byte that can start one
+// gets a row describing the single-byte token and up to two continuations.
+struct OperatorTransition {
+    TokenType single = TokenType::END_OF_FILE;
+    bool single_valid = false;
+    char second[2] = {0, 0};
+    TokenType paired[2] = {TokenType::END_OF_FILE, TokenType::END_OF_FILE};
+};
+
+struct Keyword {
+    std::string_view text;
+    TokenType kind;
+};
+
+class DfaLexer: public Lexer {
+public:
+    DfaLexer(std::string_view code);
+    ~DfaLexer() override = default;
+    auto Lex() -> TokenStream override;
+private:
+    size_t idx_ = 0;
+    const std::string_view code_;
+    auto tokenize() -> std::generator<Token>;
+    Token next_token();
+    Token lex_operator();
+    Token lex_integer();
+    Token lex_identifier();
+    Token lex_string();
+    void skip_whitespace();
+    size_t digit_run_end(size_t from) const;
+};
+
+} // namespace Lexer
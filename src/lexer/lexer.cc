@@ -12,38 +12,52 @@ namespace Lexer {
 
 TokenStream::TokenStream(std::generator<Token> tokens) : 
     tokens_(std::move(tokens)),
-    buffer_(std::unordered_map<int, Token>()),
-    idx_at_(0),
-    idx_buffered_(-1),
-    tokens_it_(nullptr) {
+    head_(0),
+    size_(0),
+    tokens_it_(nullptr),
+    end_of_file_(Token{TokenType::END_OF_FILE, std::monostate{}}) {
         tokens_it_ = std::make_unique<std::ranges::iterator_t<std::generator<Token>>>(tokens_.begin());
 }
-Token TokenStream::consume() {
-    if (buffer_.empty()) {
+
+// Pulls tokens from the generator until `count` are buffered. Returns false
+// when the generator runs dry first.
+bool TokenStream::fill(size_t count) {
+    while (size_ < count) {
         if (*tokens_it_ == tokens_.end()) {
-            return Token{TokenType::END_OF_FILE, std::monostate{}};
+            return false;
         }
-        buffer_[++idx_buffered_] = **tokens_it_;
+        if (size_ == kLookaheadCapacity) {
+            throw std::runtime_error("Token lookahead exceeds the stream capacity of " +
+                std::to_string(kLookaheadCapacity));
+        }
+        buffer_[(head_ + size_) & kLookaheadMask] = std::move(**tokens_it_);
         (*tokens_it_)++;
+        size_++;
+    }
+    return true;
+}
+
+Token TokenStream::consume() {
+    if (!fill(1)) {
+        return end_of_file_;
     }
-    Token t = buffer_[idx_at_];
-    buffer_.erase(idx_at_);
-    idx_at_++;
+    Token t = std::move(buffer_[head_]);
+    head_ = (head_ + 1) & kLookaheadMask;
+    size_--;
     return t;
 }
 
-Token TokenStream::peek(int pos_ahead) {
-    while (idx_buffered_ < idx_at_ + pos_ahead) {
-        if (*tokens_it_ == tokens_.end()) {
-            return Token{TokenType::END_OF_FILE, std::monostate{}};
-        }
-        buffer_[++idx_buffered_] = **tokens_it_;
-        (*tokens_it_)++;
+const Token& TokenStream::peek(int pos_ahead) {
+    if (pos_ahead < 0) {
+        throw std::runtime_error("Cannot peek behind the current token");
     }
-    return buffer_[idx_at_ + pos_ahead];
+    if (!fill(static_cast<size_t>(pos_ahead) + 1)) {
+        return end_of_file_;
+    }
+    return buffer_[(head_ + pos_ahead) & kLookaheadMask];
 }
 
-ManualLexer::ManualLexer(const std::string code) : idx_(0), code_(code) {}
+ManualLexer::ManualLexer(std::string_view code) : idx_(0), code_(code) {}
 auto ManualLexer::tokenize() -> std::generator<Token>  {
     while (idx_ < code_.size()) {
         while (skip()) {
@@ -187,12 +201,12 @@ auto ManualLexer::tokenize() -> std::generator<Token>  {
             idx_+=2;
             continue; 
         }
-        if (peek(std::string("int"))) {
+        if (peek("int")) {
             co_yield Token{TokenType::INTEGER_TYPE, std::monostate{}};
             idx_+=3;
             continue;
         }
-        if (peek(std::string("return"))) {
+        if (peek("return")) {
             co_yield Token{TokenType::RETURN, std::monostate{}};
             idx_+=6;
             continue;
@@ -209,18 +223,19 @@ auto ManualLexer::tokenize() -> std::generator<Token>  {
         }
         if (peek('"')) {
             idx_++;
-            while(!peek('"')) {
-                value.push_back(code_[idx_]);
+            size_t string_start = idx_;
+            while(idx_ < code_.size() && !peek('"')) {
+                idx_++;
             }
             idx_++;
-            co_yield Token{TokenType::STRING, value};
+            co_yield Token{TokenType::STRING, Source::Symbol::intern(code_.substr(string_start, idx_ - 1 - string_start))};
             continue;
         }
+        size_t name_start = idx_;
         while (idx_ < code_.size() && isalpha(code_[idx_])) {
-            value.push_back(code_[idx_]);
             idx_++;
         }
-        co_yield Token{TokenType::NAME, value};
+        co_yield Token{TokenType::NAME, Source::Symbol::intern(code_.substr(name_start, idx_ - name_start))};
     }
     co_yield Token{TokenType::END_OF_FILE, std::monostate{}};
     co_return;
@@ -236,7 +251,7 @@ bool ManualLexer::skip() {
     }
     return false;
 }
-bool ManualLexer::peek(std::string expected) {
+bool ManualLexer::peek(std::string_view expected) {
     if (expected.size() + idx_ > code_.size()) {
         return false;
     }
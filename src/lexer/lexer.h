@@ -1,7 +1,9 @@
+#pragma once
 #include <vector>
 #include "src/lexer/token.h"
 #include <generator>
 #include <set>
+#include <string_view>
 #include <unordered_map>
 #include <ranges>
 #include <memory>
@@ -16,14 +18,14 @@ public:
 
 class ManualLexer: public Lexer {
 public:
-    ManualLexer(const std::string code);
+    ManualLexer(std::string_view code);
     ~ManualLexer() override = default;
     auto Lex() -> TokenStream override;
 private:
     size_t idx_ = 0;
-    const std::string code_;
+    const std::string_view code_;
     const std::set<char> skippable_characters_ = {'\n', ' '};
-    bool peek(std::string expected);
+    bool peek(std::string_view expected);
     bool peek(char c);
     bool skip();
     auto tokenize() -> std::generator<Token>;
@@ -1,14 +1,16 @@
 #pragma once
+#include <array>
 #include <variant>
 #include <string>
 #include <generator>
 #include <ranges>
-#include <unordered_map>
 #include <memory>
+#include "src/source/symbol.h"
 
 namespace Lexer {
 
-typedef std::variant<std::monostate, int, std::string> TokenValue;
+// NAME and STRING tokens carry an interned symbol instead of owning their text.
+typedef std::variant<std::monostate, int, Source::Symbol> TokenValue;
 
 enum TokenType {
     INTEGER_VALUE,
@@ -51,16 +53,24 @@ struct Token {
     TokenValue value;
 };
 
+// Lookahead is kept in a fixed ring of kLookaheadCapacity tokens. peek()
+// hands out references into the ring, which stay valid until the next
+// consume(); consume() moves the token out of its slot.
 class TokenStream {
 public:
+    static constexpr size_t kLookaheadCapacity = 64;
     explicit TokenStream(std::generator<Token> tokens);
     Token consume();
-    Token peek(int pos_ahead);
+    const Token& peek(int pos_ahead);
 private:
+    static constexpr size_t kLookaheadMask = kLookaheadCapacity - 1;
+    static_assert((kLookaheadCapacity & kLookaheadMask) == 0, "lookahead capacity must be a power of two");
+    bool fill(size_t count);
     std::generator<Token> tokens_;
-    std::unordered_map<int, Token> buffer_;
-    int idx_at_, idx_buffered_;
+    std::array<Token, kLookaheadCapacity> buffer_;
+    size_t head_, size_;
     std::unique_ptr<std::ranges::iterator_t<std::generator<Token>>> tokens_it_;
+    const Token end_of_file_;
 };
 
 } //namespace Lexer
\ No newline at end of file
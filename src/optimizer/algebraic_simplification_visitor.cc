@@ -0,0 +1,217 @@
+#include "src/optimizer/optimizer.h"
+#include <bit>
+#include <utility>
+
+namespace Optimizer {
+
+namespace {
+
+using Tacky::OpCode;
+using Tacky::Value;
+
+bool is_constant(Value value, int constant) {
+    return value.is_constant() && value.constant_value() == constant;
+}
+
+// k for a positive 2^k, -1 otherwise
+int log2_of(Value value) {
+    if (!value.is_constant() || value.constant_value() <= 0) {
+        return -1;
+    }
+    auto bits = static_cast<uint32_t>(value.constant_value());
+    return std::has_single_bit(bits) ? std::countr_zero(bits) : -1;
+}
+
+void become_copy(Tacky::Instruction& instruction, Value value) {
+    instruction.op_ = OpCode::COPY;
+    instruction.src1_ = value;
+    instruction.src2_ = Value();
+}
+
+void become_unary(Tacky::Instruction& instruction, OpCode op, Value value) {
+    instruction.op_ = op;
+    instruction.src1_ = value;
+    instruction.src2_ = Value();
+}
+
+} // namespace
+
+void AlgebraicSimplificationVisitor::rewrite(Tacky::Program& program) {
+    for (auto& function : program.functions_) {
+        rewrite(function);
+    }
+}
+
+void AlgebraicSimplificationVisitor::rewrite(Tacky::Function& function) {
+    function_ = &function;
+    definitions_.assign(function.temporary_count_, Tacky::Instruction{});
+    output_.clear();
+    output_.reserve(function.instructions_.size());
+    for (auto instruction : function.instructions_) {
+        if (Tacky::is_control(instruction.op_) || instruction.op_ == OpCode::PHI) {
+            output_.push_back(instruction);
+            continue;
+        }
+        // a rewrite can expose another one, e.g. a combined mask of zero
+        while (instruction.op_ != OpCode::COPY && simplify(instruction)) {
+        }
+        if (expand_division(instruction)) {
+            continue;
+        }
+        define(instruction);
+    }
+    function.instructions_.swap(output_);
+    function_ = nullptr;
+}
+
+bool AlgebraicSimplificationVisitor::simplify(Tacky::Instruction& instruction) const {
+    auto& a = instruction.src1_;
+    auto& b = instruction.src2_;
+    // constants go second, so only one side needs checking below
+    if (Tacky::is_commutative(instruction.op_) && a.is_constant() && !b.is_constant()) {
+        std::swap(a, b);
+    }
+    if (instruction.op_ == OpCode::MINUS && is_constant(a, 0) && b.is_temporary()) {
+        become_unary(instruction, OpCode::NEGATE, b);
+        return true;
+    }
+    if (!a.is_temporary()) {
+        return false;
+    }
+    auto& definition = definitions_[a.temporary_id()];
+    switch (instruction.op_) {
+        case OpCode::COMPLEMENT:
+        case OpCode::NEGATE:
+            // ~~x and -(-x)
+            if (definition.op_ == instruction.op_) {
+                become_copy(instruction, definition.src1_);
+                return true;
+            }
+            return false;
+        case OpCode::MULT: {
+            if (is_constant(b, 0)) {
+                become_copy(instruction, b);
+            } else if (is_constant(b, 1)) {
+                become_copy(instruction, a);
+            } else if (is_constant(b, -1)) {
+                become_unary(instruction, OpCode::NEGATE, a);
+            } else if (int k = log2_of(b); k > 0) {
+                // imul and shl agree on the low 32 bits, wraparound included
+                instruction.op_ = OpCode::LEFT_SHIFT;
+                b = Value::constant(k);
+            } else {
+                return false;
+            }
+            return true;
+        }
+        case OpCode::PLUS:
+        case OpCode::LEFT_SHIFT:
+        case OpCode::RIGHT_SHIFT:
+            if (is_constant(b, 0)) {
+                become_copy(instruction, a);
+                return true;
+            }
+            return false;
+        case OpCode::MINUS:
+            if (is_constant(b, 0)) {
+                become_copy(instruction, a);
+            } else if (a == b) {
+                become_copy(instruction, Value::constant(0));
+            } else {
+                return false;
+            }
+            return true;
+        case OpCode::DIV:
+            if (is_constant(b, 1)) {
+                become_copy(instruction, a);
+                return true;
+            }
+            return false;
+        case OpCode::MOD:
+            if (is_constant(b, 1)) {
+                become_copy(instruction, Value::constant(0));
+                return true;
+            }
+            return false;
+        case OpCode::BITWISE_AND:
+        case OpCode::BITWISE_OR:
+        case OpCode::BITWISE_XOR: {
+            auto op = instruction.op_;
+            if (a == b) {
+                become_copy(instruction, op == OpCode::BITWISE_XOR ? Value::constant(0) : a);
+            } else if (is_constant(b, 0)) {
+                become_copy(instruction, op == OpCode::BITWISE_AND ? b : a);
+            } else if (is_constant(b, -1)) {
+                if (op == OpCode::BITWISE_XOR) {
+                    become_unary(instruction, OpCode::COMPLEMENT, a);
+                } else {
+                    become_copy(instruction, op == OpCode::BITWISE_AND ? a : b);
+                }
+            } else if (b.is_constant() && definition.op_ == op && definition.src2_.is_constant()) {
+                // (x & c1) & c2 is x & (c1 & c2), same for | and ^
+                auto mask = *fold(op, definition.src2_.constant_value(), b.constant_value());
+                a = definition.src1_;
+                b = Value::constant(mask);
+            } else {
+                return false;
+            }
+            return true;
+        }
+        case OpCode::AND:
+        case OpCode::OR: {
+            if (!b.is_constant()) {
+                return false;
+            }
+            // x && 0 and x || c for c != 0 don't depend on x, the other
+            // constants leave just the test of x
+            bool decides = (b.constant_value() == 0) == (instruction.op_ == OpCode::AND);
+            if (decides) {
+                become_copy(instruction, Value::constant(instruction.op_ == OpCode::OR));
+            } else {
+                instruction.op_ = OpCode::NOT_EQUAL;
+                b = Value::constant(0);
+            }
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// signed division rounds towards zero, an arithmetic shift towards -inf, so
+// negative dividends get 2^k - 1 added first: x/2^k is (x + bias) >> k and
+// x%2^k is x - ((x + bias) & -2^k), with bias = (x >> 31) & (2^k - 1)
+bool AlgebraicSimplificationVisitor::expand_division(const Tacky::Instruction& instruction) {
+    if (instruction.op_ != OpCode::DIV && instruction.op_ != OpCode::MOD) {
+        return false;
+    }
+    auto x = instruction.src1_;
+    int k = log2_of(instruction.src2_);
+    if (!x.is_temporary() || k <= 0) {
+        return false;
+    }
+    auto sign = emit(OpCode::RIGHT_SHIFT, x, Value::constant(31));
+    auto bias = emit(OpCode::BITWISE_AND, sign, Value::constant((1 << k) - 1));
+    auto biased = emit(OpCode::PLUS, x, bias);
+    if (instruction.op_ == OpCode::DIV) {
+        define({OpCode::RIGHT_SHIFT, instruction.dst_, biased, Value::constant(k)});
+    } else {
+        auto rounded = emit(OpCode::BITWISE_AND, biased, Value::constant(-(1 << k)));
+        define({OpCode::MINUS, instruction.dst_, x, rounded});
+    }
+    return true;
+}
+
+Value AlgebraicSimplificationVisitor::emit(OpCode op, Value src1, Value src2) {
+    auto dst = Value::temporary(function_->temporary_count_++);
+    definitions_.emplace_back();
+    define({op, dst, src1, src2});
+    return dst;
+}
+
+void AlgebraicSimplificationVisitor::define(const Tacky::Instruction& instruction) {
+    definitions_[instruction.dst_.temporary_id()] = instruction;
+    output_.push_back(instruction);
+}
+
+} // namespace Optimizer
@@ -0,0 +1,203 @@
+#include "src/optimizer/optimizer.h"
+#include "src/tacky/cfg.h"
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+
+namespace Optimizer {
+
+namespace {
+
+using Tacky::OpCode;
+using Tacky::Value;
+
+constexpr uint32_t kNoBlock = Tacky::ControlFlowGraph::kNoBlock;
+
+OpCode inverted(OpCode op) {
+    return op == OpCode::JUMP_IF_ZERO ? OpCode::JUMP_IF_NOT_ZERO : OpCode::JUMP_IF_ZERO;
+}
+
+} // namespace
+
+void BlockLayoutVisitor::rewrite(Tacky::Program& program) {
+    for (auto& function : program.functions_) {
+        rewrite(function);
+    }
+}
+
+void BlockLayoutVisitor::rewrite(Tacky::Function& function) {
+    Tacky::ControlFlowGraph cfg(function);
+    if (cfg.blocks().empty()) {
+        return;
+    }
+    function_ = &function;
+    build_exits(cfg);
+    place(cfg);
+    output_.clear();
+    output_.reserve(function.instructions_.size());
+    labels_.assign(cfg.blocks().size(), Value());
+    label_positions_.assign(cfg.blocks().size(), 0);
+    for (size_t i = 0; i < order_.size(); i++) {
+        emit_block(cfg, order_[i], i + 1 < order_.size() ? order_[i + 1] : kNoBlock);
+    }
+    // a jump back may want a label on a block that is out already, so every
+    // block got a slot for one and the ones no jump wants are dropped
+    for (auto block : order_) {
+        output_[label_positions_[block]].src1_ = labels_[block];
+    }
+    std::erase_if(output_, [](auto& instruction) {
+        return instruction.op_ == OpCode::LABEL && instruction.src1_.is_none();
+    });
+    function.instructions_.swap(output_);
+    function_ = nullptr;
+}
+
+// Works out where each block goes once the jumps are threaded. Walking
+// backwards, the blocks a block leads to further down are threaded
+// already, so a block with nothing but labels and an unconditional exit
+// forwards to wherever its exit was threaded to. A jump back goes to the
+// block as it is, which also keeps a loop of such blocks from threading
+// around forever.
+void BlockLayoutVisitor::build_exits(const Tacky::ControlFlowGraph& cfg) {
+    auto& blocks = cfg.blocks();
+    auto& instructions = function_->instructions_;
+    exits_.assign(blocks.size(), Exit{});
+    threaded_.resize(blocks.size());
+    std::iota(threaded_.begin(), threaded_.end(), 0);
+    auto thread = [&](uint32_t block) { return block == kNoBlock ? kNoBlock : threaded_[block]; };
+    for (uint32_t b = blocks.size(); b-- > 0;) {
+        auto& block = blocks[b];
+        auto& exit = exits_[b];
+        exit.body_begin_ = block.begin_;
+        while (exit.body_begin_ < block.end_ && instructions[exit.body_begin_].op_ == OpCode::LABEL) {
+            exit.body_begin_++;
+        }
+        exit.body_end_ = block.end_;
+        auto& last = instructions[block.end_ - 1];
+        if (last.op_ == OpCode::JUMP) {
+            exit.body_end_--;
+            exit.next_ = thread(block.target_);
+        } else if (Tacky::is_jump(last.op_)) {
+            exit.body_end_--;
+            exit.next_ = thread(block.fall_through_);
+            exit.taken_ = thread(block.target_);
+            exit.jump_ = last.op_;
+            exit.condition_ = last.src1_;
+            // both ways lead to the same place
+            if (exit.taken_ == exit.next_) {
+                exit.taken_ = kNoBlock;
+            }
+        } else if (last.op_ != OpCode::RETURN) {
+            exit.next_ = thread(block.fall_through_);
+        }
+        bool forwards = exit.body_begin_ >= exit.body_end_ && exit.taken_ == kNoBlock && exit.next_ != kNoBlock;
+        threaded_[b] = forwards ? exit.next_ : b;
+    }
+}
+
+// Places the blocks reachable from the entry so every block comes after its
+// predecessors, which keeps jumps going forward unless there is a loop.
+// After a block its fall through or jump target goes next when all of that
+// block's predecessors are placed, otherwise the first ready block in the
+// original order. When none is ready the blocks left are all in or after a
+// loop, and the first of them goes next with a jump back into it.
+void BlockLayoutVisitor::place(const Tacky::ControlFlowGraph& cfg) {
+    auto& blocks = cfg.blocks();
+    uint32_t entry = threaded_[0];
+    std::vector<bool> reachable(blocks.size(), false);
+    pending_.assign(blocks.size(), 0);
+    std::vector<uint32_t> worklist = {entry};
+    reachable[entry] = true;
+    while (!worklist.empty()) {
+        auto b = worklist.back();
+        worklist.pop_back();
+        for (auto successor : {exits_[b].next_, exits_[b].taken_}) {
+            if (successor == kNoBlock) {
+                continue;
+            }
+            pending_[successor]++;
+            if (!reachable[successor]) {
+                reachable[successor] = true;
+                worklist.push_back(successor);
+            }
+        }
+    }
+    // Only the last block can fall off the end of the function, and it has
+    // to stay last, so it waits until everything else is placed. The entry
+    // can't wait, emit_block() rejects it if anything else is left.
+    auto falls_off = [&](uint32_t b) {
+        return exits_[b].next_ == kNoBlock && function_->instructions_[blocks[b].end_ - 1].op_ != OpCode::RETURN;
+    };
+    uint32_t last = blocks.size() - 1;
+    bool last_waits = reachable[last] && falls_off(last) && last != entry;
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<>> ready;
+    std::vector<bool> placed(blocks.size(), false);
+    uint32_t unplaced = 0;
+    order_.clear();
+    for (uint32_t current = entry; current != kNoBlock;) {
+        order_.push_back(current);
+        placed[current] = true;
+        uint32_t preferred = kNoBlock;
+        for (auto successor : {exits_[current].next_, exits_[current].taken_}) {
+            if (successor == kNoBlock || --pending_[successor] > 0 || (last_waits && successor == last)) {
+                continue;
+            }
+            ready.push(successor);
+            if (preferred == kNoBlock) {
+                preferred = successor;
+            }
+        }
+        while (!ready.empty() && placed[ready.top()]) {
+            ready.pop();
+        }
+        current = preferred != kNoBlock && !placed[preferred] ? preferred : ready.empty() ? kNoBlock : ready.top();
+        while (current == kNoBlock && unplaced < blocks.size()) {
+            if (reachable[unplaced] && !placed[unplaced] && !(last_waits && unplaced == last)) {
+                current = unplaced;
+            }
+            unplaced++;
+        }
+        if (current == kNoBlock && last_waits && !placed[last]) {
+            current = last;
+        }
+    }
+}
+
+// Copies a block without its labels and jump, then adds the jumps it needs
+// with the next block placed right after it.
+void BlockLayoutVisitor::emit_block(const Tacky::ControlFlowGraph& cfg, uint32_t block, uint32_t following) {
+    auto& exit = exits_[block];
+    if (exit.next_ == kNoBlock && following != kNoBlock &&
+        function_->instructions_[cfg.blocks()[block].end_ - 1].op_ != OpCode::RETURN) {
+        throw std::runtime_error("Tacky block falling off the end of the function can't be placed last");
+    }
+    label_positions_[block] = output_.size();
+    output_.push_back({OpCode::LABEL, Value(), Value(), Value()});
+    auto& instructions = function_->instructions_;
+    output_.insert(output_.end(), instructions.begin() + exit.body_begin_, instructions.begin() + exit.body_end_);
+    if (exit.taken_ != kNoBlock) {
+        if (exit.next_ == following) {
+            output_.push_back({exit.jump_, Value(), exit.condition_, label_of(cfg, exit.taken_)});
+        } else if (exit.taken_ == following) {
+            output_.push_back({inverted(exit.jump_), Value(), exit.condition_, label_of(cfg, exit.next_)});
+        } else {
+            output_.push_back({exit.jump_, Value(), exit.condition_, label_of(cfg, exit.taken_)});
+            output_.push_back({OpCode::JUMP, Value(), label_of(cfg, exit.next_), Value()});
+        }
+    } else if (exit.next_ != kNoBlock && exit.next_ != following) {
+        output_.push_back({OpCode::JUMP, Value(), label_of(cfg, exit.next_), Value()});
+    }
+}
+
+// the label a jump to block uses, the block's first one if it had any
+Value BlockLayoutVisitor::label_of(const Tacky::ControlFlowGraph& cfg, uint32_t block) {
+    if (labels_[block].is_none()) {
+        auto& first = function_->instructions_[cfg.blocks()[block].begin_];
+        labels_[block] = first.op_ == OpCode::LABEL ? first.src1_ : Value::label(function_->label_count_++);
+    }
+    return labels_[block];
+}
+
+} // namespace Optimizer
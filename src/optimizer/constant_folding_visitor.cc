@@ -0,0 +1,349 @@
+#include "src/optimizer/optimizer.h"
+#include "src/tacky/cfg.h"
+#include "src/tacky/def_use.h"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+namespace Optimizer {
+
+std::optional<int> fold(Tacky::OpCode op, int left, int right) {
+    // wraparound is done on unsigned, where it is defined
+    auto l = static_cast<uint32_t>(left);
+    auto r = static_cast<uint32_t>(right);
+    switch (op) {
+        case Tacky::OpCode::COPY: return left;
+        case Tacky::OpCode::COMPLEMENT: return static_cast<int>(~l);
+        case Tacky::OpCode::NEGATE: return static_cast<int>(0u - l);
+        case Tacky::OpCode::NOT: return left == 0;
+        case Tacky::OpCode::MULT: return static_cast<int>(l * r);
+        case Tacky::OpCode::PLUS: return static_cast<int>(l + r);
+        case Tacky::OpCode::MINUS: return static_cast<int>(l - r);
+        // idiv traps on both of these
+        case Tacky::OpCode::DIV:
+        case Tacky::OpCode::MOD:
+            if (right == 0 || (left == INT_MIN && right == -1)) {
+                return std::nullopt;
+            }
+            return op == Tacky::OpCode::DIV ? left / right : left % right;
+        case Tacky::OpCode::BITWISE_AND: return left & right;
+        case Tacky::OpCode::BITWISE_OR: return left | right;
+        case Tacky::OpCode::BITWISE_XOR: return left ^ right;
+        // sal and sar only look at the low 5 bits of the count
+        case Tacky::OpCode::LEFT_SHIFT:
+        case Tacky::OpCode::RIGHT_SHIFT:
+            if (right < 0 || right >= 32) {
+                return std::nullopt;
+            }
+            return op == Tacky::OpCode::LEFT_SHIFT ? static_cast<int>(l << right) : left >> right;
+        case Tacky::OpCode::AND: return left != 0 && right != 0;
+        case Tacky::OpCode::OR: return left != 0 || right != 0;
+        case Tacky::OpCode::EQUAL: return left == right;
+        case Tacky::OpCode::NOT_EQUAL: return left != right;
+        case Tacky::OpCode::LESS: return left < right;
+        case Tacky::OpCode::LESS_EQ: return left <= right;
+        case Tacky::OpCode::GREATER: return left > right;
+        case Tacky::OpCode::GREATER_EQ: return left >= right;
+        case Tacky::OpCode::PHI:
+        case Tacky::OpCode::RETURN:
+        case Tacky::OpCode::LABEL:
+        case Tacky::OpCode::JUMP:
+        case Tacky::OpCode::JUMP_IF_ZERO:
+        case Tacky::OpCode::JUMP_IF_NOT_ZERO:
+            break;
+    }
+    return std::nullopt;
+}
+
+void ConstantFoldingVisitor::rewrite(Tacky::Program& program) {
+    for (auto& function : program.functions_) {
+        rewrite(function);
+    }
+}
+
+// Wegman and Zadeck's sparse conditional constant propagation: a block is
+// looked at once control can get there, and an instruction again whenever
+// one of its operands changes, through the def-use chains. Temporaries
+// start out unknown, on the optimistic side, so a phi around a loop can
+// still come out a constant. One defined more than once, out of SSA, is
+// never known.
+//
+// What's still unknown once that settles never got a value: a phi joining
+// only edges along which its temporary is undefined, or a temporary read
+// where its definition didn't run, like the && or || joining a right
+// operand that was jumped over. It doesn't matter what those hold, so they
+// are taken to be 0 and the propagation goes on from there.
+void ConstantFoldingVisitor::rewrite(Tacky::Function& function) {
+    auto& instructions = function.instructions_;
+    if (instructions.empty()) {
+        return;
+    }
+    cfg_.emplace(function);
+    def_use_.emplace(function);
+    function_ = &function;
+    auto& blocks = cfg_->blocks();
+    lattice_.assign(function.temporary_count_, Lattice());
+    for (uint32_t t = 0; t < function.temporary_count_; t++) {
+        if (def_use_->definitions(t).size() > 1) {
+            lattice_[t] = Lattice{Lattice::Kind::BOTTOM};
+        }
+    }
+    executable_.assign(blocks.size(), false);
+    taken_.assign(blocks.size(), false);
+    fell_.assign(blocks.size(), false);
+    executable_[0] = true;
+    block_worklist_ = {0};
+    instruction_worklist_.clear();
+    for (bool unknown = true; unknown;) {
+        propagate();
+        unknown = false;
+        // read around a loop out of SSA, before any definition ran
+        std::vector<uint32_t> stuck;
+        for (uint32_t b = 0; b < blocks.size(); b++) {
+            for (uint32_t i = blocks[b].begin_; i < blocks[b].end_ && executable_[b]; i++) {
+                auto& instruction = instructions[i];
+                if (instruction.op_ == Tacky::OpCode::PHI && lattice_of(instruction.dst_).kind_ == Lattice::Kind::TOP) {
+                    unknown = true;
+                    lower(instruction.dst_.temporary_id(), Lattice{Lattice::Kind::CONSTANT, 0});
+                    continue;
+                }
+                for (auto src : {instruction.src1_, instruction.src2_}) {
+                    if (!src.is_temporary() || lattice_of(src).kind_ != Lattice::Kind::TOP) {
+                        continue;
+                    }
+                    auto definitions = def_use_->definitions(src.temporary_id());
+                    if (std::none_of(definitions.begin(), definitions.end(),
+                            [&](uint32_t d) { return executable_[cfg_->block_containing(d)]; })) {
+                        unknown = true;
+                        lower(src.temporary_id(), Lattice{Lattice::Kind::CONSTANT, 0});
+                    } else {
+                        stuck.push_back(src.temporary_id());
+                    }
+                }
+            }
+        }
+        if (!unknown && !stuck.empty()) {
+            unknown = true;
+            for (auto t : stuck) {
+                lower(t, Lattice{Lattice::Kind::BOTTOM});
+            }
+        }
+    }
+
+    // Only the blocks control gets to stay, without the instructions whose
+    // result is known and the jumps and phi entries along edges it never
+    // takes. A phi whose entries left all bring the same temporary, or
+    // nothing, is a copy of it.
+    size_t kept = 0;
+    for (uint32_t b = 0; b < blocks.size(); b++) {
+        if (!executable_[b]) {
+            continue;
+        }
+        for (uint32_t i = blocks[b].begin_; i < blocks[b].end_; i++) {
+            auto instruction = instructions[i];
+            instruction.src1_ = substitute(instruction.src1_);
+            instruction.src2_ = substitute(instruction.src2_);
+            if (instruction.op_ == Tacky::OpCode::PHI) {
+                auto run = kept;
+                Tacky::Value joined;
+                bool copy = true;
+                for (; i < blocks[b].end_ && instructions[i].op_ == Tacky::OpCode::PHI &&
+                        instructions[i].dst_ == instruction.dst_; i++) {
+                    auto entry = instructions[i];
+                    if (!executes(cfg_->block_of(entry.src2_), b)) {
+                        continue;
+                    }
+                    entry.src1_ = substitute(entry.src1_);
+                    copy = copy && (entry.src1_.is_none() || joined.is_none() || entry.src1_ == joined);
+                    joined = entry.src1_.is_none() ? joined : entry.src1_;
+                    instructions[kept++] = entry;
+                }
+                i--;
+                if (lattice_of(instruction.dst_).kind_ == Lattice::Kind::CONSTANT) {
+                    kept = run;
+                } else if (copy) {
+                    kept = run;
+                    instructions[kept++] = {Tacky::OpCode::COPY, instruction.dst_, joined, Tacky::Value()};
+                }
+                continue;
+            }
+            if (instruction.op_ == Tacky::OpCode::JUMP_IF_ZERO || instruction.op_ == Tacky::OpCode::JUMP_IF_NOT_ZERO) {
+                if (!taken_[b]) {
+                    continue;
+                }
+                if (!fell_[b]) {
+                    instruction = {Tacky::OpCode::JUMP, Tacky::Value(), instruction.src2_, Tacky::Value()};
+                }
+            }
+            if (!Tacky::is_control(instruction.op_) && lattice_of(instruction.dst_).kind_ == Lattice::Kind::CONSTANT) {
+                continue;
+            }
+            instructions[kept++] = instruction;
+        }
+    }
+    instructions.resize(kept);
+    function_ = nullptr;
+    cfg_.reset();
+    def_use_.reset();
+}
+
+// looks at the newly reachable blocks first, then at the instructions
+// whose operands changed
+void ConstantFoldingVisitor::propagate() {
+    auto& blocks = cfg_->blocks();
+    while (!block_worklist_.empty() || !instruction_worklist_.empty()) {
+        if (!block_worklist_.empty()) {
+            auto b = block_worklist_.back();
+            block_worklist_.pop_back();
+            for (uint32_t i = blocks[b].begin_; i < blocks[b].end_; i++) {
+                visit(i);
+            }
+            continue;
+        }
+        auto i = instruction_worklist_.back();
+        instruction_worklist_.pop_back();
+        if (executable_[cfg_->block_containing(i)]) {
+            visit(i);
+        }
+    }
+}
+
+// A phi joins what comes in along the edges control takes, an entry with
+// nothing defined along its edge aside. A conditional jump on an unknown
+// condition waits for it.
+void ConstantFoldingVisitor::visit(uint32_t i) {
+    auto& instructions = function_->instructions_;
+    auto& instruction = instructions[i];
+    auto block = cfg_->block_containing(i);
+    auto& exits = cfg_->blocks()[block];
+    switch (instruction.op_) {
+        case Tacky::OpCode::PHI: {
+            auto first = i;
+            for (; first > exits.begin_ && instructions[first - 1].op_ == Tacky::OpCode::PHI &&
+                    instructions[first - 1].dst_ == instruction.dst_; first--) {
+            }
+            Lattice joined;
+            for (auto j = first; j < exits.end_ && instructions[j].op_ == Tacky::OpCode::PHI &&
+                    instructions[j].dst_ == instruction.dst_; j++) {
+                if (!instructions[j].src1_.is_none() && executes(cfg_->block_of(instructions[j].src2_), block)) {
+                    joined = meet(joined, lattice_of(instructions[j].src1_));
+                }
+            }
+            lower(instruction.dst_.temporary_id(), joined);
+            return;
+        }
+        case Tacky::OpCode::RETURN:
+            return;
+        case Tacky::OpCode::LABEL:
+            break;
+        case Tacky::OpCode::JUMP:
+            mark(block, true);
+            return;
+        case Tacky::OpCode::JUMP_IF_ZERO:
+        case Tacky::OpCode::JUMP_IF_NOT_ZERO: {
+            auto condition = lattice_of(instruction.src1_);
+            if (condition.kind_ == Lattice::Kind::TOP) {
+                return;
+            }
+            bool unknown = condition.kind_ == Lattice::Kind::BOTTOM;
+            bool zero = unknown || condition.constant_ == 0;
+            bool nonzero = unknown || condition.constant_ != 0;
+            bool if_zero = instruction.op_ == Tacky::OpCode::JUMP_IF_ZERO;
+            if (zero) {
+                mark(block, if_zero);
+            }
+            if (nonzero) {
+                mark(block, !if_zero);
+            }
+            return;
+        }
+        default: {
+            auto left = lattice_of(instruction.src1_);
+            auto right = Tacky::is_unary(instruction.op_) ? Lattice{Lattice::Kind::CONSTANT, 0}
+                : lattice_of(instruction.src2_);
+            Lattice result{Lattice::Kind::BOTTOM};
+            if (left.kind_ == Lattice::Kind::TOP || right.kind_ == Lattice::Kind::TOP) {
+                result = Lattice();
+            } else if (left.kind_ == Lattice::Kind::CONSTANT && right.kind_ == Lattice::Kind::CONSTANT) {
+                auto folded = fold(instruction.op_, left.constant_, right.constant_);
+                if (folded.has_value()) {
+                    result = Lattice{Lattice::Kind::CONSTANT, *folded};
+                }
+            }
+            lower(instruction.dst_.temporary_id(), result);
+            break;
+        }
+    }
+    // the last instruction of a block without a jump falls through
+    if (i + 1 == exits.end_ && exits.fall_through_ != Tacky::ControlFlowGraph::kNoBlock) {
+        mark(block, false);
+    }
+}
+
+// A block becomes reachable along its first edge. Along any later one only
+// its phis have something new to join.
+void ConstantFoldingVisitor::mark(uint32_t block, bool jumped) {
+    auto& flags = jumped ? taken_ : fell_;
+    if (flags[block]) {
+        return;
+    }
+    flags[block] = true;
+    auto& exits = cfg_->blocks()[block];
+    auto successor = jumped ? exits.target_ : exits.fall_through_;
+    if (!executable_[successor]) {
+        executable_[successor] = true;
+        block_worklist_.push_back(successor);
+        return;
+    }
+    auto& instructions = function_->instructions_;
+    for (auto i = cfg_->blocks()[successor].begin_; i < cfg_->blocks()[successor].end_; i++) {
+        if (instructions[i].op_ == Tacky::OpCode::PHI) {
+            instruction_worklist_.push_back(i);
+        }
+    }
+}
+
+bool ConstantFoldingVisitor::executes(uint32_t from, uint32_t to) const {
+    auto& exits = cfg_->blocks()[from];
+    return (taken_[from] && exits.target_ == to) || (fell_[from] && exits.fall_through_ == to);
+}
+
+void ConstantFoldingVisitor::lower(uint32_t temporary, Lattice value) {
+    auto lowered = meet(lattice_[temporary], value);
+    if (lowered == lattice_[temporary]) {
+        return;
+    }
+    lattice_[temporary] = lowered;
+    for (auto use : def_use_->uses(temporary)) {
+        instruction_worklist_.push_back(use);
+    }
+}
+
+ConstantFoldingVisitor::Lattice ConstantFoldingVisitor::meet(Lattice a, Lattice b) {
+    if (a.kind_ == Lattice::Kind::TOP) {
+        return b;
+    }
+    if (b.kind_ == Lattice::Kind::TOP || a == b) {
+        return a;
+    }
+    return Lattice{Lattice::Kind::BOTTOM};
+}
+
+ConstantFoldingVisitor::Lattice ConstantFoldingVisitor::lattice_of(Tacky::Value value) const {
+    if (value.is_constant()) {
+        return Lattice{Lattice::Kind::CONSTANT, value.constant_value()};
+    }
+    return value.is_temporary() ? lattice_[value.temporary_id()] : Lattice();
+}
+
+// a known temporary reads as its constant
+Tacky::Value ConstantFoldingVisitor::substitute(Tacky::Value value) const {
+    auto lattice = lattice_of(value);
+    if (value.is_temporary() && lattice.kind_ == Lattice::Kind::CONSTANT) {
+        return Tacky::Value::constant(lattice.constant_);
+    }
+    return value;
+}
+
+} // namespace Optimizer
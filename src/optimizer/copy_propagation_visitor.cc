@@ -0,0 +1,57 @@
+#include "src/optimizer/optimizer.h"
+
+namespace Optimizer {
+
+void CopyPropagationVisitor::rewrite(Tacky::Program& program) {
+    for (auto& function : program.functions_) {
+        rewrite(function);
+    }
+}
+
+// Finds the copies first and only then rewrites their uses, so a phi reading
+// a copy along a jump back gets its source as well.
+void CopyPropagationVisitor::rewrite(Tacky::Function& function) {
+    Tacky::DefUse def_use(function);
+    copies_.assign(function.temporary_count_, Tacky::Value());
+    auto& instructions = function.instructions_;
+    for (auto& instruction : instructions) {
+        if (instruction.op_ != Tacky::OpCode::COPY || def_use.definitions(instruction.dst_.temporary_id()).size() != 1) {
+            continue;
+        }
+        auto source = instruction.src1_;
+        if (!source.is_temporary() || def_use.definitions(source.temporary_id()).size() <= 1) {
+            copies_[instruction.dst_.temporary_id()] = source;
+        }
+    }
+    for (uint32_t t = 0; t < function.temporary_count_; t++) {
+        if (copies_[t].is_none()) {
+            continue;
+        }
+        auto copied = Tacky::Value::temporary(t);
+        auto source = resolve(copied);
+        for (auto use : def_use.uses(t)) {
+            for (auto* src : {&instructions[use].src1_, &instructions[use].src2_}) {
+                if (*src == copied) {
+                    *src = source;
+                }
+            }
+        }
+    }
+    size_t kept = 0;
+    for (auto& instruction : instructions) {
+        if (instruction.op_ != Tacky::OpCode::COPY || copies_[instruction.dst_.temporary_id()].is_none()) {
+            instructions[kept++] = instruction;
+        }
+    }
+    instructions.resize(kept);
+}
+
+// follows a chain of copies to where it starts
+Tacky::Value CopyPropagationVisitor::resolve(Tacky::Value value) const {
+    while (value.is_temporary() && !copies_[value.temporary_id()].is_none()) {
+        value = copies_[value.temporary_id()];
+    }
+    return value;
+}
+
+} // namespace Optimizer
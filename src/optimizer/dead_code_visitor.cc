@@ -0,0 +1,114 @@
+#include "src/optimizer/optimizer.h"
+#include "src/tacky/cfg.h"
+#include "src/tacky/def_use.h"
+#include <vector>
+
+namespace Optimizer {
+
+namespace {
+
+// idiv traps on a zero divisor and on INT_MIN / -1
+bool may_trap(const Tacky::Instruction& instruction) {
+    if (instruction.op_ != Tacky::OpCode::DIV && instruction.op_ != Tacky::OpCode::MOD) {
+        return false;
+    }
+    auto& divisor = instruction.src2_;
+    return !divisor.is_constant() || divisor.constant_value() == 0 || divisor.constant_value() == -1;
+}
+
+} // namespace
+
+void DeadCodeVisitor::rewrite(Tacky::Program& program) {
+    for (auto& function : program.functions_) {
+        rewrite(function);
+    }
+}
+
+// Mark and sweep over the def-use chains: what can't be dropped reads its
+// operands, and every definition of those is kept in turn. A phi's entries
+// all go along with it.
+void DeadCodeVisitor::rewrite(Tacky::Function& function) {
+    remove_unreachable(function);
+
+    auto& instructions = function.instructions_;
+    Tacky::DefUse def_use(function);
+    std::vector<bool> live(instructions.size(), false);
+    std::vector<uint32_t> worklist;
+    auto keep = [&](uint32_t i) {
+        auto dst = instructions[i].dst_;
+        for (; i < instructions.size() && !live[i]; i++) {
+            live[i] = true;
+            worklist.push_back(i);
+            if (instructions[i].op_ != Tacky::OpCode::PHI || i + 1 == instructions.size() ||
+                    instructions[i + 1].op_ != Tacky::OpCode::PHI || instructions[i + 1].dst_ != dst) {
+                break;
+            }
+        }
+    };
+    for (uint32_t i = 0; i < instructions.size(); i++) {
+        if (Tacky::is_control(instructions[i].op_) || may_trap(instructions[i])) {
+            keep(i);
+        }
+    }
+    while (!worklist.empty()) {
+        auto& instruction = instructions[worklist.back()];
+        worklist.pop_back();
+        for (auto src : {instruction.src1_, instruction.src2_}) {
+            if (src.is_temporary()) {
+                for (auto definition : def_use.definitions(src.temporary_id())) {
+                    keep(definition);
+                }
+            }
+        }
+    }
+    size_t kept = 0;
+    for (uint32_t i = 0; i < instructions.size(); i++) {
+        if (live[i]) {
+            instructions[kept++] = instructions[i];
+        }
+    }
+    instructions.resize(kept);
+}
+
+// Drops the blocks no path from the entry reaches, along with the phi
+// entries for the edges out of them. An && or || can still read a
+// temporary whose definition was jumped over and is gone now, it didn't
+// matter what it held there and it reads 0 instead, and a phi entry
+// bringing it is undefined.
+void DeadCodeVisitor::remove_unreachable(Tacky::Function& function) {
+    Tacky::ControlFlowGraph cfg(function);
+    auto& blocks = cfg.blocks();
+    auto& instructions = function.instructions_;
+    used_.assign(function.temporary_count_, false);
+    size_t kept = 0;
+    for (uint32_t b = 0; b < blocks.size(); b++) {
+        if (!cfg.reachable(b)) {
+            continue;
+        }
+        for (uint32_t i = blocks[b].begin_; i < blocks[b].end_; i++) {
+            auto& instruction = instructions[i];
+            if (instruction.op_ == Tacky::OpCode::PHI && !cfg.reachable(cfg.block_of(instruction.src2_))) {
+                continue;
+            }
+            if (!Tacky::is_control(instruction.op_)) {
+                used_[instruction.dst_.temporary_id()] = true;
+            }
+            instructions[kept++] = instruction;
+        }
+    }
+    instructions.resize(kept);
+    // used_ holds the defined temporaries here
+    for (auto& instruction : instructions) {
+        auto& operand = instruction.src1_;
+        if (instruction.op_ == Tacky::OpCode::PHI && operand.is_temporary() && !used_[operand.temporary_id()]) {
+            operand = Tacky::Value();
+        }
+        for (auto* src : {&instruction.src1_, &instruction.src2_}) {
+            if (src->is_temporary() && !used_[src->temporary_id()]) {
+                *src = Tacky::Value::constant(0);
+            }
+        }
+    }
+}
+
+} // namespace Optimizer
@@ -0,0 +1,37 @@
+#include "src/optimizer/optimizer.h"
+
+namespace Optimizer {
+
+namespace {
+
+size_t instruction_count(const Tacky::Program& program) {
+    size_t count = 0;
+    for (auto& function : program.functions_) {
+        count += function.instructions_.size();
+    }
+    return count;
+}
+
+} // namespace
+
+Stats optimize(Tacky::Program& program) {
+    Stats stats;
+    stats.instructions_before = instruction_count(program);
+    SsaConstructionVisitor().rewrite(program);
+    CopyPropagationVisitor().rewrite(program);
+    ValueNumberingVisitor value_numbering;
+    value_numbering.rewrite(program);
+    stats.value_numbered = value_numbering.removed();
+    ConstantFoldingVisitor().rewrite(program);
+    // simplification leaves copies and constants behind for another round
+    AlgebraicSimplificationVisitor().rewrite(program);
+    CopyPropagationVisitor().rewrite(program);
+    ConstantFoldingVisitor().rewrite(program);
+    DeadCodeVisitor().rewrite(program);
+    SsaDestructionVisitor().rewrite(program);
+    BlockLayoutVisitor().rewrite(program);
+    stats.instructions_after = instruction_count(program);
+    return stats;
+}
+
+} // namespace Optimizer
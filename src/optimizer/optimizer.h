@@ -0,0 +1,291 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "src/tacky/cfg.h"
+#include "src/tacky/def_use.h"
+#include "src/tacky/liveness.h"
+#include "src/tacky/tacky.h"
+#include <cstddef>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Optimizer {
+
+// Evaluates op over constant operands with the semantics the generated code
+// has at runtime: 32 bit wraparound, truncating division and arithmetic
+// right shifts. Returns nothing where the result isn't fixed, a division
+// that traps or a shift count x86 would mask.
+std::optional<int> fold(Tacky::OpCode op, int left, int right = 0);
+
+struct Stats {
+    size_t instructions_before = 0;
+    // repeated computations value numbering replaced by an earlier result
+    size_t value_numbered = 0;
+    size_t instructions_after = 0;
+};
+
+// Runs the Tacky passes behind -O, in order.
+Stats optimize(Tacky::Program& program);
+
+// Puts every function into SSA form: every definition gets a temporary of
+// its own and every use reads the one closest above it, through a phi
+// where paths bringing different ones join. Phis are placed on the
+// iterated dominance frontiers of the definitions, only where the
+// temporary is live, and renaming walks the dominator tree. A phi has an
+// entry for every predecessor of its block, NONE where no definition
+// comes along that edge, and a use no definition reaches at all reads 0.
+// Blocks control never gets to are dropped first.
+class SsaConstructionVisitor {
+public:
+    ~SsaConstructionVisitor() = default;
+    SsaConstructionVisitor() = default;
+    void rewrite(Tacky::Program& program);
+private:
+    // a phi of the temporary going in at the start of a block, with its
+    // new name and an operand for each of the block's predecessors
+    struct Phi {
+        uint32_t temporary_;
+        Tacky::Value dst_;
+        std::vector<Tacky::Value> operands_;
+    };
+    void rewrite(Tacky::Function& function);
+    void place_phis(Tacky::Function& function, const Tacky::ControlFlowGraph& cfg);
+    void rename(Tacky::Function& function, const Tacky::ControlFlowGraph& cfg);
+    // all indexed by block: its phis, its predecessors without repeats and
+    // its label, NONE if it has none and needs none
+    std::vector<std::vector<Phi>> phis_;
+    std::vector<std::vector<uint32_t>> predecessors_;
+    std::vector<Tacky::Value> labels_;
+    // indexed by the temporaries the function came with, the names of the
+    // definitions above the block being renamed
+    std::vector<std::vector<Tacky::Value>> names_;
+};
+
+// Takes every function out of SSA form. The phis are first isolated with
+// copies into and out of new temporaries, splitting the critical edges the
+// copies can't go on otherwise, and then copies are coalesced away wherever
+// their two sides don't interfere. The copies
+// left at one place run as a parallel copy, put in an order where none
+// overwrites what another still reads.
+class SsaDestructionVisitor {
+public:
+    ~SsaDestructionVisitor() = default;
+    SsaDestructionVisitor() = default;
+    void rewrite(Tacky::Program& program);
+private:
+    // a block going in ahead of the one an edge goes to, holding the
+    // copies along it
+    struct Split {
+        uint32_t from_;
+        Tacky::Value label_;
+        std::vector<Tacky::Instruction> copies_;
+    };
+    void rewrite(Tacky::Function& function);
+    void isolate_phis(Tacky::Function& function);
+    void coalesce(const Tacky::Function& function);
+    bool interfere(uint32_t a, uint32_t b);
+    bool live_after(uint32_t temporary, uint32_t position) const;
+    Tacky::Value value_of(uint32_t temporary);
+    void emit_parallel_copy(Tacky::Function& function, std::vector<std::pair<Tacky::Value, Tacky::Value>> copies,
+        std::vector<Tacky::Instruction>& output);
+    uint32_t find(uint32_t temporary);
+    void merge(uint32_t a, uint32_t b);
+    const Tacky::Function* function_ = nullptr;
+    std::optional<Tacky::ControlFlowGraph> cfg_;
+    std::optional<Tacky::DefUse> def_use_;
+    std::optional<Tacky::Liveness> liveness_;
+    // indexed by instruction once the phis are isolated, the parallel copy
+    // it is part of
+    std::vector<uint32_t> groups_;
+    // all indexed by temporary: a union find over the temporaries sharing
+    // one, with the members kept at the root, and the value it holds
+    std::vector<uint32_t> parents_;
+    std::vector<std::vector<uint32_t>> members_;
+    std::vector<Tacky::Value> values_;
+};
+
+// Sparse conditional constant propagation: folds instructions whose
+// operands are constants along the paths control can actually take,
+// propagates the results into their uses through the def-use chains, turns
+// a conditional jump on a constant into a jump or drops it, and drops the
+// code that leaves unreachable along with the phi entries coming from it.
+// Out of SSA form a temporary written more than once is left alone.
+class ConstantFoldingVisitor {
+public:
+    ~ConstantFoldingVisitor() = default;
+    ConstantFoldingVisitor() = default;
+    void rewrite(Tacky::Program& program);
+private:
+    // what a temporary is known to hold: nothing yet, one constant, or
+    // anything
+    struct Lattice {
+        enum class Kind : uint8_t {
+            TOP,
+            CONSTANT,
+            BOTTOM,
+        };
+        Kind kind_ = Kind::TOP;
+        int constant_ = 0;
+        bool operator==(const Lattice& that) const = default;
+    };
+    void rewrite(Tacky::Function& function);
+    void propagate();
+    void visit(uint32_t instruction);
+    void mark(uint32_t block, bool jumped);
+    bool executes(uint32_t from, uint32_t to) const;
+    void lower(uint32_t temporary, Lattice value);
+    static Lattice meet(Lattice a, Lattice b);
+    Lattice lattice_of(Tacky::Value value) const;
+    Tacky::Value substitute(Tacky::Value value) const;
+    const Tacky::Function* function_ = nullptr;
+    std::optional<Tacky::ControlFlowGraph> cfg_;
+    std::optional<Tacky::DefUse> def_use_;
+    // indexed by temporary id
+    std::vector<Lattice> lattice_;
+    // indexed by block: whether control gets there, and whether it takes
+    // the jump and the fall through out of it
+    std::vector<bool> executable_;
+    std::vector<bool> taken_;
+    std::vector<bool> fell_;
+    std::vector<uint32_t> block_worklist_;
+    std::vector<uint32_t> instruction_worklist_;
+};
+
+// Rewrites every use of a copied temporary to the copy's source and drops
+// the copy, going by the def-use chains. In SSA form the source can't
+// change in between. Out of it only a copy defining its temporary once, of
+// a source defined at most once, is propagated.
+class CopyPropagationVisitor {
+public:
+    ~CopyPropagationVisitor() = default;
+    CopyPropagationVisitor() = default;
+    void rewrite(Tacky::Program& program);
+private:
+    void rewrite(Tacky::Function& function);
+    Tacky::Value resolve(Tacky::Value value) const;
+    // indexed by temporary id, NONE unless the temporary is a copy
+    std::vector<Tacky::Value> copies_;
+};
+
+// Global value numbering over SSA form: an instruction computing the same
+// op over the same operands as one in a dominating block is dropped and its
+// uses, found through the def-use chains, read the earlier result. Operands
+// of commutative ops are put in a canonical order first, so a*b and b*a
+// share a number. Temporaries never change once defined and every use is
+// dominated by its definition, so the earlier result ran and still holds
+// wherever the later one is read. Out of SSA form, instructions touching a
+// temporary written more than once are left alone.
+class ValueNumberingVisitor {
+public:
+    ~ValueNumberingVisitor() = default;
+    ValueNumberingVisitor() = default;
+    void rewrite(Tacky::Program& program);
+    size_t removed() const { return removed_; }
+private:
+    struct Expression {
+        Tacky::OpCode op_;
+        Tacky::Value src1_;
+        Tacky::Value src2_;
+        bool operator==(const Expression& that) const = default;
+    };
+    struct ExpressionHash {
+        size_t operator()(const Expression& expression) const;
+    };
+    // the temporary holding an expression and the block computing it
+    struct Number {
+        Tacky::Value value_;
+        uint32_t block_;
+    };
+    void rewrite(Tacky::Function& function);
+    std::unordered_map<Expression, Number, ExpressionHash> numbers_;
+    size_t removed_ = 0;
+};
+
+// Rewrites algebraic identities into cheaper instructions: x*0, x|0, x^x,
+// ~~x, -(-x), x && 0, x || 1 and friends become copies, constants or a
+// single op, x*2^k a shift, signed x/2^k and x%2^k shift and mask
+// sequences, and chains of &, | or ^ with constants share one combined
+// mask. Both operands being constants is left to the folder, and so is
+// anything that might trap.
+class AlgebraicSimplificationVisitor {
+public:
+    ~AlgebraicSimplificationVisitor() = default;
+    AlgebraicSimplificationVisitor() = default;
+    void rewrite(Tacky::Program& program);
+private:
+    void rewrite(Tacky::Function& function);
+    bool simplify(Tacky::Instruction& instruction) const;
+    bool expand_division(const Tacky::Instruction& instruction);
+    Tacky::Value emit(Tacky::OpCode op, Tacky::Value src1, Tacky::Value src2 = Tacky::Value());
+    void define(const Tacky::Instruction& instruction);
+    Tacky::Function* function_ = nullptr;
+    std::vector<Tacky::Instruction> output_;
+    // indexed by temporary id, the instruction defining it once it was emitted
+    std::vector<Tacky::Instruction> definitions_;
+};
+
+// Drops the blocks of a function no path from the entry reaches and every
+// instruction whose result is never read. Labels, jumps, returns and
+// divisions that may trap are kept, and so is every definition of what a
+// kept instruction reads, found through the def-use chains. Removing the
+// rest can't change what the program does.
+class DeadCodeVisitor {
+public:
+    ~DeadCodeVisitor() = default;
+    DeadCodeVisitor() = default;
+    void rewrite(Tacky::Program& program);
+private:
+    void rewrite(Tacky::Function& function);
+    void remove_unreachable(Tacky::Function& function);
+    // indexed by temporary id, whether it's defined once unreachable
+    // blocks are gone
+    std::vector<bool> used_;
+};
+
+// Lays out the blocks of a function so control falls through as often as
+// it can. Jumps to a block holding nothing but a jump go straight to where
+// that one goes, blocks nothing reaches anymore are dropped, and the rest
+// are placed after all of their predecessors, with a block's successor
+// right after it whenever that order allows. Jumps to the next block go
+// away, a conditional jump over an unconditional one is inverted, and only
+// labels some jump still goes to are kept. Without loops jumps keep going
+// forward, so live ranges stay intervals of the instruction list for the
+// allocator.
+class BlockLayoutVisitor {
+public:
+    ~BlockLayoutVisitor() = default;
+    BlockLayoutVisitor() = default;
+    void rewrite(Tacky::Program& program);
+private:
+    // how a block ends once its jumps are threaded: it goes to next_, or to
+    // taken_ instead when jump_ on condition_ is taken. Its instructions
+    // without labels and jumps are [body_begin_, body_end_).
+    struct Exit {
+        uint32_t body_begin_ = 0;
+        uint32_t body_end_ = 0;
+        uint32_t next_ = Tacky::ControlFlowGraph::kNoBlock;
+        uint32_t taken_ = Tacky::ControlFlowGraph::kNoBlock;
+        Tacky::OpCode jump_ = Tacky::OpCode::JUMP;
+        Tacky::Value condition_;
+    };
+    void rewrite(Tacky::Function& function);
+    void build_exits(const Tacky::ControlFlowGraph& cfg);
+    void place(const Tacky::ControlFlowGraph& cfg);
+    void emit_block(const Tacky::ControlFlowGraph& cfg, uint32_t block, uint32_t following);
+    Tacky::Value label_of(const Tacky::ControlFlowGraph& cfg, uint32_t block);
+    Tacky::Function* function_ = nullptr;
+    // all indexed by block
+    std::vector<Exit> exits_;
+    std::vector<uint32_t> threaded_;
+    std::vector<uint32_t> pending_;
+    std::vector<Tacky::Value> labels_;
+    std::vector<size_t> label_positions_;
+    std::vector<uint32_t> order_;
+    std::vector<Tacky::Instruction> output_;
+};
+
+} // namespace Optimizer
+
+#endif // OPTIMIZER_H
@@ -0,0 +1,236 @@
+#include "src/optimizer/optimizer.h"
+#include "src/tacky/cfg.h"
+#include "src/tacky/def_use.h"
+#include "src/tacky/liveness.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace Optimizer {
+
+namespace {
+
+using Tacky::OpCode;
+using Tacky::Value;
+
+// Keeps the blocks the entry reaches. A phi only joins edges control can
+// take, and the dominator tree only covers those blocks.
+void remove_unreachable(Tacky::Function& function) {
+    Tacky::ControlFlowGraph cfg(function);
+    auto& instructions = function.instructions_;
+    size_t kept = 0;
+    for (uint32_t b = 0; b < cfg.blocks().size(); b++) {
+        if (!cfg.reachable(b)) {
+            continue;
+        }
+        for (uint32_t i = cfg.blocks()[b].begin_; i < cfg.blocks()[b].end_; i++) {
+            instructions[kept++] = instructions[i];
+        }
+    }
+    instructions.resize(kept);
+}
+
+} // namespace
+
+void SsaConstructionVisitor::rewrite(Tacky::Program& program) {
+    for (auto& function : program.functions_) {
+        rewrite(function);
+    }
+}
+
+// An entry some jump goes back to would need phis joining the values that
+// come around with the ones the function starts with, which come along no
+// edge. A jump to it put in front gives those an edge.
+void SsaConstructionVisitor::rewrite(Tacky::Function& function) {
+    auto& instructions = function.instructions_;
+    if (std::any_of(instructions.begin(), instructions.end(),
+            [](const Tacky::Instruction& instruction) { return instruction.op_ == OpCode::PHI; })) {
+        throw std::runtime_error("Tacky function is in SSA form already");
+    }
+    remove_unreachable(function);
+    if (instructions.empty()) {
+        return;
+    }
+    if (!Tacky::ControlFlowGraph(function).predecessors(0).empty()) {
+        instructions.insert(instructions.begin(), {OpCode::JUMP, Value(), instructions[0].src1_});
+    }
+    Tacky::ControlFlowGraph cfg(function);
+    place_phis(function, cfg);
+    rename(function, cfg);
+
+    std::vector<Tacky::Instruction> output;
+    output.reserve(instructions.size() + cfg.blocks().size());
+    for (uint32_t b = 0; b < cfg.blocks().size(); b++) {
+        auto begin = cfg.blocks()[b].begin_;
+        if (instructions[begin].op_ == OpCode::LABEL) {
+            output.push_back(instructions[begin++]);
+        } else if (!labels_[b].is_none()) {
+            output.push_back({OpCode::LABEL, Value(), labels_[b]});
+        }
+        for (auto& phi : phis_[b]) {
+            for (uint32_t p = 0; p < predecessors_[b].size(); p++) {
+                output.push_back({OpCode::PHI, phi.dst_, phi.operands_[p], labels_[predecessors_[b][p]]});
+            }
+        }
+        output.insert(output.end(), instructions.begin() + begin, instructions.begin() + cfg.blocks()[b].end_);
+    }
+    instructions.swap(output);
+}
+
+// Pruned SSA, after Cytron et al.: a temporary needs a phi on the dominance
+// frontier of every block defining it, iterated since a phi is a definition
+// as well, but only where it is live in. The frontiers are found the way
+// Cooper, Harvey and Kennedy do, walking up from each predecessor of a join
+// to the join's immediate dominator. Every predecessor of a block with
+// phis gets a label to name its entries by.
+void SsaConstructionVisitor::place_phis(Tacky::Function& function, const Tacky::ControlFlowGraph& cfg) {
+    auto& blocks = cfg.blocks();
+    auto& instructions = function.instructions_;
+    Tacky::DefUse def_use(function);
+    Tacky::Liveness liveness(function, cfg);
+    std::vector<std::vector<uint32_t>> frontiers(blocks.size());
+    predecessors_.assign(blocks.size(), {});
+    for (uint32_t b = 0; b < blocks.size(); b++) {
+        auto predecessors = cfg.predecessors(b);
+        // a block jumping to the next one falls into it as well
+        std::unique_copy(predecessors.begin(), predecessors.end(), std::back_inserter(predecessors_[b]));
+        if (predecessors_[b].size() < 2) {
+            continue;
+        }
+        for (auto predecessor : predecessors_[b]) {
+            for (auto runner = predecessor; runner != cfg.immediate_dominator(b);
+                    runner = cfg.immediate_dominator(runner)) {
+                if (frontiers[runner].empty() || frontiers[runner].back() != b) {
+                    frontiers[runner].push_back(b);
+                }
+            }
+        }
+    }
+
+    phis_.assign(blocks.size(), {});
+    // by block, the last temporary given a phi there and put on the worklist
+    std::vector<uint32_t> placed(blocks.size(), UINT32_MAX);
+    std::vector<uint32_t> queued(blocks.size(), UINT32_MAX);
+    std::vector<uint32_t> worklist;
+    for (uint32_t t = 0; t < function.temporary_count_; t++) {
+        if (def_use.uses(t).empty()) {
+            continue;
+        }
+        for (auto definition : def_use.definitions(t)) {
+            auto block = cfg.block_containing(definition);
+            if (queued[block] != t) {
+                queued[block] = t;
+                worklist.push_back(block);
+            }
+        }
+        while (!worklist.empty()) {
+            auto block = worklist.back();
+            worklist.pop_back();
+            for (auto join : frontiers[block]) {
+                if (placed[join] == t || !liveness.live_in(join, t)) {
+                    continue;
+                }
+                placed[join] = t;
+                phis_[join].push_back({t, Value(), std::vector<Value>(predecessors_[join].size())});
+                if (queued[join] != t) {
+                    queued[join] = t;
+                    worklist.push_back(join);
+                }
+            }
+        }
+    }
+
+    labels_.assign(blocks.size(), Value());
+    for (uint32_t b = 0; b < blocks.size(); b++) {
+        if (instructions[blocks[b].begin_].op_ == OpCode::LABEL) {
+            labels_[b] = instructions[blocks[b].begin_].src1_;
+        }
+    }
+    for (uint32_t b = 0; b < blocks.size(); b++) {
+        if (phis_[b].empty()) {
+            continue;
+        }
+        for (auto predecessor : predecessors_[b]) {
+            if (labels_[predecessor].is_none()) {
+                labels_[predecessor] = Value::label(function.label_count_++);
+            }
+        }
+    }
+}
+
+// Walks the dominator tree depth first with a stack of names per temporary,
+// the top being the definition closest above. The first definition of a
+// temporary keeps its name and every other one, phis included, gets a new
+// one. A block fills in its entry of the phis of its successors on the way.
+void SsaConstructionVisitor::rename(Tacky::Function& function, const Tacky::ControlFlowGraph& cfg) {
+    auto& blocks = cfg.blocks();
+    auto& instructions = function.instructions_;
+    std::vector<std::vector<uint32_t>> children(blocks.size());
+    for (auto b : cfg.reverse_postorder().subspan(1)) {
+        children[cfg.immediate_dominator(b)].push_back(b);
+    }
+    auto count = function.temporary_count_;
+    names_.assign(count, {});
+    std::vector<bool> defined(count, false);
+    // the temporaries given a name, in order, to pop them on the way back up
+    std::vector<uint32_t> pushed;
+    auto define = [&](uint32_t temporary) {
+        auto name = defined[temporary] ? Value::temporary(function.temporary_count_++) : Value::temporary(temporary);
+        defined[temporary] = true;
+        names_[temporary].push_back(name);
+        pushed.push_back(temporary);
+        return name;
+    };
+    auto current = [&](uint32_t temporary) { return names_[temporary].empty() ? Value() : names_[temporary].back(); };
+
+    // a block, the next of its children to visit and how many names were
+    // pushed before it
+    struct Visit {
+        uint32_t block_;
+        uint32_t next_;
+        size_t pushed_;
+    };
+    std::vector<Visit> stack;
+    auto enter = [&](uint32_t b) {
+        stack.push_back({b, 0, pushed.size()});
+        for (auto& phi : phis_[b]) {
+            phi.dst_ = define(phi.temporary_);
+        }
+        for (uint32_t i = blocks[b].begin_; i < blocks[b].end_; i++) {
+            auto& instruction = instructions[i];
+            for (auto* src : {&instruction.src1_, &instruction.src2_}) {
+                if (src->is_temporary()) {
+                    auto name = current(src->temporary_id());
+                    *src = name.is_none() ? Value::constant(0) : name;
+                }
+            }
+            if (instruction.dst_.is_temporary()) {
+                instruction.dst_ = define(instruction.dst_.temporary_id());
+            }
+        }
+        for (auto successor : {blocks[b].fall_through_, blocks[b].target_}) {
+            if (successor == Tacky::ControlFlowGraph::kNoBlock) {
+                continue;
+            }
+            auto& predecessors = predecessors_[successor];
+            auto entry = std::find(predecessors.begin(), predecessors.end(), b) - predecessors.begin();
+            for (auto& phi : phis_[successor]) {
+                phi.operands_[entry] = current(phi.temporary_);
+            }
+        }
+    };
+    enter(0);
+    while (!stack.empty()) {
+        auto& visit = stack.back();
+        if (visit.next_ < children[visit.block_].size()) {
+            enter(children[visit.block_][visit.next_++]);
+            continue;
+        }
+        for (; pushed.size() > visit.pushed_; pushed.pop_back()) {
+            names_[pushed.back()].pop_back();
+        }
+        stack.pop_back();
+    }
+}
+
+} // namespace Optimizer
@@ -0,0 +1,373 @@
+#include "src/optimizer/optimizer.h"
+#include "src/tacky/cfg.h"
+#include "src/tacky/def_use.h"
+#include "src/tacky/liveness.h"
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
+#include <utility>
+
+namespace Optimizer {
+
+namespace {
+
+using Tacky::OpCode;
+using Tacky::Value;
+
+constexpr uint32_t kNoGroup = UINT32_MAX;
+
+} // namespace
+
+void SsaDestructionVisitor::rewrite(Tacky::Program& program) {
+    for (auto& function : program.functions_) {
+        rewrite(function);
+    }
+}
+
+void SsaDestructionVisitor::rewrite(Tacky::Function& function) {
+    auto& instructions = function.instructions_;
+    if (std::none_of(instructions.begin(), instructions.end(),
+            [](const Tacky::Instruction& instruction) { return instruction.op_ == OpCode::PHI; })) {
+        return;
+    }
+    isolate_phis(function);
+    coalesce(function);
+
+    // every temporary is named after the smallest one it shares with
+    auto rename = [&](Value value) {
+        return value.is_temporary() ? Value::temporary(find(value.temporary_id())) : value;
+    };
+    std::vector<Tacky::Instruction> output;
+    output.reserve(instructions.size());
+    for (uint32_t i = 0; i < instructions.size(); i++) {
+        auto instruction = instructions[i];
+        if (instruction.op_ == OpCode::PHI) {
+            continue;
+        }
+        if (groups_[i] != kNoGroup) {
+            auto end = i;
+            std::vector<std::pair<Value, Value>> copies;
+            for (; end < instructions.size() && groups_[end] == groups_[i]; end++) {
+                copies.push_back({rename(instructions[end].dst_), rename(instructions[end].src1_)});
+            }
+            emit_parallel_copy(function, copies, output);
+            i = end - 1;
+            continue;
+        }
+        instruction.dst_ = rename(instruction.dst_);
+        instruction.src1_ = rename(instruction.src1_);
+        instruction.src2_ = rename(instruction.src2_);
+        if (instruction.op_ != OpCode::COPY || instruction.dst_ != instruction.src1_) {
+            output.push_back(instruction);
+        }
+    }
+    // the labels naming phi entries go unless something jumps there
+    std::unordered_set<uint32_t> targeted;
+    for (auto& instruction : output) {
+        if (Tacky::is_jump(instruction.op_)) {
+            targeted.insert(Tacky::jump_target(instruction).label_id());
+        }
+    }
+    std::erase_if(output, [&](const Tacky::Instruction& instruction) {
+        return instruction.op_ == OpCode::LABEL && !targeted.contains(instruction.src1_.label_id());
+    });
+    instructions.swap(output);
+}
+
+// Sreedhar et al.'s method I. A phi a = phi(v1, ..., vn) becomes
+// a' = phi(a1', ..., an') with a = a' at the start of its block and
+// ai' = vi on each edge, all of a', a1', ..., an' new temporaries. A phi
+// whose block has one predecessor is just a = v1. The copies of one place
+// are numbered as a group, and run as one parallel copy.
+void SsaDestructionVisitor::isolate_phis(Tacky::Function& function) {
+    auto& instructions = function.instructions_;
+    Tacky::ControlFlowGraph cfg(function);
+    auto& blocks = cfg.blocks();
+    auto copy = [](Value dst, Value src) { return Tacky::Instruction{OpCode::COPY, dst, src, Value()}; };
+    std::vector<std::vector<Tacky::Instruction>> phis(blocks.size());
+    std::vector<std::vector<Tacky::Instruction>> starts(blocks.size());
+    std::vector<std::vector<Tacky::Instruction>> ends(blocks.size());
+    // the blocks going in ahead of each block, its fall through first
+    std::vector<std::vector<Split>> splits(blocks.size());
+    // by block, the label its jump goes to instead
+    std::vector<Value> retargets(blocks.size());
+    // the copies along an edge, at the end of the predecessor when that
+    // has one successor and in a block splitting the edge otherwise
+    auto edge_copies = [&](Value from_label, uint32_t to) -> std::pair<std::vector<Tacky::Instruction>*, Value> {
+        auto from = cfg.block_of(from_label);
+        auto& block = blocks[from];
+        if (block.target_ == block.fall_through_ || block.target_ == Tacky::ControlFlowGraph::kNoBlock ||
+            block.fall_through_ == Tacky::ControlFlowGraph::kNoBlock) {
+            return {&ends[from], from_label};
+        }
+        bool fell = block.fall_through_ == to;
+        for (auto& split : splits[to]) {
+            if (split.from_ == from) {
+                return {&split.copies_, split.label_};
+            }
+        }
+        auto label = Value::label(function.label_count_++);
+        auto at = fell ? splits[to].begin() : splits[to].end();
+        auto& split = *splits[to].insert(at, Split{from, label, {}});
+        if (!fell) {
+            retargets[from] = label;
+        }
+        return {&split.copies_, label};
+    };
+
+    for (uint32_t b = 0; b < blocks.size(); b++) {
+        auto predecessors = cfg.predecessors(b);
+        bool single = predecessors.empty() || std::adjacent_find(predecessors.begin(), predecessors.end(),
+            std::not_equal_to<>()) == predecessors.end();
+        for (uint32_t i = blocks[b].begin_; i < blocks[b].end_; i++) {
+            auto& phi = instructions[i];
+            if (phi.op_ != OpCode::PHI || (i > blocks[b].begin_ && instructions[i - 1].op_ == OpCode::PHI &&
+                    instructions[i - 1].dst_ == phi.dst_)) {
+                continue;
+            }
+            auto run_end = i;
+            bool defined = false;
+            for (; run_end < blocks[b].end_ && instructions[run_end].op_ == OpCode::PHI &&
+                    instructions[run_end].dst_ == phi.dst_; run_end++) {
+                defined = defined || !instructions[run_end].src1_.is_none();
+            }
+            // undefined along every edge, it may as well be 0
+            if (!defined) {
+                starts[b].push_back(copy(phi.dst_, Value::constant(0)));
+                continue;
+            }
+            if (single) {
+                for (auto j = i; j < run_end; j++) {
+                    if (!instructions[j].src1_.is_none()) {
+                        starts[b].push_back(copy(phi.dst_, instructions[j].src1_));
+                    }
+                }
+                continue;
+            }
+            auto joined = Value::temporary(function.temporary_count_++);
+            starts[b].push_back(copy(phi.dst_, joined));
+            for (auto j = i; j < run_end; j++) {
+                auto operand = instructions[j].src1_;
+                // nothing to copy, so no need to split the edge
+                if (operand.is_none()) {
+                    phis[b].push_back(instructions[j]);
+                    phis[b].back().dst_ = joined;
+                    continue;
+                }
+                auto [copies, label] = edge_copies(instructions[j].src2_, b);
+                auto isolated = Value::temporary(function.temporary_count_++);
+                copies->push_back(copy(isolated, operand));
+                phis[b].push_back({OpCode::PHI, joined, isolated, label});
+            }
+        }
+    }
+
+    std::vector<Tacky::Instruction> output;
+    output.reserve(instructions.size() * 2);
+    groups_.clear();
+    uint32_t group_count = 0;
+    auto emit = [&](const Tacky::Instruction& instruction, uint32_t group) {
+        output.push_back(instruction);
+        groups_.push_back(group);
+    };
+    auto emit_group = [&](const std::vector<Tacky::Instruction>& copies) {
+        for (auto& instruction : copies) {
+            emit(instruction, group_count);
+        }
+        group_count++;
+    };
+    for (uint32_t b = 0; b < blocks.size(); b++) {
+        auto begin = blocks[b].begin_;
+        auto end = blocks[b].end_;
+        auto label = instructions[begin].src1_;
+        for (size_t s = 0; s < splits[b].size(); s++) {
+            emit({OpCode::LABEL, Value(), splits[b][s].label_}, kNoGroup);
+            emit_group(splits[b][s].copies_);
+            if (s + 1 < splits[b].size()) {
+                emit({OpCode::JUMP, Value(), label}, kNoGroup);
+            }
+        }
+        if (instructions[begin].op_ == OpCode::LABEL) {
+            emit(instructions[begin++], kNoGroup);
+        }
+        for (auto& phi : phis[b]) {
+            emit(phi, kNoGroup);
+        }
+        for (; begin < end && instructions[begin].op_ == OpCode::PHI; begin++) {
+        }
+        emit_group(starts[b]);
+        bool jumps = begin < end && Tacky::is_jump(instructions[end - 1].op_);
+        for (auto i = begin; i < end - jumps; i++) {
+            emit(instructions[i], kNoGroup);
+        }
+        emit_group(ends[b]);
+        if (jumps) {
+            auto jump = instructions[end - 1];
+            if (!retargets[b].is_none()) {
+                (jump.op_ == OpCode::JUMP ? jump.src1_ : jump.src2_) = retargets[b];
+            }
+            emit(jump, kNoGroup);
+        }
+        // splits in front of the next block that it no longer falls into
+        auto next = b + 1;
+        bool falls = blocks[b].fall_through_ == next;
+        if (falls && !splits[next].empty() && splits[next].front().from_ != b) {
+            emit({OpCode::JUMP, Value(), instructions[blocks[next].begin_].src1_}, kNoGroup);
+        }
+    }
+    instructions.swap(output);
+}
+
+// Boissinot et al.'s coalescing, checking the members of two groups pair by
+// pair. Each phi starts out sharing with its operands, which method I made
+// safe, and then every copy of a temporary tries to share with its source.
+void SsaDestructionVisitor::coalesce(const Tacky::Function& function) {
+    auto& instructions = function.instructions_;
+    function_ = &function;
+    cfg_.emplace(function);
+    def_use_.emplace(function);
+    liveness_.emplace(function, *cfg_);
+    auto count = function.temporary_count_;
+    parents_.resize(count);
+    members_.assign(count, {});
+    values_.assign(count, Value());
+    for (uint32_t t = 0; t < count; t++) {
+        parents_[t] = t;
+        members_[t].push_back(t);
+    }
+    for (auto& instruction : instructions) {
+        if (instruction.op_ == OpCode::PHI && instruction.src1_.is_temporary()) {
+            merge(find(instruction.dst_.temporary_id()), find(instruction.src1_.temporary_id()));
+        }
+    }
+    for (auto& instruction : instructions) {
+        if (instruction.op_ != OpCode::COPY || !instruction.src1_.is_temporary()) {
+            continue;
+        }
+        auto a = find(instruction.dst_.temporary_id());
+        auto b = find(instruction.src1_.temporary_id());
+        if (a == b) {
+            continue;
+        }
+        bool apart = true;
+        for (auto x : members_[a]) {
+            for (auto y : members_[b]) {
+                apart = apart && !interfere(x, y);
+            }
+        }
+        if (apart) {
+            merge(a, b);
+        }
+    }
+    cfg_.reset();
+    def_use_.reset();
+    liveness_.reset();
+    function_ = nullptr;
+}
+
+// Defined apart, in SSA the definition of one of them dominates every
+// place both are live at, so they interfere when the one defined first is
+// still live right after the other's definition. Holding the same value
+// they can share all the same.
+bool SsaDestructionVisitor::interfere(uint32_t a, uint32_t b) {
+    if (value_of(a) == value_of(b)) {
+        return false;
+    }
+    auto at = def_use_->definition(a);
+    auto bt = def_use_->definition(b);
+    if (at == Tacky::DefUse::kNoDefinition || bt == Tacky::DefUse::kNoDefinition) {
+        return false;
+    }
+    auto dominates = [&](uint32_t x, uint32_t y) {
+        auto xb = cfg_->block_containing(x);
+        auto yb = cfg_->block_containing(y);
+        return xb == yb ? x < y : cfg_->dominates(xb, yb);
+    };
+    if (dominates(at, bt)) {
+        return live_after(a, bt);
+    }
+    return dominates(bt, at) && live_after(b, at);
+}
+
+// read in the same block after position, phis aside, or live out of it
+bool SsaDestructionVisitor::live_after(uint32_t temporary, uint32_t position) const {
+    auto block = cfg_->block_containing(position);
+    auto& instructions = function_->instructions_;
+    for (auto use : def_use_->uses(temporary)) {
+        if (use > position && use < cfg_->blocks()[block].end_ && instructions[use].op_ != OpCode::PHI) {
+            return true;
+        }
+    }
+    return liveness_->live_out(block, temporary);
+}
+
+// what a temporary holds, through chains of copies
+Value SsaDestructionVisitor::value_of(uint32_t temporary) {
+    if (!values_[temporary].is_none()) {
+        return values_[temporary];
+    }
+    auto definition = def_use_->definition(temporary);
+    auto value = Value::temporary(temporary);
+    if (definition != Tacky::DefUse::kNoDefinition) {
+        auto& instruction = function_->instructions_[definition];
+        if (instruction.op_ == OpCode::COPY) {
+            value = instruction.src1_.is_temporary() ? value_of(instruction.src1_.temporary_id()) : instruction.src1_;
+        }
+    }
+    return values_[temporary] = value;
+}
+
+// Copies one after the other whatever doesn't overwrite the source of a
+// copy still to go. What's left then are cycles, and one is broken by
+// saving a destination in a new temporary first.
+void SsaDestructionVisitor::emit_parallel_copy(Tacky::Function& function,
+    std::vector<std::pair<Value, Value>> copies, std::vector<Tacky::Instruction>& output) {
+    // only the last copy into a temporary counts, the others aren't read
+    std::vector<std::pair<Value, Value>> pending;
+    for (auto it = copies.rbegin(); it != copies.rend(); it++) {
+        auto written = [&](const std::pair<Value, Value>& copy) { return copy.first == it->first; };
+        if (it->first != it->second && std::none_of(pending.begin(), pending.end(), written)) {
+            pending.push_back(*it);
+        }
+    }
+    std::reverse(pending.begin(), pending.end());
+    while (!pending.empty()) {
+        auto ready = std::find_if(pending.begin(), pending.end(), [&](const std::pair<Value, Value>& copy) {
+            return std::none_of(pending.begin(), pending.end(),
+                [&](const std::pair<Value, Value>& other) { return other.second == copy.first; });
+        });
+        if (ready != pending.end()) {
+            output.push_back({OpCode::COPY, ready->first, ready->second});
+            pending.erase(ready);
+            continue;
+        }
+        auto saved = Value::temporary(function.temporary_count_++);
+        auto dst = pending.front().first;
+        output.push_back({OpCode::COPY, saved, dst});
+        for (auto& copy : pending) {
+            if (copy.second == dst) {
+                copy.second = saved;
+            }
+        }
+    }
+}
+
+uint32_t SsaDestructionVisitor::find(uint32_t temporary) {
+    while (parents_[temporary] != temporary) {
+        parents_[temporary] = parents_[parents_[temporary]];
+        temporary = parents_[temporary];
+    }
+    return temporary;
+}
+
+// the smaller root stays, so a group is named after its smallest member
+void SsaDestructionVisitor::merge(uint32_t a, uint32_t b) {
+    if (b < a) {
+        std::swap(a, b);
+    }
+    parents_[b] = a;
+    members_[a].insert(members_[a].end(), members_[b].begin(), members_[b].end());
+    members_[b].clear();
+}
+
+} // namespace Optimizer
@@ -0,0 +1,89 @@
+#include "src/optimizer/optimizer.h"
+#include "src/tacky/cfg.h"
+#include "src/tacky/def_use.h"
+#include <utility>
+#include <vector>
+
+namespace Optimizer {
+
+namespace {
+
+// temporaries before constants, so a constant lands in the immediate slot
+bool goes_first(Tacky::Value a, Tacky::Value b) {
+    if (a.kind() != b.kind()) {
+        return a.is_temporary();
+    }
+    return a.bits() < b.bits();
+}
+
+} // namespace
+
+size_t ValueNumberingVisitor::ExpressionHash::operator()(const Expression& expression) const {
+    // boost style hash_combine over the three fields
+    size_t hash = static_cast<size_t>(expression.op_);
+    for (auto bits : {expression.src1_.bits(), expression.src2_.bits()}) {
+        hash ^= std::hash<uint64_t>()(bits) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+void ValueNumberingVisitor::rewrite(Tacky::Program& program) {
+    for (auto& function : program.functions_) {
+        rewrite(function);
+    }
+}
+
+// Blocks are numbered in reverse postorder, so a block's dominators are
+// all numbered by the time it is. An earlier instruction computing the same
+// thing only stands in when its block dominates this one, otherwise this
+// one takes over the number for the blocks after it. The uses of a
+// dropped result are rewritten right away, a phi reading it along a jump
+// back as well, so later instructions are numbered over what they read.
+void ValueNumberingVisitor::rewrite(Tacky::Function& function) {
+    numbers_.clear();
+    Tacky::ControlFlowGraph cfg(function);
+    Tacky::DefUse def_use(function);
+    auto& instructions = function.instructions_;
+    auto written_again = [&](Tacky::Value value) {
+        return value.is_temporary() && def_use.definitions(value.temporary_id()).size() > 1;
+    };
+    std::vector<bool> removed(instructions.size(), false);
+    for (auto block : cfg.reverse_postorder()) {
+        for (uint32_t i = cfg.blocks()[block].begin_; i < cfg.blocks()[block].end_; i++) {
+            auto& instruction = instructions[i];
+            // phis in different blocks join different edges
+            if (Tacky::is_control(instruction.op_) || instruction.op_ == Tacky::OpCode::PHI ||
+                    written_again(instruction.dst_) || written_again(instruction.src1_) ||
+                    written_again(instruction.src2_)) {
+                continue;
+            }
+            if (Tacky::is_commutative(instruction.op_) && goes_first(instruction.src2_, instruction.src1_)) {
+                std::swap(instruction.src1_, instruction.src2_);
+            }
+            auto [number, inserted] = numbers_.try_emplace(
+                Expression{instruction.op_, instruction.src1_, instruction.src2_}, Number{instruction.dst_, block});
+            if (!inserted && cfg.dominates(number->second.block_, block)) {
+                for (auto use : def_use.uses(instruction.dst_.temporary_id())) {
+                    for (auto* src : {&instructions[use].src1_, &instructions[use].src2_}) {
+                        if (*src == instruction.dst_) {
+                            *src = number->second.value_;
+                        }
+                    }
+                }
+                removed[i] = true;
+                removed_++;
+                continue;
+            }
+            number->second = Number{instruction.dst_, block};
+        }
+    }
+    size_t kept = 0;
+    for (uint32_t i = 0; i < instructions.size(); i++) {
+        if (!removed[i]) {
+            instructions[kept++] = instructions[i];
+        }
+    }
+    instructions.resize(kept);
+}
+
+} // namespace Optimizer
@@ -43,18 +43,22 @@ auto RecursiveDescentParser::parse() -> std::optional<std::shared_ptr<CAst::Prog
 }
 
 auto RecursiveDescentParser::parseProgram() -> std::optional<std::shared_ptr<CAst::ProgramNode>> {
-    CAst::ProgramNode program;
+    auto program = std::make_shared<CAst::ProgramNode>();
+    arena_ = &program->arena_;
+    std::vector<CAst::FunctionNode*> functions;
     while (tokens_.peek(0).kind != Lexer::TokenType::END_OF_FILE) {
         auto func = parseFunction();
         if (!func.has_value()) {
             break;
         }
-        program.functions_.push_back(std::move(func.value()));
+        functions.push_back(func.value());
     }
-    return std::make_shared<CAst::ProgramNode>(program);
+    program->functions_ = arena_->copy(functions);
+    arena_ = nullptr;
+    return program;
 }
 
-auto RecursiveDescentParser::parseFunction() -> std::optional<std::shared_ptr<CAst::FunctionNode>> {
+auto RecursiveDescentParser::parseFunction() -> std::optional<CAst::FunctionNode*> {
     auto return_type_opt = parseType();
     if (!return_type_opt.has_value()) {
         return std::nullopt;
@@ -71,20 +75,20 @@ auto RecursiveDescentParser::parseFunction() -> std::optional<std::shared_ptr<CA
     if (!body_opt.has_value()) {
         throw std::runtime_error("Expected function body");
     }
-    return std::make_shared<CAst::FunctionNode>(
-        std::get<std::string>(function_name.value),
+    return arena_->make<CAst::FunctionNode>(
+        std::get<Source::Symbol>(function_name.value),
         return_type_opt.value(),
         arguments_opt.value(),
         body_opt.value()
     );
 }
 
-auto RecursiveDescentParser::parseType() -> std::optional<std::shared_ptr<CAst::TypeNode>> {
+auto RecursiveDescentParser::parseType() -> std::optional<CAst::TypeNode*> {
     switch (tokens_.peek(0).kind) {
         case Lexer::TokenType::INTEGER_TYPE: {
             auto t = tokens_.consume();
             assert(t.kind == Lexer::TokenType::INTEGER_TYPE);
-            return std::make_optional(std::make_shared<CAst::TypeNode>(CAst::Type::INTEGER));
+            return std::make_optional(arena_->make<CAst::TypeNode>(CAst::Type::INTEGER));
         }
         default:
             return std::nullopt;
@@ -92,13 +96,12 @@ auto RecursiveDescentParser::parseType() -> std::optional<std::shared_ptr<CAst::
     return std::nullopt;
 }
 
-auto RecursiveDescentParser::parseFunctionArguments() -> std::optional<std::shared_ptr<CAst::FunctionArgumentsNode>> {
-    auto lparen = tokens_.peek(0);
-    if (lparen.kind != Lexer::TokenType::LPAREN) {
+auto RecursiveDescentParser::parseFunctionArguments() -> std::optional<CAst::FunctionArgumentsNode*> {
+    if (tokens_.peek(0).kind != Lexer::TokenType::LPAREN) {
         return std::nullopt;
     }
     tokens_.consume();
-    CAst::FunctionArgumentsNode function_args;
+    std::vector<CAst::FunctionArgument> arguments;
     while(tokens_.peek(0).kind != Lexer::TokenType::RPAREN) {
         if (tokens_.peek(0).kind == Lexer::TokenType::COMMA) {
             tokens_.consume();
@@ -111,35 +114,39 @@ auto RecursiveDescentParser::parseFunctionArguments() -> std::optional<std::shar
         if (name_token.kind != Lexer::TokenType::NAME) {
             throw std::runtime_error("Expected argument name");
         }
-        function_args.arguments_.push_back(CAst::FunctionArgument{
+        arguments.push_back(CAst::FunctionArgument{
             .type = type_node.value()->type_,
-            .name = std::get<std::string>(name_token.value),
+            .name = std::get<Source::Symbol>(name_token.value),
         });
     }
     if (tokens_.peek(0).kind != Lexer::TokenType::RPAREN) {
         throw std::runtime_error("Expected closing parenthesis for function arguments");
     }
     tokens_.consume();
-    return std::make_optional(std::make_shared<CAst::FunctionArgumentsNode>(std::move(function_args)));
+    return std::make_optional(arena_->make<CAst::FunctionArgumentsNode>(arena_->copy(arguments)));
 }
 
-auto RecursiveDescentParser::parseStatementBlock() -> std::optional<std::shared_ptr<CAst::StatementBlockNode>> {
+auto RecursiveDescentParser::parseStatementBlock() -> std::optional<CAst::StatementBlockNode*> {
     if (tokens_.peek(0).kind != Lexer::TokenType::LBRACE) {
         return std::nullopt;
     }
     tokens_.consume();
-    CAst::StatementBlockNode result;
+    std::vector<CAst::StatementNode*> statements;
     while (true) {
-        std::optional<std::shared_ptr<CAst::StatementNode>> statement = parseStatement();
+        std::optional<CAst::StatementNode*> statement = parseStatement();
         if (!statement.has_value()) {
             break;
         }
-        result.statements_.push_back(statement.value());
+        statements.push_back(statement.value());
     }
-    return std::make_optional(std::make_shared<CAst::StatementBlockNode>(std::move(result)));
+    if (tokens_.peek(0).kind != Lexer::TokenType::RBRACE) {
+        throw std::runtime_error("Expected closing brace for statement block");
+    }
+    tokens_.consume();
+    return std::make_optional(arena_->make<CAst::StatementBlockNode>(arena_->copy(statements)));
 }
 
-auto RecursiveDescentParser::parseStatement() -> std::optional<std::shared_ptr<CAst::StatementNode>> {
+auto RecursiveDescentParser::parseStatement() -> std::optional<CAst::StatementNode*> {
     if (tokens_.peek(0).kind != Lexer::TokenType::RETURN) {
         return std::nullopt;
     }
@@ -152,15 +159,14 @@ auto RecursiveDescentParser::parseStatement() -> std::optional<std::shared_ptr<C
         throw std::runtime_error("Expected semicolon after return statement");
     }
     tokens_.consume();
-    return std::make_optional(std::make_shared<CAst::ReturnStatementNode>(
+    return std::make_optional(arena_->make<CAst::ReturnStatementNode>(
         CAst::Type::INTEGER,
         expr.value()
     ));
 }
 
-auto RecursiveDescentParser::parseFactor() -> std::optional<std::shared_ptr<CAst::ExpressionNode>> {
-    auto cur_token = tokens_.peek(0);
-    switch (cur_token.kind) {
+auto RecursiveDescentParser::parseFactor() -> std::optional<CAst::ExpressionNode*> {
+    switch (tokens_.peek(0).kind) {
         case Lexer::TokenType::INTEGER_VALUE:
             return parseConstantValue();
         case Lexer::TokenType::TILDE:
@@ -189,7 +195,7 @@ auto RecursiveDescentParser::parseFactor() -> std::optional<std::shared_ptr<CAst
     }
 }
 
-auto RecursiveDescentParser::parseExpression(int min_precedence) -> std::optional<std::shared_ptr<CAst::ExpressionNode>> {
+auto RecursiveDescentParser::parseExpression(int min_precedence) -> std::optional<CAst::ExpressionNode*> {
     auto left = parseFactor();
     if (!left) {
         throw std::runtime_error("Expected a left factor during expr parsing");
@@ -197,58 +203,23 @@ auto RecursiveDescentParser::parseExpression(int min_precedence) -> std::optiona
     auto next_token = tokens_.peek(0).kind;
     auto next_token_precedence = precedence(next_token);
     while(is_bin_op(next_token) && next_token_precedence.value() >= min_precedence) {
-        Lexer::Token op = tokens_.consume();
-        std::optional<std::shared_ptr<CAst::ExpressionNode>> right = parseExpression(next_token_precedence.value() + 1);
+        tokens_.consume();
+        std::optional<CAst::ExpressionNode*> right = parseExpression(next_token_precedence.value() + 1);
         if (!right) {
             throw std::runtime_error("Expected to parse right expression during precedence climbing");
         }
-        switch (next_token) {
-            case Lexer::TokenType::PLUS:
-                left = std::make_optional(std::make_shared<CAst::PlusNode>(left.value(), right.value()));
-                break;
-            case Lexer::TokenType::MINUS:
-                left = std::make_optional(std::make_shared<CAst::MinusNode>(left.value(), right.value()));
-                break;
-            case Lexer::TokenType::MOD:
-                left = std::make_optional(std::make_shared<CAst::ModNode>(left.value(), right.value()));
-                break;
-            case Lexer::TokenType::DIV:
-                left = std::make_optional(std::make_shared<CAst::DivNode>(left.value(), right.value()));
-                break;
-            case Lexer::TokenType::MULT:
-                left = std::make_optional(std::make_shared<CAst::MultNode>(left.value(), right.value()));
-                break;
-            case Lexer::TokenType::AND:
-                left = std::make_optional(std::make_shared<CAst::AndNode>(left.value(), right.value()));
-                break;
-            case Lexer::TokenType::BITWISE_AND:
-                left = std::make_optional(std::make_shared<CAst::BitwiseAndNode>(left.value(), right.value()));
-                break;
-            case Lexer::TokenType::OR:
-                left = std::make_optional(std::make_shared<CAst::OrNode>(left.value(), right.value()));
-                break;
-            case Lexer::TokenType::BITWISE_OR:
-                left = std::make_optional(std::make_shared<CAst::BitwiseOrNode>(left.value(), right.value()));
-                break;
-            case Lexer::TokenType::BITWISE_XOR:
-                left = std::make_optional(std::make_shared<CAst::BitwiseXorNode>(left.value(), right.value()));
-                break;
-            case Lexer::TokenType::BITSHIFT_LEFT:
-                left = std::make_optional(std::make_shared<CAst::BitwiseLeftShiftNode>(left.value(), right.value()));
-                break;
-            case Lexer::TokenType::BITSHIFT_RIGHT:
-                left = std::make_optional(std::make_shared<CAst::BitwiseRightShiftNode>(left.value(), right.value()));
-                break;
-            default:
-                throw std::runtime_error("Unable to build bin exp from given token.");
-        }
+        left = std::make_optional(arena_->make<CAst::BinaryExpressionNode>(
+            binary_operator(next_token),
+            left.value(),
+            right.value()
+        ));
         next_token = tokens_.peek(0).kind;
         next_token_precedence = precedence(next_token);
     }
     return left;
 }
 
-auto RecursiveDescentParser::parseUnaryExpression() -> std::optional<std::shared_ptr<CAst::UnaryExpressionNode>> {
+auto RecursiveDescentParser::parseUnaryExpression() -> std::optional<CAst::UnaryExpressionNode*> {
     auto token = tokens_.consume();
     auto operand = parseFactor();
     if (!operand.has_value()) {
@@ -256,21 +227,21 @@ auto RecursiveDescentParser::parseUnaryExpression() -> std::optional<std::shared
     }
     switch (token.kind) {
         case Lexer::TokenType::TILDE:
-            return std::make_optional(std::make_shared<CAst::TildeUnaryExpressionNode>(operand.value()));
+            return std::make_optional(arena_->make<CAst::UnaryExpressionNode>(CAst::UnaryOperator::COMPLEMENT, operand.value()));
         case Lexer::TokenType::MINUS:
-            return std::make_optional(std::make_shared<CAst::MinusUnaryExpressionNode>(operand.value()));
+            return std::make_optional(arena_->make<CAst::UnaryExpressionNode>(CAst::UnaryOperator::NEGATE, operand.value()));
         case Lexer::TokenType::NOT:
-            return std::make_optional(std::make_shared<CAst::NotUnaryExpressionNode>(operand.value()));
+            return std::make_optional(arena_->make<CAst::UnaryExpressionNode>(CAst::UnaryOperator::NOT, operand.value()));
         default:
             throw std::runtime_error("Unexpecetd operation token while emiting a unary expr.");
     }
 }
 
-auto RecursiveDescentParser::parseConstantValue() -> std::optional<std::shared_ptr<CAst::ConstantValueNode>> {
+auto RecursiveDescentParser::parseConstantValue() -> std::optional<CAst::ConstantValueNode*> {
     if (tokens_.peek(0).kind == Lexer::TokenType::INTEGER_VALUE) {
         auto token = tokens_.consume();
         int value = std::get<int>(token.value);
-        return std::make_optional(std::make_shared<CAst::IntegerValueNode>(value));
+        return std::make_optional(arena_->make<CAst::IntegerValueNode>(value));
     }
     throw std::runtime_error("Expected integer token while parsing constant value");
 }
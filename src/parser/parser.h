@@ -5,6 +5,7 @@
 #include <generator>
 #include "src/lexer/token.h"
 #include <optional>
+#include <stdexcept>
 #include <unordered_map>
 
 namespace Parser {
@@ -28,6 +29,12 @@ inline bool is_bin_op(Lexer::TokenType token_type) {
         case Lexer::TokenType::OR:
         case Lexer::TokenType::BITWISE_OR:
         case Lexer::TokenType::BITWISE_XOR:
+        case Lexer::TokenType::EQUAL:
+        case Lexer::TokenType::NOT_EQUAL:
+        case Lexer::TokenType::LESS:
+        case Lexer::TokenType::GREATER:
+        case Lexer::TokenType::LESS_EQ:
+        case Lexer::TokenType::GREATER_EQ:
             return true;
         default:
             return false;
@@ -48,6 +55,12 @@ inline std::optional<Associativity> associativity(Lexer::TokenType token_type) {
         case Lexer::TokenType::OR:
         case Lexer::TokenType::BITWISE_OR:
         case Lexer::TokenType::BITWISE_XOR:
+        case Lexer::TokenType::EQUAL:
+        case Lexer::TokenType::NOT_EQUAL:
+        case Lexer::TokenType::LESS:
+        case Lexer::TokenType::GREATER:
+        case Lexer::TokenType::LESS_EQ:
+        case Lexer::TokenType::GREATER_EQ:
             return std::make_optional(LEFT);
         default:
             return std::nullopt;
@@ -69,6 +82,14 @@ inline std::optional<Precedence> precedence(Lexer::TokenType token_type) {
         case Lexer::TokenType::BITSHIFT_LEFT:
         case Lexer::TokenType::BITSHIFT_RIGHT:
             return std::make_optional(55);
+        case Lexer::TokenType::LESS:
+        case Lexer::TokenType::GREATER:
+        case Lexer::TokenType::LESS_EQ:
+        case Lexer::TokenType::GREATER_EQ:
+            return std::make_optional(50);
+        case Lexer::TokenType::EQUAL:
+        case Lexer::TokenType::NOT_EQUAL:
+            return std::make_optional(45);
         case Lexer::TokenType::BITWISE_AND:
             return std::make_optional(40);
         case Lexer::TokenType::BITWISE_XOR:
@@ -84,6 +105,31 @@ inline std::optional<Precedence> precedence(Lexer::TokenType token_type) {
     }
 }
 
+inline CAst::BinaryOperator binary_operator(Lexer::TokenType token_type) {
+    switch (token_type) {
+        case Lexer::TokenType::MULT: return CAst::BinaryOperator::MULT;
+        case Lexer::TokenType::DIV: return CAst::BinaryOperator::DIV;
+        case Lexer::TokenType::MOD: return CAst::BinaryOperator::MOD;
+        case Lexer::TokenType::PLUS: return CAst::BinaryOperator::PLUS;
+        case Lexer::TokenType::MINUS: return CAst::BinaryOperator::MINUS;
+        case Lexer::TokenType::BITSHIFT_LEFT: return CAst::BinaryOperator::LEFT_SHIFT;
+        case Lexer::TokenType::BITSHIFT_RIGHT: return CAst::BinaryOperator::RIGHT_SHIFT;
+        case Lexer::TokenType::AND: return CAst::BinaryOperator::AND;
+        case Lexer::TokenType::BITWISE_AND: return CAst::BinaryOperator::BITWISE_AND;
+        case Lexer::TokenType::OR: return CAst::BinaryOperator::OR;
+        case Lexer::TokenType::BITWISE_OR: return CAst::BinaryOperator::BITWISE_OR;
+        case Lexer::TokenType::BITWISE_XOR: return CAst::BinaryOperator::BITWISE_XOR;
+        case Lexer::TokenType::EQUAL: return CAst::BinaryOperator::EQUAL;
+        case Lexer::TokenType::NOT_EQUAL: return CAst::BinaryOperator::NOT_EQUAL;
+        case Lexer::TokenType::LESS: return CAst::BinaryOperator::LESS;
+        case Lexer::TokenType::GREATER: return CAst::BinaryOperator::GREATER;
+        case Lexer::TokenType::LESS_EQ: return CAst::BinaryOperator::LESS_EQ;
+        case Lexer::TokenType::GREATER_EQ: return CAst::BinaryOperator::GREATER_EQ;
+        default:
+            throw std::runtime_error("Unable to build bin exp from given token.");
+    }
+}
+
 class Parser {
 public:
     virtual auto parse() -> std::optional<std::shared_ptr<CAst::ProgramNode>> = 0;
@@ -97,16 +143,18 @@ public:
     ~RecursiveDescentParser() = default;
 private:
     Lexer::TokenStream tokens_;
+    // arena of the program being parsed, every node below the root goes here
+    CAst::Arena* arena_ = nullptr;
     std::optional<std::shared_ptr<CAst::ProgramNode>> parseProgram();
-    std::optional<std::shared_ptr<CAst::FunctionNode>> parseFunction();
-    std::optional<std::shared_ptr<CAst::TypeNode>> parseType();
-    std::optional<std::shared_ptr<CAst::FunctionArgumentsNode>> parseFunctionArguments();
-    std::optional<std::shared_ptr<CAst::StatementBlockNode>> parseStatementBlock();
-    std::optional<std::shared_ptr<CAst::StatementNode>> parseStatement();
-    std::optional<std::shared_ptr<CAst::ExpressionNode>> parseExpression(int min_precedence);
-    std::optional<std::shared_ptr<CAst::ExpressionNode>> parseFactor();
-    std::optional<std::shared_ptr<CAst::UnaryExpressionNode>> parseUnaryExpression();
-    std::optional<std::shared_ptr<CAst::ConstantValueNode>> parseConstantValue();
+    std::optional<CAst::FunctionNode*> parseFunction();
+    std::optional<CAst::TypeNode*> parseType();
+    std::optional<CAst::FunctionArgumentsNode*> parseFunctionArguments();
+    std::optional<CAst::StatementBlockNode*> parseStatementBlock();
+    std::optional<CAst::StatementNode*> parseStatement();
+    std::optional<CAst::ExpressionNode*> parseExpression(int min_precedence);
+    std::optional<CAst::ExpressionNode*> parseFactor();
+    std::optional<CAst::UnaryExpressionNode*> parseUnaryExpression();
+    std::optional<CAst::ConstantValueNode*> parseConstantValue();
 };
 
 } // namespace Parser
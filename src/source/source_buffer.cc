@@ -0,0 +1,138 @@
+#include "src/source/source_buffer.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Source {
+
+namespace {
+
+constexpr size_t kInitialStreamCapacity = 64 * 1024;
+
+std::runtime_error io_error(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+SourceBuffer SourceBuffer::from_file(const std::string& path) {
+    auto start = std::chrono::steady_clock::now();
+    SourceBuffer buffer(path == "-" ? "<stdin>" : path);
+    if (path == "-") {
+        buffer.read_stream(STDIN_FILENO);
+        buffer.stats_.io_time = std::chrono::steady_clock::now() - start;
+        return buffer;
+    }
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw io_error("Could not open input file", path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        throw io_error("Could not stat input file", path);
+    }
+    if (S_ISREG(info.st_mode) && info.st_size > 0) {
+        size_t size = static_cast<size_t>(info.st_size);
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            int saved = errno;
+            close(fd);
+            errno = saved;
+            throw io_error("Could not map input file", path);
+        }
+        madvise(mapping, size, MADV_SEQUENTIAL);
+        buffer.mapping_ = static_cast<const char*>(mapping);
+        buffer.mapping_size_ = size;
+        buffer.stats_.mapped = true;
+        buffer.stats_.bytes_read = size;
+    } else {
+        try {
+            buffer.read_stream(fd);
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+    }
+    close(fd);
+    buffer.stats_.io_time = std::chrono::steady_clock::now() - start;
+    return buffer;
+}
+
+SourceBuffer SourceBuffer::from_string(std::string text, std::string name) {
+    SourceBuffer buffer(std::move(name));
+    buffer.contents_ = std::move(text);
+    buffer.stats_.bytes_read = buffer.contents_.size();
+    return buffer;
+}
+
+// Reads straight into the owned buffer, doubling it as needed. Every byte
+// that crosses from the kernel, or moves when the buffer grows, is a copy.
+void SourceBuffer::read_stream(int fd) {
+    size_t used = 0;
+    contents_.resize(kInitialStreamCapacity);
+    while (true) {
+        if (used == contents_.size()) {
+            stats_.bytes_copied += used;
+            contents_.resize(contents_.size() * 2);
+        }
+        ssize_t count = read(fd, contents_.data() + used, contents_.size() - used);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw io_error("Could not read input file", name_);
+        }
+        if (count == 0) {
+            break;
+        }
+        used += static_cast<size_t>(count);
+    }
+    contents_.resize(used);
+    stats_.bytes_read = used;
+    stats_.bytes_copied += used;
+}
+
+void SourceBuffer::unmap() {
+    if (mapping_ != nullptr) {
+        munmap(const_cast<char*>(mapping_), mapping_size_);
+        mapping_ = nullptr;
+        mapping_size_ = 0;
+    }
+}
+
+SourceBuffer::SourceBuffer(SourceBuffer&& that)
+    : name_(std::move(that.name_)),
+      contents_(std::move(that.contents_)),
+      mapping_(that.mapping_),
+      mapping_size_(that.mapping_size_),
+      stats_(that.stats_) {
+    that.mapping_ = nullptr;
+    that.mapping_size_ = 0;
+}
+
+SourceBuffer& SourceBuffer::operator=(SourceBuffer&& that) {
+    if (this != &that) {
+        unmap();
+        name_ = std::move(that.name_);
+        contents_ = std::move(that.contents_);
+        mapping_ = that.mapping_;
+        mapping_size_ = that.mapping_size_;
+        stats_ = that.stats_;
+        that.mapping_ = nullptr;
+        that.mapping_size_ = 0;
+    }
+    return *this;
+}
+
+SourceBuffer::~SourceBuffer() {
+    unmap();
+}
+
+} // namespace Source
@@ -0,0 +1,51 @@
+#ifndef SOURCE_BUFFER_H
+#define SOURCE_BUFFER_H
+
+#include <chrono>
+#include <string>
+#include <string_view>
+
+namespace Source {
+
+// How the text got into memory, reported by the driver.
+struct LoadStats {
+    bool mapped = false;
+    size_t bytes_read = 0;
+    size_t bytes_copied = 0;
+    std::chrono::nanoseconds io_time{0};
+};
+
+// Owns the text of one compilation unit. Lexers and tokens only keep views
+// into it, so it must outlive every stage that reads the source.
+//
+// Regular files are mapped read-only and never copied. Pipes, terminals and
+// stdin ("-") cannot be mapped and are streamed into an owned buffer.
+class SourceBuffer {
+public:
+    static SourceBuffer from_file(const std::string& path);
+    static SourceBuffer from_string(std::string text, std::string name = "<string>");
+    SourceBuffer(SourceBuffer&& that);
+    SourceBuffer& operator=(SourceBuffer&& that);
+    SourceBuffer(const SourceBuffer& that) = delete;
+    SourceBuffer& operator=(const SourceBuffer& that) = delete;
+    ~SourceBuffer();
+    std::string_view text() const {
+        return mapping_ != nullptr ? std::string_view(mapping_, mapping_size_) : std::string_view(contents_);
+    }
+    const std::string& name() const { return name_; }
+    size_t size() const { return text().size(); }
+    const LoadStats& stats() const { return stats_; }
+private:
+    explicit SourceBuffer(std::string name) : name_(std::move(name)) {}
+    void read_stream(int fd);
+    void unmap();
+    std::string name_;
+    std::string contents_;
+    const char* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    LoadStats stats_;
+};
+
+} // namespace Source
+
+#endif // SOURCE_BUFFER_H
@@ -0,0 +1,46 @@
+#include "src/source/symbol.h"
+#include <cstring>
+
+namespace Source {
+
+SymbolTable& SymbolTable::global() {
+    static SymbolTable table;
+    return table;
+}
+
+SymbolTable::SymbolTable() : chunk_used_(kChunkSize) {
+    names_.push_back(std::string_view());
+    ids_.emplace(std::string_view(), 0);
+}
+
+std::string_view SymbolTable::store(std::string_view name) {
+    if (name.size() > kChunkSize / 4) {
+        // oversized names get a chunk of their own
+        chunks_.push_back(std::make_unique<char[]>(name.size()));
+        chunk_used_ = kChunkSize;
+        std::memcpy(chunks_.back().get(), name.data(), name.size());
+        return std::string_view(chunks_.back().get(), name.size());
+    }
+    if (chunk_used_ + name.size() > kChunkSize) {
+        chunks_.push_back(std::make_unique<char[]>(kChunkSize));
+        chunk_used_ = 0;
+    }
+    char* dst = chunks_.back().get() + chunk_used_;
+    std::memcpy(dst, name.data(), name.size());
+    chunk_used_ += name.size();
+    return std::string_view(dst, name.size());
+}
+
+Symbol SymbolTable::intern(std::string_view name) {
+    auto it = ids_.find(name);
+    if (it != ids_.end()) {
+        return Symbol(it->second);
+    }
+    auto stored = store(name);
+    uint32_t id = static_cast<uint32_t>(names_.size());
+    names_.push_back(stored);
+    ids_.emplace(stored, id);
+    return Symbol(id);
+}
+
+} // namespace Source
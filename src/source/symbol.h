@@ -0,0 +1,72 @@
+#ifndef SYMBOL_H
+#define SYMBOL_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Source {
+
+class SymbolTable;
+
+// Interned identifier. Equal names share one id, so comparing and hashing
+// symbols is an integer operation and the text is stored exactly once.
+class Symbol {
+public:
+    Symbol() : id_(0) {}
+    static Symbol intern(std::string_view name);
+    std::string_view str() const;
+    uint32_t id() const { return id_; }
+    bool operator==(const Symbol& that) const { return id_ == that.id_; }
+    bool operator!=(const Symbol& that) const { return id_ != that.id_; }
+private:
+    friend class SymbolTable;
+    explicit Symbol(uint32_t id) : id_(id) {}
+    uint32_t id_;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const Symbol& symbol) {
+    return os << symbol.str();
+}
+
+// Process wide intern pool. Names are copied into fixed size chunks that are
+// never reallocated, so the views handed out by str() live as long as the
+// process. Id 0 is always the empty name.
+class SymbolTable {
+public:
+    static SymbolTable& global();
+    Symbol intern(std::string_view name);
+    std::string_view name(Symbol symbol) const { return names_[symbol.id_]; }
+    size_t size() const { return names_.size(); }
+private:
+    SymbolTable();
+    static constexpr size_t kChunkSize = 64 * 1024;
+    std::string_view store(std::string_view name);
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    size_t chunk_used_;
+    std::vector<std::string_view> names_;
+    std::unordered_map<std::string_view, uint32_t> ids_;
+};
+
+inline Symbol Symbol::intern(std::string_view name) {
+    return SymbolTable::global().intern(name);
+}
+
+inline std::string_view Symbol::str() const {
+    return SymbolTable::global().name(*this);
+}
+
+} // namespace Source
+
+template <>
+struct std::hash<Source::Symbol> {
+    size_t operator()(const Source::Symbol& symbol) const noexcept {
+        return std::hash<uint32_t>()(symbol.id());
+    }
+};
+
+#endif // SYMBOL_H
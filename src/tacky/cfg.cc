@@ -0,0 +1,191 @@
+#include "src/tacky/cfg.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace Tacky {
+
+ControlFlowGraph::ControlFlowGraph(const Function& function) : label_blocks_(function.label_count_, kNoBlock) {
+    auto& instructions = function.instructions_;
+    for (uint32_t i = 0; i < instructions.size(); i++) {
+        auto op = instructions[i].op_;
+        bool leader = blocks_.empty() || op == OpCode::LABEL ||
+            (is_control(instructions[i - 1].op_) && instructions[i - 1].op_ != OpCode::LABEL);
+        if (leader) {
+            if (!blocks_.empty()) {
+                blocks_.back().end_ = i;
+            }
+            blocks_.push_back({i, i, kNoBlock, kNoBlock});
+        }
+        if (op == OpCode::LABEL) {
+            label_blocks_.at(instructions[i].src1_.label_id()) = blocks_.size() - 1;
+        }
+    }
+    if (!blocks_.empty()) {
+        blocks_.back().end_ = instructions.size();
+    }
+
+    std::vector<uint32_t> counts(blocks_.size() + 1, 0);
+    bool forward = true;
+    for (uint32_t b = 0; b < blocks_.size(); b++) {
+        auto& block = blocks_[b];
+        auto& last = instructions[block.end_ - 1];
+        if (is_jump(last.op_)) {
+            block.target_ = block_of(jump_target(last));
+            if (block.target_ == kNoBlock) {
+                throw std::runtime_error("Tacky jump to a label that isn't placed");
+            }
+            forward = forward && block.target_ > b;
+            counts[block.target_]++;
+        }
+        if (last.op_ != OpCode::RETURN && last.op_ != OpCode::JUMP && b + 1 < blocks_.size()) {
+            block.fall_through_ = b + 1;
+            counts[b + 1]++;
+        }
+    }
+    offsets_.assign(blocks_.size() + 1, 0);
+    for (uint32_t b = 0; b < blocks_.size(); b++) {
+        offsets_[b + 1] = offsets_[b] + counts[b];
+    }
+    predecessors_.resize(offsets_.back());
+    std::vector<uint32_t> filled(offsets_.begin(), offsets_.end() - 1);
+    for (uint32_t b = 0; b < blocks_.size(); b++) {
+        for (auto successor : {blocks_[b].fall_through_, blocks_[b].target_}) {
+            if (successor != kNoBlock) {
+                predecessors_[filled[successor]++] = b;
+            }
+        }
+    }
+    compute_order(forward);
+    compute_dominators();
+}
+
+// With every edge going forward the reachable blocks in their own order are
+// a reverse postorder already, and one walk down the blocks finds them.
+// Otherwise a depth first search from the entry lists each block once all
+// of its successors are done.
+void ControlFlowGraph::compute_order(bool forward) {
+    positions_.assign(blocks_.size(), kNoBlock);
+    order_.clear();
+    if (blocks_.empty()) {
+        return;
+    }
+    if (forward) {
+        std::vector<bool> reached(blocks_.size(), false);
+        reached[0] = true;
+        for (uint32_t b = 0; b < blocks_.size(); b++) {
+            if (!reached[b]) {
+                continue;
+            }
+            positions_[b] = order_.size();
+            order_.push_back(b);
+            for (auto successor : {blocks_[b].fall_through_, blocks_[b].target_}) {
+                if (successor != kNoBlock) {
+                    reached[successor] = true;
+                }
+            }
+        }
+        return;
+    }
+    // the stack holds a block and how many of its successors were pushed
+    std::vector<std::pair<uint32_t, uint32_t>> stack = {{0, 0}};
+    std::vector<bool> seen(blocks_.size(), false);
+    seen[0] = true;
+    while (!stack.empty()) {
+        auto& [block, next] = stack.back();
+        uint32_t successors[] = {blocks_[block].target_, blocks_[block].fall_through_};
+        if (next == 2) {
+            order_.push_back(block);
+            stack.pop_back();
+            continue;
+        }
+        auto successor = successors[next++];
+        if (successor != kNoBlock && !seen[successor]) {
+            seen[successor] = true;
+            stack.push_back({successor, 0});
+        }
+    }
+    std::reverse(order_.begin(), order_.end());
+    for (uint32_t i = 0; i < order_.size(); i++) {
+        positions_[order_[i]] = i;
+    }
+}
+
+// Cooper, Harvey and Kennedy's iterative algorithm, over the reverse
+// postorder. Walking up from two blocks by always moving the one further
+// down the order meets at their common dominator. Only an edge going back
+// up the order leaves a predecessor undone when its successor is visited,
+// without one the first pass settles everything.
+void ControlFlowGraph::compute_dominators() {
+    idoms_.assign(blocks_.size(), kNoBlock);
+    if (order_.empty()) {
+        return;
+    }
+    bool retreating = false;
+    for (auto b : order_) {
+        for (auto predecessor : predecessors(b)) {
+            retreating = retreating || (reachable(predecessor) && positions_[predecessor] >= positions_[b]);
+        }
+    }
+    // the entry is its own dominator while this runs
+    idoms_[0] = 0;
+    for (bool changed = true; changed; changed = changed && retreating) {
+        changed = false;
+        for (auto b : std::span(order_).subspan(1)) {
+            uint32_t idom = kNoBlock;
+            for (auto predecessor : predecessors(b)) {
+                if (idoms_[predecessor] == kNoBlock) {
+                    continue;
+                }
+                if (idom == kNoBlock) {
+                    idom = predecessor;
+                    continue;
+                }
+                auto other = predecessor;
+                while (idom != other) {
+                    while (positions_[other] > positions_[idom]) {
+                        other = idoms_[other];
+                    }
+                    while (positions_[idom] > positions_[other]) {
+                        idom = idoms_[idom];
+                    }
+                }
+            }
+            changed = changed || idom != idoms_[b];
+            idoms_[b] = idom;
+        }
+    }
+    idoms_[0] = kNoBlock;
+}
+
+std::span<const uint32_t> ControlFlowGraph::predecessors(uint32_t block) const {
+    return std::span(predecessors_).subspan(offsets_[block], offsets_[block + 1] - offsets_[block]);
+}
+
+uint32_t ControlFlowGraph::block_of(Value label) const {
+    if (!label.is_label() || label.label_id() >= label_blocks_.size()) {
+        throw std::runtime_error("Unexpected tacky label");
+    }
+    return label_blocks_[label.label_id()];
+}
+
+uint32_t ControlFlowGraph::block_containing(uint32_t instruction) const {
+    auto after = std::upper_bound(blocks_.begin(), blocks_.end(), instruction,
+        [](uint32_t position, const Block& block) { return position < block.begin_; });
+    if (after == blocks_.begin() || instruction >= (after - 1)->end_) {
+        throw std::runtime_error("Instruction outside of the function");
+    }
+    return after - blocks_.begin() - 1;
+}
+
+bool ControlFlowGraph::dominates(uint32_t a, uint32_t b) const {
+    if (!reachable(a) || !reachable(b)) {
+        return false;
+    }
+    // dominators come earlier in the order, walk up until b passes a
+    while (positions_[b] > positions_[a]) {
+        b = idoms_[b];
+    }
+    return a == b;
+}
+
+} // namespace Tacky
@@ -0,0 +1,63 @@
+#ifndef TACKY_CFG_H
+#define TACKY_CFG_H
+
+#include "src/tacky/tacky.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Tacky {
+
+// Basic blocks of a function and the edges between them. A block starts at
+// the first instruction, at a label or right after a jump or return, and
+// ends with the next jump or return or where the next block starts. Blocks
+// are numbered in instruction order. Jumps may go back, but the front end
+// only emits forward ones, and then block order is a topological order
+// that the reverse postorder and the dominators take straight from.
+class ControlFlowGraph {
+public:
+    static constexpr uint32_t kNoBlock = UINT32_MAX;
+    struct Block {
+        // the instructions [begin_, end_) of the function
+        uint32_t begin_;
+        uint32_t end_;
+        // where control goes when the block doesn't jump and where its jump
+        // goes, kNoBlock if it returns or has no jump
+        uint32_t fall_through_;
+        uint32_t target_;
+    };
+    explicit ControlFlowGraph(const Function& function);
+    const std::vector<Block>& blocks() const { return blocks_; }
+    std::span<const uint32_t> predecessors(uint32_t block) const;
+    // the block the label starts, kNoBlock if the label isn't placed
+    uint32_t block_of(Value label) const;
+    // the block holding the instruction
+    uint32_t block_containing(uint32_t instruction) const;
+    // the blocks the entry reaches in reverse postorder, where a block comes
+    // before its successors except along the back edges of loops
+    std::span<const uint32_t> reverse_postorder() const { return order_; }
+    bool reachable(uint32_t block) const { return positions_[block] != kNoBlock; }
+    // the closest block every path from the entry to block goes through,
+    // kNoBlock for the entry and for blocks the entry doesn't reach
+    uint32_t immediate_dominator(uint32_t block) const { return idoms_[block]; }
+    // whether every path from the entry to b goes through a, a block
+    // dominates itself
+    bool dominates(uint32_t a, uint32_t b) const;
+private:
+    void compute_order(bool forward);
+    void compute_dominators();
+    std::vector<Block> blocks_;
+    // predecessors of block b are predecessors_[offsets_[b], offsets_[b + 1])
+    std::vector<uint32_t> offsets_;
+    std::vector<uint32_t> predecessors_;
+    // indexed by label id
+    std::vector<uint32_t> label_blocks_;
+    std::vector<uint32_t> order_;
+    // indexed by block, where it is in order_ or kNoBlock
+    std::vector<uint32_t> positions_;
+    std::vector<uint32_t> idoms_;
+};
+
+} // namespace Tacky
+
+#endif // TACKY_CFG_H
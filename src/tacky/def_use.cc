@@ -0,0 +1,69 @@
+#include "src/tacky/def_use.h"
+
+namespace Tacky {
+
+namespace {
+
+// the phis after the first one of a run add no definition of their own
+bool defines(const std::vector<Instruction>& instructions, uint32_t i) {
+    auto& instruction = instructions[i];
+    if (!instruction.dst_.is_temporary()) {
+        return false;
+    }
+    return instruction.op_ != OpCode::PHI || i == 0 || instructions[i - 1].op_ != OpCode::PHI ||
+        instructions[i - 1].dst_ != instruction.dst_;
+}
+
+} // namespace
+
+// Counts first, then fills both tables in instruction order.
+DefUse::DefUse(const Function& function)
+    : definition_offsets_(function.temporary_count_ + 1, 0), use_offsets_(function.temporary_count_ + 1, 0) {
+    auto& instructions = function.instructions_;
+    for (uint32_t i = 0; i < instructions.size(); i++) {
+        auto& instruction = instructions[i];
+        for (auto src : {instruction.src1_, instruction.src2_}) {
+            if (src.is_temporary()) {
+                use_offsets_.at(src.temporary_id() + 1)++;
+            }
+        }
+        if (defines(instructions, i)) {
+            definition_offsets_.at(instruction.dst_.temporary_id() + 1)++;
+        }
+    }
+    for (uint32_t t = 0; t < function.temporary_count_; t++) {
+        definition_offsets_[t + 1] += definition_offsets_[t];
+        use_offsets_[t + 1] += use_offsets_[t];
+    }
+    definitions_.resize(definition_offsets_.back());
+    uses_.resize(use_offsets_.back());
+    std::vector<uint32_t> defined(definition_offsets_.begin(), definition_offsets_.end() - 1);
+    std::vector<uint32_t> used(use_offsets_.begin(), use_offsets_.end() - 1);
+    for (uint32_t i = 0; i < instructions.size(); i++) {
+        auto& instruction = instructions[i];
+        for (auto src : {instruction.src1_, instruction.src2_}) {
+            if (src.is_temporary()) {
+                uses_[used[src.temporary_id()]++] = i;
+            }
+        }
+        if (defines(instructions, i)) {
+            definitions_[defined[instruction.dst_.temporary_id()]++] = i;
+        }
+    }
+}
+
+uint32_t DefUse::definition(uint32_t temporary) const {
+    auto all = definitions(temporary);
+    return all.empty() ? kNoDefinition : all.front();
+}
+
+std::span<const uint32_t> DefUse::definitions(uint32_t temporary) const {
+    auto begin = definition_offsets_[temporary];
+    return std::span(definitions_).subspan(begin, definition_offsets_[temporary + 1] - begin);
+}
+
+std::span<const uint32_t> DefUse::uses(uint32_t temporary) const {
+    return std::span(uses_).subspan(use_offsets_[temporary], use_offsets_[temporary + 1] - use_offsets_[temporary]);
+}
+
+} // namespace Tacky
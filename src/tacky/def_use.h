@@ -0,0 +1,36 @@
+#ifndef TACKY_DEF_USE_H
+#define TACKY_DEF_USE_H
+
+#include "src/tacky/tacky.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Tacky {
+
+// Def-use chains of a function: the instructions defining each temporary
+// and the instructions reading it, in instruction order. An instruction
+// reading a temporary twice is listed twice. The run of phis joining one
+// temporary is a single definition, at its first instruction. In SSA form
+// every temporary has exactly one definition, out of it one may have any
+// number.
+class DefUse {
+public:
+    static constexpr uint32_t kNoDefinition = UINT32_MAX;
+    explicit DefUse(const Function& function);
+    // the first definition, kNoDefinition if nothing defines the temporary
+    uint32_t definition(uint32_t temporary) const;
+    std::span<const uint32_t> definitions(uint32_t temporary) const;
+    std::span<const uint32_t> uses(uint32_t temporary) const;
+private:
+    // the definitions of temporary t are definitions_[definition_offsets_[t],
+    // definition_offsets_[t + 1]), and the same for its uses
+    std::vector<uint32_t> definition_offsets_;
+    std::vector<uint32_t> definitions_;
+    std::vector<uint32_t> use_offsets_;
+    std::vector<uint32_t> uses_;
+};
+
+} // namespace Tacky
+
+#endif // TACKY_DEF_USE_H
@@ -0,0 +1,73 @@
+#include "src/tacky/liveness.h"
+#include <algorithm>
+
+namespace Tacky {
+
+// Each block reads what it uses before writing it itself, and kills what it
+// writes. The phi operands coming in from a block are read at its end, so
+// they go straight into its live out set.
+Liveness::Liveness(const Function& function, const ControlFlowGraph& cfg)
+    : words_((function.temporary_count_ + 63) / 64) {
+    auto& blocks = cfg.blocks();
+    auto& instructions = function.instructions_;
+    std::vector<uint64_t> reads(blocks.size() * words_, 0);
+    std::vector<uint64_t> kills(blocks.size() * words_, 0);
+    std::vector<uint64_t> phi_reads(blocks.size() * words_, 0);
+    auto set = [](std::span<uint64_t> row, uint32_t temporary) {
+        row[temporary / 64] |= uint64_t{1} << (temporary % 64);
+    };
+    auto has = [](std::span<uint64_t> row, uint32_t temporary) {
+        return (row[temporary / 64] >> (temporary % 64)) & 1;
+    };
+    for (uint32_t b = 0; b < blocks.size(); b++) {
+        auto read = row(reads, b);
+        auto killed = row(kills, b);
+        for (uint32_t i = blocks[b].begin_; i < blocks[b].end_; i++) {
+            auto& instruction = instructions[i];
+            if (instruction.op_ == OpCode::PHI) {
+                if (instruction.src1_.is_temporary()) {
+                    set(row(phi_reads, cfg.block_of(instruction.src2_)), instruction.src1_.temporary_id());
+                }
+            } else {
+                for (auto src : {instruction.src1_, instruction.src2_}) {
+                    if (src.is_temporary() && !has(killed, src.temporary_id())) {
+                        set(read, src.temporary_id());
+                    }
+                }
+            }
+            if (instruction.dst_.is_temporary()) {
+                set(killed, instruction.dst_.temporary_id());
+            }
+        }
+    }
+
+    live_in_.assign(blocks.size() * words_, 0);
+    live_out_.assign(blocks.size() * words_, 0);
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (uint32_t b = blocks.size(); b-- > 0;) {
+            auto out = row(live_out_, b);
+            auto phi_read = row(phi_reads, b);
+            std::copy(phi_read.begin(), phi_read.end(), out.begin());
+            for (auto successor : {blocks[b].fall_through_, blocks[b].target_}) {
+                if (successor == ControlFlowGraph::kNoBlock) {
+                    continue;
+                }
+                auto next = row(live_in_, successor);
+                for (size_t w = 0; w < words_; w++) {
+                    out[w] |= next[w];
+                }
+            }
+            auto in = row(live_in_, b);
+            auto read = row(reads, b);
+            auto killed = row(kills, b);
+            for (size_t w = 0; w < words_; w++) {
+                auto word = read[w] | (out[w] & ~killed[w]);
+                changed = changed || word != in[w];
+                in[w] = word;
+            }
+        }
+    }
+}
+
+} // namespace Tacky
@@ -0,0 +1,39 @@
+#ifndef TACKY_LIVENESS_H
+#define TACKY_LIVENESS_H
+
+#include "src/tacky/cfg.h"
+#include "src/tacky/tacky.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Tacky {
+
+// Which temporaries hold a value read later on, at the start and at the
+// end of every block of a function. A phi reads its operand at the end of
+// the predecessor it comes from, not in its own block, and defines its
+// temporary at the start of its block, so that one is never live in there.
+//
+// Jumps may go back, so the sets are worked out backwards over the blocks
+// until they stop changing.
+class Liveness {
+public:
+    Liveness(const Function& function, const ControlFlowGraph& cfg);
+    bool live_in(uint32_t block, uint32_t temporary) const { return test(live_in_, block, temporary); }
+    bool live_out(uint32_t block, uint32_t temporary) const { return test(live_out_, block, temporary); }
+private:
+    bool test(const std::vector<uint64_t>& sets, uint32_t block, uint32_t temporary) const {
+        return (sets[block * words_ + temporary / 64] >> (temporary % 64)) & 1;
+    }
+    std::span<uint64_t> row(std::vector<uint64_t>& sets, uint32_t block) {
+        return std::span(sets).subspan(block * words_, words_);
+    }
+    size_t words_;
+    // one row of words_ per block, temporary t is bit t % 64 of word t / 64
+    std::vector<uint64_t> live_in_;
+    std::vector<uint64_t> live_out_;
+};
+
+} // namespace Tacky
+
+#endif // TACKY_LIVENESS_H
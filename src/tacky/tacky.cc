@@ -0,0 +1,40 @@
+#include "src/tacky/tacky.h"
+#include <stdexcept>
+
+namespace Tacky {
+
+std::string opcode_as_str(OpCode op) {
+    switch (op) {
+        case OpCode::RETURN: return "Return";
+        case OpCode::COPY: return "Copy";
+        case OpCode::COMPLEMENT: return "Complement";
+        case OpCode::NEGATE: return "Negate";
+        case OpCode::NOT: return "Not";
+        case OpCode::MULT: return "Mult";
+        case OpCode::DIV: return "Div";
+        case OpCode::MOD: return "Mod";
+        case OpCode::PLUS: return "Plus";
+        case OpCode::MINUS: return "Minus";
+        case OpCode::BITWISE_AND: return "BitwiseAnd";
+        case OpCode::BITWISE_OR: return "BitwiseOr";
+        case OpCode::BITWISE_XOR: return "BitwiseXor";
+        case OpCode::LEFT_SHIFT: return "LeftShift";
+        case OpCode::RIGHT_SHIFT: return "RightShift";
+        case OpCode::AND: return "And";
+        case OpCode::OR: return "Or";
+        case OpCode::EQUAL: return "Equal";
+        case OpCode::NOT_EQUAL: return "NotEqual";
+        case OpCode::LESS: return "Less";
+        case OpCode::LESS_EQ: return "LessEq";
+        case OpCode::GREATER: return "Greater";
+        case OpCode::GREATER_EQ: return "GreaterEq";
+        case OpCode::PHI: return "Phi";
+        case OpCode::LABEL: return "Label";
+        case OpCode::JUMP: return "Jump";
+        case OpCode::JUMP_IF_ZERO: return "JumpIfZero";
+        case OpCode::JUMP_IF_NOT_ZERO: return "JumpIfNotZero";
+    }
+    throw std::runtime_error("Unexpected tacky opcode");
+}
+
+} // namespace Tacky
@@ -1,266 +1,157 @@
 #ifndef TACKY_H
 #define TACKY_H
 
-#include "src/ast/ast.h"
+#include "src/source/symbol.h"
+#include <cstdint>
 #include <string>
 #include <vector>
-#include <memory>
 
 namespace Tacky {
 
-class Visitor;
-class AstNode;
-class ProgramNode;
-class FunctionNode;
-class InstructionNode;
-class ReturnNode;
-class UnaryNode;
-class ComplementNode;
-class NotNode;
-class NegateNode;
-class ValueNode;
-class IntegerNode;
-class VariableNode;
-class BinaryOpNode;
-class DivNode;
-class ModNode;
-class MultNode;
-class PlusNode;
-class MinusNode;
-class AndNode;
-class BitwiseAndNode;
-class OrNode;
-class BitwiseOrNode;
-class BitwiseXorNode;
-class BitwiseLeftShiftNode;
-class BitwiseRightShiftNode;
-
-class Visitor {
-public:
-    virtual ~Visitor() = default;
-    virtual void visit(ProgramNode& node) = 0;
-    virtual void visit(FunctionNode& node) = 0;
-    virtual void visit(ReturnNode& node) = 0;
-    virtual void visit(ComplementNode& node) = 0;
-    virtual void visit(NegateNode& node) = 0;
-    virtual void visit(IntegerNode& node) = 0;
-    virtual void visit(VariableNode& node) = 0;
-    virtual void visit(DivNode& node) = 0;
-    virtual void visit(ModNode& node) = 0;
-    virtual void visit(MultNode& node) = 0;
-    virtual void visit(PlusNode& node) = 0;
-    virtual void visit(MinusNode& node) = 0;
-    virtual void visit(Tacky::NotNode& node) = 0;
-    virtual void visit(Tacky::AndNode& node) = 0;
-    virtual void visit(Tacky::BitwiseAndNode& node) = 0;
-    virtual void visit(Tacky::OrNode& node) = 0;
-    virtual void visit(Tacky::BitwiseOrNode& node) = 0;
-    virtual void visit(Tacky::BitwiseLeftShiftNode& node) = 0;
-    virtual void visit(Tacky::BitwiseRightShiftNode& node) = 0;
-    virtual void visit(Tacky::BitwiseXorNode& node) = 0;
-};
-
-
-class AstNode {
-public:
-    virtual ~AstNode() = default;
-    AstNode() = default;
-    AstNode(AstNode&& that) = delete;
-    AstNode operator=(AstNode&& that) = delete;
-    AstNode(AstNode& that) = delete;
-    AstNode operator=(AstNode& that) = delete;   
-    virtual void accept(Visitor& v) = 0;
-};
-
-class ProgramNode : public AstNode {
-public:
-    ProgramNode(std::vector<std::shared_ptr<FunctionNode>> functions) : functions_(std::move(functions)) {}
-    ~ProgramNode() = default;
-    void accept(Visitor& v) override { v.visit(*this); }
-    std::vector<std::shared_ptr<FunctionNode>> functions_;
-};
-
-class FunctionNode : public AstNode {
-public:
-    FunctionNode(std::string name, std::vector<std::shared_ptr<InstructionNode>> instructions) : 
-        name_(std::move(name)), instructions_(std::move(instructions)) {}
-    ~FunctionNode() = default;
-    void accept(Visitor& v) override { v.visit(*this); }
-    std::string name_;
-    std::vector<std::shared_ptr<InstructionNode>> instructions_;
-};
-
-class InstructionNode : public AstNode {
-public:
-    virtual ~InstructionNode() = default;
-    virtual void accept(Visitor& v) = 0;
-};
-
-class ReturnNode : public InstructionNode {
-public:
-    ~ReturnNode() = default;
-    ReturnNode(std::shared_ptr<ValueNode> value) : value_(std::move(value)) {}
-    void accept(Visitor& v) override { v.visit(*this); }
-    std::shared_ptr<ValueNode> value_;
-};
-
-class UnaryNode : public InstructionNode {
-public:
-    virtual ~UnaryNode() = default;
-    UnaryNode(std::shared_ptr<ValueNode> src, std::shared_ptr<ValueNode> dst)
-        :src_(std::move(src)), dst_(std::move(dst)) {}
-    virtual void accept(Visitor& v) = 0;
-    std::shared_ptr<ValueNode> src_, dst_;
-};
-
-class ComplementNode : public UnaryNode {
-public:
-    ~ComplementNode() = default;
-    ComplementNode(std::shared_ptr<ValueNode> src, std::shared_ptr<ValueNode> dst) : UnaryNode(src, dst) {}
-    void accept(Visitor& v) override { v.visit(*this); }
-};
-
-class NegateNode : public UnaryNode {
-public:
-    ~NegateNode() = default;
-    NegateNode(std::shared_ptr<ValueNode> src, std::shared_ptr<ValueNode> dst) : UnaryNode(src, dst) {}
-    void accept(Visitor& v) override { v.visit(*this); }
-};
-
-class NotNode : public UnaryNode {
-public:
-    ~NotNode() = default;
-    NotNode(std::shared_ptr<ValueNode> src, std::shared_ptr<ValueNode> dst) : UnaryNode(src, dst) {}
-    void accept(Visitor& v) override {v.visit(*this);}  
-};
-
-class BinaryOpNode : public InstructionNode {
-public:
-    std::shared_ptr<ValueNode> left_, right_, dst_;
-    ~BinaryOpNode() = default;
-    BinaryOpNode(std::shared_ptr<ValueNode> left, std::shared_ptr<ValueNode> right, std::shared_ptr<ValueNode> dst)
-        : left_(left), right_(right), dst_(dst) {}
-    virtual void accept(Visitor& v) = 0;
-};
-
-class DivNode : public BinaryOpNode {
-public:
-    ~DivNode() = default;
-    DivNode(std::shared_ptr<ValueNode> left, std::shared_ptr<ValueNode> right, std::shared_ptr<ValueNode> dst)
-        : BinaryOpNode(left, right, dst) {}
-    void accept(Visitor& v) {v.visit(*this);}
-};
-
-class ModNode : public BinaryOpNode {
-public:
-    ~ModNode() = default;
-    ModNode(std::shared_ptr<ValueNode> left, std::shared_ptr<ValueNode> right, std::shared_ptr<ValueNode> dst)
-        : BinaryOpNode(left, right, dst) {}
-    void accept(Visitor& v) {v.visit(*this);}
-};
-
-class MultNode : public BinaryOpNode {
-public:
-    ~MultNode() = default;
-    MultNode(std::shared_ptr<ValueNode> left, std::shared_ptr<ValueNode> right, std::shared_ptr<ValueNode> dst)
-        : BinaryOpNode(left, right, dst) {}
-    void accept(Visitor& v) {v.visit(*this);}
-};
-
-class MinusNode : public BinaryOpNode {
-public:
-    ~MinusNode() = default;
-    MinusNode(std::shared_ptr<ValueNode> left, std::shared_ptr<ValueNode> right, std::shared_ptr<ValueNode> dst)
-        : BinaryOpNode(left, right, dst) {}
-    void accept(Visitor& v) {v.visit(*this);}
-};
-
-class PlusNode : public BinaryOpNode {
-public:
-    ~PlusNode() = default;
-    PlusNode(std::shared_ptr<ValueNode> left, std::shared_ptr<ValueNode> right, std::shared_ptr<ValueNode> dst)
-        : BinaryOpNode(left, right, dst) {}
-    void accept(Visitor& v) {v.visit(*this);}
-};
-
-class AndNode : public BinaryOpNode {
-public:
-    ~AndNode() = default;
-    AndNode(std::shared_ptr<ValueNode> left, std::shared_ptr<ValueNode> right, std::shared_ptr<ValueNode> dst)
-        : BinaryOpNode(left, right, dst) {}
-    void accept(Visitor& v) {v.visit(*this);}
-};
-
-class BitwiseAndNode : public BinaryOpNode {
-public:
-    ~BitwiseAndNode() = default;
-    BitwiseAndNode(std::shared_ptr<ValueNode> left, std::shared_ptr<ValueNode> right, std::shared_ptr<ValueNode> dst)
-        : BinaryOpNode(left, right, dst) {}
-    void accept(Visitor& v) {v.visit(*this);}
-};
-
-class OrNode : public BinaryOpNode {
-public:
-    ~OrNode() = default;
-    OrNode(std::shared_ptr<ValueNode> left, std::shared_ptr<ValueNode> right, std::shared_ptr<ValueNode> dst)
-        : BinaryOpNode(left, right, dst) {}
-    void accept(Visitor& v) {v.visit(*this);}
-};
-
-class BitwiseOrNode : public BinaryOpNode {
-public:
-    ~BitwiseOrNode() = default;
-    BitwiseOrNode(std::shared_ptr<ValueNode> left, std::shared_ptr<ValueNode> right, std::shared_ptr<ValueNode> dst)
-        : BinaryOpNode(left, right, dst) {}
-    void accept(Visitor& v) {v.visit(*this);}
-};
-
-class BitwiseXorNode : public BinaryOpNode {
-public:
-    ~BitwiseXorNode() = default;
-    BitwiseXorNode(std::shared_ptr<ValueNode> left, std::shared_ptr<ValueNode> right, std::shared_ptr<ValueNode> dst)
-        : BinaryOpNode(left, right, dst) {}
-    void accept(Visitor& v) {v.visit(*this);}
-};
-
-class BitwiseLeftShiftNode : public BinaryOpNode {
-public:
-    ~BitwiseLeftShiftNode() = default;
-    BitwiseLeftShiftNode(std::shared_ptr<ValueNode> left, std::shared_ptr<ValueNode> right, std::shared_ptr<ValueNode> dst)
-        : BinaryOpNode(left, right, dst) {}
-    void accept(Visitor& v) {v.visit(*this);}
-};
-
-class BitwiseRightShiftNode : public BinaryOpNode {
-public:
-    ~BitwiseRightShiftNode() = default;
-    BitwiseRightShiftNode(std::shared_ptr<ValueNode> left, std::shared_ptr<ValueNode> right, std::shared_ptr<ValueNode> dst)
-        : BinaryOpNode(left, right, dst) {}
-    void accept(Visitor& v) {v.visit(*this);}
-};
-
-class ValueNode : public AstNode {
-public:
-    virtual ~ValueNode() = default;
-    virtual void accept(Visitor& v) = 0;
-};
-
-class IntegerNode : public ValueNode {
-public:
-    ~IntegerNode() = default;
-    IntegerNode(int value) : value_(value) {}
-    void accept(Visitor& v) override { v.visit(*this); }
-    int value_;
-};
-
-class VariableNode : public ValueNode {
-public:
-    ~VariableNode() = default;
-    VariableNode(std::string name) : name_(std::move(name)) {}
-    void accept(Visitor& v) override { v.visit(*this); }
-    std::string name_;
+// Tacky is a linear three address code. A function is a flat array of
+// fixed size instructions whose operands are constants or temporaries,
+// and temporaries are numbered densely from zero in every function, and so
+// are labels.
+//
+// The front end only emits jumps going forward, so the order of its
+// instructions is a topological order of the control flow graph, and every
+// temporary is defined once by an instruction coming before its uses. A
+// use isn't always reached through its definition: the && or || joining a
+// right operand that was jumped over still reads it, on a path where its
+// value can't change the result.
+//
+// The optimizer doesn't count on the order and takes jumps going back as
+// well, up to the block layout. The ASM passes after it still need every
+// jump to go forward.
+//
+// Out of SSA form a temporary may be written any number of times. In SSA
+// form, which the optimizer works on, each one is written once, every use
+// is dominated by its definition and values meet at joins through phis.
+
+enum class OpCode : uint8_t {
+    RETURN,
+    // dst = src1
+    COPY,
+    COMPLEMENT,
+    NEGATE,
+    NOT,
+    MULT,
+    DIV,
+    MOD,
+    PLUS,
+    MINUS,
+    BITWISE_AND,
+    BITWISE_OR,
+    BITWISE_XOR,
+    LEFT_SHIFT,
+    RIGHT_SHIFT,
+    // logical ops, both operands are always evaluated and dst is 0 or 1
+    AND,
+    OR,
+    EQUAL,
+    NOT_EQUAL,
+    LESS,
+    LESS_EQ,
+    GREATER,
+    GREATER_EQ,
+    // dst = src1 when control came from the block labeled src2, NONE where
+    // the value is undefined. A phi is a run of these with the same dst,
+    // one per predecessor, right after the label of its block. Only in SSA
+    // form.
+    PHI,
+    // control flow, the label is src1 for LABEL and JUMP and src2 for the
+    // conditional jumps, whose condition is src1
+    LABEL,
+    JUMP,
+    JUMP_IF_ZERO,
+    JUMP_IF_NOT_ZERO,
+};
+
+std::string opcode_as_str(OpCode op);
+
+inline bool is_unary(OpCode op) {
+    return op == OpCode::COPY || op == OpCode::COMPLEMENT || op == OpCode::NEGATE || op == OpCode::NOT;
+}
+
+inline bool is_commutative(OpCode op) {
+    return op == OpCode::MULT || op == OpCode::PLUS || op == OpCode::BITWISE_AND || op == OpCode::BITWISE_OR ||
+        op == OpCode::BITWISE_XOR || op == OpCode::AND || op == OpCode::OR || op == OpCode::EQUAL ||
+        op == OpCode::NOT_EQUAL;
+}
+
+// ops that don't define a dst
+inline bool is_control(OpCode op) {
+    return op == OpCode::RETURN || op >= OpCode::LABEL;
+}
+
+inline bool is_jump(OpCode op) {
+    return op == OpCode::JUMP || op == OpCode::JUMP_IF_ZERO || op == OpCode::JUMP_IF_NOT_ZERO;
+}
+
+inline bool is_comparison(OpCode op) {
+    return op >= OpCode::EQUAL && op <= OpCode::GREATER_EQ;
+}
+
+// Tagged operand: an int constant, a temporary index or a label index.
+// Unused operand slots hold NONE.
+class Value {
+public:
+    enum class Kind : uint8_t {
+        NONE,
+        CONSTANT,
+        TEMPORARY,
+        LABEL,
+    };
+    Value() : kind_(Kind::NONE), payload_(0) {}
+    static Value constant(int value) { return Value(Kind::CONSTANT, static_cast<uint32_t>(value)); }
+    static Value temporary(uint32_t id) { return Value(Kind::TEMPORARY, id); }
+    static Value label(uint32_t id) { return Value(Kind::LABEL, id); }
+    Kind kind() const { return kind_; }
+    bool is_none() const { return kind_ == Kind::NONE; }
+    bool is_constant() const { return kind_ == Kind::CONSTANT; }
+    bool is_temporary() const { return kind_ == Kind::TEMPORARY; }
+    bool is_label() const { return kind_ == Kind::LABEL; }
+    int constant_value() const { return static_cast<int>(payload_); }
+    uint32_t temporary_id() const { return payload_; }
+    uint32_t label_id() const { return payload_; }
+    // kind and payload packed together, for hashing and ordering
+    uint64_t bits() const { return (static_cast<uint64_t>(kind_) << 32) | payload_; }
+    bool operator==(const Value& that) const { return kind_ == that.kind_ && payload_ == that.payload_; }
+    bool operator!=(const Value& that) const { return !(*this == that); }
+private:
+    Value(Kind kind, uint32_t payload) : kind_(kind), payload_(payload) {}
+    Kind kind_;
+    uint32_t payload_;
+};
+
+// dst = src1 op src2 for binary ops, dst = op src1 for unary ones, and
+// return src1 for RETURN.
+struct Instruction {
+    OpCode op_;
+    Value dst_;
+    Value src1_;
+    Value src2_;
+};
+
+// the label a jump goes to
+inline Value jump_target(const Instruction& instruction) {
+    return instruction.op_ == OpCode::JUMP ? instruction.src1_ : instruction.src2_;
+}
+
+static_assert(sizeof(Value) == 8);
+static_assert(sizeof(Instruction) <= 32);
+
+struct Function {
+    Source::Symbol name_;
+    uint32_t temporary_count_ = 0;
+    std::vector<Instruction> instructions_;
+    uint32_t label_count_ = 0;
+};
+
+struct Program {
+    std::vector<Function> functions_;
 };
 
 } // namespace Tacky
 
-#endif // TACKY_H
\ No newline at end of file
+#endif // TACKY_H
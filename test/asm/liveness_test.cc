@@ -0,0 +1,167 @@
+#include "gtest/gtest.h"
+#include "src/asm/asm_ast.h"
+#include "src/asm/liveness.h"
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace ASM {
+
+Function function_of(std::vector<Instruction> instructions, uint32_t pseudo_count = 0) {
+    return Function{Source::Symbol::intern("main"), pseudo_count, std::move(instructions)};
+}
+
+// the sets and chains of every location, as lists. A location past the
+// ones the liveness knows about is never live or touched, that's a stack
+// slot the function no longer uses.
+std::vector<std::vector<uint32_t>> everything(const Liveness& liveness, uint32_t location_count, size_t size) {
+    std::vector<std::vector<uint32_t>> lists;
+    for (uint32_t l = 0; l < location_count; l++) {
+        lists.emplace_back();
+        for (uint32_t i = 0; i <= size && l < liveness.location_count(); i++) {
+            if (liveness.live_in(i, l)) {
+                lists.back().push_back(i);
+            }
+        }
+        for (auto chain : {&Liveness::uses, &Liveness::definitions}) {
+            auto positions = l < liveness.location_count() ? (liveness.*chain)(l) : std::span<const uint32_t>();
+            lists.emplace_back(positions.begin(), positions.end());
+        }
+    }
+    return lists;
+}
+
+TEST(LivenessTest, FollowsBothWaysOutOfAJump) {
+    auto si = Operand::reg(Register::SI);
+    auto di = Operand::reg(Register::DI);
+    auto ax = Operand::reg(Register::AX);
+    auto function = function_of({
+        {OpCode::MOV, Operand::imm(1), si},
+        {OpCode::CMP, Operand::imm(0), di},
+        {OpCode::MOV, Operand::imm(0), ax},
+        {OpCode::JE, Operand::label(0)},
+        {OpCode::MOV, Operand::imm(2), si},
+        {OpCode::LABEL, Operand::label(0)},
+        {OpCode::ADD, si, ax},
+        {OpCode::RET},
+    });
+    Liveness liveness(function);
+    auto si_at = liveness.location(si);
+    auto flags = Liveness::kFlags;
+    // si is read when the jump is taken, the flags only by the je
+    EXPECT_TRUE(liveness.live_out(0, si_at));
+    EXPECT_TRUE(liveness.live_in(3, si_at));
+    EXPECT_FALSE(liveness.live_in(4, si_at));
+    EXPECT_TRUE(liveness.live_out(4, si_at));
+    EXPECT_TRUE(liveness.live_out(2, flags));
+    EXPECT_FALSE(liveness.live_in(1, flags));
+    EXPECT_FALSE(liveness.live_out(3, flags));
+    // ret reads ax and nothing is live after it
+    EXPECT_TRUE(liveness.live_in(7, Register::AX));
+    EXPECT_FALSE(liveness.live_out(7, Register::AX));
+    EXPECT_FALSE(liveness.live_in(8, Register::AX));
+    EXPECT_FALSE(liveness.live_in(0, Register::AX));
+    EXPECT_TRUE(liveness.live_in(0, liveness.location(di)));
+}
+
+TEST(LivenessTest, ChainsDefinitionsToUses) {
+    auto ax = Operand::reg(Register::AX);
+    auto r10 = Operand::reg(Register::R10);
+    auto r10b = Operand::reg(Register::R10b);
+    auto slot = Operand::stack(-8);
+    auto function = function_of({
+        {OpCode::MOV, Operand::pseudo(0), ax},
+        {OpCode::CDQ},
+        {OpCode::MOV, Operand::imm(3), r10},
+        {OpCode::DIV, r10},
+        {OpCode::CMP, Operand::imm(0), ax},
+        {OpCode::SETE, Operand(), r10b},
+        {OpCode::MOV, r10, slot},
+        {OpCode::MOV, slot, ax},
+        {OpCode::RET},
+    }, 1);
+    Liveness liveness(function);
+    EXPECT_EQ(liveness.location(r10b), liveness.location(r10));
+    EXPECT_EQ(liveness.location(Operand::imm(3)), Liveness::kNoLocation);
+    EXPECT_EQ(liveness.location_count(), Liveness::kFlags + 1 + 1 + 2);
+    auto positions = [](std::span<const uint32_t> span) { return std::vector<uint32_t>(span.begin(), span.end()); };
+    using Positions = std::vector<uint32_t>;
+    EXPECT_EQ(positions(liveness.definitions(Register::AX)), (Positions{0, 3, 7}));
+    EXPECT_EQ(positions(liveness.uses(Register::AX)), (Positions{1, 3, 4, 8}));
+    EXPECT_EQ(positions(liveness.definitions(Register::DX)), (Positions{1, 3}));
+    // the setcc only writes the low byte, so it reads r10 as well
+    EXPECT_EQ(positions(liveness.definitions(Register::R10)), (Positions{2, 5}));
+    EXPECT_EQ(positions(liveness.uses(Register::R10)), (Positions{3, 5, 6}));
+    EXPECT_EQ(positions(liveness.definitions(Liveness::kFlags)), (Positions{3, 4}));
+    EXPECT_EQ(positions(liveness.uses(Liveness::kFlags)), (Positions{5}));
+    EXPECT_EQ(positions(liveness.uses(liveness.location(Operand::pseudo(0)))), (Positions{0}));
+    EXPECT_EQ(positions(liveness.definitions(liveness.location(slot))), (Positions{6}));
+    EXPECT_EQ(positions(liveness.uses(liveness.location(slot))), (Positions{7}));
+    EXPECT_TRUE(liveness.uses(liveness.location(Operand::stack(-4))).empty());
+}
+
+TEST(LivenessTest, UpdatesMatchRecomputing) {
+    std::mt19937 random(5);
+    std::vector<Operand> operands = {
+        Operand::reg(Register::AX), Operand::reg(Register::DX), Operand::reg(Register::SI),
+        Operand::reg(Register::R10), Operand::reg(Register::R10b), Operand::stack(-4),
+        Operand::stack(-8), Operand::pseudo(0), Operand::pseudo(1),
+    };
+    std::vector<OpCode> ops = {
+        OpCode::MOV, OpCode::MOVB, OpCode::ADD, OpCode::NEG, OpCode::CMP, OpCode::SETL,
+        OpCode::CDQ, OpCode::DIV, OpCode::BITWISE_XOR, OpCode::SAL,
+    };
+    auto pick = [&](const auto& from) { return from[random() % from.size()]; };
+    auto instruction = [&]() {
+        auto src = random() % 8 ? pick(operands) : Operand::imm(7);
+        return Instruction{pick(ops), src, pick(operands)};
+    };
+    // labels every fourth instruction, jumps to the next two right before
+    std::vector<Instruction> instructions;
+    for (uint32_t i = 0; i < 64; i++) {
+        if (i % 4 == 0) {
+            instructions.push_back({OpCode::LABEL, Operand::label(i / 4)});
+        } else if (i % 4 == 3) {
+            instructions.push_back({random() % 2 ? OpCode::JMP : OpCode::JL, Operand::label(i / 4 + 1 + random() % 2)});
+        } else {
+            instructions.push_back(instruction());
+        }
+    }
+    instructions.push_back({OpCode::LABEL, Operand::label(16)});
+    instructions.push_back({OpCode::LABEL, Operand::label(17)});
+    instructions.push_back({OpCode::RET});
+    auto function = function_of(instructions, 2);
+    Liveness liveness(function);
+    for (int edit = 0; edit < 500; edit++) {
+        uint32_t position = random() % instructions.size();
+        auto& edited = function.instructions_[position];
+        if (edited.op_ == OpCode::LABEL || edited.op_ == OpCode::RET) {
+            continue;
+        }
+        if (edited.op_ == OpCode::JMP || is_jcc(edited.op_)) {
+            edited.op_ = random() % 2 ? OpCode::JMP : OpCode::JGE;
+        } else {
+            edited = random() % 4 ? instruction() : Instruction{OpCode::RET};
+        }
+        liveness.update(position);
+        Liveness recomputed(function);
+        ASSERT_EQ(everything(liveness, liveness.location_count(), instructions.size()),
+            everything(recomputed, liveness.location_count(), instructions.size()));
+    }
+}
+
+TEST(LivenessTest, RejectsJumpsBackwards) {
+    auto function = function_of({
+        {OpCode::LABEL, Operand::label(0)},
+        {OpCode::JMP, Operand::label(0)},
+        {OpCode::RET},
+    });
+    EXPECT_THROW(Liveness{function}, std::runtime_error);
+}
+
+} // namespace ASM
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
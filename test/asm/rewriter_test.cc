@@ -0,0 +1,127 @@
+#include "gtest/gtest.h"
+#include "src/asm/asm_ast.h"
+#include "src/asm/rewriter.h"
+#include <random>
+#include <vector>
+
+namespace ASM {
+
+// instructions told apart by their immediate
+Instruction numbered(int n) {
+    return Instruction{OpCode::MOV, Operand::imm(n), Operand::reg(Register::AX)};
+}
+
+std::vector<int> numbers_of(const std::vector<Instruction>& instructions) {
+    std::vector<int> numbers;
+    for (auto& instruction : instructions) {
+        numbers.push_back(instruction.src_.imm_value());
+    }
+    return numbers;
+}
+
+std::vector<Instruction> numbered_list(int count) {
+    std::vector<Instruction> instructions;
+    for (int i = 0; i < count; i++) {
+        instructions.push_back(numbered(i));
+    }
+    return instructions;
+}
+
+TEST(RewriterTest, KeepingEverythingLeavesTheListAlone) {
+    auto instructions = numbered_list(100);
+    auto data = instructions.data();
+    {
+        Rewriter rewriter(instructions);
+        while (!rewriter.at_end()) {
+            rewriter.keep();
+        }
+    }
+    EXPECT_EQ(instructions.data(), data);
+    EXPECT_EQ(numbers_of(instructions), numbers_of(numbered_list(100)));
+}
+
+TEST(RewriterTest, EditsThroughCurrentStayInPlace) {
+    auto instructions = numbered_list(3);
+    Rewriter rewriter(instructions);
+    rewriter.current().dst_ = Operand::stack(-4);
+    rewriter.keep();
+    rewriter.finish();
+    EXPECT_EQ(instructions.size(), 3);
+    EXPECT_EQ(instructions[0].dst_, Operand::stack(-4));
+    EXPECT_EQ(instructions[1].dst_, Operand::reg(Register::AX));
+}
+
+TEST(RewriterTest, InsertEraseAndReplace) {
+    auto instructions = numbered_list(5);
+    {
+        Rewriter rewriter(instructions);
+        rewriter.insert(numbered(100));
+        rewriter.keep();                                // 0
+        rewriter.erase();                               // 1
+        rewriter.replace({numbered(20), numbered(21)}); // 2
+        rewriter.replace({});                           // 3
+        rewriter.insert(numbered(101));
+        rewriter.keep();                                // 4
+        EXPECT_TRUE(rewriter.at_end());
+        rewriter.insert(numbered(102));
+    }
+    EXPECT_EQ(numbers_of(instructions), (std::vector<int>{100, 0, 20, 21, 101, 4, 102}));
+}
+
+TEST(RewriterTest, FinishingEarlyKeepsTheUnreadTail) {
+    auto instructions = numbered_list(6);
+    Rewriter rewriter(instructions);
+    rewriter.replace({numbered(10), numbered(11), numbered(12)});
+    rewriter.erase();
+    rewriter.finish();
+    EXPECT_EQ(numbers_of(instructions), (std::vector<int>{10, 11, 12, 2, 3, 4, 5}));
+    // the cursor can carry on after a finish
+    rewriter.keep();
+    rewriter.erase();
+    rewriter.finish();
+    EXPECT_EQ(numbers_of(instructions), (std::vector<int>{10, 11, 12, 2, 4, 5}));
+}
+
+TEST(RewriterTest, MatchesRebuildingOnRandomEdits) {
+    std::mt19937 rng(1234);
+    for (int round = 0; round < 200; round++) {
+        int size = std::uniform_int_distribution<int>(0, 300)(rng);
+        auto instructions = numbered_list(size);
+        std::vector<int> expected;
+        int next = 1000;
+        Rewriter rewriter(instructions);
+        for (int i = 0; i < size; i++) {
+            switch (std::uniform_int_distribution<int>(0, 3)(rng)) {
+                case 0:
+                    rewriter.keep();
+                    expected.push_back(i);
+                    break;
+                case 1:
+                    rewriter.erase();
+                    break;
+                case 2: {
+                    ASSERT_EQ(rewriter.current().src_.imm_value(), i);
+                    rewriter.replace({numbered(next), numbered(next + 1), numbered(next + 2)});
+                    expected.insert(expected.end(), {next, next + 1, next + 2});
+                    next += 3;
+                    break;
+                }
+                case 3:
+                    rewriter.insert(numbered(next));
+                    rewriter.keep();
+                    expected.insert(expected.end(), {next, i});
+                    next++;
+                    break;
+            }
+        }
+        rewriter.finish();
+        ASSERT_EQ(numbers_of(instructions), expected) << "round " << round;
+    }
+}
+
+} // namespace ASM
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,60 @@
+#include "gtest/gtest.h"
+#include "src/ast/arena.h"
+#include "src/ast/ast.h"
+#include <cstdint>
+#include <vector>
+
+namespace CAst {
+
+TEST(ArenaTest, NodesKeepTheirValuesAcrossChunks) {
+    Arena arena;
+    std::vector<IntegerValueNode*> leaves;
+    for (int i = 0; i < 100000; i++) {
+        leaves.push_back(arena.make<IntegerValueNode>(i));
+    }
+    ExpressionNode* sum = leaves[0];
+    for (int i = 1; i < 100; i++) {
+        sum = arena.make<BinaryExpressionNode>(BinaryOperator::PLUS, sum, leaves[i]);
+    }
+    for (int i = 0; i < 100000; i++) {
+        ASSERT_EQ(leaves[i]->value_, i);
+    }
+    auto top = node_cast<BinaryExpressionNode>(sum);
+    ASSERT_NE(top, nullptr);
+    EXPECT_EQ(top->right_, leaves[99]);
+    EXPECT_GE(arena.bytes_reserved(), arena.bytes_allocated());
+}
+
+TEST(ArenaTest, AllocationsAreAligned) {
+    struct alignas(32) Wide { char bytes[32]; };
+    Arena arena;
+    for (int i = 0; i < 1000; i++) {
+        arena.make<char>('x');
+        auto wide = arena.make<Wide>();
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(wide) % alignof(Wide), 0);
+        auto node = arena.make<IntegerValueNode>(i);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(node) % alignof(IntegerValueNode), 0);
+    }
+}
+
+TEST(ArenaTest, CopiesSpans) {
+    Arena arena;
+    EXPECT_TRUE(arena.copy(std::vector<int>()).empty());
+    std::vector<int> values(50000);
+    for (int i = 0; i < 50000; i++) {
+        values[i] = i * 3;
+    }
+    auto span = arena.copy(values);
+    values.clear();
+    ASSERT_EQ(span.size(), 50000);
+    for (int i = 0; i < 50000; i++) {
+        ASSERT_EQ(span[i], i * 3);
+    }
+}
+
+} // namespace CAst
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,118 @@
+#include "src/lexer/dfa_lexer.h"
+#include "src/parser/parser.h"
+#include "src/codegen/c_ast_to_tacky/c_ast_to_tacky.h"
+#include "src/codegen/tacky_to_asm/tacky_to_asm.h"
+#include "src/codegen/asm_dump/asm_dump.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+
+// Time spent in register allocation, the ASM pseudo replacement, instruction
+// fixup and assembly dump over a generated source of --size_mb megabytes. The dump is written
+// to /dev/null.
+
+int SIZE_MB = 4, HEIGHT = 10, ROUNDS = 5, SEED = 42;
+
+void append_expression(std::mt19937& rng, int height, std::string& code) {
+    auto draw = [&](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+    if (height == 0) {
+        code += std::to_string(draw(0, 200));
+        return;
+    }
+    const char* bin_ops[] = {" * ", " / ", " % ", " + ", " - ", " & ", " | ", " ^ ", " << ", " >> "};
+    if (draw(0, 2) != 1) {
+        code += "(";
+        append_expression(rng, height - 1, code);
+        code += bin_ops[draw(0, 9)];
+        append_expression(rng, height - 1, code);
+        code += ")";
+    } else {
+        code += draw(0, 1) ? "-(" : "~(";
+        append_expression(rng, height - 1, code);
+        code += ")";
+    }
+}
+
+std::string generate_source(size_t target_size) {
+    std::mt19937 rng(SEED);
+    std::string code;
+    int function_idx = 0;
+    while (code.size() < target_size) {
+        code += "int f" + std::to_string(function_idx++) + "() {\n    return ";
+        append_expression(rng, HEIGHT, code);
+        code += ";\n}\n\n";
+    }
+    return code;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg(argv[i]);
+        if (arg.starts_with("--size_mb=")) {
+            SIZE_MB = std::stoi(std::string(arg.substr(10)));
+        } else if (arg.starts_with("--height=")) {
+            HEIGHT = std::stoi(std::string(arg.substr(9)));
+        } else if (arg.starts_with("--rounds=")) {
+            ROUNDS = std::stoi(std::string(arg.substr(9)));
+        } else if (arg.starts_with("--seed=")) {
+            SEED = std::stoi(std::string(arg.substr(7)));
+        }
+    }
+    std::string code = generate_source(static_cast<size_t>(SIZE_MB) * 1024 * 1024);
+    Parser::RecursiveDescentParser parser(Lexer::DfaLexer(code).Lex());
+    auto c_ast = parser.parse();
+    Codegen::AstToTackyVisitor tacky_visitor;
+    auto tacky_program = tacky_visitor.get_tacky_from_c_ast(c_ast.value());
+    c_ast.reset();
+    Codegen::TackyToAsmVisitor asm_visitor;
+    auto asm_program = asm_visitor.get_asm_from_tacky(tacky_program);
+
+    double best_allocation = 1e30, best_pseudo = 1e30, best_fixup = 1e30, best_dump = 1e30;
+    size_t instructions = 0, frame_bytes = 0, largest_frame = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        auto fixed_program = asm_program;
+        auto start = std::chrono::steady_clock::now();
+        Codegen::RegisterAllocatorVisitor register_allocator;
+        register_allocator.rewrite(fixed_program);
+        best_allocation = std::min(best_allocation, seconds_since(start));
+
+        start = std::chrono::steady_clock::now();
+        Codegen::PseudoReplacerVisitor pseudo_replacer;
+        pseudo_replacer.rewrite(fixed_program);
+        best_pseudo = std::min(best_pseudo, seconds_since(start));
+
+        start = std::chrono::steady_clock::now();
+        Codegen::InstructionFixUpVisitor fixup;
+        fixup.rewrite(fixed_program);
+        best_fixup = std::min(best_fixup, seconds_since(start));
+
+        start = std::chrono::steady_clock::now();
+        {
+            Codegen::ASMDumper dumper("/dev/null");
+            dumper.dump_assembly(fixed_program);
+        }
+        best_dump = std::min(best_dump, seconds_since(start));
+
+        instructions = 0;
+        frame_bytes = 0;
+        largest_frame = 0;
+        for (auto& function : fixed_program.functions_) {
+            instructions += function.instructions_.size();
+            frame_bytes += function.frame_size_;
+            largest_frame = std::max<size_t>(largest_frame, function.frame_size_);
+        }
+    }
+    std::cout << "Allocated registers in, replaced pseudos in, fixed up and dumped " << instructions << " instructions from " << code.size()
+              << " bytes, best of " << ROUNDS << " rounds" << std::endl;
+    std::cout << "register allocation: " << best_allocation * 1000 << " ms, pseudo replacement: " << best_pseudo * 1000 << " ms, fixup: " << best_fixup * 1000 << " ms, dump: " << best_dump * 1000 << " ms" << std::endl;
+    std::cout << "frames: " << frame_bytes << " bytes over " << asm_program.functions_.size() << " functions, largest "
+              << largest_frame << " bytes" << std::endl;
+    return 0;
+}
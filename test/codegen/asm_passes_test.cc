@@ -0,0 +1,954 @@
+#include "gtest/gtest.h"
+#include "src/asm/asm_ast.h"
+#include "src/codegen/tacky_to_asm/tacky_to_asm.h"
+#include "src/codegen/asm_dump/asm_dump.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+namespace Codegen {
+
+using ASM::Instruction;
+using ASM::OpCode;
+using ASM::Operand;
+using ASM::Register;
+
+ASM::Program single_function(std::vector<Instruction> instructions, uint32_t pseudo_count = 0) {
+    ASM::Program program;
+    program.functions_.push_back(ASM::Function{Source::Symbol::intern("main"), pseudo_count, std::move(instructions)});
+    return program;
+}
+
+void expect_instructions(const std::vector<Instruction>& actual, const std::vector<Instruction>& expected) {
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); i++) {
+        EXPECT_EQ(actual[i].op_, expected[i].op_) << "instruction " << i;
+        EXPECT_EQ(actual[i].src_, expected[i].src_) << "instruction " << i;
+        EXPECT_EQ(actual[i].dst_, expected[i].dst_) << "instruction " << i;
+        EXPECT_EQ(actual[i].index_, expected[i].index_) << "instruction " << i;
+        EXPECT_EQ(actual[i].scale_, expected[i].scale_) << "instruction " << i;
+    }
+}
+
+TEST(AsmPassesTest, OperandsArePlainValues) {
+    EXPECT_EQ(sizeof(Operand), 8);
+    EXPECT_EQ(Operand::reg(Register::R10), Operand::reg(Register::R10));
+    EXPECT_NE(Operand::reg(Register::R10), Operand::reg(Register::R11));
+    EXPECT_EQ(Operand::stack(-12).stack_offset(), -12);
+    EXPECT_EQ(Operand::imm(-1).imm_value(), -1);
+    EXPECT_NE(Operand::imm(4), Operand::stack(4));
+    EXPECT_TRUE(Operand().is_none());
+}
+
+TEST(AsmPassesTest, PseudosShareOneSlotPerId) {
+    auto program = single_function({
+        {OpCode::MOV, Operand::imm(1), Operand::pseudo(7)},
+        {OpCode::MOV, Operand::pseudo(7), Operand::pseudo(3)},
+        {OpCode::NEG, Operand(), Operand::pseudo(7)},
+        {OpCode::MOV, Operand::pseudo(3), Operand::reg(Register::AX)},
+    }, 8);
+    PseudoReplacerVisitor replacer;
+    replacer.rewrite(program);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::MOV, Operand::imm(1), Operand::stack(-4)},
+        {OpCode::MOV, Operand::stack(-4), Operand::stack(-8)},
+        {OpCode::NEG, Operand(), Operand::stack(-4)},
+        {OpCode::MOV, Operand::stack(-8), Operand::reg(Register::AX)},
+    });
+    EXPECT_EQ(program.functions_[0].frame_size_, 8);
+}
+
+TEST(AsmPassesTest, DeadPseudosHandTheirSlotOn) {
+    // 0 dies feeding 1, 1 and 2 overlap, 3 starts once both are dead
+    auto program = single_function({
+        {OpCode::MOV, Operand::imm(1), Operand::pseudo(0)},
+        {OpCode::MOV, Operand::pseudo(0), Operand::pseudo(1)},
+        {OpCode::MOV, Operand::imm(2), Operand::pseudo(2)},
+        {OpCode::ADD, Operand::pseudo(1), Operand::pseudo(2)},
+        {OpCode::MOV, Operand::pseudo(2), Operand::pseudo(3)},
+        {OpCode::MOV, Operand::pseudo(3), Operand::reg(Register::AX)},
+        {OpCode::RET},
+    }, 4);
+    PseudoReplacerVisitor replacer;
+    replacer.rewrite(program);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::MOV, Operand::imm(1), Operand::stack(-4)},
+        {OpCode::MOV, Operand::stack(-4), Operand::stack(-8)},
+        {OpCode::MOV, Operand::imm(2), Operand::stack(-4)},
+        {OpCode::ADD, Operand::stack(-8), Operand::stack(-4)},
+        {OpCode::MOV, Operand::stack(-4), Operand::stack(-8)},
+        {OpCode::MOV, Operand::stack(-8), Operand::reg(Register::AX)},
+        {OpCode::RET},
+    });
+    EXPECT_EQ(program.functions_[0].frame_size_, 8);
+}
+
+TEST(AsmPassesTest, EveryFunctionGetsItsOwnFrame) {
+    ASM::Program program;
+    program.functions_.push_back(ASM::Function{Source::Symbol::intern("big"), 3, {
+        {OpCode::MOV, Operand::imm(1), Operand::pseudo(0)},
+        {OpCode::MOV, Operand::imm(2), Operand::pseudo(1)},
+        {OpCode::MOV, Operand::imm(3), Operand::pseudo(2)},
+        {OpCode::ADD, Operand::pseudo(0), Operand::pseudo(1)},
+        {OpCode::ADD, Operand::pseudo(1), Operand::pseudo(2)},
+        {OpCode::RET},
+    }});
+    program.functions_.push_back(ASM::Function{Source::Symbol::intern("small"), 1, {
+        {OpCode::MOV, Operand::imm(1), Operand::pseudo(0)},
+        {OpCode::MOV, Operand::pseudo(0), Operand::reg(Register::AX)},
+        {OpCode::RET},
+    }});
+    PseudoReplacerVisitor replacer;
+    replacer.rewrite(program);
+    EXPECT_EQ(program.functions_[0].frame_size_, 12);
+    EXPECT_EQ(program.functions_[1].frame_size_, 4);
+    EXPECT_EQ(program.functions_[1].instructions_[0].dst_, Operand::stack(-4));
+
+    InstructionFixUpVisitor fixup;
+    fixup.rewrite(program);
+    EXPECT_EQ(program.functions_[0].instructions_[0].src_, Operand::imm(32));
+    EXPECT_EQ(program.functions_[1].instructions_[0].src_, Operand::imm(16));
+}
+
+TEST(AsmPassesTest, AllocatorHandsDeadRegistersOn) {
+    auto program = single_function({
+        {OpCode::MOV, Operand::imm(1), Operand::pseudo(0)},
+        {OpCode::NEG, Operand(), Operand::pseudo(0)},
+        {OpCode::MOV, Operand::pseudo(0), Operand::pseudo(1)},
+        {OpCode::MOV, Operand::imm(2), Operand::pseudo(2)},
+        {OpCode::ADD, Operand::pseudo(1), Operand::pseudo(2)},
+        {OpCode::MOV, Operand::pseudo(2), Operand::reg(Register::AX)},
+        {OpCode::RET},
+    }, 3);
+    RegisterAllocatorVisitor allocator;
+    allocator.rewrite(program);
+    auto si = Operand::reg(Register::SI);
+    auto di = Operand::reg(Register::DI);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::MOV, Operand::imm(1), si},
+        {OpCode::NEG, Operand(), si},
+        {OpCode::MOV, si, di},
+        {OpCode::MOV, Operand::imm(2), si},
+        {OpCode::ADD, di, si},
+        {OpCode::MOV, si, Operand::reg(Register::AX)},
+        {OpCode::RET},
+    });
+    EXPECT_TRUE(program.functions_[0].saved_registers_.empty());
+}
+
+// ten pseudos, all live at once, one more than there are registers
+std::vector<Instruction> ten_live_pseudos(bool fourth_is_constant) {
+    std::vector<Instruction> instructions;
+    for (int id = 0; id < 10; id++) {
+        instructions.push_back({OpCode::MOV, Operand::imm(id), Operand::pseudo(id)});
+        if (id != 4 || !fourth_is_constant) {
+            instructions.push_back({OpCode::NEG, Operand(), Operand::pseudo(id)});
+        }
+    }
+    for (int id = 0; id < 10; id++) {
+        instructions.push_back({OpCode::ADD, Operand::pseudo(id), Operand::reg(Register::AX)});
+    }
+    instructions.push_back({OpCode::RET});
+    return instructions;
+}
+
+TEST(AsmPassesTest, AllocatorSpillsTheLongestIntervalOnATie) {
+    auto program = single_function(ten_live_pseudos(false), 10);
+    RegisterAllocatorVisitor allocator;
+    allocator.rewrite(program);
+    auto& function = program.functions_[0];
+    for (auto& instruction : function.instructions_) {
+        for (auto operand : {instruction.src_, instruction.dst_}) {
+            EXPECT_TRUE(!operand.is_pseudo() || operand.pseudo_id() == 9);
+        }
+    }
+    EXPECT_EQ(function.instructions_[18].dst_, Operand::pseudo(9));
+    EXPECT_EQ(function.saved_registers_, (std::vector<Register>{
+        Register::BX, Register::R12, Register::R13, Register::R14, Register::R15}));
+
+    // the spilled pseudo lives below the saved registers
+    PseudoReplacerVisitor replacer;
+    replacer.rewrite(program);
+    EXPECT_EQ(function.instructions_[18].dst_, Operand::stack(-44));
+    EXPECT_EQ(function.frame_size_, 44);
+    InstructionFixUpVisitor fixup;
+    fixup.rewrite(program);
+    EXPECT_EQ(function.instructions_[0].src_, Operand::imm(24));
+}
+
+TEST(AsmPassesTest, AllocatorRematerializesSpilledConstants) {
+    auto program = single_function(ten_live_pseudos(true), 10);
+    RegisterAllocatorVisitor allocator;
+    allocator.rewrite(program);
+    auto& instructions = program.functions_[0].instructions_;
+    ASSERT_EQ(instructions.size(), 29);
+    for (auto& instruction : instructions) {
+        EXPECT_FALSE(instruction.src_.is_pseudo());
+        EXPECT_FALSE(instruction.dst_.is_pseudo());
+    }
+    // the constant's definition is gone, its use reads the immediate and
+    // the last pseudo gets the register it held
+    EXPECT_EQ(instructions[8].dst_, Operand::reg(Register::R12));
+    EXPECT_EQ(instructions[16].dst_, Operand::reg(Register::BX));
+    EXPECT_EQ(instructions[22].src_, Operand::imm(4));
+}
+
+TEST(AsmPassesTest, PseudoIdsMustBeBelowTheFunctionCount) {
+    auto program = single_function({
+        {OpCode::MOV, Operand::imm(1), Operand::pseudo(2)},
+    }, 2);
+    PseudoReplacerVisitor replacer;
+    EXPECT_THROW(replacer.rewrite(program), std::runtime_error);
+    RegisterAllocatorVisitor allocator;
+    EXPECT_THROW(allocator.rewrite(program), std::runtime_error);
+}
+
+TEST(AsmPassesTest, FixUpRewritesUnencodableOperands) {
+    auto r10 = Operand::reg(Register::R10);
+    auto r11 = Operand::reg(Register::R11);
+    auto cl = Operand::reg(Register::CL);
+    auto a = Operand::stack(-4);
+    auto b = Operand::stack(-8);
+    auto program = single_function({
+        {OpCode::MOV, a, b},
+        {OpCode::DIV, Operand::imm(3)},
+        {OpCode::DIV, a},
+        {OpCode::SUB, a, b},
+        {OpCode::ADD, Operand::imm(1), b},
+        {OpCode::MULT, a, b},
+        {OpCode::SAR, a, b},
+        {OpCode::SAL, Operand::imm(2), b},
+        {OpCode::SAR, Operand::reg(Register::SI), Operand::reg(Register::DI)},
+        {OpCode::SAL, Operand::imm(2), Operand::reg(Register::DI)},
+        {OpCode::SAR, Operand::imm(-188), Operand::reg(Register::DI)},
+        {OpCode::CMP, a, b},
+        {OpCode::CMP, Operand::reg(Register::SI), Operand::imm(5)},
+        {OpCode::CMP, Operand::imm(5), a},
+        {OpCode::RET},
+    });
+    program.functions_[0].frame_size_ = 8;
+    InstructionFixUpVisitor fixup;
+    fixup.rewrite(program);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::ALLOCATE_STACK, Operand::imm(16)},
+        {OpCode::MOV, a, r10},
+        {OpCode::MOV, r10, b},
+        {OpCode::MOV, Operand::imm(3), r10},
+        {OpCode::DIV, r10},
+        {OpCode::DIV, a},
+        {OpCode::MOV, a, r10},
+        {OpCode::SUB, r10, b},
+        {OpCode::ADD, Operand::imm(1), b},
+        {OpCode::MOV, b, r11},
+        {OpCode::MULT, a, r11},
+        {OpCode::MOV, r11, b},
+        {OpCode::MOVB, a, cl},
+        {OpCode::MOV, b, r11},
+        {OpCode::SAR, cl, r11},
+        {OpCode::MOV, r11, b},
+        {OpCode::MOV, b, r11},
+        {OpCode::SAL, Operand::imm(2), r11},
+        {OpCode::MOV, r11, b},
+        {OpCode::MOVB, Operand::reg(Register::SI), cl},
+        {OpCode::SAR, cl, Operand::reg(Register::DI)},
+        {OpCode::SAL, Operand::imm(2), Operand::reg(Register::DI)},
+        // counts past the width are undefined, masked like CL would be
+        {OpCode::SAR, Operand::imm(4), Operand::reg(Register::DI)},
+        {OpCode::MOV, a, r10},
+        {OpCode::CMP, r10, b},
+        {OpCode::MOV, Operand::imm(5), r11},
+        {OpCode::CMP, Operand::reg(Register::SI), r11},
+        {OpCode::CMP, Operand::imm(5), a},
+        {OpCode::RET},
+    });
+}
+
+TEST(AsmPassesTest, DumpsAttSyntax) {
+    auto program = single_function({
+        {OpCode::ALLOCATE_STACK, Operand::imm(16)},
+        {OpCode::MOV, Operand::imm(5), Operand::stack(-4)},
+        {OpCode::NOT, Operand(), Operand::stack(-4)},
+        {OpCode::MOVB, Operand::stack(-4), Operand::reg(Register::CL)},
+        {OpCode::MOV, Operand::stack(-4), Operand::reg(Register::AX)},
+        {OpCode::RET},
+    });
+    auto path = (std::filesystem::temp_directory_path() /
+        ("asm_passes_test_" + std::to_string(getpid()) + ".s")).string();
+    {
+        ASMDumper dumper(path);
+        dumper.dump_assembly(program);
+    }
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    std::remove(path.c_str());
+    EXPECT_EQ(text.str(),
+        "\t.section .note.GNU-stack,\"\",@progbits\n"
+        "\t.text\n"
+        "\t.globl main\n"
+        "main:\n"
+        "\tpushq  %rbp\n"
+        "\tmovq   %rsp, %rbp\n"
+        "\tsubq   $16, %rsp\n"
+        "\tmovl   $5,  -4(%rbp)\n"
+        "\tnotl   -4(%rbp)\n"
+        "\tmovb   -4(%rbp),  %cl\n"
+        "\tmovl   -4(%rbp),  %eax\n"
+        "\tmovq   %rbp,%rsp\n"
+        "\tpopq   %rbp\n"
+        "\tret\n");
+}
+
+TEST(AsmPassesTest, DumpsSavedRegisters) {
+    auto program = single_function({
+        {OpCode::ALLOCATE_STACK, Operand::imm(0)},
+        {OpCode::MOV, Operand::imm(5), Operand::reg(Register::R12)},
+        {OpCode::MOVB, Operand::reg(Register::SI), Operand::reg(Register::CL)},
+        {OpCode::MOV, Operand::reg(Register::R12), Operand::reg(Register::AX)},
+        {OpCode::RET},
+    });
+    program.functions_[0].saved_registers_ = {Register::BX, Register::R12};
+    auto path = (std::filesystem::temp_directory_path() /
+        ("asm_passes_test_saved_" + std::to_string(getpid()) + ".s")).string();
+    {
+        ASMDumper dumper(path);
+        dumper.dump_assembly(program);
+    }
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    std::remove(path.c_str());
+    EXPECT_EQ(text.str(),
+        "\t.section .note.GNU-stack,\"\",@progbits\n"
+        "\t.text\n"
+        "\t.globl main\n"
+        "main:\n"
+        "\tpushq  %rbp\n"
+        "\tmovq   %rsp, %rbp\n"
+        "\tpushq  %rbx\n"
+        "\tpushq  %r12\n"
+        "\tsubq   $0, %rsp\n"
+        "\tmovl   $5,  %r12d\n"
+        "\tmovb   %sil,  %cl\n"
+        "\tmovl   %r12d,  %eax\n"
+        "\tmovq   -8(%rbp), %rbx\n"
+        "\tmovq   -16(%rbp), %r12\n"
+        "\tmovq   %rbp,%rsp\n"
+        "\tpopq   %rbp\n"
+        "\tret\n");
+}
+
+TEST(AsmPassesTest, ConstantDivisorsMultiplyInsteadOfIdiv) {
+    auto lower = [](int divisor) {
+        Tacky::Program program;
+        program.functions_.push_back(Tacky::Function{Source::Symbol::intern("main"), 2, {
+            {Tacky::OpCode::NEGATE, Tacky::Value::temporary(0), Tacky::Value::constant(5)},
+            {Tacky::OpCode::DIV, Tacky::Value::temporary(1), Tacky::Value::temporary(0), Tacky::Value::constant(divisor)},
+            {Tacky::OpCode::RETURN, Tacky::Value(), Tacky::Value::temporary(1)},
+        }});
+        return TackyToAsmVisitor().get_asm_from_tacky(program);
+    };
+    auto count = [](const ASM::Program& program, OpCode op) {
+        size_t n = 0;
+        for (auto& instruction : program.functions_[0].instructions_) {
+            n += instruction.op_ == op;
+        }
+        return n;
+    };
+    for (int divisor : {7, -7, 3, 1000, 1 << 20, INT_MAX}) {
+        auto program = lower(divisor);
+        EXPECT_EQ(count(program, OpCode::DIV), 0) << divisor;
+        EXPECT_EQ(count(program, OpCode::MULT64), 1) << divisor;
+        EXPECT_EQ(count(program, OpCode::NEG), divisor < 0 ? 2 : 1) << divisor;
+    }
+    // these trap or have no magic number
+    for (int divisor : {0, 1, -1, INT_MIN}) {
+        EXPECT_EQ(count(lower(divisor), OpCode::DIV), 1) << divisor;
+    }
+}
+
+TEST(AsmPassesTest, FusesDivisionAndModuloOfSameOperands) {
+    auto t = [](uint32_t id) { return Tacky::Value::temporary(id); };
+    auto lower = [&](Tacky::Value divisor, Tacky::Value modulo_dividend) {
+        Tacky::Program program;
+        program.functions_.push_back(Tacky::Function{Source::Symbol::intern("main"), 6, {
+            {Tacky::OpCode::NEGATE, t(0), Tacky::Value::constant(5)},
+            {Tacky::OpCode::NEGATE, t(1), Tacky::Value::constant(3)},
+            {Tacky::OpCode::MOD, t(2), modulo_dividend, divisor},
+            {Tacky::OpCode::PLUS, t(3), t(0), t(1)},
+            {Tacky::OpCode::DIV, t(4), t(0), divisor},
+            {Tacky::OpCode::PLUS, t(5), t(2), t(4)},
+            {Tacky::OpCode::RETURN, Tacky::Value(), t(5)},
+        }});
+        return TackyToAsmVisitor().get_asm_from_tacky(program).functions_[0].instructions_;
+    };
+    auto count = [](const std::vector<Instruction>& instructions, OpCode op) {
+        size_t n = 0;
+        for (auto& instruction : instructions) {
+            n += instruction.op_ == op;
+        }
+        return n;
+    };
+
+    auto fused = lower(t(1), t(0));
+    EXPECT_EQ(count(fused, OpCode::DIV), 1);
+    // the quotient and the remainder both leave the one idiv
+    auto idiv = std::find_if(fused.begin(), fused.end(), [](auto& i) { return i.op_ == OpCode::DIV; });
+    ASSERT_LT(idiv + 2, fused.end());
+    expect_instructions({idiv + 1, idiv + 3}, {
+        {OpCode::MOV, Operand::reg(Register::AX), Operand::pseudo(4)},
+        {OpCode::MOV, Operand::reg(Register::DX), Operand::pseudo(2)},
+    });
+
+    EXPECT_EQ(count(lower(Tacky::Value::constant(7), t(0)), OpCode::MULT64), 1);
+    EXPECT_EQ(count(lower(t(1), t(1)), OpCode::DIV), 2);
+    EXPECT_EQ(count(lower(t(0), t(1)), OpCode::DIV), 2);
+}
+
+TEST(AsmPassesTest, DoesNotPairDivisionsAcrossRedefinitions) {
+    auto t = [](uint32_t id) { return Tacky::Value::temporary(id); };
+    auto c = [](int value) { return Tacky::Value::constant(value); };
+    auto divisions = [](std::vector<Tacky::Instruction> body, uint32_t temporary_count) {
+        Tacky::Program program;
+        program.functions_.push_back(Tacky::Function{Source::Symbol::intern("main"), temporary_count, body});
+        auto instructions = TackyToAsmVisitor().get_asm_from_tacky(program).functions_[0].instructions_;
+        return std::count_if(instructions.begin(), instructions.end(),
+            [](auto& instruction) { return instruction.op_ == OpCode::DIV; });
+    };
+    // t0 is written again between the two
+    EXPECT_EQ(divisions({
+        {Tacky::OpCode::NEGATE, t(0), c(5)},
+        {Tacky::OpCode::NEGATE, t(1), c(3)},
+        {Tacky::OpCode::DIV, t(2), t(0), t(1)},
+        {Tacky::OpCode::COPY, t(0), t(1)},
+        {Tacky::OpCode::MOD, t(3), t(0), t(1)},
+        {Tacky::OpCode::PLUS, t(4), t(2), t(3)},
+        {Tacky::OpCode::RETURN, Tacky::Value(), t(4)},
+    }, 5), 2);
+    // the remainder's temporary is still read for what it held before
+    EXPECT_EQ(divisions({
+        {Tacky::OpCode::NEGATE, t(0), c(5)},
+        {Tacky::OpCode::NEGATE, t(1), c(3)},
+        {Tacky::OpCode::NEGATE, t(3), c(7)},
+        {Tacky::OpCode::DIV, t(2), t(0), t(1)},
+        {Tacky::OpCode::PLUS, t(4), t(2), t(3)},
+        {Tacky::OpCode::MOD, t(3), t(0), t(1)},
+        {Tacky::OpCode::PLUS, t(4), t(4), t(3)},
+        {Tacky::OpCode::RETURN, Tacky::Value(), t(4)},
+    }, 5), 2);
+}
+
+TEST(AsmPassesTest, PeepholeForwardsStoresThroughSpilledChains) {
+    auto r10 = Operand::reg(Register::R10);
+    auto r11 = Operand::reg(Register::R11);
+    auto ax = Operand::reg(Register::AX);
+    // what fixup leaves for t0 = 5 * 3; t1 = t0; return t1 with every pseudo on the stack
+    auto program = single_function({
+        {OpCode::MOV, Operand::imm(5), Operand::stack(-4)},
+        {OpCode::MOV, Operand::stack(-4), r11},
+        {OpCode::MULT, Operand::imm(3), r11},
+        {OpCode::MOV, r11, Operand::stack(-4)},
+        {OpCode::MOV, Operand::stack(-4), r10},
+        {OpCode::MOV, r10, Operand::stack(-8)},
+        {OpCode::MOV, Operand::stack(-8), ax},
+        {OpCode::RET},
+    });
+    PeepholeVisitor peephole;
+    peephole.rewrite(program);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::MOV, Operand::imm(5), r11},
+        {OpCode::MULT, Operand::imm(3), r11},
+        {OpCode::MOV, r11, ax},
+        {OpCode::RET},
+    });
+    auto hits = peephole.hits();
+    ASSERT_EQ(hits.size(), PeepholeVisitor::kRuleCount);
+    EXPECT_EQ(hits[2], (std::pair<std::string, size_t>{"store to load forwarding", 3}));
+    EXPECT_EQ(hits[3], (std::pair<std::string, size_t>{"copy through dead register", 1}));
+    EXPECT_EQ(hits[4], (std::pair<std::string, size_t>{"dead store", 3}));
+}
+
+TEST(AsmPassesTest, PeepholeRespectsImplicitOperands) {
+    auto si = Operand::reg(Register::SI);
+    auto ax = Operand::reg(Register::AX);
+    auto dx = Operand::reg(Register::DX);
+    auto r10 = Operand::reg(Register::R10);
+    auto program = single_function({
+        {OpCode::MOV, Operand::imm(0), si},
+        // cdq overwrites it before anyone reads it
+        {OpCode::MOV, Operand::imm(7), dx},
+        {OpCode::MOV, si, ax},
+        {OpCode::ADD, Operand::imm(4), ax},
+        {OpCode::CDQ},
+        // idiv can't take the immediate, this stays a copy
+        {OpCode::MOV, Operand::imm(3), r10},
+        {OpCode::DIV, r10},
+        {OpCode::MOV, si, si},
+        {OpCode::MOV, dx, ax},
+        {OpCode::MOV, ax, dx},
+        {OpCode::RET},
+    });
+    PeepholeVisitor peephole;
+    peephole.rewrite(program);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::BITWISE_XOR, si, si},
+        {OpCode::MOV, si, ax},
+        {OpCode::ADD, Operand::imm(4), ax},
+        {OpCode::CDQ},
+        {OpCode::MOV, Operand::imm(3), r10},
+        {OpCode::DIV, r10},
+        {OpCode::MOV, dx, ax},
+        {OpCode::RET},
+    });
+    std::vector<std::pair<std::string, size_t>> expected = {
+        {"self move", 1},
+        {"redundant move", 1},
+        {"store to load forwarding", 0},
+        {"copy through dead register", 0},
+        {"dead store", 1},
+        {"zeroing idiom", 1},
+        {"test idiom", 0},
+    };
+    EXPECT_EQ(peephole.hits(), expected);
+}
+
+TEST(AsmPassesTest, PeepholeKeepsFlagsSetccReads) {
+    auto si = Operand::reg(Register::SI);
+    auto di = Operand::reg(Register::DI);
+    auto ax = Operand::reg(Register::AX);
+    auto program = single_function({
+        {OpCode::MOV, Operand::imm(0), si},
+        {OpCode::CMP, Operand::imm(3), di},
+        {OpCode::SETL, Operand(), si},
+        {OpCode::CMP, Operand::imm(0), di},
+        // xor would clobber the flags sete reads
+        {OpCode::MOV, Operand::imm(0), ax},
+        {OpCode::SETE, Operand(), ax},
+        {OpCode::ADD, si, ax},
+        {OpCode::RET},
+    });
+    PeepholeVisitor peephole;
+    peephole.rewrite(program);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::BITWISE_XOR, si, si},
+        {OpCode::CMP, Operand::imm(3), di},
+        {OpCode::SETL, Operand(), si},
+        {OpCode::TEST, di, di},
+        {OpCode::MOV, Operand::imm(0), ax},
+        {OpCode::SETE, Operand(), ax},
+        {OpCode::ADD, si, ax},
+        {OpCode::RET},
+    });
+    auto hits = peephole.hits();
+    EXPECT_EQ(hits[5], (std::pair<std::string, size_t>{"zeroing idiom", 1}));
+    EXPECT_EQ(hits[6], (std::pair<std::string, size_t>{"test idiom", 1}));
+}
+
+TEST(AsmPassesTest, PeepholeKeepsDeadStoresSettingReadFlags) {
+    auto si = Operand::reg(Register::SI);
+    auto di = Operand::reg(Register::DI);
+    auto ax = Operand::reg(Register::AX);
+    std::vector<Instruction> instructions = {
+        {OpCode::MOV, Operand::imm(7), ax},
+        // si is overwritten right away, but setl reads the flags
+        {OpCode::SUB, Operand::imm(1), si},
+        {OpCode::MOV, di, si},
+        {OpCode::SETL, Operand(), ax},
+        {OpCode::ADD, si, ax},
+        {OpCode::RET},
+    };
+    auto program = single_function(instructions);
+    PeepholeVisitor peephole;
+    peephole.rewrite(program);
+    expect_instructions(program.functions_[0].instructions_, instructions);
+    EXPECT_EQ(peephole.hits()[4], (std::pair<std::string, size_t>{"dead store", 0}));
+}
+
+TEST(AsmPassesTest, PeepholeStopsAtJumpsAndLabels) {
+    auto si = Operand::reg(Register::SI);
+    auto di = Operand::reg(Register::DI);
+    auto ax = Operand::reg(Register::AX);
+    std::vector<Instruction> instructions = {
+        {OpCode::MOV, Operand::imm(1), si},
+        {OpCode::CMP, Operand::imm(0), di},
+        // je reads the flags xor would clobber
+        {OpCode::MOV, Operand::imm(0), ax},
+        {OpCode::JE, Operand::label(0)},
+        // only overwrites si when the jump isn't taken
+        {OpCode::MOV, Operand::imm(2), si},
+        {OpCode::LABEL, Operand::label(0)},
+        {OpCode::ADD, si, ax},
+        {OpCode::RET},
+    };
+    auto program = single_function(instructions);
+    PeepholeVisitor().rewrite(program);
+    instructions[1] = {OpCode::TEST, di, di};
+    expect_instructions(program.functions_[0].instructions_, instructions);
+}
+
+TEST(AsmPassesTest, PeepholeDropsStoresDeadOnEveryPath) {
+    auto si = Operand::reg(Register::SI);
+    auto di = Operand::reg(Register::DI);
+    auto ax = Operand::reg(Register::AX);
+    auto slot = Operand::stack(-4);
+    std::vector<Instruction> instructions = {
+        // both paths overwrite the slot before reading it
+        {OpCode::MOV, si, slot},
+        {OpCode::CMP, Operand::imm(0), di},
+        {OpCode::JE, Operand::label(0)},
+        {OpCode::MOV, Operand::imm(1), slot},
+        {OpCode::JMP, Operand::label(1)},
+        {OpCode::LABEL, Operand::label(0)},
+        {OpCode::MOV, Operand::imm(2), slot},
+        {OpCode::LABEL, Operand::label(1)},
+        {OpCode::MOV, slot, ax},
+        {OpCode::RET},
+    };
+    auto program = single_function(instructions);
+    PeepholeVisitor peephole;
+    peephole.rewrite(program);
+    instructions.erase(instructions.begin());
+    instructions[0] = {OpCode::TEST, di, di};
+    expect_instructions(program.functions_[0].instructions_, instructions);
+    EXPECT_EQ(peephole.hits()[4], (std::pair<std::string, size_t>{"dead store", 1}));
+}
+
+TEST(AsmPassesTest, TilesArithmeticIntoLeaAndImul) {
+    auto t = [](uint32_t id) { return Tacky::Value::temporary(id); };
+    auto k = [](int value) { return Tacky::Value::constant(value); };
+    Tacky::Program program;
+    // ((t0 + t1 * 4) * 5) * 7 - 12, every temporary in the chain used once
+    program.functions_.push_back(Tacky::Function{Source::Symbol::intern("main"), 7, {
+        {Tacky::OpCode::NEGATE, t(0), k(5)},
+        {Tacky::OpCode::NEGATE, t(1), k(3)},
+        {Tacky::OpCode::MULT, t(2), t(1), k(4)},
+        {Tacky::OpCode::PLUS, t(3), t(0), t(2)},
+        {Tacky::OpCode::MULT, t(4), t(3), k(5)},
+        {Tacky::OpCode::MULT, t(5), t(4), k(7)},
+        {Tacky::OpCode::MINUS, t(6), t(5), k(12)},
+        {Tacky::OpCode::RETURN, Tacky::Value(), t(6)},
+    }});
+    auto asm_program = TackyToAsmVisitor().get_asm_from_tacky(program);
+    auto p = [](uint32_t id) { return Operand::pseudo(id); };
+    EXPECT_EQ(asm_program.functions_[0].pseudo_count_, 7);
+    expect_instructions(asm_program.functions_[0].instructions_, {
+        {OpCode::MOV, Operand::imm(5), p(0)},
+        {OpCode::NEG, Operand(), p(0)},
+        {OpCode::MOV, Operand::imm(3), p(1)},
+        {OpCode::NEG, Operand(), p(1)},
+        {OpCode::LEA, p(0), p(3), p(1), 4},
+        {OpCode::LEA, p(3), p(4), p(3), 4},
+        {OpCode::MULT3, p(4), p(5), Operand::imm(7)},
+        {OpCode::LEA, p(5), p(6), Operand::imm(-12)},
+        {OpCode::MOV, p(6), Operand::reg(Register::AX)},
+        {OpCode::RET},
+    });
+}
+
+TEST(AsmPassesTest, TilingKeepsSharedTemporariesAndNeedsFreshPseudos) {
+    auto t = [](uint32_t id) { return Tacky::Value::temporary(id); };
+    auto k = [](int value) { return Tacky::Value::constant(value); };
+    Tacky::Program program;
+    // t1 is used twice so it's computed once, and 6 * 2 scales a constant
+    // that has to be in a register first
+    program.functions_.push_back(Tacky::Function{Source::Symbol::intern("main"), 4, {
+        {Tacky::OpCode::NEGATE, t(0), k(5)},
+        {Tacky::OpCode::PLUS, t(1), t(0), k(1)},
+        {Tacky::OpCode::MULT, t(2), k(6), k(2)},
+        {Tacky::OpCode::BITWISE_XOR, t(3), t(1), t(2)},
+        {Tacky::OpCode::BITWISE_AND, t(2), t(3), t(1)},
+        {Tacky::OpCode::RETURN, Tacky::Value(), t(2)},
+    }});
+    auto asm_program = TackyToAsmVisitor().get_asm_from_tacky(program);
+    auto p = [](uint32_t id) { return Operand::pseudo(id); };
+    EXPECT_EQ(asm_program.functions_[0].pseudo_count_, 5);
+    expect_instructions(asm_program.functions_[0].instructions_, {
+        {OpCode::MOV, Operand::imm(5), p(0)},
+        {OpCode::NEG, Operand(), p(0)},
+        {OpCode::LEA, p(0), p(1), Operand::imm(1)},
+        {OpCode::MOV, Operand::imm(6), p(4)},
+        {OpCode::LEA, Operand(), p(2), p(4), 2},
+        {OpCode::MOV, p(1), p(3)},
+        {OpCode::BITWISE_XOR, p(2), p(3)},
+        {OpCode::MOV, p(3), p(2)},
+        {OpCode::BITWISE_AND, p(1), p(2)},
+        {OpCode::MOV, p(2), Operand::reg(Register::AX)},
+        {OpCode::RET},
+    });
+}
+
+TEST(AsmPassesTest, LowersComparisonsAndLogicWithSetcc) {
+    auto t = [](uint32_t id) { return Tacky::Value::temporary(id); };
+    auto k = [](int value) { return Tacky::Value::constant(value); };
+    Tacky::Program program;
+    program.functions_.push_back(Tacky::Function{Source::Symbol::intern("main"), 9, {
+        {Tacky::OpCode::NEGATE, t(0), k(5)},
+        {Tacky::OpCode::LESS, t(1), k(3), t(0)},
+        {Tacky::OpCode::NOT, t(2), t(1)},
+        {Tacky::OpCode::EQUAL, t(3), t(0), k(4)},
+        {Tacky::OpCode::AND, t(4), t(2), t(3)},
+        {Tacky::OpCode::OR, t(5), t(4), t(0)},
+        {Tacky::OpCode::NOT, t(6), t(5)},
+        {Tacky::OpCode::AND, t(7), t(0), t(6)},
+        {Tacky::OpCode::NOT, t(8), t(0)},
+        {Tacky::OpCode::RETURN, Tacky::Value(), t(8)},
+    }});
+    auto asm_program = TackyToAsmVisitor().get_asm_from_tacky(program);
+    auto p = [](uint32_t id) { return Operand::pseudo(id); };
+    auto zero = Operand::imm(0);
+    EXPECT_EQ(asm_program.functions_[0].pseudo_count_, 11);
+    expect_instructions(asm_program.functions_[0].instructions_, {
+        {OpCode::MOV, Operand::imm(5), p(0)},
+        {OpCode::NEG, Operand(), p(0)},
+        // !(3 < t0) is t0 <= 3, off the same cmp
+        {OpCode::MOV, zero, p(2)},
+        {OpCode::CMP, Operand::imm(3), p(0)},
+        {OpCode::SETLE, Operand(), p(2)},
+        {OpCode::MOV, zero, p(3)},
+        {OpCode::CMP, Operand::imm(4), p(0)},
+        {OpCode::SETE, Operand(), p(3)},
+        // both sides are 0 or 1 already
+        {OpCode::MOV, p(2), p(4)},
+        {OpCode::BITWISE_AND, p(3), p(4)},
+        // (t4 | t0) != 0
+        {OpCode::MOV, p(4), p(9)},
+        {OpCode::BITWISE_OR, p(0), p(9)},
+        {OpCode::MOV, zero, p(5)},
+        {OpCode::CMP, zero, p(9)},
+        {OpCode::SETNE, Operand(), p(5)},
+        {OpCode::MOV, p(5), p(6)},
+        {OpCode::BITWISE_XOR, Operand::imm(1), p(6)},
+        // t0 != 0 into a fresh pseudo first
+        {OpCode::MOV, zero, p(10)},
+        {OpCode::CMP, zero, p(0)},
+        {OpCode::SETNE, Operand(), p(10)},
+        {OpCode::MOV, p(10), p(7)},
+        {OpCode::BITWISE_AND, p(6), p(7)},
+        {OpCode::MOV, zero, p(8)},
+        {OpCode::CMP, zero, p(0)},
+        {OpCode::SETE, Operand(), p(8)},
+        {OpCode::MOV, p(8), Operand::reg(Register::AX)},
+        {OpCode::RET},
+    });
+}
+
+TEST(AsmPassesTest, LowersJumpsAndBranchesOnComparisons) {
+    auto t = [](uint32_t id) { return Tacky::Value::temporary(id); };
+    auto k = [](int value) { return Tacky::Value::constant(value); };
+    auto l = [](uint32_t id) { return Tacky::Value::label(id); };
+    Tacky::Program program;
+    program.functions_.push_back(Tacky::Function{Source::Symbol::intern("main"), 5, {
+        {Tacky::OpCode::NEGATE, t(0), k(5)},
+        {Tacky::OpCode::LESS, t(1), t(0), k(3)},
+        {Tacky::OpCode::JUMP_IF_NOT_ZERO, Tacky::Value(), t(1), l(0)},
+        {Tacky::OpCode::EQUAL, t(2), t(0), k(4)},
+        {Tacky::OpCode::JUMP_IF_ZERO, Tacky::Value(), k(0), l(0)},
+        {Tacky::OpCode::JUMP_IF_ZERO, Tacky::Value(), k(1), l(0)},
+        {Tacky::OpCode::LABEL, Tacky::Value(), l(0)},
+        {Tacky::OpCode::OR, t(3), t(1), t(2)},
+        {Tacky::OpCode::GREATER, t(4), t(3), t(0)},
+        {Tacky::OpCode::JUMP_IF_ZERO, Tacky::Value(), t(4), l(1)},
+        {Tacky::OpCode::RETURN, Tacky::Value(), t(3)},
+        {Tacky::OpCode::LABEL, Tacky::Value(), l(1)},
+        {Tacky::OpCode::RETURN, Tacky::Value(), k(7)},
+    }, 2});
+    auto asm_program = TackyToAsmVisitor().get_asm_from_tacky(program);
+    auto p = [](uint32_t id) { return Operand::pseudo(id); };
+    auto zero = Operand::imm(0);
+    auto ax = Operand::reg(Register::AX);
+    EXPECT_EQ(asm_program.functions_[0].pseudo_count_, 6);
+    expect_instructions(asm_program.functions_[0].instructions_, {
+        {OpCode::MOV, Operand::imm(5), p(0)},
+        {OpCode::NEG, Operand(), p(0)},
+        {OpCode::MOV, zero, p(1)},
+        {OpCode::CMP, Operand::imm(3), p(0)},
+        {OpCode::SETL, Operand(), p(1)},
+        {OpCode::CMP, zero, p(1)},
+        {OpCode::JNE, Operand::label(0)},
+        {OpCode::MOV, zero, p(2)},
+        {OpCode::CMP, Operand::imm(4), p(0)},
+        {OpCode::SETE, Operand(), p(2)},
+        // jumps on constants always go or never do
+        {OpCode::JMP, Operand::label(0)},
+        {OpCode::LABEL, Operand::label(0)},
+        // t2 holds anything when the jump was taken, only t1 is 0 or 1 here
+        {OpCode::MOV, p(1), p(5)},
+        {OpCode::BITWISE_OR, p(2), p(5)},
+        {OpCode::MOV, zero, p(3)},
+        {OpCode::CMP, zero, p(5)},
+        {OpCode::SETNE, Operand(), p(3)},
+        // jumps when t3 > t0 doesn't hold, off the cmp itself
+        {OpCode::CMP, p(0), p(3)},
+        {OpCode::JLE, Operand::label(1)},
+        {OpCode::MOV, p(3), ax},
+        {OpCode::RET},
+        {OpCode::LABEL, Operand::label(1)},
+        {OpCode::MOV, Operand::imm(7), ax},
+        {OpCode::RET},
+    });
+}
+
+TEST(AsmPassesTest, FixUpMovesLeaAndImulOperandsIntoRegisters) {
+    auto r10 = Operand::reg(Register::R10);
+    auto r11 = Operand::reg(Register::R11);
+    auto a = Operand::stack(-4);
+    auto b = Operand::stack(-8);
+    auto si = Operand::reg(Register::SI);
+    auto program = single_function({
+        {OpCode::LEA, a, b, a, 2},
+        {OpCode::LEA, si, si, Operand::imm(7)},
+        {OpCode::LEA, si, si, Operand::imm(7), 4},
+        {OpCode::LEA, Operand(), si, Operand::imm(7), 8},
+        {OpCode::MULT3, a, b, Operand::imm(7)},
+        {OpCode::MULT3, Operand::imm(3), si, Operand::imm(7)},
+        {OpCode::RET},
+    });
+    program.functions_[0].frame_size_ = 8;
+    InstructionFixUpVisitor fixup;
+    fixup.rewrite(program);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::ALLOCATE_STACK, Operand::imm(16)},
+        {OpCode::MOV, a, r10},
+        {OpCode::MOV, a, r11},
+        {OpCode::LEA, r10, r11, r11, 2},
+        {OpCode::MOV, r11, b},
+        // a rematerialized index reads as a displacement only unscaled
+        {OpCode::LEA, si, si, Operand::imm(7)},
+        {OpCode::MOV, Operand::imm(7), r11},
+        {OpCode::LEA, si, si, r11, 4},
+        {OpCode::MOV, Operand::imm(7), r11},
+        {OpCode::LEA, Operand(), si, r11, 8},
+        {OpCode::MULT3, a, r11, Operand::imm(7)},
+        {OpCode::MOV, r11, b},
+        {OpCode::MOV, Operand::imm(3), r10},
+        {OpCode::MULT3, r10, si, Operand::imm(7)},
+        {OpCode::RET},
+    });
+}
+
+TEST(AsmPassesTest, DumpsLeaAndThreeOperandImul) {
+    auto ax = Operand::reg(Register::AX);
+    auto cx = Operand::reg(Register::DI);
+    auto dx = Operand::reg(Register::DX);
+    auto program = single_function({
+        {OpCode::LEA, ax, cx, dx, 4},
+        {OpCode::LEA, ax, cx, Operand::imm(-12)},
+        {OpCode::LEA, ax, cx, Operand::imm(0)},
+        {OpCode::LEA, Operand(), cx, ax, 8},
+        {OpCode::MULT3, dx, cx, Operand::imm(7)},
+        {OpCode::RET},
+    });
+    auto path = (std::filesystem::temp_directory_path() /
+        ("asm_passes_test_lea_" + std::to_string(getpid()) + ".s")).string();
+    {
+        ASMDumper dumper(path);
+        dumper.dump_assembly(program);
+    }
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    std::remove(path.c_str());
+    EXPECT_NE(text.str().find(
+        "\tleal   (%rax,%rdx,4),  %edi\n"
+        "\tleal   -12(%rax),  %edi\n"
+        "\tleal   (%rax),  %edi\n"
+        "\tleal   (,%rax,8),  %edi\n"
+        "\timull  $7,  %edx,  %edi\n"), std::string::npos) << text.str();
+}
+
+TEST(AsmPassesTest, DumpsComparisons) {
+    auto program = single_function({
+        {OpCode::CMP, Operand::imm(3), Operand::reg(Register::DI)},
+        {OpCode::SETLE, Operand(), Operand::reg(Register::SI)},
+        {OpCode::TEST, Operand::reg(Register::R8), Operand::reg(Register::R8)},
+        {OpCode::SETNE, Operand(), Operand::stack(-4)},
+        {OpCode::RET},
+    });
+    auto path = (std::filesystem::temp_directory_path() /
+        ("asm_passes_test_cmp_" + std::to_string(getpid()) + ".s")).string();
+    {
+        ASMDumper dumper(path);
+        dumper.dump_assembly(program);
+    }
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    std::remove(path.c_str());
+    EXPECT_NE(text.str().find(
+        "\tcmpl  $3,  %edi\n"
+        "\tsetle  %sil\n"
+        "\ttestl %r8d,  %r8d\n"
+        "\tsetne  -4(%rbp)\n"), std::string::npos) << text.str();
+}
+
+TEST(AsmPassesTest, DumpsLabelsAndJumps) {
+    auto program = single_function({
+        {OpCode::LABEL, Operand::label(0)},
+        {OpCode::JMP, Operand::label(1)},
+        {OpCode::JE, Operand::label(0)},
+        {OpCode::JGE, Operand::label(1)},
+        {OpCode::LABEL, Operand::label(1)},
+        {OpCode::RET},
+    });
+    auto path = (std::filesystem::temp_directory_path() /
+        ("asm_passes_test_jump_" + std::to_string(getpid()) + ".s")).string();
+    {
+        ASMDumper dumper(path);
+        dumper.dump_assembly(program);
+    }
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    std::remove(path.c_str());
+    EXPECT_NE(text.str().find(
+        ".Lmain.0:\n"
+        "\tjmp    .Lmain.1\n"
+        "\tje     .Lmain.0\n"
+        "\tjge    .Lmain.1\n"
+        ".Lmain.1:\n"), std::string::npos) << text.str();
+}
+
+TEST(AsmPassesTest, DumpsQuadWordOps) {
+    auto program = single_function({
+        {OpCode::MOVSX, Operand::reg(Register::AX), Operand::reg(Register::AX)},
+        {OpCode::MULT64, Operand::reg(Register::R11), Operand::reg(Register::AX)},
+        {OpCode::SAR64, Operand::imm(34), Operand::reg(Register::AX)},
+        {OpCode::RET},
+    });
+    auto path = (std::filesystem::temp_directory_path() /
+        ("asm_passes_test_quad_" + std::to_string(getpid()) + ".s")).string();
+    {
+        ASMDumper dumper(path);
+        dumper.dump_assembly(program);
+    }
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    std::remove(path.c_str());
+    EXPECT_NE(text.str().find(
+        "\tmovslq %eax,  %rax\n"
+        "\timulq  %r11,  %rax\n"
+        "\tsarq  $34,  %rax\n"), std::string::npos);
+}
+
+TEST(AsmPassesTest, PseudosCantBeDumped) {
+    auto path = (std::filesystem::temp_directory_path() /
+        ("asm_passes_test_pseudo_" + std::to_string(getpid()) + ".s")).string();
+    ASMDumper dumper(path);
+    EXPECT_THROW(dumper.dump_assembly(single_function({
+        {OpCode::MOV, Operand::imm(1), Operand::pseudo(0)},
+    })), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+} // namespace Codegen
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
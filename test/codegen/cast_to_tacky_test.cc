@@ -5,6 +5,7 @@
 #include "src/tacky/tacky.h"
 #include "src/codegen/c_ast_to_tacky/c_ast_to_tacky.h"
 #include <string>
+#include <vector>
 
 namespace Codegen {
 
@@ -13,67 +14,137 @@ const std::string basic_program =
     "   return ~(-(~400));\n"
     "}\n";
 
-TEST(TackyTest, BasicProgram) {
-    std::unique_ptr<Lexer::Lexer> l = std::make_unique<Lexer::ManualLexer>(basic_program);
-    auto lexered_tokens = l->Lex();
-    std::unique_ptr<Parser::Parser> p = std::make_unique<Parser::RecursiveDescentParser>(std::move(lexered_tokens));
+Tacky::Program lower(const std::string& code) {
+    std::unique_ptr<Lexer::Lexer> l = std::make_unique<Lexer::ManualLexer>(code);
+    std::unique_ptr<Parser::Parser> p = std::make_unique<Parser::RecursiveDescentParser>(l->Lex());
     std::optional<std::shared_ptr<CAst::ProgramNode>> program_opt = p->parse();
-    ASSERT_TRUE(program_opt.has_value());
-    auto program = program_opt.value();
-
+    EXPECT_TRUE(program_opt.has_value());
     Codegen::AstToTackyVisitor visitor;
-    std::shared_ptr<Tacky::ProgramNode> tacky_program = visitor.get_tacky_from_c_ast(program);
-
-    auto functions = tacky_program->functions_;
-    ASSERT_EQ(functions.size(), 1);
-    ASSERT_EQ(functions[0]->name_, "main");
+    return visitor.get_tacky_from_c_ast(program_opt.value());
+}
 
-    auto instructions = functions[0]->instructions_;
+TEST(TackyTest, BasicProgram) {
+    Tacky::Program program = lower(basic_program);
+    ASSERT_EQ(program.functions_.size(), 1);
+    auto& function = program.functions_[0];
+    ASSERT_EQ(function.name_.str(), "main");
+    ASSERT_EQ(function.temporary_count_, 3);
 
+    auto& instructions = function.instructions_;
     ASSERT_EQ(instructions.size(), 4);
 
-    auto op0 = std::dynamic_pointer_cast<Tacky::ComplementNode>(instructions[0]);
-    ASSERT_NE(nullptr, op0);
-
-    auto op0_src = std::dynamic_pointer_cast<Tacky::IntegerNode>(op0->src_);
-    ASSERT_NE(nullptr, op0_src);
-    ASSERT_EQ(op0_src->value_, 400);
-
-    auto op0_dst = std::dynamic_pointer_cast<Tacky::VariableNode>(op0->dst_);
-    ASSERT_NE(nullptr, op0_dst);
-    ASSERT_EQ(op0_dst->name_, "_tacky_temp_0");
-    
-    auto op1 = std::dynamic_pointer_cast<Tacky::NegateNode>(instructions[1]);
-    ASSERT_NE(nullptr, op1);
+    ASSERT_EQ(instructions[0].op_, Tacky::OpCode::COMPLEMENT);
+    ASSERT_EQ(instructions[0].src1_, Tacky::Value::constant(400));
+    ASSERT_EQ(instructions[0].dst_, Tacky::Value::temporary(0));
+    ASSERT_TRUE(instructions[0].src2_.is_none());
 
-    auto op1_src = std::dynamic_pointer_cast<Tacky::VariableNode>(op1->src_);
-    ASSERT_NE(nullptr, op1_src);
-    ASSERT_EQ(op1_src->name_, "_tacky_temp_0");
+    ASSERT_EQ(instructions[1].op_, Tacky::OpCode::NEGATE);
+    ASSERT_EQ(instructions[1].src1_, Tacky::Value::temporary(0));
+    ASSERT_EQ(instructions[1].dst_, Tacky::Value::temporary(1));
 
-    auto op1_dst = std::dynamic_pointer_cast<Tacky::VariableNode>(op1->dst_);
-    ASSERT_NE(nullptr, op1_dst);
-    ASSERT_EQ(op1_dst->name_, "_tacky_temp_1");
+    ASSERT_EQ(instructions[2].op_, Tacky::OpCode::COMPLEMENT);
+    ASSERT_EQ(instructions[2].src1_, Tacky::Value::temporary(1));
+    ASSERT_EQ(instructions[2].dst_, Tacky::Value::temporary(2));
 
-    auto op2 = std::dynamic_pointer_cast<Tacky::ComplementNode>(instructions[2]);
-    ASSERT_NE(nullptr, op2);
-
-    auto op2_src = std::dynamic_pointer_cast<Tacky::VariableNode>(op2->src_);
-    ASSERT_NE(nullptr, op2_src);
-    ASSERT_EQ(op2_src->name_, "_tacky_temp_1");
-
-    auto op2_dst = std::dynamic_pointer_cast<Tacky::VariableNode>(op2->dst_);
-    ASSERT_NE(nullptr, op2_dst);
-    ASSERT_EQ(op2_dst->name_, "_tacky_temp_2");
+    ASSERT_EQ(instructions[3].op_, Tacky::OpCode::RETURN);
+    ASSERT_EQ(instructions[3].src1_, Tacky::Value::temporary(2));
+    ASSERT_TRUE(instructions[3].dst_.is_none());
+}
 
-    auto op3 = std::dynamic_pointer_cast<Tacky::ReturnNode>(instructions[3]);
-    ASSERT_NE(nullptr, op3);
+TEST(TackyTest, TemporariesAreNumberedPerFunction) {
+    Tacky::Program program = lower(
+        "int f() { return 1 + 2 * 3; }\n"
+        "int g() { return -5 / 2; }\n");
+    ASSERT_EQ(program.functions_.size(), 2);
+
+    auto& f = program.functions_[0].instructions_;
+    ASSERT_EQ(program.functions_[0].temporary_count_, 2);
+    ASSERT_EQ(f.size(), 3);
+    ASSERT_EQ(f[0].op_, Tacky::OpCode::MULT);
+    ASSERT_EQ(f[0].src1_, Tacky::Value::constant(2));
+    ASSERT_EQ(f[0].src2_, Tacky::Value::constant(3));
+    ASSERT_EQ(f[0].dst_, Tacky::Value::temporary(0));
+    ASSERT_EQ(f[1].op_, Tacky::OpCode::PLUS);
+    ASSERT_EQ(f[1].src1_, Tacky::Value::constant(1));
+    ASSERT_EQ(f[1].src2_, Tacky::Value::temporary(0));
+    ASSERT_EQ(f[1].dst_, Tacky::Value::temporary(1));
+
+    // ids restart at zero in every function
+    auto& g = program.functions_[1].instructions_;
+    ASSERT_EQ(program.functions_[1].temporary_count_, 2);
+    ASSERT_EQ(g[0].op_, Tacky::OpCode::NEGATE);
+    ASSERT_EQ(g[0].dst_, Tacky::Value::temporary(0));
+    ASSERT_EQ(g[1].op_, Tacky::OpCode::DIV);
+    ASSERT_EQ(g[1].src1_, Tacky::Value::temporary(0));
+    ASSERT_EQ(g[1].src2_, Tacky::Value::constant(2));
+    ASSERT_EQ(g[1].dst_, Tacky::Value::temporary(1));
+}
 
-    auto op3_value = std::dynamic_pointer_cast<Tacky::VariableNode>(op3->value_);
-    ASSERT_NE(nullptr, op3_value);
-    ASSERT_EQ(op3_value->name_, "_tacky_temp_2");
+TEST(TackyTest, ConstantsNeedNoInstructions) {
+    Tacky::Program program = lower("int main() { return 42; }");
+    auto& function = program.functions_[0];
+    ASSERT_EQ(function.temporary_count_, 0);
+    ASSERT_EQ(function.instructions_.size(), 1);
+    ASSERT_EQ(function.instructions_[0].op_, Tacky::OpCode::RETURN);
+    ASSERT_EQ(function.instructions_[0].src1_, Tacky::Value::constant(42));
+}
 
-    ASSERT_TRUE(visitor.result_buffer_.empty());
+TEST(TackyTest, ShortCircuitsJumpOverDivisionsThatMayTrap) {
+    auto t = [](uint32_t id) { return Tacky::Value::temporary(id); };
+    auto k = [](int value) { return Tacky::Value::constant(value); };
+    auto l = [](uint32_t id) { return Tacky::Value::label(id); };
+    // a divisor that can't trap needs no jump
+    auto safe = lower("int main() { return 1 && 2 / 3; }").functions_[0].instructions_;
+    ASSERT_EQ(safe.size(), 3);
+    EXPECT_EQ(safe[0].op_, Tacky::OpCode::DIV);
+    EXPECT_EQ(safe[1].op_, Tacky::OpCode::AND);
+
+    // the && after the label reads the division on both paths
+    auto function = lower("int main() { return 1 && 2 / (3 - 3); }").functions_[0];
+    EXPECT_EQ(function.label_count_, 1);
+    std::vector<Tacky::Instruction> expected = {
+        {Tacky::OpCode::JUMP_IF_ZERO, Tacky::Value(), k(1), l(0)},
+        {Tacky::OpCode::MINUS, t(0), k(3), k(3)},
+        {Tacky::OpCode::DIV, t(1), k(2), t(0)},
+        {Tacky::OpCode::LABEL, Tacky::Value(), l(0)},
+        {Tacky::OpCode::AND, t(2), k(1), t(1)},
+        {Tacky::OpCode::RETURN, Tacky::Value(), t(2)},
+    };
+    auto& jumping = function.instructions_;
+    ASSERT_EQ(jumping.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        EXPECT_EQ(jumping[i].op_, expected[i].op_) << i;
+        EXPECT_EQ(jumping[i].dst_, expected[i].dst_) << i;
+        EXPECT_EQ(jumping[i].src1_, expected[i].src1_) << i;
+        EXPECT_EQ(jumping[i].src2_, expected[i].src2_) << i;
+    }
+
+    // || skips its right operand when the left one isn't 0, and the inner
+    // skip lands before the outer one
+    auto nested = lower("int main() { return 1 && (2 || 4 % (5 - 5)); }").functions_[0].instructions_;
+    std::vector<Tacky::OpCode> ops;
+    for (auto& instruction : nested) {
+        ops.push_back(instruction.op_);
+    }
+    EXPECT_EQ(ops, (std::vector<Tacky::OpCode>{
+        Tacky::OpCode::JUMP_IF_ZERO, Tacky::OpCode::JUMP_IF_NOT_ZERO, Tacky::OpCode::MINUS, Tacky::OpCode::MOD,
+        Tacky::OpCode::LABEL, Tacky::OpCode::OR, Tacky::OpCode::LABEL, Tacky::OpCode::AND, Tacky::OpCode::RETURN,
+    }));
+    EXPECT_EQ(nested[0].src2_, l(0));
+    EXPECT_EQ(nested[1].src1_, k(2));
+    EXPECT_EQ(nested[1].src2_, l(1));
+    EXPECT_EQ(nested[4].src1_, l(1));
+    EXPECT_EQ(nested[6].src1_, l(0));
+}
 
+TEST(TackyTest, ValueEncoding) {
+    ASSERT_EQ(Tacky::Value::constant(-7).constant_value(), -7);
+    ASSERT_EQ(Tacky::Value::constant(2147483647).constant_value(), 2147483647);
+    ASSERT_TRUE(Tacky::Value::temporary(3).is_temporary());
+    ASSERT_NE(Tacky::Value::temporary(3), Tacky::Value::constant(3));
+    ASSERT_NE(Tacky::Value::label(3), Tacky::Value::temporary(3));
+    ASSERT_EQ(Tacky::Value::label(3).label_id(), 3);
+    ASSERT_TRUE(Tacky::Value().is_none());
 }
 
 } // namespace Codegen
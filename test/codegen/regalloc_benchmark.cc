@@ -0,0 +1,153 @@
+#include "src/lexer/dfa_lexer.h"
+#include "src/parser/parser.h"
+#include "src/codegen/c_ast_to_tacky/c_ast_to_tacky.h"
+#include "src/codegen/tacky_to_asm/tacky_to_asm.h"
+#include "src/codegen/asm_dump/asm_dump.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Runtime cycles of the examples/ programs compiled with and without the
+// register allocator. Each program's main is renamed and linked against a
+// driver that calls it --calls times under rdtsc, keeping the best of
+// --rounds. Needs a C compiler to assemble and link, --cc=cc by default.
+// --peephole runs the peephole pass after fixup in both configurations.
+
+std::string EXAMPLES = "examples", CC = "cc";
+int CALLS = 1000000, ROUNDS = 5;
+bool PEEPHOLE = false;
+
+const char* kDriver = R"(#include <stdio.h>
+#include <x86intrin.h>
+int bench_entry(void);
+int main(int argc, char** argv) {
+    int calls = CALLS, rounds = ROUNDS;
+    unsigned long long best = ~0ull;
+    volatile int sink = 0;
+    for (int round = 0; round < rounds; round++) {
+        unsigned long long start = __rdtsc();
+        for (int i = 0; i < calls; i++) {
+            sink += bench_entry();
+        }
+        unsigned long long cycles = __rdtsc() - start;
+        best = cycles < best ? cycles : best;
+    }
+    printf("%f\n", (double)best / calls);
+    return 0;
+}
+)";
+
+struct Compiled {
+    size_t instructions = 0;
+    size_t stack_operands = 0;
+    // negative when the program traps, e.g. on a division by zero
+    double cycles_per_call = -1;
+};
+
+Compiled compile_and_run(const std::string& code, bool allocate, const std::filesystem::path& work_dir) {
+    Parser::RecursiveDescentParser parser(Lexer::DfaLexer(code).Lex());
+    auto c_ast = parser.parse();
+    if (!c_ast.has_value()) {
+        throw std::runtime_error("Parsing failed");
+    }
+    Codegen::AstToTackyVisitor tacky_visitor;
+    auto tacky_program = tacky_visitor.get_tacky_from_c_ast(c_ast.value());
+    Codegen::TackyToAsmVisitor asm_visitor;
+    auto asm_program = asm_visitor.get_asm_from_tacky(tacky_program);
+    if (allocate) {
+        Codegen::RegisterAllocatorVisitor register_allocator;
+        register_allocator.rewrite(asm_program);
+    }
+    Codegen::PseudoReplacerVisitor pseudo_replacer;
+    pseudo_replacer.rewrite(asm_program);
+    Codegen::InstructionFixUpVisitor fixup;
+    fixup.rewrite(asm_program);
+    if (PEEPHOLE) {
+        Codegen::PeepholeVisitor peephole;
+        peephole.rewrite(asm_program);
+    }
+
+    Compiled result;
+    for (auto& function : asm_program.functions_) {
+        if (function.name_.str() == "main") {
+            function.name_ = Source::Symbol::intern("bench_entry");
+        }
+        result.instructions += function.instructions_.size();
+        for (auto& instruction : function.instructions_) {
+            result.stack_operands += instruction.src_.is_stack() + instruction.dst_.is_stack();
+        }
+    }
+    auto assembly = work_dir / "program.s";
+    auto binary = work_dir / "program";
+    {
+        Codegen::ASMDumper dumper(assembly.string());
+        dumper.dump_assembly(asm_program);
+    }
+    std::string command = CC + " -O2 -DCALLS=" + std::to_string(CALLS) + " -DROUNDS=" + std::to_string(ROUNDS) + " " +
+        (work_dir / "driver.c").string() + " " + assembly.string() + " -o " + binary.string();
+    if (std::system(command.c_str()) != 0) {
+        throw std::runtime_error("Unable to build " + binary.string());
+    }
+    // stderr is dropped so a trapping program only shows up as missing cycles
+    FILE* output = popen((binary.string() + " 2>/dev/null").c_str(), "r");
+    if (output == nullptr) {
+        throw std::runtime_error("Unable to run " + binary.string());
+    }
+    if (std::fscanf(output, "%lf", &result.cycles_per_call) != 1) {
+        result.cycles_per_call = -1;
+    }
+    pclose(output);
+    return result;
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg(argv[i]);
+        if (arg.starts_with("--examples=")) {
+            EXAMPLES = std::string(arg.substr(11));
+        } else if (arg.starts_with("--cc=")) {
+            CC = std::string(arg.substr(5));
+        } else if (arg.starts_with("--calls=")) {
+            CALLS = std::stoi(std::string(arg.substr(8)));
+        } else if (arg.starts_with("--rounds=")) {
+            ROUNDS = std::stoi(std::string(arg.substr(9)));
+        } else if (arg == "--peephole") {
+            PEEPHOLE = true;
+        }
+    }
+    auto work_dir = std::filesystem::temp_directory_path() / ("regalloc_benchmark_" + std::to_string(getpid()));
+    std::filesystem::create_directories(work_dir);
+    std::ofstream(work_dir / "driver.c") << kDriver;
+
+    std::vector<std::filesystem::path> sources;
+    for (auto& entry : std::filesystem::directory_iterator(EXAMPLES)) {
+        if (entry.path().extension() == ".c") {
+            sources.push_back(entry.path());
+        }
+    }
+    std::sort(sources.begin(), sources.end());
+    for (auto& source : sources) {
+        std::ifstream in(source);
+        std::stringstream code;
+        code << in.rdbuf();
+        auto stack = compile_and_run(code.str(), false, work_dir);
+        auto registers = compile_and_run(code.str(), true, work_dir);
+        std::cout << source.filename().string() << ": ";
+        if (stack.cycles_per_call < 0 || registers.cycles_per_call < 0) {
+            std::cout << "traps, ";
+        } else {
+            std::cout << stack.cycles_per_call << " -> " << registers.cycles_per_call << " cycles per call, ";
+        }
+        std::cout << stack.instructions << " -> " << registers.instructions << " instructions, "
+                  << stack.stack_operands << " -> " << registers.stack_operands << " stack operands" << std::endl;
+    }
+    std::filesystem::remove_all(work_dir);
+    return 0;
+}
@@ -1,18 +1,30 @@
+#include <climits>
+#include <fstream>
 #include <string>
 #include <random>
+#include <utility>
 #include <iostream>
+#include <iterator>
+#include <optional>
+#include <vector>
 
 #include "src/ast/ast.h"
 #include "src/codegen/c_ast_to_tacky/c_ast_to_tacky.h"
 #include "src/codegen/tacky_to_asm/tacky_to_asm.h"
 #include "src/codegen/asm_dump/asm_dump.h"
+#include "src/optimizer/optimizer.h"
 #include "src/lexer/lexer.h"
+#include "src/lexer/dfa_lexer.h"
 #include "src/parser/parser.h"
 
 #include "gtest/gtest.h"
 
 
-int SEED = 42, ITERATIONS = 100, MAX_HEIGHT = 7;
+int SEED = 42, ITERATIONS = 100, MAX_HEIGHT = 7, DIVISOR_RANGE = 300;
+// summed over every program compiled with -O
+Optimizer::Stats OPTIMIZER_STATS;
+// shared by every compiled program, so its hit counts cover all of them
+Codegen::PeepholeVisitor PEEPHOLE;
 
 class RNG {
 private:
@@ -27,109 +39,64 @@ public:
     }
 };
 
-std::shared_ptr<CAst::ExpressionNode> rand_unexp(RNG& rng, int height);
-std::shared_ptr<CAst::ExpressionNode> rand_binexp(RNG& rng, int height);
-std::shared_ptr<CAst::ExpressionNode> rand_exp(RNG& rng, int height);
+CAst::ExpressionNode* rand_unexp(CAst::Arena& arena, RNG& rng, int height);
+CAst::ExpressionNode* rand_binexp(CAst::Arena& arena, RNG& rng, int height);
+CAst::ExpressionNode* rand_exp(CAst::Arena& arena, RNG& rng, int height);
 
-class CAstPrettyPrint : public CAst::Visitor {
+class CAstPrettyPrint {
 private:
     std::string expr_;
 public:
     ~CAstPrettyPrint() = default;
     CAstPrettyPrint() : expr_("") {}
-    void visit(CAst::TypeNode& node) override {}
-    void visit(CAst::FunctionArgumentsNode& node) override {}
-    void visit(CAst::StatementBlockNode& node) override {}
-    void visit(CAst::FunctionNode& node) override {}
-    void visit(CAst::ProgramNode& node) override {}
 
-    void visit(CAst::ReturnStatementNode& node) override {
+    void visit(CAst::ReturnStatementNode& node) {
         expr_ += "return ";
-        node.return_value_->accept(*this);
+        visit(*node.return_value_);
         expr_ += ";";
     }
-    void visit(CAst::TildeUnaryExpressionNode& node) override {
-        expr_ += "~(";
-        node.operand_->accept(*this);
-        expr_ += ")";
-    }
-    void visit(CAst::MinusUnaryExpressionNode& node) override {
-        expr_ += "-(";
-        node.operand_->accept(*this);
-        expr_ += ")";
-    }
-    void visit(CAst::NotUnaryExpressionNode& node) override {
-        expr_ += "(!";
-        node.operand_->accept(*this);
-        expr_ += ")";
-    }
-    void visit(CAst::IntegerValueNode& node) override {
-        expr_ += std::to_string(node.value_);
-    }
-    void visit(CAst::DivNode& node) {
-        node.left_->accept(*this);
-        expr_ += "/";
-        node.right_->accept(*this);
-    }
-    void visit(CAst::MultNode& node) {
-        node.left_->accept(*this);
-        expr_ += "*";
-        node.right_->accept(*this);
-    }
-    void visit(CAst::ModNode& node) {
-        node.left_->accept(*this);
-        expr_ += "%";
-        node.right_->accept(*this);
-    }
-    void visit(CAst::MinusNode& node) {
-        expr_ += "(";
-        node.left_->accept(*this);
-        expr_ += ")";
-        expr_ += "-";
-        expr_ += "(";
-        node.right_->accept(*this);
-        expr_ += ")";
-
-    }
-    void visit(CAst::BitwiseAndNode& node) {
-        node.left_->accept(*this);
-        expr_ += "&";
-        node.right_->accept(*this);
-    }
-    void visit(CAst::BitwiseOrNode& node) {
-        node.left_->accept(*this);
-        expr_ += "|";
-        node.right_->accept(*this);
-    }
-    void visit(CAst::BitwiseXorNode& node) {
-        node.left_->accept(*this);
-        expr_ += "^";
-        node.right_->accept(*this);
-    }
-    void visit(CAst::BitwiseLeftShiftNode& node) {
-        node.left_->accept(*this);
-        expr_ += "<<";
-        node.right_->accept(*this);
-    }
-    void visit(CAst::BitwiseRightShiftNode& node) {
-        node.left_->accept(*this);
-        expr_ += ">>";
-        node.right_->accept(*this);
-    }
-    void visit(CAst::AndNode& node) {
-        node.left_->accept(*this);
-        expr_ += "&&";
-        node.right_->accept(*this);
-    }
-    void visit(CAst::OrNode& node) {
-        node.left_->accept(*this);
-        expr_ += "||";
-        node.right_->accept(*this);
-    }
-    void visit(CAst::PlusNode& node) {
-        node.left_->accept(*this);
-        expr_ += "+";
-        node.right_->accept(*this);
+    void visit(CAst::ExpressionNode& node) {
+        switch (node.kind_) {
+            case CAst::NodeKind::INTEGER_VALUE:
+                expr_ += std::to_string(static_cast<CAst::IntegerValueNode&>(node).value_);
+                break;
+            case CAst::NodeKind::UNARY_EXPRESSION:
+                visit(static_cast<CAst::UnaryExpressionNode&>(node));
+                break;
+            case CAst::NodeKind::BINARY_EXPRESSION:
+                visit(static_cast<CAst::BinaryExpressionNode&>(node));
+                break;
+            default:
+                throw std::runtime_error("Unexpected node kind in expression");
+        }
+    }
+    void visit(CAst::UnaryExpressionNode& node) {
+        switch (node.op_) {
+            case CAst::UnaryOperator::COMPLEMENT:
+            case CAst::UnaryOperator::NEGATE:
+                expr_ += CAst::unary_operator_as_str(node.op_) + "(";
+                visit(*node.operand_);
+                expr_ += ")";
+                break;
+            case CAst::UnaryOperator::NOT:
+                expr_ += "(!";
+                visit(*node.operand_);
+                expr_ += ")";
+                break;
+        }
+    }
+    void visit(CAst::BinaryExpressionNode& node) {
+        if (node.op_ == CAst::BinaryOperator::MINUS) {
+            expr_ += "(";
+            visit(*node.left_);
+            expr_ += ")-(";
+            visit(*node.right_);
+            expr_ += ")";
+            return;
+        }
+        visit(*node.left_);
+        expr_ += CAst::binary_operator_as_str(node.op_);
+        visit(*node.right_);
     }
     std::string get_return_string() {
         return expr_;
@@ -147,38 +114,62 @@ const std::vector<std::string> bin_ops = {
     "BITWISE_XOR",
     "SHIFT_LEFT",
     "SHIFT_RIGHT",
+    "EQUAL",
+    "NOT_EQUAL",
+    "LESS",
+    "GREATER",
+    "LESS_EQ",
+    "GREATER_EQ",
+    "AND",
+    "OR",
 };
 
-std::shared_ptr<CAst::ExpressionNode> rand_binexp(RNG& rng, int height) {
+CAst::ExpressionNode* rand_binexp(CAst::Arena& arena, RNG& rng, int height) {
     if (height == 0) {
         int number = rng.draw(0, 200);
-        return std::make_shared<CAst::IntegerValueNode>(number);
+        return arena.make<CAst::IntegerValueNode>(number);
     }
-    auto left = rand_exp(rng, height - 1);
-    auto right = rand_exp(rng, height - 1);
+    auto left = rand_exp(arena, rng, height - 1);
+    auto right = rand_exp(arena, rng, height - 1);
     auto draw_idx = rng.draw(0, bin_ops.size()-1);
     auto draw_kind = bin_ops[draw_idx];
 
     if (draw_kind == "MULT") {
-        return std::make_shared<CAst::MultNode>(left, right);
+        return arena.make<CAst::BinaryExpressionNode>(CAst::BinaryOperator::MULT, left, right);
     } else if (draw_kind == "DIV") {
-        return std::make_shared<CAst::DivNode>(left, right);
+        return arena.make<CAst::BinaryExpressionNode>(CAst::BinaryOperator::DIV, left, right);
     } else if (draw_kind == "PLUS") {
-        return std::make_shared<CAst::PlusNode>(left, right);
+        return arena.make<CAst::BinaryExpressionNode>(CAst::BinaryOperator::PLUS, left, right);
     } else if (draw_kind == "MINUS") {
-        return std::make_shared<CAst::MinusNode>(left, right);
+        return arena.make<CAst::BinaryExpressionNode>(CAst::BinaryOperator::MINUS, left, right);
     } else if (draw_kind == "MOD") {
-        return std::make_shared<CAst::ModNode>(left, right);
+        return arena.make<CAst::BinaryExpressionNode>(CAst::BinaryOperator::MOD, left, right);
     } else if (draw_kind == "BITWISE_AND") {
-        return std::make_shared<CAst::BitwiseAndNode>(left, right);
+        return arena.make<CAst::BinaryExpressionNode>(CAst::BinaryOperator::BITWISE_AND, left, right);
     } else if (draw_kind == "BITWISE_OR") {
-        return std::make_shared<CAst::BitwiseOrNode>(left, right);
+        return arena.make<CAst::BinaryExpressionNode>(CAst::BinaryOperator::BITWISE_OR, left, right);
     } else if (draw_kind == "BITWISE_XOR") {
-        return std::make_shared<CAst::BitwiseXorNode>(left, right);
+        return arena.make<CAst::BinaryExpressionNode>(CAst::BinaryOperator::BITWISE_XOR, left, right);
     } else if (draw_kind == "SHIFT_LEFT") {
-        return std::make_shared<CAst::BitwiseLeftShiftNode>(left, right);
+        return arena.make<CAst::BinaryExpressionNode>(CAst::BinaryOperator::LEFT_SHIFT, left, right);
     } else if (draw_kind == "SHIFT_RIGHT") {
-        return std::make_shared<CAst::BitwiseRightShiftNode>(left, right);
+        return arena.make<CAst::BinaryExpressionNode>(CAst::BinaryOperator::RIGHT_SHIFT, left, right);
+    } else if (draw_kind == "EQUAL") {
+        return arena.make<CAst::BinaryExpressionNode>(CAst::BinaryOperator::EQUAL, left, right);
+    } else if (draw_kind == "NOT_EQUAL") {
+        return arena.make<CAst::BinaryExpressionNode>(CAst::BinaryOperator::NOT_EQUAL, left, right);
+    } else if (draw_kind == "LESS") {
+        return arena.make<CAst::BinaryExpressionNode>(CAst::BinaryOperator::LESS, left, right);
+    } else if (draw_kind == "GREATER") {
+        return arena.make<CAst::BinaryExpressionNode>(CAst::BinaryOperator::GREATER, left, right);
+    } else if (draw_kind == "LESS_EQ") {
+        return arena.make<CAst::BinaryExpressionNode>(CAst::BinaryOperator::LESS_EQ, left, right);
+    } else if (draw_kind == "GREATER_EQ") {
+        return arena.make<CAst::BinaryExpressionNode>(CAst::BinaryOperator::GREATER_EQ, left, right);
+    } else if (draw_kind == "AND") {
+        return arena.make<CAst::BinaryExpressionNode>(CAst::BinaryOperator::AND, left, right);
+    } else if (draw_kind == "OR") {
+        return arena.make<CAst::BinaryExpressionNode>(CAst::BinaryOperator::OR, left, right);
     } else {
         throw std::runtime_error("Unsupported binop: " + draw_kind);
     }
@@ -187,49 +178,64 @@ std::shared_ptr<CAst::ExpressionNode> rand_binexp(RNG& rng, int height) {
 const std::vector<std::string> un_ops = {
     "MINUS",
     "TILDE",
+    "NOT",
 };
 
-std::shared_ptr<CAst::ExpressionNode> rand_unexp(RNG& rng, int height) {
+CAst::ExpressionNode* rand_unexp(CAst::Arena& arena, RNG& rng, int height) {
     if (height == 0) {
         int number = rng.draw(0, 200);
-        return std::make_shared<CAst::IntegerValueNode>(number);
+        return arena.make<CAst::IntegerValueNode>(number);
     }
-    auto operand = rand_exp(rng, height - 1);
+    auto operand = rand_exp(arena, rng, height - 1);
     auto draw_idx = rng.draw(0, un_ops.size() - 1);
     auto draw_kind = un_ops[draw_idx];
     if (draw_kind == "MINUS") {
-        return std::make_shared<CAst::MinusUnaryExpressionNode>(operand);
+        return arena.make<CAst::UnaryExpressionNode>(CAst::UnaryOperator::NEGATE, operand);
     } else if (draw_kind == "TILDE") {
-        return std::make_shared<CAst::TildeUnaryExpressionNode>(operand);
+        return arena.make<CAst::UnaryExpressionNode>(CAst::UnaryOperator::COMPLEMENT, operand);
+    } else if (draw_kind == "NOT") {
+        return arena.make<CAst::UnaryExpressionNode>(CAst::UnaryOperator::NOT, operand);
     } else {
         throw std::runtime_error("Unsupported unop: " + draw_kind);
     }
 }
 
-std::shared_ptr<CAst::ExpressionNode> rand_exp(RNG& rng, int height) {
+CAst::ExpressionNode* rand_exp(CAst::Arena& arena, RNG& rng, int height) {
     auto draw = rng.draw(0, 2);
     if (draw%2 == 0) {
-        return rand_binexp(rng, height);
+        return rand_binexp(arena, rng, height);
     } else {
-       return rand_unexp(rng, height);
+       return rand_unexp(arena, rng, height);
     }
 }
 
-void dump_asm_to_file(std::string filename, std::string prog) {
-        auto lex = Lexer::ManualLexer(prog);
-        auto parser = Parser::RecursiveDescentParser(lex.Lex());
-        auto CAst = parser.parse();
-        auto tacky_visitor = Codegen::AstToTackyVisitor();
-        std::shared_ptr<Tacky::ProgramNode> tacky_program = tacky_visitor.get_tacky_from_c_ast(CAst.value());
+void dump_tacky_to_file(std::string filename, Tacky::Program& tacky_program) {
         auto asm_visitor = Codegen::TackyToAsmVisitor();
-        std::shared_ptr<ASM::ProgramNode> asm_program = asm_visitor.get_asm_from_tacky(tacky_program);      
+        ASM::Program asm_program = asm_visitor.get_asm_from_tacky(tacky_program);
+        auto register_allocator_visitor = Codegen::RegisterAllocatorVisitor();
+        register_allocator_visitor.rewrite(asm_program);
         auto pseudo_replacement_visitor = Codegen::PseudoReplacerVisitor();
-        auto no_pseudo_asm_program = pseudo_replacement_visitor.get_rewritten_asm_program(asm_program);
-        int max_offset = pseudo_replacement_visitor.get_offset();
-        auto instruction_fixup_visitor = Codegen::InstructionFixUpVisitor(max_offset);
-        auto fixed_asm_program = instruction_fixup_visitor.get_rewritten_asm_program(no_pseudo_asm_program);
+        pseudo_replacement_visitor.rewrite(asm_program);
+        auto instruction_fixup_visitor = Codegen::InstructionFixUpVisitor();
+        instruction_fixup_visitor.rewrite(asm_program);
+        PEEPHOLE.rewrite(asm_program);
         auto asm_dump_visitor = Codegen::ASMDumper(std::string(filename));
-        asm_dump_visitor.dump_assembly(fixed_asm_program);
+        asm_dump_visitor.dump_assembly(asm_program);
+}
+
+void dump_asm_to_file(std::string filename, std::string prog, bool optimize) {
+        auto lex = Lexer::DfaLexer(prog);
+        auto parser = Parser::RecursiveDescentParser(lex.Lex());
+        auto CAst = parser.parse();
+        auto tacky_visitor = Codegen::AstToTackyVisitor();
+        Tacky::Program tacky_program = tacky_visitor.get_tacky_from_c_ast(CAst.value());
+        if (optimize) {
+            auto stats = Optimizer::optimize(tacky_program);
+            OPTIMIZER_STATS.instructions_before += stats.instructions_before;
+            OPTIMIZER_STATS.value_numbered += stats.value_numbered;
+            OPTIMIZER_STATS.instructions_after += stats.instructions_after;
+        }
+        dump_tacky_to_file(filename, tacky_program);
 }
 
 TEST(FuzzTest, ExpressionFuzzingTest) {
@@ -242,7 +248,8 @@ TEST(FuzzTest, ExpressionFuzzingTest) {
 
     for(int i=0;i<ITERATIONS;i++) {
         int random_height = seeded_rng.draw(1, MAX_HEIGHT);
-        auto expr = rand_exp(seeded_rng, random_height);
+        CAst::Arena arena;
+        auto expr = rand_exp(arena, seeded_rng, random_height);
         auto pretty_printer = CAstPrettyPrint();
         auto random_ret = CAst::ReturnStatementNode(
             CAst::Type::INTEGER,
@@ -261,7 +268,6 @@ TEST(FuzzTest, ExpressionFuzzingTest) {
 
         // Write C source
         std::ofstream(c_file) << prog;
-        dump_asm_to_file(s_file, prog);
 
         // 2. Reference Execution (GCC)
         std::string compile_cmd = "gcc " + c_file + " -o " + gcc_bin + " 2> " + work_dir + "/gcc_err.txt";
@@ -273,15 +279,414 @@ TEST(FuzzTest, ExpressionFuzzingTest) {
             std::cout << "Skipping: GCC detected undefined behavior at compile-time : " << err_content << std::endl;
             continue; // Skip iteration      
         }
-        // 4. Assemble your output and Run
-        std::system(("gcc " + s_file + " -o " + my_bin).c_str());
-        int my_exit_code = WEXITSTATUS(std::system(my_bin.c_str()));
         int gcc_exit_code = WEXITSTATUS(std::system(gcc_bin.c_str()));
 
-        // 5. Compare
-        EXPECT_EQ(gcc_exit_code, my_exit_code) << "Mismatch for: " << prog;
+        // 4. Assemble your output and Run, with and without -O
+        for (bool optimize : {false, true}) {
+            dump_asm_to_file(s_file, prog, optimize);
+            std::system(("gcc " + s_file + " -o " + my_bin).c_str());
+            int my_exit_code = WEXITSTATUS(std::system(my_bin.c_str()));
+
+            // 5. Compare
+            EXPECT_EQ(gcc_exit_code, my_exit_code) << "Mismatch for: " << prog << (optimize ? " with -O" : "");
+        }
+
+    }
+    std::cout << "-O: " << OPTIMIZER_STATS.instructions_before << " TACKY instructions in, "
+              << OPTIMIZER_STATS.value_numbered << " removed by value numbering, "
+              << OPTIMIZER_STATS.instructions_after << " left" << std::endl;
+    for (auto& [rule, hits] : PEEPHOLE.hits()) {
+        std::cout << "peephole " << rule << ": " << hits << std::endl;
+    }
+}
+
+// C source for n, which can't be spelled as a single literal when it is INT_MIN
+std::string int_literal(int n) {
+    if (n == INT_MIN) {
+        return "(-2147483647 - 1)";
+    }
+    return n < 0 ? "(-" + std::to_string(-static_cast<long long>(n)) + ")" : std::to_string(n);
+}
+
+int random_int(RNG& rng) {
+    return static_cast<int>(static_cast<uint32_t>(rng.draw(0, 0xffff)) << 16 | rng.draw(0, 0xffff));
+}
+
+// A C program, built by gcc, that calls each compiled function and compares
+// it against an expression gcc computes over a few volatile ints. Checks go
+// in batches, one huge main takes gcc ages.
+class Checker {
+private:
+    std::string variables_;
+    std::string declarations_ = "#include <stdio.h>\n";
+    std::string checks_;
+    int count_ = 0;
+    int batches_ = 0;
+
+public:
+    Checker(std::string variables) : variables_(variables) {}
+
+    int count() const { return count_; }
+
+    // setup assigns the variables, report is the printf format and
+    // arguments shown after the function name on a mismatch
+    void add(const std::string& name, const std::string& setup, const std::string& expected, const std::string& report) {
+        if (count_ % 512 == 0) {
+            if (batches_ > 0) {
+                checks_ += "    return failures;\n}\n";
+            }
+            checks_ += "static int check" + std::to_string(batches_) + "(void) {\n";
+            if (!variables_.empty()) {
+                checks_ += "    volatile int " + variables_ + ";\n";
+            }
+            checks_ += "    int failures = 0;\n";
+            batches_++;
+        }
+        count_++;
+        declarations_ += "int " + name + "(void);\n";
+        if (!setup.empty()) {
+            checks_ += "    " + setup + "\n";
+        }
+        checks_ += "    if (" + name + "() != " + expected + ") { printf(\"" + name + ": " + report + "); failures++; }\n";
+    }
 
+    std::string source(const std::string& helpers = "") const {
+        std::string source = declarations_ + helpers + checks_ + "    return failures;\n}\n\nint main(void) {\n    int failures = 0;\n";
+        for (int i = 0; i < batches_; i++) {
+            source += "    failures += check" + std::to_string(i) + "();\n";
+        }
+        return source + "    printf(\"%d failures\\n\", failures);\n    return failures != 0;\n}\n";
     }
+};
+
+std::string checker_path(const std::string& name, const std::string& suffix) {
+    const char* bazel_tmp = std::getenv("TEST_TMPDIR");
+    std::string work_dir = bazel_tmp ? std::string(bazel_tmp) : ".";
+    return work_dir + "/" + name + suffix;
+}
+
+// links the functions compiled into s_file against checker and runs it
+void link_checker(const std::string& name, const std::string& s_file, const std::string& checker) {
+    std::string checker_file = checker_path(name, "_checker.c");
+    std::string bin = checker_path(name, "_bin");
+    std::ofstream(checker_file) << checker;
+    ASSERT_EQ(std::system(("gcc -w " + checker_file + " " + s_file + " -o " + bin).c_str()), 0);
+    EXPECT_EQ(std::system(bin.c_str()), 0) << name << " mismatches, see the output above";
+}
+
+// compiles program, links it against checker and runs it
+void run_checker(const std::string& name, Tacky::Program& program, const std::string& checker) {
+    std::string s_file = checker_path(name, ".s");
+    dump_tacky_to_file(s_file, program);
+    link_checker(name, s_file, checker);
+}
+
+// Constant divisors lower to a multiply high and shift. Every divisor in
+// [-DIVISOR_RANGE, DIVISOR_RANGE], the powers of two and their neighbours,
+// the extremes and random ones are each compiled as a function dividing
+// edge case and random dividends, and a checker built by gcc compares each
+// result against a runtime idiv. The functions are built in Tacky, so the
+// divisor is an operand even when it is negative, and n + 0 keeps the
+// dividend in a temporary. Quotient and remainder of the same operands are
+// also checked together, since they come out of a single division.
+TEST(FuzzTest, ConstantDivisionMatchesGcc) {
+    auto seeded_rng = RNG(SEED);
+
+    std::vector<int> divisors;
+    for (int d = -DIVISOR_RANGE; d <= DIVISOR_RANGE; d++) {
+        divisors.push_back(d);
+    }
+    for (int k = 1; k < 31; k++) {
+        for (int d : {(1 << k) - 1, 1 << k, (1 << k) + 1}) {
+            divisors.push_back(d);
+            divisors.push_back(-d);
+        }
+    }
+    for (int d : {INT_MAX, INT_MIN, INT_MIN + 1, INT_MAX - 1}) {
+        divisors.push_back(d);
+    }
+    for (int i = 0; i < 200; i++) {
+        divisors.push_back(random_int(seeded_rng));
+    }
+
+    Tacky::Program program;
+    Checker checker("n, d");
+    auto add_check = [&](const std::string& name, int n, int d, const std::string& expected, const std::string& label) {
+        checker.add(name, "n = " + int_literal(n) + "; d = " + int_literal(d) + ";", expected,
+                    "%d " + label + " %d\\n\", n, d");
+    };
+    for (int d : divisors) {
+        if (d == 0) {
+            continue;
+        }
+        long long wide = d;
+        for (long long n : {-wide - 1, -wide, -wide + 1, -1ll, 0ll, 1ll, wide - 1, wide, wide + 1,
+                            static_cast<long long>(INT_MIN), INT_MIN + 1ll, static_cast<long long>(INT_MAX),
+                            static_cast<long long>(random_int(seeded_rng))}) {
+            // the one quotient that traps, and neighbours that don't fit an int
+            if ((d == -1 && n == INT_MIN) || n < INT_MIN || n > INT_MAX) {
+                continue;
+            }
+            for (const char* op : {" / ", " % "}) {
+                auto name = "f" + std::to_string(checker.count());
+                auto dividend = Tacky::Value::temporary(0);
+                auto result = Tacky::Value::temporary(1);
+                program.functions_.push_back(Tacky::Function{Source::Symbol::intern(name), 2, {
+                    {Tacky::OpCode::PLUS, dividend, Tacky::Value::constant(static_cast<int>(n)), Tacky::Value::constant(0)},
+                    {op[1] == '/' ? Tacky::OpCode::DIV : Tacky::OpCode::MOD, result, dividend, Tacky::Value::constant(d)},
+                    {Tacky::OpCode::RETURN, Tacky::Value(), result},
+                }});
+                add_check(name, static_cast<int>(n), d, std::string("n") + op + "d", std::string(1, op[1]));
+            }
+            // n / d ^ n % d shares one division, with d both known and in a temporary
+            for (bool known : {true, false}) {
+                // idiv doesn't care which divisor it gets, a few of them do
+                if (!known && (wide < -16 || wide > 16) && d != INT_MIN && d != INT_MAX) {
+                    continue;
+                }
+                auto name = "f" + std::to_string(checker.count());
+                auto dividend = Tacky::Value::temporary(0);
+                auto divisor = known ? Tacky::Value::constant(d) : Tacky::Value::temporary(1);
+                program.functions_.push_back(Tacky::Function{Source::Symbol::intern(name), 5, {
+                    {Tacky::OpCode::PLUS, dividend, Tacky::Value::constant(static_cast<int>(n)), Tacky::Value::constant(0)},
+                    {Tacky::OpCode::PLUS, Tacky::Value::temporary(1), Tacky::Value::constant(d), Tacky::Value::constant(0)},
+                    {Tacky::OpCode::DIV, Tacky::Value::temporary(2), dividend, divisor},
+                    {Tacky::OpCode::MOD, Tacky::Value::temporary(3), dividend, divisor},
+                    {Tacky::OpCode::BITWISE_XOR, Tacky::Value::temporary(4), Tacky::Value::temporary(2), Tacky::Value::temporary(3)},
+                    {Tacky::OpCode::RETURN, Tacky::Value(), Tacky::Value::temporary(4)},
+                }});
+                add_check(name, static_cast<int>(n), d, "(n / d ^ n % d)", "/%%");
+            }
+        }
+    }
+    run_checker("division", program, checker.source());
+    std::cout << "checked " << checker.count() << " constant divisions" << std::endl;
+}
+
+// constants the tiles care about: lea scales and their neighbours, shift
+// counts, and the extremes, mixed with random ones
+int rand_tile_constant(RNG& rng) {
+    static const int interesting[] = {-9, -5, -3, -2, -1, 0, 1, 2, 3, 4, 5, 7, 8, 9, 10, 16, INT_MIN, INT_MAX};
+    if (rng.draw(0, 3) == 0) {
+        return random_int(rng);
+    }
+    return interesting[rng.draw(0, std::size(interesting) - 1)];
+}
+
+// Appends a random tree to instructions, leaves are constants or the
+// temporaries holding a, b and c. expected gets the same tree in C, with
+// the helpers in kWrapping standing in for what would overflow.
+Tacky::Value rand_tile_tree(RNG& rng, int height, Tacky::Function& function, std::string& expected) {
+    if (height == 0 || rng.draw(0, 4) == 0) {
+        auto leaf = rng.draw(0, 4);
+        if (leaf < 3) {
+            expected += std::string(1, 'a' + leaf);
+            return Tacky::Value::temporary(leaf);
+        }
+        int k = rand_tile_constant(rng);
+        expected += int_literal(k);
+        return Tacky::Value::constant(k);
+    }
+    static const std::pair<Tacky::OpCode, const char*> ops[] = {
+        {Tacky::OpCode::PLUS, "add"}, {Tacky::OpCode::MINUS, "sub"}, {Tacky::OpCode::MULT, "mul"},
+        {Tacky::OpCode::LEFT_SHIFT, "shl"}, {Tacky::OpCode::RIGHT_SHIFT, "sar"},
+        {Tacky::OpCode::BITWISE_AND, "and"}, {Tacky::OpCode::BITWISE_OR, "or"}, {Tacky::OpCode::BITWISE_XOR, "xor"},
+        {Tacky::OpCode::NEGATE, "neg"}, {Tacky::OpCode::COMPLEMENT, "not"},
+    };
+    auto [op, helper] = ops[rng.draw(0, std::size(ops) - 1)];
+    expected += std::string(helper) + "(";
+    auto left = rand_tile_tree(rng, height - 1, function, expected);
+    Tacky::Value right;
+    if (op == Tacky::OpCode::LEFT_SHIFT || op == Tacky::OpCode::RIGHT_SHIFT) {
+        // counts past the width are undefined in C
+        int count = rng.draw(0, 1) ? rng.draw(1, 3) : rng.draw(0, 31);
+        expected += ", " + std::to_string(count);
+        right = Tacky::Value::constant(count);
+    } else if (!Tacky::is_unary(op)) {
+        expected += ", ";
+        right = rand_tile_tree(rng, height - 1, function, expected);
+    }
+    expected += ")";
+    auto dst = Tacky::Value::temporary(function.temporary_count_++);
+    function.instructions_.push_back({op, dst, left, right});
+    return dst;
+}
+
+constexpr const char* kWrapping =
+    "static int add(int x, int y) { return (int)((unsigned)x + (unsigned)y); }\n"
+    "static int sub(int x, int y) { return (int)((unsigned)x - (unsigned)y); }\n"
+    "static int mul(int x, int y) { return (int)((unsigned)x * (unsigned)y); }\n"
+    "static int shl(int x, int k) { return (int)((unsigned)x << k); }\n"
+    "static int sar(int x, int k) { return x >> k; }\n"
+    "static int and(int x, int y) { return x & y; }\n"
+    "static int or(int x, int y) { return x | y; }\n"
+    "static int xor(int x, int y) { return x ^ y; }\n"
+    "static int neg(int x) { return (int)(0u - (unsigned)x); }\n"
+    "static int not(int x) { return ~x; }\n";
+
+// Arithmetic lowers by tiling expression trees, so random trees over the
+// arithmetic ops, with the constants lea and imul tiles match, are compiled
+// as functions and a checker built by gcc compares each result against the
+// same tree computed with wrapping arithmetic. a, b and c are loaded as
+// n + 0 so they sit in temporaries, folded into the tree when used once.
+TEST(FuzzTest, TiledArithmeticMatchesGcc) {
+    auto seeded_rng = RNG(SEED);
+    Tacky::Program program;
+    Checker checker("a, b, c");
+    for (int i = 0; i < ITERATIONS * 40; i++) {
+        auto name = "f" + std::to_string(checker.count());
+        Tacky::Function function{Source::Symbol::intern(name), 3, {}};
+        int leaves[3];
+        for (uint32_t t = 0; t < 3; t++) {
+            leaves[t] = rand_tile_constant(seeded_rng);
+            function.instructions_.push_back({Tacky::OpCode::PLUS, Tacky::Value::temporary(t),
+                                              Tacky::Value::constant(leaves[t]), Tacky::Value::constant(0)});
+        }
+        std::string expected;
+        auto result = rand_tile_tree(seeded_rng, seeded_rng.draw(1, MAX_HEIGHT), function, expected);
+        function.instructions_.push_back({Tacky::OpCode::RETURN, Tacky::Value(), result});
+        program.functions_.push_back(std::move(function));
+        checker.add(name, "a = " + int_literal(leaves[0]) + "; b = " + int_literal(leaves[1]) + "; c = " + int_literal(leaves[2]) + ";",
+                    expected, "a = %d, b = %d, c = %d\\n\", a, b, c");
+    }
+    run_checker("tiling", program, checker.source(kWrapping));
+    std::cout << "checked " << checker.count() << " tiled trees" << std::endl;
+}
+
+// Appends a random tree of comparisons, !, && and || to instructions, over
+// arithmetic trees from rand_tile_tree. expected gets the same tree in C.
+Tacky::Value rand_logic_tree(RNG& rng, int height, Tacky::Function& function, std::string& expected) {
+    if (height == 0 || rng.draw(0, 4) == 0) {
+        return rand_tile_tree(rng, rng.draw(0, 2), function, expected);
+    }
+    static const std::pair<Tacky::OpCode, const char*> ops[] = {
+        {Tacky::OpCode::EQUAL, "=="}, {Tacky::OpCode::NOT_EQUAL, "!="}, {Tacky::OpCode::LESS, "<"},
+        {Tacky::OpCode::LESS_EQ, "<="}, {Tacky::OpCode::GREATER, ">"}, {Tacky::OpCode::GREATER_EQ, ">="},
+        {Tacky::OpCode::AND, "&&"}, {Tacky::OpCode::OR, "||"}, {Tacky::OpCode::NOT, "!"},
+    };
+    auto [op, symbol] = ops[rng.draw(0, std::size(ops) - 1)];
+    expected += "(";
+    Tacky::Value left, right;
+    if (op == Tacky::OpCode::NOT) {
+        expected += "!";
+        left = rand_logic_tree(rng, height - 1, function, expected);
+    } else {
+        left = rand_logic_tree(rng, height - 1, function, expected);
+        expected += std::string(" ") + symbol + " ";
+        right = rand_logic_tree(rng, height - 1, function, expected);
+    }
+    expected += ")";
+    auto dst = Tacky::Value::temporary(function.temporary_count_++);
+    function.instructions_.push_back({op, dst, left, right});
+    return dst;
+}
+
+// Comparisons and logical ops lower to cmp and setcc, with a ! right after
+// a comparison setting the opposite condition, so random trees of them over
+// arithmetic are checked like the tiled ones.
+TEST(FuzzTest, ComparisonsAndLogicMatchGcc) {
+    auto seeded_rng = RNG(SEED);
+    Tacky::Program program;
+    Checker checker("a, b, c");
+    for (int i = 0; i < ITERATIONS * 20; i++) {
+        auto name = "f" + std::to_string(checker.count());
+        Tacky::Function function{Source::Symbol::intern(name), 3, {}};
+        int leaves[3];
+        for (uint32_t t = 0; t < 3; t++) {
+            leaves[t] = rand_tile_constant(seeded_rng);
+            function.instructions_.push_back({Tacky::OpCode::PLUS, Tacky::Value::temporary(t),
+                                              Tacky::Value::constant(leaves[t]), Tacky::Value::constant(0)});
+        }
+        std::string expected;
+        auto result = rand_logic_tree(seeded_rng, seeded_rng.draw(1, MAX_HEIGHT), function, expected);
+        function.instructions_.push_back({Tacky::OpCode::RETURN, Tacky::Value(), result});
+        program.functions_.push_back(std::move(function));
+        checker.add(name, "a = " + int_literal(leaves[0]) + "; b = " + int_literal(leaves[1]) + "; c = " + int_literal(leaves[2]) + ";",
+                    expected, "a = %d, b = %d, c = %d\\n\", a, b, c");
+    }
+    run_checker("logic", program, checker.source(kWrapping));
+    std::cout << "checked " << checker.count() << " logic trees" << std::endl;
+}
+
+// An expression of literals, divisions, comparisons, ! and short circuits
+// in C, and its value, nullopt when evaluating it traps.
+struct ShortCircuit {
+    std::string source;
+    std::optional<int> value;
+};
+
+ShortCircuit rand_short_circuit(RNG& rng, int height) {
+    if (height == 0 || rng.draw(0, 5) == 0) {
+        static const int interesting[] = {INT_MIN, -1, 0, 0, 1, 2, 7};
+        int k = rng.draw(0, 2) ? interesting[rng.draw(0, std::size(interesting) - 1)] : rng.draw(-50, 50);
+        return {int_literal(k), k};
+    }
+    // !, && twice, || twice, /, %, <, >= and ==
+    auto kind = rng.draw(0, 9);
+    if (kind == 0) {
+        auto operand = rand_short_circuit(rng, height - 1);
+        return {"(!" + operand.source + ")", operand.value.transform([](int v) { return static_cast<int>(v == 0); })};
+    }
+    auto left = rand_short_circuit(rng, height - 1);
+    auto right = rand_short_circuit(rng, height - 1);
+    auto source = [&](const char* op) { return "(" + left.source + " " + op + " " + right.source + ")"; };
+    if (kind <= 4) {
+        bool is_and = kind <= 2;
+        auto text = source(is_and ? "&&" : "||");
+        if (!left.value) {
+            return {text, std::nullopt};
+        }
+        // the right operand only runs when the left one doesn't decide
+        if ((*left.value != 0) != is_and) {
+            return {text, static_cast<int>(!is_and)};
+        }
+        return {text, right.value.transform([](int v) { return static_cast<int>(v != 0); })};
+    }
+    static const char* symbols[] = {"/", "%", "<", ">=", "=="};
+    auto text = source(symbols[kind - 5]);
+    if (!left.value || !right.value) {
+        return {text, std::nullopt};
+    }
+    int l = *left.value, r = *right.value;
+    switch (kind) {
+        case 5:
+        case 6:
+            if (r == 0 || (l == INT_MIN && r == -1)) {
+                return {text, std::nullopt};
+            }
+            return {text, kind == 5 ? l / r : l % r};
+        case 7: return {text, static_cast<int>(l < r)};
+        case 8: return {text, static_cast<int>(l >= r)};
+        default: return {text, static_cast<int>(l == r)};
+    }
+}
+
+// && and || compute both sides without branches, and divisions in a right
+// operand that C wouldn't evaluate get a divisor of 1 instead of trapping.
+// Random expressions with divisions by 0 and INT_MIN / -1 behind short
+// circuits are compiled from C, with and without -O, and checked against
+// their values worked out here. Ones that trap when C evaluates them are
+// left out.
+TEST(FuzzTest, ShortCircuitsMatchGcc) {
+    auto seeded_rng = RNG(SEED);
+    Checker checker("");
+    std::string program;
+    while (checker.count() < ITERATIONS * 10) {
+        auto expression = rand_short_circuit(seeded_rng, seeded_rng.draw(2, MAX_HEIGHT));
+        if (!expression.value) {
+            continue;
+        }
+        auto name = "f" + std::to_string(checker.count());
+        program += "int " + name + "() { return " + expression.source + "; }\n";
+        checker.add(name, "", int_literal(*expression.value), "got %d\\n\", " + name + "()");
+    }
+    for (bool optimize : {false, true}) {
+        std::string name = optimize ? "short_circuit_optimized" : "short_circuit";
+        std::string s_file = checker_path(name, ".s");
+        dump_asm_to_file(s_file, program, optimize);
+        link_checker(name, s_file, checker.source());
+    }
+    std::cout << "checked " << checker.count() << " short circuits" << std::endl;
 }
 
 int main(int argc, char **argv) {
@@ -298,6 +703,9 @@ int main(int argc, char **argv) {
         else if (arg.starts_with("--max_height=")) {
             MAX_HEIGHT = std::stoi(std::string(arg.substr(13)));
         }
+        else if (arg.starts_with("--divisor_range=")) {
+            DIVISOR_RANGE = std::stoi(std::string(arg.substr(16)));
+        }
     }
 
     testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,122 @@
+#include "gtest/gtest.h"
+#include "src/lexer/lexer.h"
+#include "src/lexer/dfa_lexer.h"
+#include <random>
+#include <variant>
+
+const std::vector<std::string> programs = {
+    "int main() {\n"
+    "   return 2;\n"
+    "}\n",
+    "int negate(int val) {\n"
+    "   return ~(-(--x));\n"
+    "}\n",
+    "int function(int a, int b) {\n"
+    "   return 2*7%5 + 10 - 11;\n"
+    "}\n",
+    "int function() {\n"
+    "return !2 || 3 && 4 & 2 | 5 ^ 3 >> 4 << 10 ;"
+    "}\n",
+    "int function() {\n"
+    "return 2 == 3 < 4 > 5 != 7 >= 8 <= 12;"
+    "}\n",
+};
+
+namespace Lexer {
+
+std::vector<Token> drain(TokenStream tokens) {
+    std::vector<Token> result;
+    while (true) {
+        Token token = tokens.consume();
+        result.push_back(token);
+        if (token.kind == TokenType::END_OF_FILE) {
+            return result;
+        }
+    }
+}
+
+void expect_same_tokens(const std::string& code) {
+    auto manual_tokens = drain(ManualLexer(code).Lex());
+    auto dfa_tokens = drain(DfaLexer(code).Lex());
+    ASSERT_EQ(manual_tokens.size(), dfa_tokens.size()) << code;
+    for (size_t i = 0; i < manual_tokens.size(); i++) {
+        EXPECT_EQ(manual_tokens[i].kind, dfa_tokens[i].kind) << "token " << i << " of " << code;
+        EXPECT_EQ(manual_tokens[i].value, dfa_tokens[i].value) << "token " << i << " of " << code;
+    }
+}
+
+TEST(DfaLexerTest, MatchesManualLexerOnPrograms) {
+    for (auto& program : programs) {
+        expect_same_tokens(program);
+    }
+}
+
+TEST(DfaLexerTest, MatchesManualLexerOnTokenSoup) {
+    const std::vector<std::string> lexemes = {
+        "(", ")", "{", "}", ";", ",", "~", "--", "-", "+", "*", "/", "%", "&&", "&",
+        "||", "|", "^", "!=", "!", "<<", "<=", ">>", ">=", "<", ">", "==",
+        "int", "return", "main", "foo", "x", "0", "7", "42", "123456789", "2147483647",
+    };
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<size_t> pick(0, lexemes.size() - 1);
+    std::uniform_int_distribution<int> spaces(1, 12);
+    for (int round = 0; round < 50; round++) {
+        std::string code;
+        for (int i = 0; i < 400; i++) {
+            code += lexemes[pick(rng)];
+            int gap = spaces(rng);
+            for (int j = 0; j < gap; j++) {
+                code += (j % 5 == 4) ? '\n' : ' ';
+            }
+        }
+        expect_same_tokens(code);
+    }
+}
+
+TEST(DfaLexerTest, KeywordPrefixesAreIdentifiers) {
+    auto tokens = drain(DfaLexer("integer returned int return_ int2").Lex());
+    std::vector<Token> expected = {
+        Token{TokenType::NAME, Source::Symbol::intern("integer")},
+        Token{TokenType::NAME, Source::Symbol::intern("returned")},
+        Token{TokenType::INTEGER_TYPE, std::monostate{}},
+        Token{TokenType::NAME, Source::Symbol::intern("return_")},
+        Token{TokenType::NAME, Source::Symbol::intern("int2")},
+        Token{TokenType::END_OF_FILE, std::monostate{}},
+    };
+    ASSERT_EQ(tokens.size(), expected.size());
+    for (size_t i = 0; i < tokens.size(); i++) {
+        EXPECT_EQ(tokens[i].kind, expected[i].kind);
+        EXPECT_EQ(tokens[i].value, expected[i].value);
+    }
+}
+
+TEST(DfaLexerTest, LongWhitespaceAndDigitRuns) {
+    // runs longer than a SWAR word, and ending at every offset within one
+    for (int pad = 0; pad < 9; pad++) {
+        std::string code = std::string(37 + pad, ' ') + "\t\r\n\v\f" + std::string(13 + pad, '0') + "42" +
+            std::string(19 + pad, '\n') + "9";
+        auto tokens = drain(DfaLexer(code).Lex());
+        ASSERT_EQ(tokens.size(), 3);
+        EXPECT_EQ(tokens[0].value, TokenValue(42));
+        EXPECT_EQ(tokens[1].value, TokenValue(9));
+        EXPECT_EQ(tokens[2].kind, TokenType::END_OF_FILE);
+    }
+}
+
+TEST(DfaLexerTest, RejectsOutOfRangeIntegers) {
+    EXPECT_THROW(drain(DfaLexer("return 2147483648;").Lex()), std::runtime_error);
+    auto tokens = drain(DfaLexer("return 2147483647;").Lex());
+    EXPECT_EQ(tokens[1].value, TokenValue(2147483647));
+}
+
+TEST(DfaLexerTest, RejectsUnknownCharacters) {
+    EXPECT_THROW(drain(DfaLexer("return 1 = 2;").Lex()), std::runtime_error);
+    EXPECT_THROW(drain(DfaLexer("return @;").Lex()), std::runtime_error);
+}
+
+} // namespace Lexer
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,94 @@
+#include "src/lexer/lexer.h"
+#include "src/lexer/dfa_lexer.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+
+// Throughput comparison between ManualLexer and DfaLexer over a generated
+// source of --size_mb megabytes, shaped like the fuzz programs.
+
+int SIZE_MB = 8, ROUNDS = 3, SEED = 42;
+
+std::string function_name(int idx) {
+    std::string name = "fn";
+    do {
+        name.push_back('a' + idx % 26);
+        idx /= 26;
+    } while (idx > 0);
+    return name;
+}
+
+std::string generate_source(size_t target_size) {
+    const std::vector<std::string> bin_ops = {"*", "/", "%", "+", "-", "&", "|", "^", "<<", ">>", "&&", "||"};
+    const std::vector<std::string> un_ops = {"-", "~", "!"};
+    std::mt19937 rng(SEED);
+    auto draw = [&](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+    std::string code;
+    code.reserve(target_size + 4096);
+    int function_idx = 0;
+    while (code.size() < target_size) {
+        code += "int " + function_name(function_idx++) + "() {\n    return ";
+        int terms = draw(20, 200);
+        for (int i = 0; i < terms; i++) {
+            if (draw(0, 3) == 0) {
+                code += un_ops[draw(0, un_ops.size() - 1)] + "(";
+                code += std::to_string(draw(0, 100000));
+                code += ")";
+            } else {
+                code += std::to_string(draw(0, 100000));
+            }
+            if (i + 1 < terms) {
+                code += " " + bin_ops[draw(0, bin_ops.size() - 1)] + " ";
+            }
+        }
+        code += ";\n}\n\n";
+    }
+    return code;
+}
+
+template <typename L>
+double lex_seconds(const std::string& code, size_t& token_count) {
+    auto start = std::chrono::steady_clock::now();
+    auto lexer = std::make_unique<L>(code);
+    auto tokens = lexer->Lex();
+    token_count = 0;
+    while (tokens.consume().kind != Lexer::TokenType::END_OF_FILE) {
+        token_count++;
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+template <typename L>
+void report(const std::string& name, const std::string& code) {
+    double best = 1e30;
+    size_t token_count = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        best = std::min(best, lex_seconds<L>(code, token_count));
+    }
+    double megabytes = code.size() / (1024.0 * 1024.0);
+    std::cout << name << ": " << token_count << " tokens in " << best * 1000 << " ms, "
+              << megabytes / best << " MB/s, " << token_count / best / 1e6 << " Mtokens/s" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg(argv[i]);
+        if (arg.starts_with("--size_mb=")) {
+            SIZE_MB = std::stoi(std::string(arg.substr(10)));
+        } else if (arg.starts_with("--rounds=")) {
+            ROUNDS = std::stoi(std::string(arg.substr(9)));
+        } else if (arg.starts_with("--seed=")) {
+            SEED = std::stoi(std::string(arg.substr(7)));
+        }
+    }
+    std::string code = generate_source(static_cast<size_t>(SIZE_MB) * 1024 * 1024);
+    std::cout << "Lexing " << code.size() << " bytes, best of " << ROUNDS << " rounds" << std::endl;
+    report<Lexer::ManualLexer>("ManualLexer", code);
+    report<Lexer::DfaLexer>("DfaLexer", code);
+    return 0;
+}
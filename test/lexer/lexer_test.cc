@@ -60,7 +60,7 @@ TEST(LexerTest, SomeRelationalOps) {
     std::unique_ptr<Lexer> l = std::make_unique<ManualLexer>(some_relational_ops);
     std::vector<Token> expected_results = {
         Token{TokenType::INTEGER_TYPE, std::monostate{}},
-        Token{TokenType::NAME, std::string("function")},
+        Token{TokenType::NAME, Source::Symbol::intern("function")},
         Token{TokenType::LPAREN, std::monostate{}},
         Token{TokenType::RPAREN, std::monostate{}},
         Token{TokenType::LBRACE, std::monostate{}},
@@ -89,7 +89,7 @@ TEST(LexerTest, SomeBoolOps) {
     std::unique_ptr<Lexer> l = std::make_unique<ManualLexer>(some_boolean_ops);
     std::vector<Token> expected_results = {
         Token{TokenType::INTEGER_TYPE, std::monostate{}},
-        Token{TokenType::NAME, std::string("function")},
+        Token{TokenType::NAME, Source::Symbol::intern("function")},
         Token{TokenType::LPAREN, std::monostate{}},
         Token{TokenType::RPAREN, std::monostate{}},
         Token{TokenType::LBRACE, std::monostate{}},
@@ -121,13 +121,13 @@ TEST(LexerTest, SomeBinexps) {
     std::unique_ptr<Lexer> l = std::make_unique<ManualLexer>(some_binexps);
     std::vector<Token> expected_results = {
         Token{TokenType::INTEGER_TYPE, std::monostate{}},
-        Token{TokenType::NAME, std::string("function")},
+        Token{TokenType::NAME, Source::Symbol::intern("function")},
         Token{TokenType::LPAREN, std::monostate{}},
         Token{TokenType::INTEGER_TYPE, std::monostate{}},
-        Token{TokenType::NAME, std::string("a")},
+        Token{TokenType::NAME, Source::Symbol::intern("a")},
         Token{TokenType::COMMA, std::monostate{}},
         Token{TokenType::INTEGER_TYPE, std::monostate{}},
-        Token{TokenType::NAME, std::string("b")},
+        Token{TokenType::NAME, Source::Symbol::intern("b")},
         Token{TokenType::RPAREN, std::monostate{}},
         Token{TokenType::LBRACE, std::monostate{}},
         Token{TokenType::RETURN, std::monostate{}},
@@ -151,10 +151,10 @@ TEST(LexerTest, AnotherBasicLex) {
     std::unique_ptr<Lexer> l = std::make_unique<ManualLexer>(another_basic_program);
     std::vector<Token> expected_results = {
         Token{TokenType::INTEGER_TYPE, std::monostate{}},
-        Token{TokenType::NAME, std::string("negate")},
+        Token{TokenType::NAME, Source::Symbol::intern("negate")},
         Token{TokenType::LPAREN,  std::monostate{}},
         Token{TokenType::INTEGER_TYPE, std::monostate{}},
-        Token{TokenType::NAME, std::string("val")},
+        Token{TokenType::NAME, Source::Symbol::intern("val")},
         Token{TokenType::RPAREN,  std::monostate{}},
         Token{TokenType::LBRACE, std::monostate{}},
         Token{TokenType::RETURN, std::monostate{}},
@@ -163,7 +163,7 @@ TEST(LexerTest, AnotherBasicLex) {
         Token{TokenType::MINUS, std::monostate{}},
         Token{TokenType::LPAREN, std::monostate{}},
         Token{TokenType::DOUBLE_MINUS, std::monostate{}},
-        Token{TokenType::NAME, std::string("x")},
+        Token{TokenType::NAME, Source::Symbol::intern("x")},
         Token{TokenType::RPAREN, std::monostate{}},
         Token{TokenType::RPAREN, std::monostate{}},
         Token{TokenType::SEMICOLON, std::monostate{}},
@@ -178,7 +178,7 @@ TEST(LexerTest, BasicProgramLex) {
     std::unique_ptr<Lexer> l = std::make_unique<ManualLexer>(basic_program);
     std::vector<Token> expected_results = {
         Token{TokenType::INTEGER_TYPE, std::monostate{}},
-        Token{TokenType::NAME, std::string("main")},
+        Token{TokenType::NAME, Source::Symbol::intern("main")},
         Token{TokenType::LPAREN,  std::monostate{}},
         Token{TokenType::RPAREN,  std::monostate{}},
         Token{TokenType::LBRACE, std::monostate{}},
@@ -192,6 +192,34 @@ TEST(LexerTest, BasicProgramLex) {
     assert_expected_lex_results(expected_results, results);
 }
 
+TEST(TokenStreamTest, LookaheadWrapsAroundTheRing) {
+    std::string code;
+    for (int i = 0; i < 1000; i++) {
+        code += std::to_string(i) + " ";
+    }
+    std::unique_ptr<Lexer> l = std::make_unique<ManualLexer>(code);
+    auto results = l->Lex();
+    for (int i = 0; i < 1000; i++) {
+        int ahead = std::min(10, 999 - i);
+        EXPECT_EQ(results.peek(ahead).value, TokenValue(i + ahead));
+        const Token& current = results.peek(0);
+        EXPECT_EQ(current.value, TokenValue(i));
+        Token consumed = results.consume();
+        EXPECT_EQ(consumed.kind, TokenType::INTEGER_VALUE);
+        EXPECT_EQ(consumed.value, TokenValue(i));
+    }
+    EXPECT_EQ(results.consume().kind, TokenType::END_OF_FILE);
+    EXPECT_EQ(results.peek(0).kind, TokenType::END_OF_FILE);
+}
+
+TEST(TokenStreamTest, LookaheadBeyondCapacityThrows) {
+    std::string code(2 * TokenStream::kLookaheadCapacity, ';');
+    std::unique_ptr<Lexer> l = std::make_unique<ManualLexer>(code);
+    auto results = l->Lex();
+    EXPECT_EQ(results.peek(TokenStream::kLookaheadCapacity - 1).kind, TokenType::SEMICOLON);
+    EXPECT_THROW(results.peek(TokenStream::kLookaheadCapacity), std::runtime_error);
+}
+
 } // namespace Lexer
 
 int main(int argc, char **argv) {
@@ -0,0 +1,164 @@
+#include "gtest/gtest.h"
+#include "src/optimizer/optimizer.h"
+#include "test/tacky/tacky_test_util.h"
+#include <climits>
+#include <optional>
+#include <vector>
+
+namespace Optimizer {
+
+using Tacky::Instruction;
+using Tacky::OpCode;
+using Tacky::Value;
+using namespace Tacky::Testing;
+
+// x = x_value + 0 is left to the folder, so x stays an opaque temporary here
+Tacky::Program program_over_x(int x_value, std::vector<Instruction> body, uint32_t temporary_count) {
+    body.insert(body.begin(), {OpCode::PLUS, t(0), c(x_value), c(0)});
+    return single_function(std::move(body), temporary_count);
+}
+
+// evaluates a function with the folder's semantics, nothing if it traps
+std::optional<int> run(const Tacky::Function& function) {
+    std::vector<int> temporaries(function.temporary_count_);
+    auto value = [&](Value v) { return v.is_constant() ? v.constant_value() : temporaries[v.temporary_id()]; };
+    for (auto& instruction : function.instructions_) {
+        if (instruction.op_ == OpCode::RETURN) {
+            return value(instruction.src1_);
+        }
+        auto result = fold(instruction.op_, value(instruction.src1_),
+            instruction.src2_.is_none() ? 0 : value(instruction.src2_));
+        if (!result.has_value()) {
+            return std::nullopt;
+        }
+        temporaries[instruction.dst_.temporary_id()] = *result;
+    }
+    return std::nullopt;
+}
+
+size_t count(const Tacky::Function& function, OpCode op) {
+    size_t n = 0;
+    for (auto& instruction : function.instructions_) {
+        n += instruction.op_ == op;
+    }
+    return n;
+}
+
+TEST(AlgebraicSimplificationTest, PowerOfTwoDivisionsBecomeShiftsAndMasks) {
+    for (int k = 1; k <= 30; k++) {
+        int divisor = 1 << k;
+        for (int x : {INT_MIN, INT_MIN + 1, -divisor - 1, -divisor, -divisor + 1, -1, 0, 1, divisor - 1, divisor,
+                      divisor + 1, INT_MAX, -123456789, 987654321}) {
+            for (auto op : {OpCode::DIV, OpCode::MOD}) {
+                auto program = program_over_x(x, {
+                    {op, t(1), t(0), c(divisor)},
+                    {OpCode::RETURN, Value(), t(1)},
+                }, 2);
+                AlgebraicSimplificationVisitor().rewrite(program);
+                auto& function = program.functions_[0];
+                EXPECT_EQ(count(function, op), 0);
+                EXPECT_EQ(run(function), op == OpCode::DIV ? x / divisor : x % divisor)
+                    << x << (op == OpCode::DIV ? " / " : " % ") << divisor;
+            }
+        }
+    }
+}
+
+TEST(AlgebraicSimplificationTest, PowerOfTwoMultiplicationsBecomeShifts) {
+    for (auto factor : {c(8), c(1 << 30)}) {
+        for (bool constant_first : {false, true}) {
+            auto program = program_over_x(-5, {
+                constant_first ? Instruction{OpCode::MULT, t(1), factor, t(0)} : Instruction{OpCode::MULT, t(1), t(0), factor},
+                {OpCode::RETURN, Value(), t(1)},
+            }, 2);
+            AlgebraicSimplificationVisitor().rewrite(program);
+            auto& function = program.functions_[0];
+            EXPECT_EQ(count(function, OpCode::MULT), 0);
+            EXPECT_EQ(count(function, OpCode::LEFT_SHIFT), 1);
+            EXPECT_EQ(run(function), static_cast<int>(static_cast<uint32_t>(-5) * factor.constant_value()));
+        }
+    }
+}
+
+TEST(AlgebraicSimplificationTest, IdentitiesLeaveASingleCopyOrOp) {
+    struct Case {
+        Instruction instruction;
+        OpCode becomes;
+        int expected;
+    };
+    int x = 1234;
+    std::vector<Case> cases = {
+        {{OpCode::MULT, t(1), t(0), c(0)}, OpCode::COPY, 0},
+        {{OpCode::MULT, t(1), c(1), t(0)}, OpCode::COPY, x},
+        {{OpCode::MULT, t(1), t(0), c(-1)}, OpCode::NEGATE, -x},
+        {{OpCode::PLUS, t(1), c(0), t(0)}, OpCode::COPY, x},
+        {{OpCode::MINUS, t(1), t(0), c(0)}, OpCode::COPY, x},
+        {{OpCode::MINUS, t(1), c(0), t(0)}, OpCode::NEGATE, -x},
+        {{OpCode::MINUS, t(1), t(0), t(0)}, OpCode::COPY, 0},
+        {{OpCode::DIV, t(1), t(0), c(1)}, OpCode::COPY, x},
+        {{OpCode::MOD, t(1), t(0), c(1)}, OpCode::COPY, 0},
+        {{OpCode::BITWISE_OR, t(1), t(0), c(0)}, OpCode::COPY, x},
+        {{OpCode::BITWISE_OR, t(1), t(0), c(-1)}, OpCode::COPY, -1},
+        {{OpCode::BITWISE_AND, t(1), t(0), c(0)}, OpCode::COPY, 0},
+        {{OpCode::BITWISE_AND, t(1), c(-1), t(0)}, OpCode::COPY, x},
+        {{OpCode::BITWISE_AND, t(1), t(0), t(0)}, OpCode::COPY, x},
+        {{OpCode::BITWISE_XOR, t(1), t(0), t(0)}, OpCode::COPY, 0},
+        {{OpCode::BITWISE_XOR, t(1), t(0), c(-1)}, OpCode::COMPLEMENT, ~x},
+        {{OpCode::AND, t(1), c(0), t(0)}, OpCode::COPY, 0},
+        {{OpCode::AND, t(1), t(0), c(7)}, OpCode::NOT_EQUAL, 1},
+        {{OpCode::OR, t(1), t(0), c(-3)}, OpCode::COPY, 1},
+        {{OpCode::OR, t(1), c(0), t(0)}, OpCode::NOT_EQUAL, 1},
+        {{OpCode::LEFT_SHIFT, t(1), t(0), c(0)}, OpCode::COPY, x},
+    };
+    for (auto& test_case : cases) {
+        auto program = program_over_x(x, {test_case.instruction, {OpCode::RETURN, Value(), t(1)}}, 2);
+        AlgebraicSimplificationVisitor().rewrite(program);
+        auto& instructions = program.functions_[0].instructions_;
+        ASSERT_EQ(instructions.size(), 3);
+        EXPECT_EQ(instructions[1].op_, test_case.becomes) << Tacky::opcode_as_str(test_case.instruction.op_);
+        EXPECT_EQ(run(program.functions_[0]), test_case.expected) << Tacky::opcode_as_str(test_case.instruction.op_);
+    }
+}
+
+TEST(AlgebraicSimplificationTest, DoubleNegationsCancel) {
+    for (auto op : {OpCode::NEGATE, OpCode::COMPLEMENT}) {
+        auto program = program_over_x(77, {
+            {op, t(1), t(0)},
+            {op, t(2), t(1)},
+            {OpCode::RETURN, Value(), t(2)},
+        }, 3);
+        AlgebraicSimplificationVisitor().rewrite(program);
+        auto& instructions = program.functions_[0].instructions_;
+        EXPECT_EQ(instructions[2].op_, OpCode::COPY);
+        EXPECT_EQ(instructions[2].src1_, t(0));
+    }
+}
+
+TEST(AlgebraicSimplificationTest, ChainedMasksCombine) {
+    auto program = program_over_x(0x1234, {
+        {OpCode::BITWISE_AND, t(1), t(0), c(0xff)},
+        {OpCode::BITWISE_AND, t(2), c(0x0f), t(1)},
+        {OpCode::BITWISE_OR, t(3), t(2), c(0x100)},
+        {OpCode::BITWISE_OR, t(4), t(3), c(0x200)},
+        {OpCode::BITWISE_AND, t(5), t(1), c(0x100)},
+        {OpCode::PLUS, t(6), t(4), t(5)},
+        {OpCode::RETURN, Value(), t(6)},
+    }, 7);
+    AlgebraicSimplificationVisitor().rewrite(program);
+    auto& instructions = program.functions_[0].instructions_;
+    EXPECT_EQ(instructions[2].src1_, t(0));
+    EXPECT_EQ(instructions[2].src2_, c(0x0f));
+    EXPECT_EQ(instructions[4].src1_, t(2));
+    EXPECT_EQ(instructions[4].src2_, c(0x300));
+    // the masks don't overlap, so the last and is known to be zero
+    EXPECT_EQ(instructions[5].op_, OpCode::COPY);
+    EXPECT_EQ(instructions[5].src1_, c(0));
+    EXPECT_EQ(run(program.functions_[0]), 0x304);
+}
+
+} // namespace Optimizer
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,401 @@
+#include "gtest/gtest.h"
+#include "src/optimizer/optimizer.h"
+#include "test/tacky/tacky_test_util.h"
+#include <stdexcept>
+#include <vector>
+
+namespace Optimizer {
+
+using Tacky::Instruction;
+using Tacky::OpCode;
+using Tacky::Value;
+using namespace Tacky::Testing;
+
+TEST(CleanupPassesTest, CopiesResolveThroughChains) {
+    auto program = single_function({
+        {OpCode::NEGATE, t(0), c(3)},
+        {OpCode::COPY, t(1), t(0)},
+        {OpCode::COPY, t(2), t(1)},
+        {OpCode::PLUS, t(3), t(2), t(1)},
+        {OpCode::COPY, t(4), c(7)},
+        {OpCode::MULT, t(5), t(3), t(4)},
+        {OpCode::RETURN, Value(), t(5)},
+    }, 6);
+    CopyPropagationVisitor().rewrite(program);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::NEGATE, t(0), c(3)},
+        {OpCode::PLUS, t(3), t(0), t(0)},
+        {OpCode::MULT, t(5), t(3), c(7)},
+        {OpCode::RETURN, Value(), t(5)},
+    });
+}
+
+// a counter going down around a loop, in SSA form
+std::vector<Instruction> countdown_loop(std::vector<Instruction> body) {
+    std::vector<Instruction> loop = {
+        {OpCode::LABEL, Value(), l(2)},
+        {OpCode::NEGATE, t(0), c(3)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::PHI, t(1), t(0), l(2)},
+        {OpCode::PHI, t(1), t(3), l(1)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(1), l(3)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::MINUS, t(2), t(1), c(1)},
+    };
+    loop.insert(loop.end(), body.begin(), body.end());
+    loop.insert(loop.end(), {
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(3)},
+        {OpCode::RETURN, Value(), t(1)},
+    });
+    return loop;
+}
+
+TEST(CleanupPassesTest, CopiesReachPhisAlongJumpsBack) {
+    auto program = single_function(countdown_loop({{OpCode::COPY, t(3), t(2)}}), 4, 4);
+    CopyPropagationVisitor().rewrite(program);
+    auto expected = countdown_loop({});
+    expected[4].src1_ = t(2);
+    expect_instructions(program.functions_[0].instructions_, expected);
+}
+
+TEST(CleanupPassesTest, CopiesOfTemporariesWrittenAgainStay) {
+    // out of SSA form t0 changes after the copy
+    std::vector<Instruction> instructions = {
+        {OpCode::NEGATE, t(0), c(3)},
+        {OpCode::COPY, t(1), t(0)},
+        {OpCode::NEGATE, t(0), c(4)},
+        {OpCode::PLUS, t(2), t(1), t(0)},
+        {OpCode::RETURN, Value(), t(2)},
+    };
+    auto program = single_function(instructions, 3);
+    CopyPropagationVisitor().rewrite(program);
+    expect_instructions(program.functions_[0].instructions_, instructions);
+}
+
+TEST(CleanupPassesTest, NothingRunsAfterTheFirstReturn) {
+    auto program = single_function({
+        {OpCode::NEGATE, t(0), c(3)},
+        {OpCode::RETURN, Value(), t(0)},
+        {OpCode::NEGATE, t(1), c(4)},
+        {OpCode::RETURN, Value(), t(1)},
+    }, 2);
+    DeadCodeVisitor().rewrite(program);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::NEGATE, t(0), c(3)},
+        {OpCode::RETURN, Value(), t(0)},
+    });
+}
+
+TEST(CleanupPassesTest, UnreachableBlocksAreDropped) {
+    auto program = single_function({
+        {OpCode::NEGATE, t(0), c(3)},
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::NEGATE, t(1), c(4)},
+        // no jump comes here
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::NEGATE, t(2), c(5)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::AND, t(3), t(0), t(2)},
+        {OpCode::RETURN, Value(), t(3)},
+    }, 4, 2);
+    DeadCodeVisitor().rewrite(program);
+    // the && read of the jumped over operand reads 0 now
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::NEGATE, t(0), c(3)},
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::AND, t(3), t(0), c(0)},
+        {OpCode::RETURN, Value(), t(3)},
+    });
+}
+
+TEST(CleanupPassesTest, ReadsAroundALoopKeepTheirDefinitions) {
+    auto program = single_function({
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::RETURN, Value(), t(1)},
+        {OpCode::LABEL, Value(), l(0)},
+        // only read by the return above
+        {OpCode::NEGATE, t(1), c(4)},
+        {OpCode::NEGATE, t(2), c(5)},
+        {OpCode::JUMP, Value(), l(1)},
+    }, 3, 2);
+    DeadCodeVisitor().rewrite(program);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::RETURN, Value(), t(1)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::NEGATE, t(1), c(4)},
+        {OpCode::JUMP, Value(), l(1)},
+    });
+}
+
+TEST(CleanupPassesTest, PhisOnlyReadingEachOtherAreDropped) {
+    // t4 and t5 go around the loop without anything else reading them
+    auto program = single_function(countdown_loop({
+        {OpCode::PLUS, t(5), t(4), c(2)},
+        {OpCode::COPY, t(3), t(2)},
+    }), 6, 4);
+    auto& instructions = program.functions_[0].instructions_;
+    instructions.insert(instructions.begin() + 5, {
+        {OpCode::PHI, t(4), c(0), l(2)},
+        {OpCode::PHI, t(4), t(5), l(1)},
+    });
+    DeadCodeVisitor().rewrite(program);
+    expect_instructions(instructions, countdown_loop({{OpCode::COPY, t(3), t(2)}}));
+}
+
+TEST(CleanupPassesTest, UnreadResultsAreDropped) {
+    auto program = single_function({
+        {OpCode::NEGATE, t(0), c(3)},
+        {OpCode::COMPLEMENT, t(1), t(0)},
+        {OpCode::PLUS, t(2), t(1), c(1)},
+        {OpCode::MINUS, t(3), c(5), c(2)},
+        {OpCode::DIV, t(4), c(5), c(2)},
+        // these may trap, so they stay even though nothing reads them
+        {OpCode::DIV, t(5), c(5), t(3)},
+        {OpCode::MOD, t(6), c(5), c(-1)},
+        {OpCode::RETURN, Value(), t(1)},
+    }, 7);
+    DeadCodeVisitor().rewrite(program);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::NEGATE, t(0), c(3)},
+        {OpCode::COMPLEMENT, t(1), t(0)},
+        {OpCode::MINUS, t(3), c(5), c(2)},
+        {OpCode::DIV, t(5), c(5), t(3)},
+        {OpCode::MOD, t(6), c(5), c(-1)},
+        {OpCode::RETURN, Value(), t(1)},
+    });
+}
+
+TEST(CleanupPassesTest, RepeatedComputationsReuseTheFirstResult) {
+    // (-3 * 4) + (4 * -3) - (-3 - 4) + (4 - -3)
+    auto program = single_function({
+        {OpCode::NEGATE, t(0), c(3)},
+        {OpCode::MULT, t(1), t(0), c(4)},
+        {OpCode::NEGATE, t(2), c(3)},
+        {OpCode::MULT, t(3), c(4), t(2)},
+        {OpCode::PLUS, t(4), t(1), t(3)},
+        {OpCode::MINUS, t(5), t(0), c(4)},
+        {OpCode::MINUS, t(6), c(4), t(2)},
+        {OpCode::MINUS, t(7), t(4), t(5)},
+        {OpCode::PLUS, t(8), t(7), t(6)},
+        {OpCode::RETURN, Value(), t(8)},
+    }, 9);
+    ValueNumberingVisitor value_numbering;
+    value_numbering.rewrite(program);
+    EXPECT_EQ(value_numbering.removed(), 2);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::NEGATE, t(0), c(3)},
+        {OpCode::MULT, t(1), t(0), c(4)},
+        {OpCode::PLUS, t(4), t(1), t(1)},
+        {OpCode::MINUS, t(5), t(0), c(4)},
+        {OpCode::MINUS, t(6), c(4), t(0)},
+        {OpCode::MINUS, t(7), t(4), t(5)},
+        {OpCode::PLUS, t(8), t(6), t(7)},
+        {OpCode::RETURN, Value(), t(8)},
+    });
+}
+
+TEST(CleanupPassesTest, ValueNumbersReachDominatedBlocks) {
+    auto program = single_function({
+        {OpCode::NEGATE, t(0), c(3)},
+        {OpCode::MULT, t(1), t(0), t(0)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(1), l(0)},
+        // only reached through the multiplication above
+        {OpCode::MULT, t(2), t(0), t(0)},
+        {OpCode::NEGATE, t(3), t(2)},
+        {OpCode::LABEL, Value(), l(0)},
+        // the negation above may not have run
+        {OpCode::NEGATE, t(4), t(1)},
+        {OpCode::MULT, t(5), t(0), t(0)},
+        {OpCode::PLUS, t(6), t(4), t(5)},
+        {OpCode::RETURN, Value(), t(6)},
+    }, 7, 1);
+    ValueNumberingVisitor value_numbering;
+    value_numbering.rewrite(program);
+    EXPECT_EQ(value_numbering.removed(), 2);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::NEGATE, t(0), c(3)},
+        {OpCode::MULT, t(1), t(0), t(0)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(1), l(0)},
+        {OpCode::NEGATE, t(3), t(1)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::NEGATE, t(4), t(1)},
+        {OpCode::PLUS, t(6), t(1), t(4)},
+        {OpCode::RETURN, Value(), t(6)},
+    });
+}
+
+TEST(CleanupPassesTest, ValueNumbersFollowDominatorsNotInstructionOrder) {
+    auto program = single_function({
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::JUMP, Value(), l(0)},
+        // only reached from the block at l0, which comes after it
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::MULT, t(2), t(0), t(0)},
+        {OpCode::RETURN, Value(), t(2)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::MULT, t(1), t(0), t(0)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(1), l(1)},
+        {OpCode::RETURN, Value(), t(1)},
+    }, 3, 2);
+    ValueNumberingVisitor value_numbering;
+    value_numbering.rewrite(program);
+    EXPECT_EQ(value_numbering.removed(), 1);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::RETURN, Value(), t(1)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::MULT, t(1), t(0), t(0)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(1), l(1)},
+        {OpCode::RETURN, Value(), t(1)},
+    });
+}
+
+TEST(CleanupPassesTest, LayoutThreadsJumpsAndFallsThrough) {
+    auto program = single_function({
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(0)},
+        {OpCode::JUMP, Value(), l(1)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::NEGATE, t(1), c(2)},
+        {OpCode::JUMP, Value(), l(2)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::JUMP, Value(), l(3)},
+        {OpCode::LABEL, Value(), l(2)},
+        {OpCode::RETURN, Value(), t(1)},
+        {OpCode::LABEL, Value(), l(3)},
+        {OpCode::RETURN, Value(), t(0)},
+    }, 2, 4);
+    BlockLayoutVisitor().rewrite(program);
+    // the jumps through l1 go straight to l3's return, which falls right
+    // after the test, and the other return follows its block
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(0)},
+        {OpCode::RETURN, Value(), t(0)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::NEGATE, t(1), c(2)},
+        {OpCode::RETURN, Value(), t(1)},
+    });
+}
+
+TEST(CleanupPassesTest, LayoutInvertsJumpsToTheNextBlock) {
+    auto program = single_function({
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(0)},
+        {OpCode::JUMP, Value(), l(1)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::NEGATE, t(1), c(2)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::PLUS, t(2), t(0), t(1)},
+        {OpCode::RETURN, Value(), t(2)},
+    }, 3, 2);
+    BlockLayoutVisitor().rewrite(program);
+    // the join has to wait for the block at l0, which comes next instead
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::JUMP_IF_NOT_ZERO, Value(), t(0), l(1)},
+        {OpCode::NEGATE, t(1), c(2)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::PLUS, t(2), t(0), t(1)},
+        {OpCode::RETURN, Value(), t(2)},
+    });
+}
+
+TEST(CleanupPassesTest, LayoutJumpsBackIntoLoops) {
+    auto program = single_function({
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(1)},
+        {OpCode::JUMP, Value(), l(2)},
+        {OpCode::LABEL, Value(), l(2)},
+        {OpCode::NEGATE, t(1), t(0)},
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::RETURN, Value(), t(0)},
+    }, 2, 3);
+    BlockLayoutVisitor().rewrite(program);
+    // the loop head keeps its label for the jump back from below
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(1)},
+        {OpCode::NEGATE, t(1), t(0)},
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::RETURN, Value(), t(0)},
+    });
+}
+
+TEST(CleanupPassesTest, LayoutKeepsTheBlockFallingOffLast) {
+    std::vector<Instruction> loop = {
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::JUMP_IF_NOT_ZERO, Value(), t(0), l(1)},
+        {OpCode::RETURN, Value(), t(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::NEGATE, t(1), c(2)},
+        // runs off the end when the jump isn't taken
+        {OpCode::JUMP_IF_ZERO, Value(), t(1), l(0)},
+    };
+    auto program = single_function(loop, 2, 2);
+    BlockLayoutVisitor().rewrite(program);
+    expect_instructions(program.functions_[0].instructions_, loop);
+
+    // here it is where the function starts
+    program = single_function({
+        {OpCode::JUMP, Value(), l(1)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::RETURN, Value(), c(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(0)},
+    }, 1, 2);
+    EXPECT_THROW(BlockLayoutVisitor().rewrite(program), std::runtime_error);
+}
+
+TEST(CleanupPassesTest, OptimizeRunsEveryPass) {
+    auto program = single_function({
+        {OpCode::COPY, t(0), c(6)},
+        {OpCode::MULT, t(1), t(0), c(7)},
+        {OpCode::NEGATE, t(2), t(1)},
+        {OpCode::RETURN, Value(), t(1)},
+        {OpCode::RETURN, Value(), t(2)},
+    }, 3);
+    auto stats = optimize(program);
+    EXPECT_EQ(stats.instructions_before, 5);
+    EXPECT_EQ(stats.instructions_after, 1);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::RETURN, Value(), c(42)},
+    });
+
+    // a jump on a folded condition skips the division, and the layout
+    // drops the jump to what comes next
+    program = single_function({
+        {OpCode::MINUS, t(0), c(2), c(2)},
+        {OpCode::JUMP_IF_NOT_ZERO, Value(), t(0), l(0)},
+        {OpCode::DIV, t(1), c(1), t(0)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::OR, t(2), t(0), t(1)},
+        {OpCode::RETURN, Value(), t(2)},
+    }, 3, 1);
+    optimize(program);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::DIV, t(1), c(1), c(0)},
+        {OpCode::NOT_EQUAL, t(2), t(1), c(0)},
+        {OpCode::RETURN, Value(), t(2)},
+    });
+}
+
+} // namespace Optimizer
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
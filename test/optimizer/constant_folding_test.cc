@@ -0,0 +1,123 @@
+#include "gtest/gtest.h"
+#include "src/codegen/c_ast_to_tacky/c_ast_to_tacky.h"
+#include "src/lexer/dfa_lexer.h"
+#include "src/optimizer/optimizer.h"
+#include "src/parser/parser.h"
+#include "test/tacky/tacky_test_util.h"
+#include <climits>
+#include <string>
+#include <vector>
+
+namespace Optimizer {
+
+using Tacky::OpCode;
+using Tacky::Value;
+using namespace Tacky::Testing;
+
+Tacky::Program fold_program(const std::string& code) {
+    Parser::RecursiveDescentParser parser(Lexer::DfaLexer(code).Lex());
+    auto program_opt = parser.parse();
+    EXPECT_TRUE(program_opt.has_value());
+    Codegen::AstToTackyVisitor visitor;
+    auto program = visitor.get_tacky_from_c_ast(program_opt.value());
+    ConstantFoldingVisitor folder;
+    folder.rewrite(program);
+    return program;
+}
+
+TEST(ConstantFoldingTest, FoldsWholeTreesIntoTheReturn) {
+    auto program = fold_program("int main() { return -(142)/196*191%-(22)+177/72%-(36/61%-(73)+5)*~(~(-(69/157))); }");
+    auto& instructions = program.functions_[0].instructions_;
+    ASSERT_EQ(instructions.size(), 1);
+    EXPECT_EQ(instructions[0].op_, OpCode::RETURN);
+    EXPECT_EQ(instructions[0].src1_, Value::constant(-142/196*191%-(22)+177/72%-(36/61%-(73)+5)*~(~(-(69/157)))));
+}
+
+TEST(ConstantFoldingTest, UsesCIntSemantics) {
+    EXPECT_EQ(fold(OpCode::PLUS, INT_MAX, 1), INT_MIN);
+    EXPECT_EQ(fold(OpCode::MINUS, INT_MIN, 1), INT_MAX);
+    EXPECT_EQ(fold(OpCode::MULT, 65536, 65536), 0);
+    EXPECT_EQ(fold(OpCode::NEGATE, INT_MIN), INT_MIN);
+    EXPECT_EQ(fold(OpCode::DIV, -7, 2), -3);
+    EXPECT_EQ(fold(OpCode::MOD, -7, 2), -1);
+    EXPECT_EQ(fold(OpCode::MOD, 7, -2), 1);
+    EXPECT_EQ(fold(OpCode::RIGHT_SHIFT, -16, 2), -4);
+    EXPECT_EQ(fold(OpCode::LEFT_SHIFT, 1, 31), INT_MIN);
+    EXPECT_EQ(fold(OpCode::COMPLEMENT, 0), -1);
+    EXPECT_EQ(fold(OpCode::NOT, 5), 0);
+    EXPECT_EQ(fold(OpCode::AND, 2, 3), 1);
+    EXPECT_EQ(fold(OpCode::OR, 0, 0), 0);
+    EXPECT_EQ(fold(OpCode::LESS, INT_MIN, 0), 1);
+    EXPECT_EQ(fold(OpCode::GREATER_EQ, -1, 0), 0);
+    EXPECT_EQ(fold(OpCode::NOT_EQUAL, 3, 3), 0);
+}
+
+TEST(ConstantFoldingTest, FoldsDivisionsBehindShortCircuits) {
+    // the folded conditions jump over both divisions, which are dropped
+    auto program = fold_program("int main() { return (1 > 2) && 5 / 0 || !(3 > 4) || 1 % 0; }");
+    auto& instructions = program.functions_[0].instructions_;
+    std::vector<OpCode> ops;
+    for (auto& instruction : instructions) {
+        ops.push_back(instruction.op_);
+    }
+    EXPECT_EQ(ops, (std::vector<OpCode>{OpCode::JUMP, OpCode::LABEL, OpCode::JUMP, OpCode::LABEL, OpCode::RETURN}));
+    EXPECT_EQ(instructions.back().src1_, Value::constant(1));
+
+    // a jump that is never taken goes away, and its label with nothing
+    // jumping there is reached by falling through
+    program = fold_program("int main() { return 2 && 4 / 0; }");
+    auto& kept = program.functions_[0].instructions_;
+    ASSERT_EQ(kept.size(), 4);
+    EXPECT_EQ(kept[0].op_, OpCode::DIV);
+    EXPECT_EQ(kept[1].op_, OpCode::LABEL);
+    EXPECT_EQ(kept[2].op_, OpCode::AND);
+    EXPECT_EQ(kept[2].src1_, Value::constant(2));
+}
+
+TEST(ConstantFoldingTest, KeepsLabelsOnlyJumpedToFromBelow) {
+    auto program = single_function({
+        {OpCode::JUMP, Value(), l(1)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::RETURN, Value(), t(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::PLUS, t(0), c(2), c(3)},
+        {OpCode::JUMP, Value(), l(0)},
+    }, 1, 2);
+    ConstantFoldingVisitor().rewrite(program);
+    // the return comes before the sum it reads
+    auto& instructions = program.functions_[0].instructions_;
+    std::vector<OpCode> ops;
+    for (auto& instruction : instructions) {
+        ops.push_back(instruction.op_);
+    }
+    EXPECT_EQ(ops, (std::vector<OpCode>{OpCode::JUMP, OpCode::LABEL, OpCode::RETURN, OpCode::LABEL, OpCode::JUMP}));
+    EXPECT_EQ(instructions[2].src1_, c(5));
+}
+
+TEST(ConstantFoldingTest, LeavesTrapsAndMaskedShiftsAlone) {
+    EXPECT_FALSE(fold(OpCode::DIV, 1, 0).has_value());
+    EXPECT_FALSE(fold(OpCode::MOD, 1, 0).has_value());
+    EXPECT_FALSE(fold(OpCode::DIV, INT_MIN, -1).has_value());
+    EXPECT_FALSE(fold(OpCode::MOD, INT_MIN, -1).has_value());
+    EXPECT_FALSE(fold(OpCode::LEFT_SHIFT, 1, 32).has_value());
+    EXPECT_FALSE(fold(OpCode::RIGHT_SHIFT, 1, -1).has_value());
+
+    // the division stays, with the folded operands propagated into it
+    auto program = fold_program("int main() { return (3 + 4) / (2 - 2) + 1; }");
+    auto& instructions = program.functions_[0].instructions_;
+    ASSERT_EQ(instructions.size(), 3);
+    EXPECT_EQ(instructions[0].op_, OpCode::DIV);
+    EXPECT_EQ(instructions[0].src1_, Value::constant(7));
+    EXPECT_EQ(instructions[0].src2_, Value::constant(0));
+    EXPECT_EQ(instructions[1].op_, OpCode::PLUS);
+    EXPECT_EQ(instructions[1].src1_, instructions[0].dst_);
+    EXPECT_EQ(instructions[1].src2_, Value::constant(1));
+    EXPECT_EQ(instructions[2].src1_, instructions[1].dst_);
+}
+
+} // namespace Optimizer
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,309 @@
+#include "gtest/gtest.h"
+#include "src/optimizer/optimizer.h"
+#include "test/tacky/tacky_test_util.h"
+#include <utility>
+#include <vector>
+
+namespace Optimizer {
+
+using Tacky::Instruction;
+using Tacky::OpCode;
+using Tacky::Value;
+using namespace Tacky::Testing;
+
+// a && (b || c), both right operands jumped over
+std::vector<Instruction> nested_short_circuits() {
+    return {
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(0)},
+        {OpCode::NEGATE, t(1), c(2)},
+        {OpCode::JUMP_IF_NOT_ZERO, Value(), t(1), l(1)},
+        {OpCode::NEGATE, t(2), c(3)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::OR, t(3), t(1), t(2)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::AND, t(4), t(0), t(3)},
+        {OpCode::RETURN, Value(), t(4)},
+    };
+}
+
+// a counter summing itself down to 0, both temporaries written twice
+std::vector<Instruction> countdown() {
+    return {
+        {OpCode::COPY, t(0), c(10)},
+        {OpCode::COPY, t(1), c(0)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(1)},
+        {OpCode::PLUS, t(1), t(1), t(0)},
+        {OpCode::MINUS, t(0), t(0), c(1)},
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::RETURN, Value(), t(1)},
+    };
+}
+
+TEST(SsaTest, ConstructionPutsPhisAtJoins) {
+    auto program = single_function(nested_short_circuits(), 5, 2);
+    SsaConstructionVisitor().rewrite(program);
+    EXPECT_EQ(program.functions_[0].temporary_count_, 7);
+    EXPECT_EQ(program.functions_[0].label_count_, 5);
+    // the predecessors of both joins get labels to key the entries by
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::LABEL, Value(), l(4)},
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(0)},
+        {OpCode::LABEL, Value(), l(2)},
+        {OpCode::NEGATE, t(1), c(2)},
+        {OpCode::JUMP_IF_NOT_ZERO, Value(), t(1), l(1)},
+        {OpCode::LABEL, Value(), l(3)},
+        {OpCode::NEGATE, t(2), c(3)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::PHI, t(5), Value(), l(2)},
+        {OpCode::PHI, t(5), t(2), l(3)},
+        {OpCode::OR, t(3), t(1), t(5)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::PHI, t(6), Value(), l(4)},
+        {OpCode::PHI, t(6), t(3), l(1)},
+        {OpCode::AND, t(4), t(0), t(6)},
+        {OpCode::RETURN, Value(), t(4)},
+    });
+
+    // uses their definitions dominate are left alone
+    auto dominated = single_function({
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(0)},
+        {OpCode::NEGATE, t(1), t(0)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::RETURN, Value(), t(0)},
+    }, 2, 1);
+    SsaConstructionVisitor().rewrite(dominated);
+    EXPECT_EQ(dominated.functions_[0].temporary_count_, 2);
+    EXPECT_EQ(dominated.functions_[0].instructions_.size(), 5);
+}
+
+TEST(SsaTest, ConstructionRenamesTemporariesWrittenAgain) {
+    auto program = single_function(countdown(), 2, 2);
+    SsaConstructionVisitor().rewrite(program);
+    EXPECT_EQ(program.functions_[0].temporary_count_, 6);
+    // the loop header joins what the entry and the back edge bring
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::LABEL, Value(), l(2)},
+        {OpCode::COPY, t(0), c(10)},
+        {OpCode::COPY, t(1), c(0)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::PHI, t(2), t(0), l(2)},
+        {OpCode::PHI, t(2), t(5), l(3)},
+        {OpCode::PHI, t(3), t(1), l(2)},
+        {OpCode::PHI, t(3), t(4), l(3)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(2), l(1)},
+        {OpCode::LABEL, Value(), l(3)},
+        {OpCode::PLUS, t(4), t(3), t(2)},
+        {OpCode::MINUS, t(5), t(2), c(1)},
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::RETURN, Value(), t(3)},
+    });
+}
+
+TEST(SsaTest, DestructionCoalescesWhatConstructionAdds) {
+    for (auto [instructions, temporaries] : {std::pair{nested_short_circuits(), 5u}, std::pair{countdown(), 2u}}) {
+        auto program = single_function(instructions, temporaries, 2);
+        SsaConstructionVisitor().rewrite(program);
+        SsaDestructionVisitor().rewrite(program);
+        expect_instructions(program.functions_[0].instructions_, instructions);
+    }
+}
+
+TEST(SsaTest, DestructionCopiesOperandsLiveAcrossTheJoin) {
+    auto program = single_function({
+        {OpCode::LABEL, Value(), l(2)},
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::NEGATE, t(1), c(2)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::PHI, t(2), t(0), l(2)},
+        {OpCode::PHI, t(2), t(1), l(1)},
+        {OpCode::PLUS, t(3), t(2), t(0)},
+        {OpCode::RETURN, Value(), t(3)},
+    }, 4, 3);
+    SsaDestructionVisitor().rewrite(program);
+    // t0 is still read after the join, so it gets copied on the jump,
+    // which needs a block of its own as the entry falls through as well
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(3)},
+        {OpCode::NEGATE, t(1), c(2)},
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(3)},
+        {OpCode::COPY, t(1), t(0)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::PLUS, t(3), t(1), t(0)},
+        {OpCode::RETURN, Value(), t(3)},
+    });
+}
+
+TEST(SsaTest, DestructionCopiesWhereSharingWouldClobber) {
+    auto program = single_function({
+        {OpCode::LABEL, Value(), l(2)},
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::NEGATE, t(1), c(2)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::NEGATE, t(3), c(3)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::PHI, t(2), c(5), l(2)},
+        {OpCode::PHI, t(2), t(1), l(1)},
+        {OpCode::RETURN, Value(), t(2)},
+    }, 4, 3);
+    SsaDestructionVisitor().rewrite(program);
+    // 5 is copied only on the jump, and t1 shares with the phi
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::NEGATE, t(1), c(2)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(3)},
+        {OpCode::NEGATE, t(3), c(3)},
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(3)},
+        {OpCode::COPY, t(1), c(5)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::RETURN, Value(), t(1)},
+    });
+}
+
+TEST(SsaTest, DestructionSwapsThroughATemporary) {
+    // each time around the loop t3 and t4 trade values
+    auto program = single_function({
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::COPY, t(0), c(1)},
+        {OpCode::COPY, t(1), c(2)},
+        {OpCode::COPY, t(2), c(5)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::PHI, t(3), t(0), l(1)},
+        {OpCode::PHI, t(3), t(4), l(0)},
+        {OpCode::PHI, t(4), t(1), l(1)},
+        {OpCode::PHI, t(4), t(3), l(0)},
+        {OpCode::PHI, t(5), t(2), l(1)},
+        {OpCode::PHI, t(5), t(6), l(0)},
+        {OpCode::MINUS, t(6), t(5), c(1)},
+        {OpCode::JUMP_IF_NOT_ZERO, Value(), t(6), l(0)},
+        {OpCode::MINUS, t(7), t(3), t(4)},
+        {OpCode::RETURN, Value(), t(7)},
+    }, 8, 2);
+    SsaDestructionVisitor().rewrite(program);
+    // the back edge is split, and the swap saves t3 before t0 overwrites it
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::COPY, t(0), c(1)},
+        {OpCode::COPY, t(1), c(2)},
+        {OpCode::COPY, t(2), c(5)},
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(2)},
+        {OpCode::COPY, t(1), t(3)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::COPY, t(3), t(0)},
+        {OpCode::COPY, t(0), t(1)},
+        {OpCode::MINUS, t(2), t(2), c(1)},
+        {OpCode::JUMP_IF_NOT_ZERO, Value(), t(2), l(2)},
+        {OpCode::MINUS, t(7), t(3), t(0)},
+        {OpCode::RETURN, Value(), t(7)},
+    });
+}
+
+TEST(SsaTest, FoldingResolvesPhisOfEdgesThatAreGone) {
+    // the jump never goes, the phi copies what falls through
+    auto program = single_function({
+        {OpCode::LABEL, Value(), l(2)},
+        {OpCode::JUMP_IF_ZERO, Value(), c(1), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::DIV, t(0), c(1), c(0)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::PHI, t(1), Value(), l(2)},
+        {OpCode::PHI, t(1), t(0), l(1)},
+        {OpCode::RETURN, Value(), t(1)},
+    }, 2, 3);
+    ConstantFoldingVisitor().rewrite(program);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::LABEL, Value(), l(2)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::DIV, t(0), c(1), c(0)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::COPY, t(1), t(0)},
+        {OpCode::RETURN, Value(), t(1)},
+    });
+
+    // the jump always goes, and what it brings is undefined
+    program = single_function({
+        {OpCode::LABEL, Value(), l(2)},
+        {OpCode::JUMP_IF_ZERO, Value(), c(0), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::DIV, t(0), c(1), c(0)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::PHI, t(1), Value(), l(2)},
+        {OpCode::PHI, t(1), t(0), l(1)},
+        {OpCode::RETURN, Value(), t(1)},
+    }, 2, 3);
+    ConstantFoldingVisitor().rewrite(program);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::LABEL, Value(), l(2)},
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::RETURN, Value(), c(0)},
+    });
+
+    // undefined or 5 may as well be 5
+    program = single_function({
+        {OpCode::LABEL, Value(), l(2)},
+        {OpCode::DIV, t(0), c(1), c(0)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::PHI, t(1), Value(), l(2)},
+        {OpCode::PHI, t(1), c(5), l(1)},
+        {OpCode::RETURN, Value(), t(1)},
+    }, 2, 3);
+    ConstantFoldingVisitor().rewrite(program);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::LABEL, Value(), l(2)},
+        {OpCode::DIV, t(0), c(1), c(0)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::RETURN, Value(), c(5)},
+    });
+}
+
+TEST(SsaTest, FoldingCarriesConstantsAroundLoops) {
+    // t0 is 5 on the way in and stays 5 coming back around
+    auto program = single_function({
+        {OpCode::COPY, t(0), c(5)},
+        {OpCode::COPY, t(1), c(3)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(1), l(1)},
+        {OpCode::MULT, t(0), t(0), c(1)},
+        {OpCode::MINUS, t(1), t(1), c(1)},
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::RETURN, Value(), t(0)},
+    }, 2, 2);
+    SsaConstructionVisitor().rewrite(program);
+    ConstantFoldingVisitor().rewrite(program);
+    expect_instructions(program.functions_[0].instructions_, {
+        {OpCode::LABEL, Value(), l(2)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::PHI, t(3), c(3), l(2)},
+        {OpCode::PHI, t(3), t(5), l(3)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(3), l(1)},
+        {OpCode::LABEL, Value(), l(3)},
+        {OpCode::MINUS, t(5), t(3), c(1)},
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::RETURN, Value(), c(5)},
+    });
+}
+
+} // namespace Optimizer
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,91 @@
+#include "src/lexer/dfa_lexer.h"
+#include "src/parser/parser.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <sys/resource.h>
+
+// Parse time and peak memory of the C AST over a generated source of
+// --size_mb megabytes, made of fuzz-shaped expressions up to --height deep.
+
+int SIZE_MB = 16, HEIGHT = 14, ROUNDS = 3, SEED = 42;
+
+long peak_rss_kb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+void append_expression(std::mt19937& rng, int height, std::string& code) {
+    auto draw = [&](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+    if (height == 0) {
+        code += std::to_string(draw(0, 200));
+        return;
+    }
+    const char* bin_ops[] = {" * ", " / ", " % ", " + ", " - ", " & ", " | ", " ^ ", " << ", " >> "};
+    if (draw(0, 2) != 1) {
+        code += "(";
+        append_expression(rng, height - 1, code);
+        code += bin_ops[draw(0, 9)];
+        append_expression(rng, height - 1, code);
+        code += ")";
+    } else {
+        code += draw(0, 1) ? "-(" : "~(";
+        append_expression(rng, height - 1, code);
+        code += ")";
+    }
+}
+
+std::string generate_source(size_t target_size) {
+    std::mt19937 rng(SEED);
+    std::string code;
+    int function_idx = 0;
+    while (code.size() < target_size) {
+        code += "int f" + std::to_string(function_idx++) + "() {\n    return ";
+        append_expression(rng, HEIGHT, code);
+        code += ";\n}\n\n";
+    }
+    return code;
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg(argv[i]);
+        if (arg.starts_with("--size_mb=")) {
+            SIZE_MB = std::stoi(std::string(arg.substr(10)));
+        } else if (arg.starts_with("--height=")) {
+            HEIGHT = std::stoi(std::string(arg.substr(9)));
+        } else if (arg.starts_with("--rounds=")) {
+            ROUNDS = std::stoi(std::string(arg.substr(9)));
+        } else if (arg.starts_with("--seed=")) {
+            SEED = std::stoi(std::string(arg.substr(7)));
+        }
+    }
+    std::string code = generate_source(static_cast<size_t>(SIZE_MB) * 1024 * 1024);
+    long rss_before = peak_rss_kb();
+    double best = 1e30, teardown = 0;
+    size_t functions = 0, arena_bytes = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        auto start = std::chrono::steady_clock::now();
+        Parser::RecursiveDescentParser parser(Lexer::DfaLexer(code).Lex());
+        auto program = parser.parse();
+        auto parsed = std::chrono::steady_clock::now();
+        functions = program.value()->functions_.size();
+        arena_bytes = program.value()->arena_.bytes_reserved();
+        program.reset();
+        auto freed = std::chrono::steady_clock::now();
+        if (std::chrono::duration<double>(parsed - start).count() < best) {
+            best = std::chrono::duration<double>(parsed - start).count();
+            teardown = std::chrono::duration<double>(freed - parsed).count();
+        }
+    }
+    std::cout << "Parsed " << code.size() << " bytes into " << functions << " functions, best of "
+              << ROUNDS << " rounds" << std::endl;
+    std::cout << "lex+parse: " << best * 1000 << " ms, free tree: " << teardown * 1000 << " ms" << std::endl;
+    std::cout << "arena: " << arena_bytes / 1024 << " KB, peak RSS growth while parsing: "
+              << (peak_rss_kb() - rss_before) << " KB" << std::endl;
+    return 0;
+}
@@ -29,8 +29,8 @@ TEST(ParserTest, SomeBinexps) {
     ASSERT_TRUE(program_opt.has_value());
     auto program = program_opt.value();
     ASSERT_EQ(program->functions_.size(), 1);
-    std::shared_ptr<CAst::FunctionNode> main_function = program->functions_[0];
-    ASSERT_EQ(main_function->name_, "main");
+    CAst::FunctionNode* main_function = program->functions_[0];
+    ASSERT_EQ(main_function->name_.str(), "main");
 
     // Assert int return type and no args
     ASSERT_EQ(main_function->type_node_->type_, CAst::Type::INTEGER);
@@ -42,7 +42,7 @@ TEST(ParserTest, SomeBinexps) {
     ASSERT_EQ(main_function->body_->statements_.size(), 1);
 
     // Assert return statement present
-    auto return_stmt = std::dynamic_pointer_cast<CAst::ReturnStatementNode>(main_function->body_->statements_[0]);
+    auto return_stmt = CAst::node_cast<CAst::ReturnStatementNode>(main_function->body_->statements_[0]);
     ASSERT_NE(return_stmt, nullptr);
 
 
@@ -54,37 +54,42 @@ TEST(ParserTest, SomeBinexps) {
     //          2 7
     // Assert return value is a - binexp, with right = 11
 
-    auto return_value = std::dynamic_pointer_cast<CAst::MinusNode>(return_stmt->return_value_);
+    auto return_value = CAst::node_cast<CAst::BinaryExpressionNode>(return_stmt->return_value_);
+    ASSERT_NE(return_value, nullptr);
+    ASSERT_EQ(return_value->op_, CAst::BinaryOperator::MINUS);
     ASSERT_NE(return_stmt, nullptr);
-    auto expected_11 = std::dynamic_pointer_cast<CAst::IntegerValueNode>(return_value->right_);
+    auto expected_11 = CAst::node_cast<CAst::IntegerValueNode>(return_value->right_);
     ASSERT_NE(expected_11, nullptr);
     ASSERT_EQ(expected_11->value_, 11);
 
     // Assert left operand is a X + 10 operation
 
-    auto plus_op = std::dynamic_pointer_cast<CAst::PlusNode>(return_value->left_);
+    auto plus_op = CAst::node_cast<CAst::BinaryExpressionNode>(return_value->left_);
     ASSERT_NE(plus_op, nullptr);
+    ASSERT_EQ(plus_op->op_, CAst::BinaryOperator::PLUS);
 
-    auto expected_10 = std::dynamic_pointer_cast<CAst::IntegerValueNode>(plus_op->right_);
+    auto expected_10 = CAst::node_cast<CAst::IntegerValueNode>(plus_op->right_);
     ASSERT_NE(expected_10, nullptr);
     ASSERT_EQ(expected_10->value_, 10);
 
     // Assert the mod Operation
 
-    auto mod_op = std::dynamic_pointer_cast<CAst::ModNode>(plus_op->left_);
+    auto mod_op = CAst::node_cast<CAst::BinaryExpressionNode>(plus_op->left_);
     ASSERT_NE(mod_op, nullptr);
-    auto expected_5 = std::dynamic_pointer_cast<CAst::IntegerValueNode>(mod_op->right_);
+    ASSERT_EQ(mod_op->op_, CAst::BinaryOperator::MOD);
+    auto expected_5 = CAst::node_cast<CAst::IntegerValueNode>(mod_op->right_);
     ASSERT_NE(expected_5, nullptr);
     ASSERT_EQ(expected_5->value_, 5);
 
     // Assert the mult operation
 
-    auto mult_op = std::dynamic_pointer_cast<CAst::MultNode>(mod_op->left_);
+    auto mult_op = CAst::node_cast<CAst::BinaryExpressionNode>(mod_op->left_);
     ASSERT_NE(mult_op, nullptr);
-    auto expected_2 = std::dynamic_pointer_cast<CAst::IntegerValueNode>(mult_op->left_);
+    ASSERT_EQ(mult_op->op_, CAst::BinaryOperator::MULT);
+    auto expected_2 = CAst::node_cast<CAst::IntegerValueNode>(mult_op->left_);
     ASSERT_NE(expected_2, nullptr);
     ASSERT_EQ(2, expected_2->value_);
-    auto expected_7 = std::dynamic_pointer_cast<CAst::IntegerValueNode>(mult_op->right_);
+    auto expected_7 = CAst::node_cast<CAst::IntegerValueNode>(mult_op->right_);
     ASSERT_NE(expected_7, nullptr);
     ASSERT_EQ(7, expected_7->value_);
 }
@@ -98,8 +103,8 @@ TEST(ParserTest, AnotherBasicProgram) {
     ASSERT_TRUE(program_opt.has_value());
     auto program = program_opt.value();
     ASSERT_EQ(program->functions_.size(), 1);
-    std::shared_ptr<CAst::FunctionNode> main_function = program->functions_[0];
-    ASSERT_EQ(main_function->name_, "main");
+    CAst::FunctionNode* main_function = program->functions_[0];
+    ASSERT_EQ(main_function->name_.str(), "main");
 
     // Assert int return type and no args
     ASSERT_EQ(main_function->type_node_->type_, CAst::Type::INTEGER);
@@ -107,23 +112,26 @@ TEST(ParserTest, AnotherBasicProgram) {
     ASSERT_EQ(main_function->body_->statements_.size(), 1);
 
     // Assert return statement present
-    auto return_stmt = std::dynamic_pointer_cast<CAst::ReturnStatementNode>(main_function->body_->statements_[0]);
+    auto return_stmt = CAst::node_cast<CAst::ReturnStatementNode>(main_function->body_->statements_[0]);
     ASSERT_NE(return_stmt, nullptr);
 
     // Assert return val is a tilde unary op
-    auto first_inner_op = std::dynamic_pointer_cast<CAst::TildeUnaryExpressionNode>(return_stmt->return_value_);
+    auto first_inner_op = CAst::node_cast<CAst::UnaryExpressionNode>(return_stmt->return_value_);
     ASSERT_NE(first_inner_op, nullptr);
+    ASSERT_EQ(first_inner_op->op_, CAst::UnaryOperator::COMPLEMENT);
 
     // Assert second inner exp is a minus unary op
-    auto second_inner_op = std::dynamic_pointer_cast<CAst::MinusUnaryExpressionNode>(first_inner_op->operand_);
+    auto second_inner_op = CAst::node_cast<CAst::UnaryExpressionNode>(first_inner_op->operand_);
     ASSERT_NE(second_inner_op, nullptr);
+    ASSERT_EQ(second_inner_op->op_, CAst::UnaryOperator::NEGATE);
 
     // Assert third inner exp is another tilde unary op
-    auto third_inner_op = std::dynamic_pointer_cast<CAst::TildeUnaryExpressionNode>(second_inner_op->operand_);
+    auto third_inner_op = CAst::node_cast<CAst::UnaryExpressionNode>(second_inner_op->operand_);
     ASSERT_NE(third_inner_op, nullptr);
+    ASSERT_EQ(third_inner_op->op_, CAst::UnaryOperator::COMPLEMENT);
 
     // Assert final inner operand is 400
-    auto inner_integer = std::dynamic_pointer_cast<CAst::IntegerValueNode>(third_inner_op->operand_);
+    auto inner_integer = CAst::node_cast<CAst::IntegerValueNode>(third_inner_op->operand_);
     ASSERT_NE(inner_integer, nullptr);
     ASSERT_EQ(inner_integer->value_, 400);
 }
@@ -135,18 +143,64 @@ TEST(ParserTest, BasicProgram) {
     ASSERT_TRUE(program_opt.has_value());
     auto program = program_opt.value();
     ASSERT_EQ(program->functions_.size(), 1);
-    std::shared_ptr<CAst::FunctionNode> main_function = program->functions_[0];
-    ASSERT_EQ(main_function->name_, "main");
+    CAst::FunctionNode* main_function = program->functions_[0];
+    ASSERT_EQ(main_function->name_.str(), "main");
     ASSERT_EQ(main_function->type_node_->type_, CAst::Type::INTEGER);
     ASSERT_EQ(main_function->arguments_node_->arguments_.size(), 0);
     ASSERT_EQ(main_function->body_->statements_.size(), 1);
-    auto return_stmt = std::dynamic_pointer_cast<CAst::ReturnStatementNode>(main_function->body_->statements_[0]);
+    auto return_stmt = CAst::node_cast<CAst::ReturnStatementNode>(main_function->body_->statements_[0]);
     ASSERT_NE(return_stmt, nullptr);
-    auto return_value = std::dynamic_pointer_cast<CAst::IntegerValueNode>(return_stmt->return_value_);
+    auto return_value = CAst::node_cast<CAst::IntegerValueNode>(return_stmt->return_value_);
     ASSERT_NE(return_value, nullptr);
     ASSERT_EQ(return_value->value_, 2);
 }
 
+TEST(ParserTest, MultipleFunctions) {
+    std::unique_ptr<Lexer::Lexer> l = std::make_unique<Lexer::ManualLexer>(
+        "int first() { return 1; }\n"
+        "int second(int a, int b) { return 2; return 3; }\n"
+        "int third() { return ~4; }\n");
+    std::unique_ptr<Parser> p = std::make_unique<RecursiveDescentParser>(std::move(l->Lex()));
+    auto program = p->parse().value();
+    ASSERT_EQ(program->functions_.size(), 3);
+    EXPECT_EQ(program->functions_[0]->name_.str(), "first");
+    EXPECT_EQ(program->functions_[1]->name_.str(), "second");
+    EXPECT_EQ(program->functions_[1]->arguments_node_->arguments_.size(), 2);
+    EXPECT_EQ(program->functions_[1]->body_->statements_.size(), 2);
+    EXPECT_EQ(program->functions_[2]->name_.str(), "third");
+}
+
+TEST(ParserTest, RelationalOperatorsBindBetweenShiftsAndBitwiseOps) {
+    // ((1 << 2) < 3 == (4 >= 5)) & 6
+    std::unique_ptr<Lexer::Lexer> l = std::make_unique<Lexer::ManualLexer>(
+        "int main() { return 1 << 2 < 3 == 4 >= 5 & 6; }");
+    std::unique_ptr<Parser> p = std::make_unique<RecursiveDescentParser>(std::move(l->Lex()));
+    auto program = p->parse().value();
+    auto return_stmt = CAst::node_cast<CAst::ReturnStatementNode>(program->functions_[0]->body_->statements_[0]);
+    ASSERT_NE(return_stmt, nullptr);
+    auto bitwise_and = CAst::node_cast<CAst::BinaryExpressionNode>(return_stmt->return_value_);
+    ASSERT_NE(bitwise_and, nullptr);
+    EXPECT_EQ(bitwise_and->op_, CAst::BinaryOperator::BITWISE_AND);
+    auto equal = CAst::node_cast<CAst::BinaryExpressionNode>(bitwise_and->left_);
+    ASSERT_NE(equal, nullptr);
+    EXPECT_EQ(equal->op_, CAst::BinaryOperator::EQUAL);
+    auto less = CAst::node_cast<CAst::BinaryExpressionNode>(equal->left_);
+    ASSERT_NE(less, nullptr);
+    EXPECT_EQ(less->op_, CAst::BinaryOperator::LESS);
+    auto shift = CAst::node_cast<CAst::BinaryExpressionNode>(less->left_);
+    ASSERT_NE(shift, nullptr);
+    EXPECT_EQ(shift->op_, CAst::BinaryOperator::LEFT_SHIFT);
+    auto greater_eq = CAst::node_cast<CAst::BinaryExpressionNode>(equal->right_);
+    ASSERT_NE(greater_eq, nullptr);
+    EXPECT_EQ(greater_eq->op_, CAst::BinaryOperator::GREATER_EQ);
+}
+
+TEST(ParserTest, UnterminatedBlockThrows) {
+    std::unique_ptr<Lexer::Lexer> l = std::make_unique<Lexer::ManualLexer>("int main() { return 1;");
+    std::unique_ptr<Parser> p = std::make_unique<RecursiveDescentParser>(std::move(l->Lex()));
+    EXPECT_THROW(p->parse(), std::runtime_error);
+}
+
 } // namespace Parser;
 
 int main(int argc, char **argv) {
@@ -0,0 +1,94 @@
+#include "gtest/gtest.h"
+#include "src/source/source_buffer.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace Source {
+
+std::string temp_file_with(const std::string& contents) {
+    auto path = std::filesystem::temp_directory_path() /
+        ("source_buffer_test_" + std::to_string(getpid()) + "_" + std::to_string(contents.size()));
+    std::ofstream out(path, std::ios::binary);
+    out << contents;
+    return path.string();
+}
+
+TEST(SourceBufferTest, RegularFilesAreMappedWithoutCopies) {
+    std::string code = "int main() {\n    return 2;\n}\n";
+    auto path = temp_file_with(code);
+    auto buffer = SourceBuffer::from_file(path);
+    EXPECT_EQ(buffer.text(), code);
+    EXPECT_TRUE(buffer.stats().mapped);
+    EXPECT_EQ(buffer.stats().bytes_read, code.size());
+    EXPECT_EQ(buffer.stats().bytes_copied, 0);
+    std::remove(path.c_str());
+}
+
+TEST(SourceBufferTest, MappingSurvivesMoves) {
+    std::string code(100000, 'x');
+    auto path = temp_file_with(code);
+    auto first = SourceBuffer::from_file(path);
+    SourceBuffer second = std::move(first);
+    auto third = SourceBuffer::from_string("y");
+    third = std::move(second);
+    EXPECT_EQ(third.text(), code);
+    std::remove(path.c_str());
+}
+
+TEST(SourceBufferTest, EmptyFileIsEmptyText) {
+    auto path = temp_file_with("");
+    auto buffer = SourceBuffer::from_file(path);
+    EXPECT_EQ(buffer.size(), 0);
+    EXPECT_EQ(buffer.text(), "");
+    std::remove(path.c_str());
+}
+
+TEST(SourceBufferTest, PipesAreStreamed) {
+    // large enough to force the stream buffer to grow a few times
+    std::string code;
+    while (code.size() < 300000) {
+        code += "int f() { return 1 + 2; }\n";
+    }
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    std::thread writer([&] {
+        size_t written = 0;
+        while (written < code.size()) {
+            ssize_t count = write(fds[1], code.data() + written, code.size() - written);
+            if (count <= 0) {
+                break;
+            }
+            written += count;
+        }
+        close(fds[1]);
+    });
+    auto buffer = SourceBuffer::from_file("/dev/fd/" + std::to_string(fds[0]));
+    writer.join();
+    close(fds[0]);
+    EXPECT_EQ(buffer.text(), code);
+    EXPECT_FALSE(buffer.stats().mapped);
+    EXPECT_EQ(buffer.stats().bytes_read, code.size());
+    EXPECT_GE(buffer.stats().bytes_copied, code.size());
+}
+
+TEST(SourceBufferTest, MissingFileThrows) {
+    EXPECT_THROW(SourceBuffer::from_file("/nonexistent/input.c"), std::runtime_error);
+}
+
+TEST(SourceBufferTest, FromStringKeepsText) {
+    auto buffer = SourceBuffer::from_string("int main() { return 0; }");
+    EXPECT_EQ(buffer.text(), "int main() { return 0; }");
+    EXPECT_EQ(buffer.size(), 24);
+    EXPECT_EQ(buffer.name(), "<string>");
+}
+
+} // namespace Source
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,51 @@
+#include "gtest/gtest.h"
+#include "src/source/symbol.h"
+#include <string>
+
+namespace Source {
+
+TEST(SymbolTest, EqualNamesShareOneId) {
+    std::string first = "counter";
+    std::string second = std::string("coun") + "ter";
+    Symbol a = Symbol::intern(first);
+    Symbol b = Symbol::intern(second);
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(a.id(), b.id());
+    EXPECT_NE(a, Symbol::intern("counters"));
+}
+
+TEST(SymbolTest, TextOutlivesTheInternedString) {
+    Symbol symbol;
+    {
+        std::string temporary = "short_lived_name";
+        symbol = Symbol::intern(temporary);
+    }
+    EXPECT_EQ(symbol.str(), "short_lived_name");
+}
+
+TEST(SymbolTest, EmptyNameIsTheDefaultSymbol) {
+    EXPECT_EQ(Symbol::intern(""), Symbol());
+    EXPECT_EQ(Symbol().str(), "");
+}
+
+TEST(SymbolTest, ManyAndOversizedNamesRoundTrip) {
+    std::vector<std::pair<std::string, Symbol>> interned;
+    for (int i = 0; i < 20000; i++) {
+        std::string name = "name_" + std::to_string(i);
+        interned.emplace_back(name, Symbol::intern(name));
+    }
+    std::string huge(100000, 'x');
+    Symbol huge_symbol = Symbol::intern(huge);
+    for (auto& [name, symbol] : interned) {
+        ASSERT_EQ(symbol.str(), name);
+        ASSERT_EQ(Symbol::intern(name), symbol);
+    }
+    EXPECT_EQ(huge_symbol.str(), huge);
+}
+
+} // namespace Source
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
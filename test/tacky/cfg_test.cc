@@ -0,0 +1,161 @@
+#include "gtest/gtest.h"
+#include "src/tacky/cfg.h"
+#include "test/tacky/tacky_test_util.h"
+#include <stdexcept>
+#include <vector>
+
+namespace Tacky {
+
+using namespace Testing;
+
+constexpr uint32_t kNoBlock = ControlFlowGraph::kNoBlock;
+
+std::vector<uint32_t> predecessors(const ControlFlowGraph& cfg, uint32_t block) {
+    auto span = cfg.predecessors(block);
+    return std::vector<uint32_t>(span.begin(), span.end());
+}
+
+TEST(CfgTest, SplitsBlocksAtLabelsAndJumps) {
+    auto diamond = function({
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(0)},
+        {OpCode::NEGATE, t(1), c(2)},
+        {OpCode::JUMP, Value(), l(1)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::RETURN, Value(), t(0)},
+        // nothing gets here
+        {OpCode::NEGATE, t(2), c(3)},
+    }, 3, 2);
+    ControlFlowGraph cfg(diamond);
+    auto& blocks = cfg.blocks();
+    ASSERT_EQ(blocks.size(), 5);
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    for (auto& block : blocks) {
+        ranges.emplace_back(block.begin_, block.end_);
+    }
+    EXPECT_EQ(ranges, (std::vector<std::pair<uint32_t, uint32_t>>{{0, 2}, {2, 4}, {4, 5}, {5, 7}, {7, 8}}));
+
+    EXPECT_EQ(blocks[0].fall_through_, 1);
+    EXPECT_EQ(blocks[0].target_, 2);
+    EXPECT_EQ(blocks[1].fall_through_, kNoBlock);
+    EXPECT_EQ(blocks[1].target_, 3);
+    EXPECT_EQ(blocks[2].fall_through_, 3);
+    EXPECT_EQ(blocks[2].target_, kNoBlock);
+    EXPECT_EQ(blocks[3].fall_through_, kNoBlock);
+    EXPECT_EQ(blocks[4].fall_through_, kNoBlock);
+
+    EXPECT_EQ(predecessors(cfg, 0), std::vector<uint32_t>{});
+    EXPECT_EQ(predecessors(cfg, 3), (std::vector<uint32_t>{1, 2}));
+    EXPECT_EQ(predecessors(cfg, 4), std::vector<uint32_t>{});
+    EXPECT_EQ(cfg.block_of(l(0)), 2);
+    EXPECT_EQ(cfg.block_of(l(1)), 3);
+    EXPECT_EQ(cfg.block_containing(3), 1);
+    EXPECT_EQ(cfg.block_containing(5), 3);
+}
+
+TEST(CfgTest, FindsDominators) {
+    auto diamond = function({
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(0)},
+        {OpCode::NEGATE, t(1), c(2)},
+        {OpCode::JUMP_IF_NOT_ZERO, Value(), t(1), l(1)},
+        {OpCode::NEGATE, t(2), c(3)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::NEGATE, t(3), c(4)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::RETURN, Value(), t(0)},
+        {OpCode::RETURN, Value(), t(1)},
+    }, 4, 2);
+    ControlFlowGraph cfg(diamond);
+    ASSERT_EQ(cfg.blocks().size(), 6);
+    EXPECT_EQ(cfg.immediate_dominator(0), kNoBlock);
+    EXPECT_EQ(cfg.immediate_dominator(1), 0);
+    EXPECT_EQ(cfg.immediate_dominator(2), 1);
+    // reached from 1 directly and through 2
+    EXPECT_EQ(cfg.immediate_dominator(3), 1);
+    EXPECT_EQ(cfg.immediate_dominator(4), 0);
+    EXPECT_EQ(cfg.immediate_dominator(5), kNoBlock);
+
+    EXPECT_TRUE(cfg.dominates(0, 4));
+    EXPECT_TRUE(cfg.dominates(1, 3));
+    EXPECT_TRUE(cfg.dominates(3, 3));
+    EXPECT_FALSE(cfg.dominates(2, 3));
+    EXPECT_FALSE(cfg.dominates(1, 4));
+    EXPECT_FALSE(cfg.dominates(0, 5));
+}
+
+TEST(CfgTest, FollowsJumpsBack) {
+    // a loop whose exit test is at the top, with a jump back to it
+    auto loop = function({
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(1)},
+        {OpCode::NEGATE, t(1), c(2)},
+        {OpCode::JUMP_IF_NOT_ZERO, Value(), t(1), l(2)},
+        {OpCode::NEGATE, t(2), c(3)},
+        {OpCode::LABEL, Value(), l(2)},
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::RETURN, Value(), t(0)},
+        // only reached from itself
+        {OpCode::LABEL, Value(), l(3)},
+        {OpCode::JUMP, Value(), l(3)},
+    }, 3, 4);
+    ControlFlowGraph cfg(loop);
+    ASSERT_EQ(cfg.blocks().size(), 7);
+    EXPECT_EQ(cfg.blocks()[4].target_, 1);
+    EXPECT_EQ(predecessors(cfg, 1), (std::vector<uint32_t>{0, 4}));
+    auto order = cfg.reverse_postorder();
+    EXPECT_EQ(std::vector<uint32_t>(order.begin(), order.end()), (std::vector<uint32_t>{0, 1, 2, 3, 4, 5}));
+    EXPECT_TRUE(cfg.reachable(4));
+    EXPECT_FALSE(cfg.reachable(6));
+
+    EXPECT_EQ(cfg.immediate_dominator(1), 0);
+    EXPECT_EQ(cfg.immediate_dominator(2), 1);
+    EXPECT_EQ(cfg.immediate_dominator(4), 2);
+    // the exit is only reached through the test at the top
+    EXPECT_EQ(cfg.immediate_dominator(5), 1);
+    EXPECT_EQ(cfg.immediate_dominator(6), kNoBlock);
+    EXPECT_TRUE(cfg.dominates(1, 4));
+    EXPECT_FALSE(cfg.dominates(4, 1));
+    EXPECT_FALSE(cfg.dominates(2, 5));
+    EXPECT_FALSE(cfg.dominates(6, 6));
+}
+
+TEST(CfgTest, PutsLoopBodiesBeforeWhatFollows) {
+    // the body comes after the exit in the instructions
+    auto rotated = function({
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::JUMP_IF_NOT_ZERO, Value(), c(1), l(1)},
+        {OpCode::RETURN, Value(), c(0)},
+    }, 1, 2);
+    ControlFlowGraph cfg(rotated);
+    ASSERT_EQ(cfg.blocks().size(), 4);
+    auto order = cfg.reverse_postorder();
+    EXPECT_EQ(std::vector<uint32_t>(order.begin(), order.end()), (std::vector<uint32_t>{0, 2, 3, 1}));
+    EXPECT_EQ(cfg.immediate_dominator(1), 2);
+    EXPECT_EQ(cfg.immediate_dominator(2), 0);
+    EXPECT_EQ(cfg.immediate_dominator(3), 2);
+    EXPECT_TRUE(cfg.dominates(2, 1));
+    EXPECT_FALSE(cfg.dominates(1, 2));
+}
+
+TEST(CfgTest, RejectsJumpsToLabelsNotPlaced) {
+    auto nowhere = function({
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::RETURN, Value(), c(0)},
+    }, 0, 1);
+    EXPECT_THROW(ControlFlowGraph{nowhere}, std::runtime_error);
+    EXPECT_TRUE(ControlFlowGraph(function({}, 0, 0)).blocks().empty());
+}
+
+} // namespace Tacky
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+#include "src/tacky/def_use.h"
+#include "test/tacky/tacky_test_util.h"
+#include <vector>
+
+namespace Tacky {
+
+using namespace Testing;
+
+std::vector<uint32_t> uses(const DefUse& def_use, uint32_t temporary) {
+    auto span = def_use.uses(temporary);
+    return std::vector<uint32_t>(span.begin(), span.end());
+}
+
+std::vector<uint32_t> definitions(const DefUse& def_use, uint32_t temporary) {
+    auto span = def_use.definitions(temporary);
+    return std::vector<uint32_t>(span.begin(), span.end());
+}
+
+TEST(DefUseTest, ChainsDefinitionsToUses) {
+    auto ssa = function({
+        {OpCode::LABEL, Value(), l(2)},
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::MULT, t(1), t(0), t(0)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::PHI, t(2), Value(), l(2)},
+        {OpCode::PHI, t(2), t(1), l(1)},
+        {OpCode::AND, t(3), t(0), t(2)},
+        {OpCode::RETURN, Value(), t(3)},
+    }, 5, 3);
+    DefUse def_use(ssa);
+    EXPECT_EQ(def_use.definition(0), 1);
+    // a phi's entries define it once
+    EXPECT_EQ(definitions(def_use, 2), (std::vector<uint32_t>{6}));
+    EXPECT_EQ(def_use.definition(4), DefUse::kNoDefinition);
+    EXPECT_EQ(uses(def_use, 0), (std::vector<uint32_t>{2, 4, 4, 8}));
+    EXPECT_EQ(uses(def_use, 1), (std::vector<uint32_t>{7}));
+    EXPECT_EQ(uses(def_use, 3), (std::vector<uint32_t>{9}));
+    EXPECT_TRUE(uses(def_use, 4).empty());
+}
+
+TEST(DefUseTest, ListsEveryDefinitionOutOfSsa) {
+    auto twice = function({
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::NEGATE, t(0), t(0)},
+        {OpCode::RETURN, Value(), t(0)},
+    }, 1);
+    DefUse def_use(twice);
+    EXPECT_EQ(def_use.definition(0), 0);
+    EXPECT_EQ(definitions(def_use, 0), (std::vector<uint32_t>{0, 1}));
+    EXPECT_EQ(uses(def_use, 0), (std::vector<uint32_t>{1, 2}));
+}
+
+} // namespace Tacky
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
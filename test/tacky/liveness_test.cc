@@ -0,0 +1,63 @@
+#include "gtest/gtest.h"
+#include "src/tacky/liveness.h"
+#include "test/tacky/tacky_test_util.h"
+#include <vector>
+
+namespace Tacky {
+
+using namespace Testing;
+
+TEST(LivenessTest, CarriesValuesAroundLoops) {
+    // t0 counts down, t1 is only read after the loop
+    auto loop = function({
+        {OpCode::COPY, t(0), c(10)},
+        {OpCode::COPY, t(1), c(0)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(1)},
+        {OpCode::MINUS, t(0), t(0), c(1)},
+        {OpCode::JUMP, Value(), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::RETURN, Value(), t(1)},
+    }, 2, 2);
+    ControlFlowGraph cfg(loop);
+    Liveness liveness(loop, cfg);
+    EXPECT_FALSE(liveness.live_in(0, 0));
+    EXPECT_TRUE(liveness.live_out(0, 0));
+    EXPECT_TRUE(liveness.live_in(1, 0));
+    EXPECT_TRUE(liveness.live_in(1, 1));
+    // the back edge brings t1 around as well
+    EXPECT_TRUE(liveness.live_out(2, 1));
+    EXPECT_TRUE(liveness.live_out(2, 0));
+    EXPECT_FALSE(liveness.live_in(3, 0));
+    EXPECT_TRUE(liveness.live_in(3, 1));
+}
+
+TEST(LivenessTest, ReadsPhiOperandsAtTheEndOfTheirEdge) {
+    auto ssa = function({
+        {OpCode::LABEL, Value(), l(2)},
+        {OpCode::NEGATE, t(0), c(1)},
+        {OpCode::JUMP_IF_ZERO, Value(), t(0), l(0)},
+        {OpCode::LABEL, Value(), l(1)},
+        {OpCode::NEGATE, t(1), c(2)},
+        {OpCode::LABEL, Value(), l(0)},
+        {OpCode::PHI, t(2), t(0), l(2)},
+        {OpCode::PHI, t(2), t(1), l(1)},
+        {OpCode::RETURN, Value(), t(2)},
+    }, 3, 3);
+    ControlFlowGraph cfg(ssa);
+    Liveness liveness(ssa, cfg);
+    // t0 only flows along the jump, t1 only along the fall through
+    EXPECT_TRUE(liveness.live_out(0, 0));
+    EXPECT_FALSE(liveness.live_in(1, 0));
+    EXPECT_TRUE(liveness.live_out(1, 1));
+    for (uint32_t t = 0; t < 3; t++) {
+        EXPECT_FALSE(liveness.live_in(2, t));
+    }
+}
+
+} // namespace Tacky
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,41 @@
+#ifndef TACKY_TEST_UTIL_H
+#define TACKY_TEST_UTIL_H
+
+#include "gtest/gtest.h"
+#include "src/tacky/tacky.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// shorthands for writing Tacky by hand in tests
+namespace Tacky::Testing {
+
+inline Value t(uint32_t id) { return Value::temporary(id); }
+inline Value c(int value) { return Value::constant(value); }
+inline Value l(uint32_t id) { return Value::label(id); }
+
+inline Function function(std::vector<Instruction> instructions, uint32_t temporary_count,
+    uint32_t label_count = 0) {
+    return Function{Source::Symbol::intern("main"), temporary_count, std::move(instructions), label_count};
+}
+
+inline Program single_function(std::vector<Instruction> instructions, uint32_t temporary_count,
+    uint32_t label_count = 0) {
+    Program program;
+    program.functions_.push_back(function(std::move(instructions), temporary_count, label_count));
+    return program;
+}
+
+inline void expect_instructions(const std::vector<Instruction>& actual, const std::vector<Instruction>& expected) {
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); i++) {
+        EXPECT_EQ(actual[i].op_, expected[i].op_) << "instruction " << i;
+        EXPECT_EQ(actual[i].dst_, expected[i].dst_) << "instruction " << i;
+        EXPECT_EQ(actual[i].src1_, expected[i].src1_) << "instruction " << i;
+        EXPECT_EQ(actual[i].src2_, expected[i].src2_) << "instruction " << i;
+    }
+}
+
+} // namespace Tacky::Testing
+
+#endif // TACKY_TEST_UTIL_H